@@ -0,0 +1,108 @@
+"""
+Telemetry encoding benchmark: JSON vs. compact binary (telemetry_codec.py).
+
+For one representative payload per node type, reports
+  * payload bytes and MQTT PUBLISH frame bytes (fixed header + topic + payload)
+    for both encodings — what actually crosses the 2.4 GHz hotspot channel,
+  * per-message decode cost on this machine: json.loads vs. telemetry_codec.decode.
+
+Run on the Pi for representative decode numbers:
+
+    cd broker && python3 bench_telemetry.py [--iterations N]
+"""
+
+import argparse
+import json
+import time
+
+import telemetry_codec
+
+# A synced stamp (wr_time.h), as every payload carries one.
+TS_MS = 1760612345678
+SEQ   = 8123
+
+# Firmware defaults for a node of each type (same values the nodes boot with).
+SAMPLES = {
+    "utility_a": ("UTILITY", {
+        "v_out": 230.0, "freq_hz": 60.0, "load_pct": 12, "state": "GRID_OK",
+        "voltage_kv": 230.0, "phase": 3}),
+    "hv_mv_transformer_a": ("HV_MV_TRANSFORMER", {
+        "input_kv": 230.0, "output_kv": 35, "load_pct": 35, "power_mva": 17.5,
+        "temp_f": 105, "state": "NORMAL", "voltage": 35000}),
+    "mv_switchgear_a": ("MV_SWITCHGEAR", {
+        "breaker": True, "current_a": 116.0, "load_kw": 4000.0, "load_pct": 25,
+        "state": "CLOSED", "voltage": 34500}),
+    "mv_lv_transformer_a": ("MV_LV_TRANSFORMER", {
+        "load_pct": 45, "power_kva": 450.0, "temp_f": 112, "state": "NORMAL",
+        "voltage": 480}),
+    "lv_switchgear_a": ("LV_SWITCHGEAR", {
+        "breaker": True, "current_a": 625.0, "load_kw": 300.0, "load_pct": 30,
+        "state": "CLOSED", "voltage": 480}),
+    "generator_a": ("GENERATOR", {
+        "fuel_pct": 85, "rpm": 0, "output_v": 0.0, "load_pct": 0,
+        "state": "STANDBY", "voltage": 480}),
+    "ups_a": ("UPS", {
+        "battery_pct": 100, "load_pct": 40, "input_v": 480.0, "output_v": 480.0,
+        "state": "NORMAL", "voltage": 480}),
+    "cooling_a": ("COOLING", {
+        "input_v": 480.0, "coolant_temp_f": 65, "fan_speed_pct": 60, "fan_count": 55,
+        "fans_running": 55, "load_pct": 60, "state": "NORMAL", "voltage": 480}),
+    "server_rack_a1": ("SERVER_RACK", {
+        "cpu_pct": 42, "inlet_f": 75, "power_kw": 3.2, "units": 8,
+        "state": "NORMAL", "voltage": 48}),
+}
+
+
+def mqtt_frame_bytes(topic, payload_len):
+    """QoS 0 PUBLISH: 1 B type + varint remaining length + 2 B topic length +
+    topic + payload."""
+    remaining = 2 + len(topic) + payload_len
+    varint = 1 if remaining < 128 else 2
+    return 1 + varint + remaining
+
+
+def per_message_us(fn, arg, iterations):
+    t0 = time.perf_counter()
+    for _ in range(iterations):
+        fn(arg)
+    return (time.perf_counter() - t0) / iterations * 1e6
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    ap.add_argument("--iterations", type=int, default=50000)
+    args = ap.parse_args()
+
+    hdr = (f"{'node':<20} {'json B':>7} {'bin B':>6} {'ratio':>6} "
+           f"{'frame json':>10} {'frame bin':>9} {'loads us':>9} {'decode us':>9}")
+    print(hdr)
+    print("-" * len(hdr))
+
+    tot = {"json": 0, "bin": 0, "fj": 0, "fb": 0, "tj": 0.0, "tb": 0.0}
+    for node_id, (ntype, fields) in SAMPLES.items():
+        stamp = {"ts": telemetry_codec.format_ts_ms(TS_MS), "ts_ms": TS_MS, "ts_err_us": 840,
+                 "seq": SEQ}
+        js = json.dumps({**stamp, **fields}, separators=(",", ":")).encode()
+        bn = telemetry_codec.encode(ntype, fields, ts_ms=TS_MS, ts_err_us=840, seq=SEQ)
+        assert telemetry_codec.decode(bn) == json.loads(js), node_id
+
+        fj = mqtt_frame_bytes(f"winter-river/{node_id}/status", len(js))
+        fb = mqtt_frame_bytes(f"winter-river/{node_id}/status/bin", len(bn))
+        tj = per_message_us(json.loads, js, args.iterations)
+        tb = per_message_us(telemetry_codec.decode, bn, args.iterations)
+
+        print(f"{node_id:<20} {len(js):>7} {len(bn):>6} {len(js) / len(bn):>5.1f}x "
+              f"{fj:>10} {fb:>9} {tj:>9.2f} {tb:>9.2f}")
+        for k, v in (("json", len(js)), ("bin", len(bn)), ("fj", fj), ("fb", fb),
+                     ("tj", tj), ("tb", tb)):
+            tot[k] += v
+
+    n = len(SAMPLES)
+    print("-" * len(hdr))
+    print(f"{'mean':<20} {tot['json'] / n:>7.0f} {tot['bin'] / n:>6.0f} "
+          f"{tot['json'] / tot['bin']:>5.1f}x {tot['fj'] / n:>10.0f} {tot['fb'] / n:>9.0f} "
+          f"{tot['tj'] / n:>9.2f} {tot['tb'] / n:>9.2f}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,155 @@
+"""
+Control-path latency — broker side of esp32-nodes/lib/winter_river/src/wr_latency.h.
+
+Every control string the engine sends gets two trailing tokens:
+
+    INPUT:480.0 STATUS:NORMAL SEQ:8123 T:51234567
+
+SEQ counts the commands sent to each node (1, 2, 3, ... per node, so the node
+can tell a dropped one; link_loss.py), T the broker's send time on its own
+monotonic millisecond clock (mod 2**31 so it fits the firmware's long). The
+node times the message (received → applied) and echoes the newest applied
+command in each JSON telemetry payload:
+
+    "ctl_seq":8123,"ctl_t":51234567,"ctl_apply_us":142,"ctl_age_ms":3810
+
+When that payload arrives, observe() splits the round trip into stages, all
+in ms and all measured on one clock each (no broker ↔ node clock sync):
+
+    total     broker send → telemetry reflecting it arrives back
+    apply     node: MQTT callback → node handler done (ctl_apply_us)
+    wait      node: applied → payload built (ctl_age_ms; mostly the
+              telemetry interval in periodic mode)
+    transit   total − apply − wait: broker → Mosquitto → WiFi → node plus
+              node → Mosquitto → broker, i.e. the network path both ways
+
+Each stage goes into a per-node log-bucketed histogram; report() returns
+p50/p95/p99 per node for the window since the previous report and starts a
+new one. An echo is counted once (by SEQ) and only if this broker run sent
+that SEQ/T pair to that node, so a node still echoing a command from before
+a broker restart is ignored rather than producing a garbage sample.
+"""
+
+import math
+import time
+from collections import OrderedDict, defaultdict
+
+CLOCK_MOD = 2 ** 31
+
+# Log-spaced buckets: BUCKETS_PER_OCTAVE per doubling from MIN_MS (~19 %
+# wide, so a reported percentile is within ~10 % of the true sample), last
+# bucket open-ended. 0.05 ms .. ~52 s covers a µs-scale apply stage and a
+# multi-second telemetry wait alike.
+MIN_MS             = 0.05
+BUCKETS_PER_OCTAVE = 4
+N_BUCKETS          = 80
+
+STAGES      = ("total", "transit", "apply", "wait")
+PERCENTILES = ((50, 0.50), (95, 0.95), (99, 0.99))
+
+# Sent SEQ/T pairs remembered per node. The broker re-sends every tick, so
+# this covers echoes up to ~2 min old at 1 Hz — longer than a node waits
+# between telemetry publishes, on-change keyframes included.
+SENT_HISTORY = 128
+
+
+def clock_ms():
+    """The T stamp clock: monotonic ms, wrapped to 31 bits."""
+    return int(time.monotonic() * 1000) % CLOCK_MOD
+
+
+class Histogram:
+    """Fixed log-bucket latency histogram (ms)."""
+
+    def __init__(self):
+        self.counts = [0] * N_BUCKETS
+        self.n = 0
+
+    @staticmethod
+    def bucket(ms):
+        if ms <= MIN_MS:
+            return 0
+        idx = math.ceil(math.log2(ms / MIN_MS) * BUCKETS_PER_OCTAVE)
+        return min(idx, N_BUCKETS - 1)
+
+    @staticmethod
+    def upper_bound(idx):
+        return MIN_MS * 2 ** (idx / BUCKETS_PER_OCTAVE)
+
+    def add(self, ms):
+        self.counts[self.bucket(max(0.0, ms))] += 1
+        self.n += 1
+
+    def percentile(self, q):
+        """Upper bound of the bucket holding the q-quantile, or None if empty."""
+        if not self.n:
+            return None
+        rank = max(1, math.ceil(q * self.n))
+        seen = 0
+        for idx, c in enumerate(self.counts):
+            seen += c
+            if seen >= rank:
+                return self.upper_bound(idx)
+        return self.upper_bound(N_BUCKETS - 1)
+
+
+class ControlLatency:
+    """Stamps outgoing control strings and aggregates the echoed timings."""
+
+    def __init__(self, clock=clock_ms):
+        self._clock = clock
+        self._seq = defaultdict(int)              # node_id → last SEQ sent
+        self._sent = defaultdict(OrderedDict)     # node_id → {seq: t}
+        self._last_seq = {}                       # node_id → last counted echo
+        self._hist = defaultdict(lambda: {s: Histogram() for s in STAGES})
+
+    def stamp(self, node_id, cmd):
+        """Return `cmd` with SEQ:/T: appended and remember the pair."""
+        seq = self._seq[node_id] % (CLOCK_MOD - 1) + 1
+        self._seq[node_id] = seq
+        t = self._clock()
+        sent = self._sent[node_id]
+        sent[seq] = t
+        if len(sent) > SENT_HISTORY:
+            sent.popitem(last=False)
+        return f"{cmd} SEQ:{seq} T:{t}"
+
+    def observe(self, node_id, payload):
+        """Record the control echo in one decoded telemetry payload.
+        Returns True if it produced a new sample."""
+        seq = payload.get("ctl_seq")
+        if not isinstance(seq, int) or seq == self._last_seq.get(node_id):
+            return False
+        t = self._sent.get(node_id, {}).get(seq)
+        if t is None or payload.get("ctl_t") != t:
+            return False
+        apply_us = payload.get("ctl_apply_us")
+        wait_ms  = payload.get("ctl_age_ms")
+        if not isinstance(apply_us, (int, float)) or not isinstance(wait_ms, (int, float)):
+            return False
+        self._last_seq[node_id] = seq
+
+        total = (self._clock() - t) % CLOCK_MOD
+        apply_ms = apply_us / 1000.0
+        h = self._hist[node_id]
+        h["total"].add(total)
+        h["apply"].add(apply_ms)
+        h["wait"].add(wait_ms)
+        h["transit"].add(total - apply_ms - wait_ms)
+        return True
+
+    def report(self):
+        """{node_id: {"n": .., "<stage>_p50_ms": .., ...}} for nodes with
+        samples in this window, then start a new window."""
+        out = {}
+        for node_id, h in sorted(self._hist.items()):
+            n = h["total"].n
+            if not n:
+                continue
+            row = {"n": n}
+            for stage in STAGES:
+                for label, q in PERCENTILES:
+                    row[f"{stage}_p{label}_ms"] = round(h[stage].percentile(q), 2)
+            out[node_id] = row
+        self._hist.clear()
+        return out
@@ -0,0 +1,179 @@
+"""
+Link loss accounting — broker side of esp32-nodes/lib/winter_river/src/wr_seq.h.
+
+Both directions carry a per-sender sequence number, starting at 1:
+
+    broker → node   SEQ:<n> on every control message, per node (control_latency.py)
+    node → broker   "seq":<n> in every telemetry payload (or the binary header)
+
+Control goes out at QoS 0, so these are the only way to see what the link
+drops. SeqTracker below is the firmware's wr::SeqTracker, line for line; keep
+the two in step. The node runs one over the control it applied and reports
+its counters, cumulative since boot, in every JSON payload:
+
+    "ctl_rx":8123,"ctl_lost":4,"ctl_dup":0,"ctl_reord":1
+
+LinkLoss runs one tracker per node over the telemetry and turns the node's
+control counters into deltas (the first payload after a broker start is the
+baseline; counters going backwards mean the node rebooted). report() returns
+both directions per node for the window since the previous report, and
+summary() the fleet-wide loss rates of the last reported window, for
+winter-river/facility/status.
+
+Records a node kept through an outage and backfilled later (wr_backfill.h)
+fill the gap the outage left: backfilled() counts them as reordered.
+"""
+
+from collections import defaultdict
+
+WINDOW = 32
+
+COUNTERS = ("rx", "lost", "dup", "reord")
+
+# Node-reported control counters, in COUNTERS order (wr_telemetry.h).
+CONTROL_FIELDS = ("ctl_rx", "ctl_lost", "ctl_dup", "ctl_reord")
+
+
+class SeqTracker:
+    """Gap / duplicate / reorder counters over one sender's numbers."""
+
+    def __init__(self):
+        self.started = False
+        self.high = 0
+        self.seen = 0            # bit i: high - i arrived
+        self.received = 0
+        self.lost = 0
+        self.duplicates = 0
+        self.reordered = 0
+        self.restarts = 0
+
+    def observe(self, seq):
+        """Count one arrival. Returns "first", "in_order", "gap",
+        "duplicate", "reordered" or "restart"."""
+        if not self.started or seq == 1 or seq + WINDOW <= self.high:
+            kind = "restart" if self.started else "first"
+            if self.started:
+                self.restarts += 1
+            self.started = True
+            self.high = seq
+            self.seen = (1 << WINDOW) - 1     # nothing below the first number is owed
+            self.received += 1
+            return kind
+        if seq > self.high:
+            d = seq - self.high
+            self.lost += d - 1
+            self.seen = 1 if d >= WINDOW else ((self.seen << d) | 1) & ((1 << WINDOW) - 1)
+            self.high = seq
+            self.received += 1
+            return "in_order" if d == 1 else "gap"
+        bit = 1 << (self.high - seq)
+        if self.seen & bit:
+            self.duplicates += 1
+            return "duplicate"
+        self.seen |= bit
+        self.lost -= 1
+        self.reordered += 1
+        self.received += 1
+        return "reordered"
+
+    def counters(self):
+        return (self.received, self.lost, self.duplicates, self.reordered)
+
+
+def loss_pct(rx, lost):
+    """Lost share of the messages sent, or None with nothing to go on."""
+    sent = rx + lost
+    return round(100.0 * lost / sent, 2) if sent else None
+
+
+def _delta(now, then):
+    return tuple(a - b for a, b in zip(now, then))
+
+
+class LinkLoss:
+    """Per-node telemetry and control loss, reported in windows."""
+
+    def __init__(self):
+        self._telemetry = defaultdict(SeqTracker)
+        self._telemetry_reported = {}                 # node_id → counters at last report
+        self._control_last = {}                       # node_id → last node-reported counters
+        self._control = defaultdict(lambda: (0, 0, 0, 0))   # node_id → this window
+        self._summary = {"telemetry_loss_pct": None, "control_loss_pct": None}
+
+    def observe(self, node_id, payload):
+        """Account one decoded telemetry payload."""
+        seq = payload.get("seq")
+        if isinstance(seq, int) and not isinstance(seq, bool) and seq > 0:
+            self._telemetry[node_id].observe(seq)
+
+        ctl = tuple(payload.get(f) for f in CONTROL_FIELDS)
+        if not all(isinstance(v, int) and not isinstance(v, bool) for v in ctl):
+            return
+        last = self._control_last.get(node_id)
+        self._control_last[node_id] = ctl
+        if last is None:
+            return                                     # baseline
+        step = ctl if any(a < b for a, b in zip(ctl, last)) else _delta(ctl, last)
+        self._control[node_id] = tuple(a + b for a, b in zip(self._control[node_id], step))
+
+    def backfilled(self, node_id, seq):
+        """Account one telemetry record a node kept through an outage and
+        sent late on /backfill (wr_backfill.h). Its number is usually below
+        the live stream's by then, and was counted lost: it counts as
+        reordered instead, however far back (not only within WINDOW, and
+        without SeqTracker's restart rule, which would rewind the tracker)."""
+        if not isinstance(seq, int) or isinstance(seq, bool) or seq <= 0:
+            return
+        tracker = self._telemetry[node_id]
+        if not tracker.started or seq > tracker.high:
+            tracker.observe(seq)
+            return
+        d = tracker.high - seq
+        if d < WINDOW:
+            bit = 1 << d
+            if tracker.seen & bit:
+                tracker.duplicates += 1
+                return
+            tracker.seen |= bit
+        elif tracker.lost <= 0:
+            return                                     # never owed: a resent batch
+        tracker.lost -= 1
+        tracker.reordered += 1
+        tracker.received += 1
+
+    def report(self):
+        """{node_id: {"telemetry_rx": .., ..., "telemetry_loss_pct": ..,
+        "control_rx": .., ..., "control_loss_pct": ..}} for nodes heard from
+        in this window, then start a new window."""
+        out = {}
+        totals = {"telemetry": [0, 0], "control": [0, 0]}
+        for node_id in sorted(set(self._telemetry) | set(self._control)):
+            row = {}
+            for direction, counts in (("telemetry", self._telemetry_window(node_id)),
+                                      ("control", self._control.get(node_id))):
+                if counts is None or not any(counts):
+                    continue
+                rx, lost = counts[0], max(0, counts[1])
+                for name, v in zip(COUNTERS, (rx, lost) + tuple(counts[2:])):
+                    row[f"{direction}_{name}"] = v
+                row[f"{direction}_loss_pct"] = loss_pct(rx, lost)
+                totals[direction][0] += rx
+                totals[direction][1] += lost
+            if row:
+                out[node_id] = row
+        self._control.clear()
+        self._summary = {f"{d}_loss_pct": loss_pct(*t) for d, t in totals.items()}
+        return out
+
+    def summary(self):
+        """Fleet-wide loss rates of the last reported window."""
+        return dict(self._summary)
+
+    def _telemetry_window(self, node_id):
+        tracker = self._telemetry.get(node_id)
+        if tracker is None:
+            return None
+        now = tracker.counters()
+        then = self._telemetry_reported.get(node_id, (0, 0, 0, 0))
+        self._telemetry_reported[node_id] = now
+        return _delta(now, then)
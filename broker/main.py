@@ -24,7 +24,12 @@ import psycopg2
 import toml
 from psycopg2.extras import RealDictCursor
 
+import telemetry_codec
+import tick_frame
+from control_latency import ControlLatency
+from link_loss import LinkLoss
 from thermal import WEATHER_PRESETS, ThermalConfig, compute_thermal, resolve_weather
+from time_sync import TimeResponder
 
 try:
     from influxdb_client import InfluxDBClient, Point
@@ -85,12 +90,22 @@ _cfg = _load_config()
 
 MQTT_BROKER = _cfg["mqtt"]["broker_host"]
 MQTT_PORT   = _cfg["mqtt"]["broker_port"]
+CONTROL_QOS = _cfg["mqtt"].get("control_qos", 0)
+TICK_FRAME  = _cfg["mqtt"].get("tick_frame", False)
 DB_CONFIG   = _cfg["database"]["dsn"]
 TICK_RATE   = _cfg.get("simulation", {}).get("tick_rate", 1.0)
 
 # Generator startup delay in simulation ticks (1 tick = 1 s at default tick rate)
 GEN_STARTUP_TICKS = 10
 
+# Outage cascade → fleet-wide telemetry burst (esp32-nodes wr_rate.h). A tick
+# that changes the computed status of at least CASCADE_MIN_CHANGES nodes adds
+# BURST:<BURST_WINDOW_MS> to every control string it sends, so every node
+# reports at its burst rate while the event plays out, not only the nodes
+# whose own state changed. Each further such tick extends the window.
+CASCADE_MIN_CHANGES = 3
+BURST_WINDOW_MS     = 10000
+
 # Weather starts deterministically at this preset on every broker boot. Runtime
 # changes arrive over MQTT (winter-river/weather/control) and are never persisted
 # — a restart always returns here regardless of the last command. The TOML
@@ -100,7 +115,7 @@ DEFAULT_WEATHER_PRESET = 1
 
 # Status topics published by the broker for Telegraf/Grafana. They intentionally
 # are not rows in the DB topology and must not be treated as ESP32 telemetry.
-VIRTUAL_STATUS_NODE_IDS = {"facility", "weather"}
+VIRTUAL_STATUS_NODE_IDS = {"facility", "weather", "broker"}
 
 # Common environment variable names used by setup scripts and service defaults.
 INFLUX_TOKEN_ENV_VARS = ("INFLUXDB_TOKEN", "INFLUX_TOKEN", "INFLUXDB_ADMIN_TOKEN")
@@ -108,8 +123,39 @@ INFLUX_TOKEN_ENV_VARS = ("INFLUXDB_TOKEN", "INFLUX_TOKEN", "INFLUXDB_ADMIN_TOKEN
 # Mark a node OFFLINE if no telemetry arrives in this window. Covers silent
 # ESP32 hangs that don't fire the MQTT LWT — telemetry interval is 5 s, so
 # 3 missed cycles + slack catches a hung node without flapping under jitter.
+# A node's RATE: control token cannot set its interval above 15 s (RATE_MAX_MS
+# in wr_rate.h), so it stays inside this threshold.
+# Nodes in on-change mode (wr_deadband.h) still send a keyframe every 3
+# intervals (15 s); keep WR_KEYFRAME_INTERVALS × 5 s below this threshold.
 STALE_NODE_THRESHOLD_SEC = 20
 
+# A message from a node_id missing from the nodes table re-reads the table
+# (re-running init_db.sql needs no restart), at most once per this many
+# seconds, so an unprovisioned board (<type>_<mac>) publishing at telemetry
+# rate costs no more than that. Each unknown id is logged once.
+UNKNOWN_NODE_RELOAD_SEC = 30
+
+# Per-node control latency percentiles (control_latency.py) are published on
+# winter-river/<node_id>/latency once per window of this length.
+LATENCY_REPORT_SEC = 60
+
+# Per-node telemetry / control loss (link_loss.py) is published on
+# winter-river/<node_id>/loss once per window of this length; the fleet-wide
+# rates of the latest window ride on winter-river/facility/status.
+LOSS_REPORT_SEC = 60
+
+# Engine load counters (cumulative since start) published every tick on
+# winter-river/broker/status, for capacity runs with esp32-nodes/loadgen.
+# tick_overruns counts ticks whose own work (tick_ms: simulation, control
+# fan-out, writes) took longer than TICK_RATE. It measures the work only:
+# the main loop sleeps TICK_RATE after every tick, so ticks are always
+# TICK_RATE + tick_ms apart.
+BROKER_STATUS_TOPIC = "winter-river/broker/status"
+
+# Retained per-node upstream neighbours for the firmware's peer fast path
+# (esp32-nodes wr_peer.h), from nodes.parent_id / secondary_parent_id.
+TOPOLOGY_TOPIC = "winter-river/{}/topology"
+
 logging.basicConfig(
     level=logging.INFO,
     format="%(asctime)s [%(levelname)s] %(message)s",
@@ -117,6 +163,17 @@ logging.basicConfig(
 log = logging.getLogger("winter-river")
 
 
+def topology_blob(parent_id, secondary_parent_id):
+    """Control-token blob naming a node's upstream neighbours, e.g.
+    "PARENT:mv_lv_transformer_a SECONDARY:generator_a". Empty for a root."""
+    parts = []
+    if parent_id:
+        parts.append(f"PARENT:{parent_id}")
+    if secondary_parent_id:
+        parts.append(f"SECONDARY:{secondary_parent_id}")
+    return " ".join(parts)
+
+
 def _resolve_influx_token(icfg):
     """Resolve an InfluxDB token from env first, then config fallback."""
     configured = icfg.get("token_env")
@@ -170,6 +227,11 @@ class WinterRiverEngine:
         except Exception as exc:
             log.warning("MQTT setup failed (%s) — will retry in background", exc)
 
+        # Fleet time sync for the nodes' ts_ms stamps (time_sync.py). Own MQTT
+        # connection, so replies never queue behind ingest on this client.
+        self._time_responder = TimeResponder(MQTT_BROKER, MQTT_PORT)
+        self._time_responder.start()
+
         self._thermal_cfg = ThermalConfig.from_mapping(_cfg.get("thermal"))
         # Always boot at the default preset (not config-driven) so every broker
         # start is deterministic; operators change weather at runtime via MQTT
@@ -181,8 +243,39 @@ class WinterRiverEngine:
         # Static topology cache — populated from `nodes` at startup. The set is
         # rebuilt on a cache miss in on_message so re-running init_db.sql
         # mid-session takes effect without a broker restart. Avoids one SELECT
-        # per inbound telemetry packet.
+        # per inbound telemetry packet. The same query yields each node's
+        # retained topology blob (TOPOLOGY_TOPIC) and tick-frame slot
+        # (tick_frame.py).
         self._known_nodes = self._load_known_nodes()
+        self._known_loaded_at = time.monotonic()
+        self._unknown_nodes = set()           # ids already logged as unknown
+        self._publish_topology(self.mqtt_client)
+
+        # Last JSON republished on <node>/status for each binary-telemetry node
+        # (see _republish_status). on_message skips exactly that payload when
+        # it loops back, so a binary message is ingested once, not twice.
+        self._bin_echo = {}
+
+        # SEQ:/T: stamps on outgoing control and the per-node latency
+        # histograms built from the nodes' echoes (control_latency.py).
+        self._control_latency = ControlLatency()
+        self._latency_reported_at = time.monotonic()
+
+        # Sequence-number loss accounting, both directions (link_loss.py).
+        self._link_loss = LinkLoss()
+        self._loss_reported_at = time.monotonic()
+
+        # Cumulative ingest / fan-out / tick counters (BROKER_STATUS_TOPIC).
+        # on_message runs on the paho thread, the tick on the main thread;
+        # each counter has a single writer.
+        self._load = {"ingested": 0, "rejected": 0, "controls": 0,
+                      "ticks": 0, "tick_overruns": 0}
+
+        # Number of the last tick frame sent (tick_frame.py).
+        self._tick_seq = 0
+
+        # Each node's computed status on the previous tick, for _cascade().
+        self._prev_status = None
 
         # Live fan-bank counts reported by cooling_a / cooling_b telemetry.
         # Default = nominal so the first tick (before any telemetry arrives)
@@ -231,28 +324,83 @@ class WinterRiverEngine:
         if rc == 0:
             log.info("MQTT connected to %s:%d", MQTT_BROKER, MQTT_PORT)
             client.subscribe("winter-river/+/status", qos=1)
+            # Compact binary telemetry from nodes built/switched to it
+            # (telemetry_codec.py; esp32-nodes wr_telemetry.h).
+            client.subscribe("winter-river/+/status/bin", qos=1)
+            # Telemetry nodes kept while their link was down, sent late
+            # (esp32-nodes wr_backfill.h).
+            client.subscribe("winter-river/+/backfill", qos=1)
             # Operator weather control (thermal-only; weather is not a DB node).
             client.subscribe("winter-river/weather/control", qos=1)
+            self._publish_topology(client)
         else:
             log.warning("MQTT connect failed (rc=%d) — will retry", rc)
 
+    def _publish_topology(self, client):
+        """Publish every node's topology blob and tick-frame slot, retained. On
+        each connect (the firmware subscribes on its own), and after the cache
+        is (re)loaded. on_connect can fire before __init__ has loaded the
+        cache."""
+        for node_id, blob in sorted(getattr(self, "_topology", {}).items()):
+            client.publish(TOPOLOGY_TOPIC.format(node_id), blob, qos=1, retain=True)
+        slots = getattr(self, "_slots", None)
+        for node_id in slots.ids if slots else ():
+            client.publish(tick_frame.SLOT_TOPIC.format(node_id), slots.assignment(node_id),
+                           qos=1, retain=True)
+
     # ── MQTT ingestion ────────────────────────────────────────────────────────
 
     def _load_known_nodes(self):
-        """Return the set of seeded node_ids. Empty set in no-DB mode."""
+        """Return the set of seeded node_ids. Empty set in no-DB mode.
+        Also refreshes self._topology, the per-node topology blobs, and
+        self._slots, the tick-frame slot map (_load_slots)."""
         if self.db is None:
             return set()
         try:
             with self.db.cursor() as cur:
-                cur.execute("SELECT node_id FROM nodes")
-                ids = {row["node_id"] for row in cur.fetchall()}
+                cur.execute("SELECT node_id, parent_id, secondary_parent_id FROM nodes")
+                rows = cur.fetchall()
+            self._topology = {
+                row["node_id"]: topology_blob(row["parent_id"], row["secondary_parent_id"])
+                for row in rows
+            }
+            ids = set(self._topology)
             log.info("Topology cache loaded: %d nodes", len(ids))
-            return ids
         except Exception as exc:
             log.warning("Failed to load topology cache: %s", exc)
             try: self.db.rollback()
             except Exception: pass
             return set()
+        self._load_slots(ids)
+        return ids
+
+    def _reload_known_nodes(self):
+        """Re-read the known nodes after a miss, unless that was done less
+        than UNKNOWN_NODE_RELOAD_SEC ago. Republishes the topology blobs if
+        they changed."""
+        now = time.monotonic()
+        if now - self._known_loaded_at < UNKNOWN_NODE_RELOAD_SEC:
+            return
+        self._known_loaded_at = now
+        topology = getattr(self, "_topology", {})
+        self._known_nodes = self._load_known_nodes()
+        self._unknown_nodes -= self._known_nodes
+        if getattr(self, "_topology", {}) != topology:
+            self._publish_topology(self.mqtt_client)
+
+    def _load_slots(self, ids):
+        """Set self._slots for `ids` with mqtt.tick_frame, else None. A fleet
+        too large for one frame (tick_frame.py) keeps per-node control; that is
+        logged once, not on every reload."""
+        self._slots = None
+        if not TICK_FRAME:
+            return
+        try:
+            self._slots = tick_frame.SlotMap(ids)
+        except ValueError as exc:
+            if not getattr(self, "_slots_warned", False):
+                log.warning("Tick frame off: %s; sending per-node control", exc)
+                self._slots_warned = True
 
     def on_message(self, client, userdata, msg):
         """Update live_status and historical_data from ESP32 MQTT telemetry."""
@@ -263,6 +411,8 @@ class WinterRiverEngine:
             return
 
         parts = msg.topic.split("/")
+        is_binary = len(parts) == 4 and parts[2] == "status" and parts[3] == "bin"
+        is_backfill = len(parts) == 3 and parts[2] == "backfill"
         if (
             len(parts) == 3
             and parts[0] == "winter-river"
@@ -271,6 +421,12 @@ class WinterRiverEngine:
         ):
             return
 
+        # Our own JSON republish of a binary message looping back — already
+        # ingested from /status/bin. A plain bytes compare, no json.loads.
+        if (not is_binary and not is_backfill and len(parts) > 1
+                and self._bin_echo.get(parts[1]) == msg.payload):
+            return
+
         # No DB → no node_id validation possible → drop the message.
         if self.db is None:
             return
@@ -278,22 +434,42 @@ class WinterRiverEngine:
             node_id = parts[1]
 
             # Reject messages from node_ids not in the topology cache. On miss,
-            # refresh the cache once (covers re-seeding mid-session) before
-            # rejecting — avoids needing a broker restart when init_db.sql runs.
+            # refresh the cache (covers re-seeding mid-session), at most every
+            # UNKNOWN_NODE_RELOAD_SEC, before rejecting — avoids needing a
+            # broker restart when init_db.sql runs.
             if node_id not in self._known_nodes:
-                self._known_nodes = self._load_known_nodes()
+                self._reload_known_nodes()
                 if node_id not in self._known_nodes:
-                    log.warning(
-                        "Ignoring MQTT message from unknown node_id %r (topic: %s). "
-                        "Is legacy firmware flashed? Run init_db.sql to add new nodes.",
-                        node_id, msg.topic,
-                    )
+                    self._load["rejected"] += 1
+                    if node_id not in self._unknown_nodes:
+                        self._unknown_nodes.add(node_id)
+                        log.warning(
+                            "Ignoring MQTT messages from unknown node_id %r (topic: %s). "
+                            "Is legacy firmware flashed, or the board unprovisioned? "
+                            "Run init_db.sql to add new nodes.",
+                            node_id, msg.topic,
+                        )
                     return
 
-            try:
-                payload = json.loads(msg.payload)
-            except (json.JSONDecodeError, UnicodeDecodeError):
-                payload = {"status": "ONLINE"}
+            if is_backfill:
+                self._ingest_backfill(node_id, msg.payload)
+                return
+
+            if is_binary:
+                try:
+                    payload = telemetry_codec.decode(msg.payload)
+                except ValueError as exc:
+                    self._load["rejected"] += 1
+                    log.warning("Dropping binary telemetry from %s: %s", node_id, exc)
+                    return
+                metrics = json.dumps(payload)
+                self._republish_status(node_id, metrics)
+            else:
+                try:
+                    payload = json.loads(msg.payload)
+                except (json.JSONDecodeError, UnicodeDecodeError):
+                    payload = {"status": "ONLINE"}
+                metrics = json.dumps(payload)
 
             is_present = payload.get("status") != "OFFLINE"
 
@@ -313,6 +489,9 @@ class WinterRiverEngine:
                 if not is_present:
                     self._cooling_fans[node_id] = 0
 
+            self._control_latency.observe(node_id, payload)
+            self._link_loss.observe(node_id, payload)
+
             with self.db.cursor() as cur:
                 if status_from_telemetry:
                     cur.execute(
@@ -328,17 +507,55 @@ class WinterRiverEngine:
                     )
                 cur.execute(
                     "INSERT INTO historical_data (node_id, metrics) VALUES (%s, %s)",
-                    (node_id, json.dumps(payload)),
+                    (node_id, metrics),
                 )
                 self.db.commit()
+            self._load["ingested"] += 1
 
         except Exception as exc:
+            self._load["rejected"] += 1
             log.error("on_message error: %s", exc)
             try:
                 self.db.rollback()
             except Exception:
                 pass
 
+    def _ingest_backfill(self, node_id, payload):
+        """Store one winter-river/<node_id>/backfill batch: telemetry the node
+        kept while its link was down (esp32-nodes wr_backfill.h). All of it
+        goes into historical_data in one INSERT, at the records' own
+        timestamps. live_status and the retained /status already show
+        something newer, so they are left alone."""
+        records, bad = telemetry_codec.decode_batch(payload)
+        rows = [r for r in records if r.get("ts_ms")]     # no clock: no place in history
+        self._load["rejected"] += bad + len(records) - len(rows)
+        if bad:
+            log.warning("Backfill from %s: %d undecodable record(s) dropped", node_id, bad)
+        for r in rows:
+            self._link_loss.backfilled(node_id, r.get("seq"))
+        if not rows:
+            return
+        params = []
+        for r in rows:
+            params += [node_id, r["ts_ms"] / 1000.0, json.dumps(r)]
+        with self.db.cursor() as cur:
+            cur.execute(
+                "INSERT INTO historical_data (node_id, timestamp, metrics) VALUES "
+                + ", ".join(["(%s, to_timestamp(%s), %s)"] * len(rows)),
+                params,
+            )
+            self.db.commit()
+        self._load["ingested"] += len(rows)
+
+    def _republish_status(self, node_id, metrics):
+        """Mirror a decoded binary message as JSON on <node_id>/status (retained),
+        so Telegraf / Grafana / status.sh see the same topic and payload shape
+        whichever encoding the node uses. The radio hop carried the packed form;
+        this republish is loopback on the Pi."""
+        raw = metrics.encode()
+        self._bin_echo[node_id] = raw
+        self.mqtt_client.publish(f"winter-river/{node_id}/status", raw, qos=0, retain=True)
+
     def _handle_weather_control(self, msg):
         """Apply an operator weather command from winter-river/weather/control.
 
@@ -687,6 +904,7 @@ class WinterRiverEngine:
         """Fetch all node states, propagate voltages, run thermal, push commands."""
         if self.db is None:
             return   # no-DB mode: skip the tick entirely
+        started = time.monotonic()
         try:
             self._mark_stale_nodes()
             with self.db.cursor() as cur:
@@ -721,6 +939,12 @@ class WinterRiverEngine:
             # 24 nodes × 1 Hz of inflight PUBACK traffic; a node servicing MQTT
             # slowly couldn't keep up, the backlog wedged its socket, and
             # Mosquitto dropped it ("MQTT FAILED"). QoS 0 removes that pressure.
+            # mqtt.control_qos = 1 is for fleets built with WR_MQTT_ASYNC
+            # (wr_mqtt.h), whose client acks from a buffer pool without blocking.
+            burst = self._cascade(nodes)
+            if burst:
+                log.info("Status cascade: fleet telemetry burst for %d ms", BURST_WINDOW_MS)
+            commands = {}
             for nid in order:
                 node = nodes[nid]
                 # Utility is an exogenous input (firmware/manual-owned), not a broker
@@ -731,13 +955,19 @@ class WinterRiverEngine:
                 # it downstream; recovery is a manual STATUS:GRID_OK on utility/control.
                 if node["node_type"] == "UTILITY":
                     continue
-                cmd  = self._control_cmd(node, node["v_out"], node["status_msg"])
-                self.mqtt_client.publish(f"winter-river/{nid}/control", cmd, qos=0)
+                cmd = self._control_cmd(node, node["v_out"], node["status_msg"])
+                if burst:
+                    cmd += f" BURST:{BURST_WINDOW_MS}"
+                cmd = self._control_latency.stamp(nid, cmd)
+                commands[nid] = cmd
                 log.debug("→ %s/control: %s", nid, cmd)
+            self._publish_control(commands)
 
             # Publish derived facility + weather state for Telegraf / Grafana.
             self._publish_facility_status(self._latest_thermal)
             self._publish_weather_status()
+            self._publish_control_latency()
+            self._publish_link_loss()
 
             with self.db.cursor() as cur:
                 for nid, node in nodes.items():
@@ -770,6 +1000,8 @@ class WinterRiverEngine:
             except Exception:
                 pass
 
+        self._publish_broker_status(time.monotonic() - started)
+
     # ── Thermal coupling ──────────────────────────────────────────────────────
 
     def _compute_tick_thermal(self, nodes):
@@ -822,6 +1054,7 @@ class WinterRiverEngine:
             "rack_dp_pa":      round(t["rack_dp_pa"], 2),
             "fan_dp_pa":       round(t["fan_dp_pa"], 2),
             "racks_total":     t["racks_total"],
+            **self._link_loss.summary(),
         }
         self.mqtt_client.publish(
             "winter-river/facility/status",
@@ -846,6 +1079,77 @@ class WinterRiverEngine:
             json.dumps(payload), qos=1, retain=True,
         )
 
+    def _publish_control_latency(self):
+        """Every LATENCY_REPORT_SEC, publish each node's control latency
+        percentiles (retained) for Telegraf → InfluxDB → Grafana."""
+        now = time.monotonic()
+        if now - self._latency_reported_at < LATENCY_REPORT_SEC:
+            return
+        self._latency_reported_at = now
+        ts = time.strftime("%H:%M:%S")
+        for nid, row in self._control_latency.report().items():
+            self.mqtt_client.publish(
+                f"winter-river/{nid}/latency",
+                json.dumps({"ts": ts, **row}), qos=1, retain=True,
+            )
+
+    def _publish_link_loss(self):
+        """Every LOSS_REPORT_SEC, publish each node's telemetry and control
+        loss counters for the window (retained)."""
+        now = time.monotonic()
+        if now - self._loss_reported_at < LOSS_REPORT_SEC:
+            return
+        self._loss_reported_at = now
+        ts = time.strftime("%H:%M:%S")
+        for nid, row in self._link_loss.report().items():
+            self.mqtt_client.publish(
+                f"winter-river/{nid}/loss",
+                json.dumps({"ts": ts, **row}), qos=1, retain=True,
+            )
+
+    def _cascade(self, nodes):
+        """True if this tick changed the computed status of CASCADE_MIN_CHANGES
+        or more nodes since the previous one. The first tick after start has
+        nothing to compare with."""
+        now = {nid: node["status_msg"] for nid, node in nodes.items()}
+        prev, self._prev_status = self._prev_status, now
+        if prev is None:
+            return False
+        changed = sum(1 for nid, status in now.items() if nid in prev and prev[nid] != status)
+        return changed >= CASCADE_MIN_CHANGES
+
+    def _publish_control(self, commands):
+        """Send one tick's control strings ({node_id: cmd}): a single tick
+        frame with mqtt.tick_frame (tick_frame.py), else, or when the frame
+        would not fit the nodes' buffer, one <node_id>/control each."""
+        slots = getattr(self, "_slots", None)
+        if TICK_FRAME and slots is not None and all(nid in slots.index for nid in commands):
+            frame = slots.encode(self._tick_seq + 1, commands)
+            if len(frame) <= tick_frame.MAX_BYTES:
+                self._tick_seq += 1
+                self.mqtt_client.publish(tick_frame.TOPIC, frame, qos=CONTROL_QOS)
+                self._load["controls"] += len(commands)
+                return
+            log.warning("Tick frame of %d bytes exceeds %d; sending per-node control",
+                        len(frame), tick_frame.MAX_BYTES)
+        for nid, cmd in commands.items():
+            self.mqtt_client.publish(f"winter-river/{nid}/control", cmd, qos=CONTROL_QOS)
+            self._load["controls"] += 1
+
+    def _publish_broker_status(self, tick_sec):
+        """Count the tick just run and publish the engine load counters."""
+        load = self._load
+        load["ticks"] += 1
+        if tick_sec > TICK_RATE:
+            load["tick_overruns"] += 1
+        payload = {
+            "ts":      time.strftime("%H:%M:%S"),
+            "node":    "broker",
+            "tick_ms": round(tick_sec * 1000.0, 1),
+            **load,
+        }
+        self.mqtt_client.publish(BROKER_STATUS_TOPIC, json.dumps(payload), qos=0, retain=True)
+
     def _persist_facility_metrics(self, t):
         if not t or self._facility_metrics_disabled:
             return
@@ -0,0 +1,401 @@
+"""
+Fleet OTA orchestrator — the Pi side of esp32-nodes/lib/winter_river/src/wr_ota.h.
+
+Replaces 24 serial USB uploads with one command that updates every board
+over WiFi, several at a time:
+
+    cd esp32-nodes && pio run                       # build the fleet
+    python3 broker/ota.py record                    # store each env's firmware.bin
+    python3 broker/ota.py push [--nodes ups_a ...] [--parallel 8]
+
+`record` copies each node's firmware.bin into the image store
+(ota_store/<node_id>/<crc32>.bin) and marks it as that node's target. The
+firmware.bin is the node type's fleet image (.pio/build/<type>/), or the
+board's own per-board build if that is newer. `push` then:
+
+  1. subscribes winter-river/+/ota/status. Each node's retained status
+     carries "image", the CRC-32 of the build it runs;
+  2. for each node not already on its target, makes a WRD1 delta from the
+     running build to the target (ota_delta.py). If the running build is not
+     in the store, it makes a full image. Deltas are cached next to the
+     images as <base>-<target>.wrd;
+  3. serves the store over HTTP (--http-port, default 8070) and sends
+         winter-river/<id>/ota   URL:http://<pi>:8070/<id>/<base>-<target>.wrd TARGET:<target>
+     to at most --parallel nodes at a time;
+  4. follows each node's status (DOWNLOADING with pct, REBOOTING, TRIAL)
+     until it reports the target image CONFIRMED, or FAILED / ROLLED_BACK /
+     no result within --timeout, and prints a line per change and a summary.
+
+Exits 0 only if every selected node ends on its target image.
+"""
+
+import argparse
+import http.server
+import json
+import logging
+import os
+import queue
+import re
+import sys
+import threading
+import time
+import zlib
+
+import ota_delta
+
+COMMAND_TOPIC = "winter-river/{}/ota"
+STATUS_TOPIC  = "winter-river/+/ota/status"
+
+HERE        = os.path.dirname(os.path.abspath(__file__))
+PROJECT_DIR = os.path.join(HERE, "..", "esp32-nodes")
+STORE_DIR   = os.path.join(HERE, "ota_store")
+
+HTTP_PORT = 8070
+PARALLEL  = 8
+TIMEOUT_S = 300.0     # command → confirmed; the node's own trial needs 30 s of MQTT
+DISCOVER_S = 5.0      # wait this long for retained status before sending full images
+
+_NODE_ID = re.compile(r"^[A-Za-z0-9_-]{1,40}$")
+_CRC     = re.compile(r"^[0-9a-f]{8}$")
+_DELTA   = re.compile(r"^/([A-Za-z0-9_-]{1,40})/([0-9a-f]{8})-([0-9a-f]{8})\.wrd$")
+
+FINAL = ("ok", "failed", "rolled_back", "timeout")
+
+log = logging.getLogger("winter-river.ota")
+
+
+def crc_hex(data):
+    return f"{zlib.crc32(data):08x}"
+
+
+class ImageStore:
+    """Recorded builds per node, and the deltas between them."""
+
+    def __init__(self, root=STORE_DIR):
+        self.root = root
+
+    def _dir(self, node_id):
+        if not _NODE_ID.match(node_id):
+            raise ValueError(f"bad node id {node_id!r}")
+        return os.path.join(self.root, node_id)
+
+    def record(self, node_id, data):
+        """Store one build and make it the node's target. Returns its CRC."""
+        d = self._dir(node_id)
+        os.makedirs(d, exist_ok=True)
+        crc = crc_hex(data)
+        path = os.path.join(d, f"{crc}.bin")
+        if not os.path.exists(path):
+            with open(path + ".tmp", "wb") as f:
+                f.write(data)
+            os.replace(path + ".tmp", path)
+        with open(os.path.join(d, "target"), "w") as f:
+            f.write(crc + "\n")
+        return crc
+
+    def target(self, node_id):
+        try:
+            with open(os.path.join(self._dir(node_id), "target")) as f:
+                crc = f.read().strip()
+        except OSError:
+            return None
+        return crc if _CRC.match(crc) else None
+
+    def image(self, node_id, crc):
+        try:
+            with open(os.path.join(self._dir(node_id), f"{crc}.bin"), "rb") as f:
+                return f.read()
+        except OSError:
+            return None
+
+    def nodes(self):
+        if not os.path.isdir(self.root):
+            return []
+        return sorted(n for n in os.listdir(self.root) if _NODE_ID.match(n) and self.target(n))
+
+    def delta_name(self, node_id, base, target):
+        """File name of the delta from `base` (None: unknown) to `target`,
+        built and cached on first use."""
+        base_image = self.image(node_id, base) if base else None
+        base = base if base_image is not None else "00000000"
+        name = f"{base}-{target}.wrd"
+        path = os.path.join(self._dir(node_id), name)
+        if not os.path.exists(path):
+            target_image = self.image(node_id, target)
+            if target_image is None:
+                raise FileNotFoundError(f"{node_id}: no image {target}")
+            with open(path + ".tmp", "wb") as f:
+                f.write(ota_delta.encode(base_image, target_image))
+            os.replace(path + ".tmp", path)
+        return name
+
+    def path(self, url_path):
+        """Filesystem path of a served delta, or None."""
+        m = _DELTA.match(url_path)
+        if not m:
+            return None
+        path = os.path.join(self._dir(m.group(1)), f"{m.group(2)}-{m.group(3)}.wrd")
+        return path if os.path.exists(path) else None
+
+
+def serve(store, port=HTTP_PORT):
+    """Serve the store's deltas over HTTP on a background thread."""
+
+    class Handler(http.server.BaseHTTPRequestHandler):
+        def do_GET(self):
+            path = store.path(self.path)
+            if path is None:
+                self.send_error(404)
+                return
+            with open(path, "rb") as f:
+                data = f.read()
+            self.send_response(200)
+            self.send_header("Content-Type", "application/octet-stream")
+            self.send_header("Content-Length", str(len(data)))
+            self.end_headers()
+            self.wfile.write(data)
+
+        def log_message(self, fmt, *args):
+            log.debug("http: " + fmt, *args)
+
+    server = http.server.ThreadingHTTPServer(("", port), Handler)
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    return server
+
+
+def build_command(base_url, node_id, name, target):
+    return f"URL:{base_url}/{node_id}/{name} TARGET:{target}"
+
+
+class Orchestrator:
+    """Which node to send next, and where each one stands.
+
+    Not thread-safe: feed it statuses and step() it from one thread. publish
+    is called as publish(topic, payload).
+    """
+
+    def __init__(self, store, publish, base_url, nodes, parallel=PARALLEL, timeout=TIMEOUT_S,
+                 discover=DISCOVER_S, clock=time.monotonic):
+        self._store = store
+        self._publish = publish
+        self._base_url = base_url
+        self._parallel = max(1, parallel)
+        self._timeout = timeout
+        self._clock = clock
+        self._discover_until = clock() + discover
+        self.running = {}                         # node_id → image CRC from its status
+        self.status = {}                          # node_id → last status payload
+        self.result = {}                          # node_id → pending / sent / one of FINAL
+        self.detail = {}                          # node_id → error or progress text
+        self._targets = {}
+        self._sent_at = {}
+        for node_id in nodes:
+            target = store.target(node_id)
+            if target is None:
+                self.result[node_id] = "failed"
+                self.detail[node_id] = "no recorded image"
+            else:
+                self._targets[node_id] = target
+                self.result[node_id] = "pending"
+
+    def on_status(self, node_id, payload):
+        """One winter-river/<id>/ota/status payload (decoded JSON)."""
+        if node_id not in self.result:
+            return
+        image = payload.get("image")
+        if isinstance(image, str) and _CRC.match(image):
+            self.running[node_id] = image
+        self.status[node_id] = payload
+        if self.result[node_id] != "sent":
+            return
+        state = payload.get("state")
+        target = self._targets[node_id]
+        if state in ("CONFIRMED", "IDLE") and image == target:
+            self._finish(node_id, "ok", f"{target} confirmed")
+        elif state == "FAILED":
+            self._finish(node_id, "failed", payload.get("error") or "failed")
+        elif state == "ROLLED_BACK":
+            self._finish(node_id, "rolled_back", f"back on {image}")
+        elif state == "DOWNLOADING":
+            pct = payload.get("pct")
+            self.detail[node_id] = f"{pct}%" if pct is not None else f"{payload.get('bytes', 0)} B"
+        elif state:
+            self.detail[node_id] = state.lower()
+
+    def step(self):
+        """Time out stuck nodes and send commands while slots are free.
+        Returns True once every node has a final result."""
+        now = self._clock()
+        for node_id, sent_at in list(self._sent_at.items()):
+            if now - sent_at >= self._timeout:
+                self._finish(node_id, "timeout", self.detail.get(node_id, "no status"))
+        discovering = now < self._discover_until
+        for node_id in sorted(self._targets):
+            if len(self._sent_at) >= self._parallel:
+                break
+            if self.result[node_id] != "pending":
+                continue
+            running = self.running.get(node_id)
+            if running is None and discovering:
+                continue                          # its retained status may still come
+            target = self._targets[node_id]
+            if running == target:
+                self._finish(node_id, "ok", "already on target", sent=False)
+                continue
+            try:
+                name = self._store.delta_name(node_id, running, target)
+            except (OSError, ValueError) as exc:
+                self._finish(node_id, "failed", str(exc), sent=False)
+                continue
+            self._publish(COMMAND_TOPIC.format(node_id),
+                          build_command(self._base_url, node_id, name, target))
+            self.result[node_id] = "sent"
+            self.detail[node_id] = "full image" if name.startswith("00000000-") else "delta"
+            self._sent_at[node_id] = now
+        return all(r in FINAL for r in self.result.values())
+
+    def _finish(self, node_id, result, detail, sent=True):
+        self.result[node_id] = result
+        self.detail[node_id] = detail
+        if sent:
+            self._sent_at.pop(node_id, None)
+
+    def summary(self):
+        """{result: [node_id, ...]} over all nodes."""
+        out = {}
+        for node_id, result in sorted(self.result.items()):
+            out.setdefault(result, []).append(node_id)
+        return out
+
+
+def roster(project_dir=PROJECT_DIR):
+    """{env: {"node_id", "label", "source"}} for every per-board env in
+    platformio.ini; "source" is the src/ directory, which is also the name
+    of the node type's fleet image env."""
+    envs, env, src = {}, None, None
+    with open(os.path.join(project_dir, "platformio.ini")) as f:
+        for line in f:
+            m = re.match(r"^\[env:([^\]]+)\]", line)
+            if m:
+                env, src = m.group(1), None
+                continue
+            m = re.search(r"build_src_filter\s*=\s*\+<([A-Za-z0-9_]+)/>", line)
+            if env and m:
+                src = m.group(1)
+            m = re.search(r'-DWR_NODE_ID="([^"]+)"', line)
+            if env and m:
+                label = re.search(r'-DWR_NODE_LABEL="([^"]+)"', line)
+                envs[env] = {"node_id": m.group(1), "label": label.group(1) if label else m.group(1),
+                             "source": src}
+    return envs
+
+
+def board_envs(project_dir=PROJECT_DIR):
+    """{env: node_id} for every per-board env in platformio.ini."""
+    return {env: row["node_id"] for env, row in roster(project_dir).items()}
+
+
+def firmware_path(project_dir, env, source):
+    """The newer of the board's own build and its node type's fleet image."""
+    paths = [os.path.join(project_dir, ".pio", "build", e, "firmware.bin") for e in (env, source) if e]
+    paths = [p for p in paths if os.path.exists(p)]
+    return max(paths, key=os.path.getmtime) if paths else None
+
+
+def cmd_record(args):
+    store = ImageStore(args.store)
+    envs = roster(args.project)
+    selected = args.envs or sorted(envs)
+    missing = 0
+    for env in selected:
+        row = envs.get(env)
+        path = row and firmware_path(args.project, env, row["source"])
+        if not path:
+            print(f"{env:24s} no firmware.bin (build it first)")
+            missing += 1
+            continue
+        with open(path, "rb") as f:
+            crc = store.record(row["node_id"], f.read())
+        print(f"{row['node_id']:24s} {crc}  {os.path.getsize(path)} B  "
+              f"{os.path.basename(os.path.dirname(path))}")
+    return 1 if missing else 0
+
+
+def cmd_push(args):
+    import paho.mqtt.client as mqtt
+
+    store = ImageStore(args.store)
+    nodes = args.nodes or store.nodes()
+    if not nodes:
+        print("nothing recorded; run `ota.py record` first")
+        return 1
+    statuses = queue.Queue()
+    client = mqtt.Client()
+
+    def on_connect(c, userdata, flags, rc):
+        if rc == 0:
+            c.subscribe(STATUS_TOPIC, qos=1)
+
+    def on_message(c, userdata, msg):
+        try:
+            statuses.put((msg.topic.split("/")[1], json.loads(msg.payload)))
+        except (ValueError, IndexError):
+            pass
+
+    client.on_connect = on_connect
+    client.on_message = on_message
+    client.connect(args.host, args.port, keepalive=60)
+    client.loop_start()
+    server = serve(store, args.http_port)
+
+    orch = Orchestrator(store, lambda t, p: client.publish(t, p, qos=1),
+                        f"http://{args.http_host}:{args.http_port}", nodes,
+                        parallel=args.parallel, timeout=args.timeout)
+    shown = {}
+    done = False
+    while not done:
+        try:
+            orch.on_status(*statuses.get(timeout=0.2))
+            while True:
+                orch.on_status(*statuses.get_nowait())
+        except queue.Empty:
+            pass
+        done = orch.step()
+        for node_id in nodes:
+            line = f"{orch.result[node_id]:12s} {orch.detail.get(node_id, '')}"
+            if shown.get(node_id) != line:
+                shown[node_id] = line
+                print(f"{node_id:24s} {line}", flush=True)
+
+    client.loop_stop()
+    server.shutdown()
+    summary = orch.summary()
+    print("\n" + ", ".join(f"{r}: {len(n)}" for r, n in summary.items()))
+    return 0 if set(summary) <= {"ok"} else 1
+
+
+def main(argv=None):
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[0].strip())
+    ap.add_argument("--store", default=STORE_DIR, help="image store directory")
+    sub = ap.add_subparsers(dest="cmd", required=True)
+
+    rec = sub.add_parser("record", help="store the built firmware.bin of each board env")
+    rec.add_argument("envs", nargs="*", help="envs to record (default: all boards)")
+    rec.add_argument("--project", default=PROJECT_DIR, help="PlatformIO project directory")
+
+    push = sub.add_parser("push", help="update the fleet to the recorded images")
+    push.add_argument("--nodes", nargs="+", help="node ids (default: all recorded)")
+    push.add_argument("--host", default="localhost", help="MQTT broker")
+    push.add_argument("--port", type=int, default=1883)
+    push.add_argument("--http-host", default="192.168.4.1", help="address the nodes reach the Pi on")
+    push.add_argument("--http-port", type=int, default=HTTP_PORT)
+    push.add_argument("--parallel", type=int, default=PARALLEL, help="boards updating at once")
+    push.add_argument("--timeout", type=float, default=TIMEOUT_S, help="seconds per board")
+
+    args = ap.parse_args(argv)
+    return cmd_record(args) if args.cmd == "record" else cmd_push(args)
+
+
+if __name__ == "__main__":
+    logging.basicConfig(level=logging.INFO, format="%(asctime)s [%(levelname)s] %(message)s")
+    sys.exit(main())
@@ -0,0 +1,154 @@
+"""
+Binary-delta firmware images — the Pi side of esp32-nodes/lib/winter_river/src/wr_delta.h.
+
+A node updating over the air (wr_ota.h) rebuilds its new image from the one
+it is running plus a delta downloaded from the Pi (ota.py). Two builds of the
+same node type share almost all of their bytes, so the delta is mostly
+copies:
+
+    offset 0   "WRD1"
+    offset 4   u32 base_size     bytes of the running image the delta reads
+    offset 8   u32 base_crc      zlib.crc32 of those bytes
+    offset 12  u32 target_size
+    offset 16  u32 target_crc    zlib.crc32 of the image the ops produce
+    offset 20  ops, each an opcode byte then LEB128 varints:
+                 0x01 COPY  <base offset> <length>
+                 0x02 DATA  <length> <length bytes>
+                 0x00 END
+
+encode() finds copies the way VCDIFF-style encoders do: every BLOCK-aligned
+BLOCK bytes of the base are indexed, the target is scanned a byte at a time
+for an indexed block, and each hit is extended both ways. Shorter matches
+than MIN_COPY are left as literals; a COPY op costs up to 11 bytes.
+encode(None, target) makes a full image (base_size 0, one DATA op) for a
+node whose running image is unknown.
+
+apply() is a reference decoder for tests and tools; the node's decoder is
+the C++ one, checked against this module by tests/test_ota_delta.py.
+"""
+
+import struct
+import zlib
+
+MAGIC    = b"WRD1"
+HEADER   = struct.Struct("<4sIIII")
+END, COPY, DATA = 0x00, 0x01, 0x02
+
+BLOCK    = 16
+MIN_COPY = 24
+
+
+def _varint(n):
+    out = bytearray()
+    while True:
+        b = n & 0x7F
+        n >>= 7
+        if n:
+            out.append(b | 0x80)
+        else:
+            out.append(b)
+            return bytes(out)
+
+
+def _read_varint(buf, i):
+    n = shift = 0
+    while True:
+        if shift > 28:
+            raise ValueError("varint too long")
+        b = buf[i]
+        i += 1
+        n |= (b & 0x7F) << shift
+        shift += 7
+        if not b & 0x80:
+            return n, i
+
+
+def _match_forward(a, ai, b, bi):
+    """Length of the common run of a[ai:] and b[bi:]."""
+    limit = min(len(a) - ai, len(b) - bi)
+    n, step = 0, 4096
+    while step:
+        while n + step <= limit and a[ai + n:ai + n + step] == b[bi + n:bi + n + step]:
+            n += step
+        step //= 2
+    return n
+
+
+def encode(base, target):
+    """Delta that turns `base` (bytes, or None) into `target`."""
+    base = base or b""
+    base_v, target_v = memoryview(base), memoryview(target)
+    out = bytearray(HEADER.pack(MAGIC, len(base), zlib.crc32(base),
+                                len(target), zlib.crc32(target)))
+
+    def literal(start, end):
+        if end > start:
+            out.append(DATA)
+            out.extend(_varint(end - start))
+            out.extend(target_v[start:end])
+
+    index = {}
+    for p in range(0, len(base) - BLOCK + 1, BLOCK):
+        index.setdefault(bytes(base_v[p:p + BLOCK]), p)
+
+    pending = 0          # start of the literal run not yet written
+    i = 0
+    while i + BLOCK <= len(target):
+        p = index.get(bytes(target_v[i:i + BLOCK]))
+        if p is None:
+            i += 1
+            continue
+        back = 0
+        while i - back > pending and p - back > 0 and target[i - back - 1] == base[p - back - 1]:
+            back += 1
+        length = BLOCK + _match_forward(base_v, p + BLOCK, target_v, i + BLOCK) + back
+        if length < MIN_COPY:
+            i += 1
+            continue
+        literal(pending, i - back)
+        out.append(COPY)
+        out.extend(_varint(p - back))
+        out.extend(_varint(length))
+        i += length - back
+        pending = i
+    literal(pending, len(target))
+    out.append(END)
+    return bytes(out)
+
+
+def header(delta):
+    """(base_size, base_crc, target_size, target_crc) of a delta."""
+    magic, *fields = HEADER.unpack_from(delta)
+    if magic != MAGIC:
+        raise ValueError("not a WRD1 delta")
+    return tuple(fields)
+
+
+def apply(base, delta):
+    """Rebuild the target image. Raises ValueError on any mismatch."""
+    base = base or b""
+    base_size, base_crc, target_size, target_crc = header(delta)
+    if base_size > len(base) or zlib.crc32(base[:base_size]) != base_crc:
+        raise ValueError("base image mismatch")
+    out = bytearray()
+    i = HEADER.size
+    while True:
+        op = delta[i]
+        i += 1
+        if op == END:
+            break
+        if op == COPY:
+            at, i = _read_varint(delta, i)
+            n, i = _read_varint(delta, i)
+            if at + n > base_size:
+                raise ValueError("copy outside the base image")
+            out += base[at:at + n]
+        elif op == DATA:
+            n, i = _read_varint(delta, i)
+            out += delta[i:i + n]
+            i += n
+        else:
+            raise ValueError(f"bad op 0x{op:02X}")
+    if len(out) != target_size or zlib.crc32(out) != target_crc:
+        raise ValueError("target image mismatch")
+    return bytes(out)
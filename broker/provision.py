@@ -0,0 +1,195 @@
+"""
+Board identity provisioning — the Pi side of esp32-nodes/lib/winter_river/src/wr_identity.h.
+
+Boards run one firmware image per node type and learn which node they are
+from NVS. This tool writes that identity once per board, keyed by the
+board's factory MAC:
+
+    python3 broker/provision.py list                         # who is out there
+    python3 broker/provision.py set a1b2c3d4e5f6 server_rack_b3
+    python3 broker/provision.py apply                        # the [provision] table in config.toml
+    python3 broker/provision.py clear a1b2c3d4e5f6
+
+`set` and `apply` publish, retained,
+
+    winter-river/provision/<mac>    ID:server_rack_b3 LABEL:rack_b3
+
+A connected board stores it and restarts as that node. A board that is
+not plugged in yet picks it up on its first connect. So swapping a spare
+is: flash the node type's image, `set` the spare's MAC to the dead board's
+id, plug it in. The OLED label defaults to the roster's (the per-board envs
+in platformio.ini). Node ids must be in that roster; the firmware also
+refuses an id of another node type.
+
+`list` reads the retained winter-river/<id>/identity reports. Unprovisioned
+boards show up as <type>_<mac> with source UNPROVISIONED.
+"""
+
+import argparse
+import json
+import os
+import re
+import sys
+import time
+
+import ota
+
+PROVISION_TOPIC = "winter-river/provision/{}"
+IDENTITY_TOPIC  = "winter-river/+/identity"
+
+CONFIG_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)), "config.toml")
+
+_MAC = re.compile(r"^[0-9a-f]{12}$")
+
+
+def normalize_mac(mac):
+    """"A1:B2:C3:D4:E5:F6" / "a1-b2-..." / "a1b2c3d4e5f6" → "a1b2c3d4e5f6"."""
+    m = re.sub(r"[:\-.]", "", str(mac)).lower()
+    if not _MAC.match(m):
+        raise ValueError(f"bad MAC {mac!r}")
+    return m
+
+
+def labels(project_dir=ota.PROJECT_DIR):
+    """{node_id: OLED label} from the roster."""
+    return {row["node_id"]: row["label"] for row in ota.roster(project_dir).values()}
+
+
+def build_message(node_id, label):
+    return f"ID:{node_id} LABEL:{label}"
+
+
+def plan(table, known):
+    """[(mac, node_id, label)] for a {mac: node_id} table, validated against
+    the roster `known` ({node_id: label}). Raises ValueError on a bad MAC,
+    an unknown node id, or two boards given one id."""
+    out, seen = [], {}
+    for mac, node_id in sorted(table.items()):
+        mac = normalize_mac(mac)
+        if node_id not in known:
+            raise ValueError(f"{mac}: unknown node id {node_id!r}")
+        if node_id in seen:
+            raise ValueError(f"{node_id} given to both {seen[node_id]} and {mac}")
+        seen[node_id] = mac
+        out.append((mac, node_id, known[node_id]))
+    return out
+
+
+def parse_report(topic, payload):
+    """(node_id, report) from a winter-river/<id>/identity message, or None."""
+    parts = topic.split("/")
+    if len(parts) != 3 or not payload:
+        return None
+    try:
+        report = json.loads(payload)
+    except ValueError:
+        return None
+    return (parts[1], report) if isinstance(report, dict) else None
+
+
+def _client(args):
+    import paho.mqtt.client as mqtt
+
+    client = mqtt.Client()
+    client.connect(args.host, args.port, keepalive=60)
+    client.loop_start()
+    return client
+
+
+def _publish(client, mac, payload):
+    info = client.publish(PROVISION_TOPIC.format(mac), payload, qos=1, retain=True)
+    info.wait_for_publish()
+
+
+def cmd_list(args):
+    reports = {}
+
+    def on_message(_c, _u, msg):
+        parsed = parse_report(msg.topic, msg.payload)
+        if parsed:
+            reports[parsed[0]] = parsed[1]
+
+    client = _client(args)
+    client.on_message = on_message
+    client.subscribe(IDENTITY_TOPIC, qos=1)
+    time.sleep(args.wait)
+    client.loop_stop()
+    print(f"{'mac':14s} {'node_id':30s} {'label':12s} {'source':14s}")
+    for node_id, r in sorted(reports.items(), key=lambda kv: (kv[1].get("source", ""), kv[0])):
+        line = f"{r.get('mac', '?'):14s} {node_id:30s} {r.get('label', ''):12s} {r.get('source', '?'):14s}"
+        if r.get("error"):
+            line += f" {r['error']}: {r.get('rejected', '')}"
+        print(line)
+    return 0
+
+
+def cmd_set(args):
+    known = labels(args.project)
+    try:
+        [(mac, node_id, label)] = plan({args.mac: args.node_id}, known)
+    except ValueError as exc:
+        print(exc)
+        return 1
+    client = _client(args)
+    _publish(client, mac, build_message(node_id, args.label or label))
+    client.loop_stop()
+    print(f"{mac} → {node_id}")
+    return 0
+
+
+def cmd_apply(args):
+    import toml
+
+    table = toml.load(args.config).get("provision", {})
+    if not table:
+        print(f"no [provision] table in {args.config}")
+        return 1
+    try:
+        rows = plan(table, labels(args.project))
+    except ValueError as exc:
+        print(exc)
+        return 1
+    client = _client(args)
+    for mac, node_id, label in rows:
+        _publish(client, mac, build_message(node_id, label))
+        print(f"{mac} → {node_id}")
+    client.loop_stop()
+    return 0
+
+
+def cmd_clear(args):
+    mac = normalize_mac(args.mac)
+    client = _client(args)
+    _publish(client, mac, b"")
+    client.loop_stop()
+    print(f"{mac} cleared (the board keeps its NVS identity)")
+    return 0
+
+
+def main(argv=None):
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[0].strip())
+    ap.add_argument("--host", default="localhost", help="MQTT broker")
+    ap.add_argument("--port", type=int, default=1883)
+    ap.add_argument("--project", default=ota.PROJECT_DIR, help="PlatformIO project (the roster)")
+    sub = ap.add_subparsers(dest="cmd", required=True)
+
+    ls = sub.add_parser("list", help="show the boards' identity reports")
+    ls.add_argument("--wait", type=float, default=2.0, help="seconds to collect reports")
+
+    st = sub.add_parser("set", help="give one board (by MAC) its node id")
+    st.add_argument("mac")
+    st.add_argument("node_id")
+    st.add_argument("--label", help="OLED label (default: the roster's)")
+
+    ap_ = sub.add_parser("apply", help="publish the whole [provision] MAC table")
+    ap_.add_argument("--config", default=CONFIG_PATH)
+
+    cl = sub.add_parser("clear", help="remove a board's retained provisioning message")
+    cl.add_argument("mac")
+
+    args = ap.parse_args(argv)
+    return {"list": cmd_list, "set": cmd_set, "apply": cmd_apply, "clear": cmd_clear}[args.cmd](args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
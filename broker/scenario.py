@@ -0,0 +1,407 @@
+"""
+Scenario compiler — the Pi side of esp32-nodes/lib/winter_river/src/wr_scenario.h.
+
+A training drill is a timed sequence of control tokens on a few nodes. Sent
+by hand with mosquitto_pub, its timing is only as good as the operator and
+the network. A scenario file describes it once; this tool compiles each
+node's part to a small program, pushes it, and the node runs it against its
+own clock:
+
+    python3 broker/scenario.py compile broker/scenarios/fan_degradation.scn -v
+    python3 broker/scenario.py push broker/scenarios/fan_degradation.scn
+    python3 broker/scenario.py status
+    python3 broker/scenario.py stop cooling_a
+
+A scenario file, one block per node (or per group of nodes running the same
+program); `#` starts a comment, indentation is for the reader:
+
+    node cooling_a
+      set FANS_RUNNING:50 STATUS:NORMAL
+      wait 30s
+      ramp FANS_RUNNING 50 40 60s every 5s
+      repeat 3
+        set STATUS:DEGRADED
+        wait 500ms
+        set STATUS:NORMAL
+        wait 500ms
+      end
+
+    set <token> ...                   one control message, applied as is
+    wait <duration>
+    ramp <key> <from> <to> <duration> [every <duration>]
+                                      <key>:<value> each step (default 250ms),
+                                      <to> exactly at the end; as many
+                                      decimals as the literals have
+    repeat <count> | repeat forever   ... end, nested up to 4 deep
+
+Durations are 250ms, 2s, 1.5s, 2m, or bare milliseconds. `push` gives every
+node the same start time, --lead seconds from now on the Pi's clock (the
+fleet clock, time_sync.py), so a multi-node drill starts together. Programs
+are not retained: a node that reboots mid-drill drops out of it. `stop`
+sends the empty program. `status` reads the retained
+winter-river/<id>/scenario/status reports.
+"""
+
+import argparse
+import json
+import re
+import struct
+import sys
+import time
+import zlib
+
+import ota
+import provision
+
+MAGIC   = 0xA7
+VERSION = 1
+
+TOPIC        = "winter-river/{}/scenario"
+STATUS_TOPIC = "winter-river/+/scenario/status"
+
+# wr_scenario.h limits. WR_SCENARIO_BYTES is 512.
+MAX_BYTES    = 512
+REPEAT_DEPTH = 4
+TEXT_MAX     = 63
+KEY_MAX      = 15
+MAX_DECIMALS = 6
+MAX_LEAD_MS  = 600000
+
+DEFAULT_STEP_MS = 250
+
+SET, WAIT, RAMP, REPEAT, END = 0x01, 0x02, 0x03, 0x04, 0x05
+
+_HEADER = struct.Struct("<BBHq")
+_RAMP   = struct.Struct("<ffIHB")
+
+_DURATION = re.compile(r"^(\d+(?:\.\d+)?)(ms|s|m)?$")
+_NUMBER   = re.compile(r"^[-+]?\d+(?:\.(\d+))?$")
+_KEY      = re.compile(r"^[A-Z][A-Z0-9_]*$")
+
+
+class ScenarioError(ValueError):
+    """A scenario file that does not compile; `line` is 1-based, 0 if none."""
+
+    def __init__(self, line, msg):
+        super().__init__(f"line {line}: {msg}" if line else msg)
+        self.line = line
+
+
+def parse_duration(text):
+    """"250ms" / "2s" / "1.5s" / "2m" / "750" → milliseconds."""
+    m = _DURATION.match(text)
+    if not m:
+        raise ValueError(f"bad duration {text!r}")
+    ms = float(m.group(1)) * {None: 1, "ms": 1, "s": 1000, "m": 60000}[m.group(2)]
+    if ms != int(ms) or ms > 0xFFFFFFFF:
+        raise ValueError(f"duration {text!r} out of range")
+    return int(ms)
+
+
+def _number(text):
+    """(value, decimals) of a ramp endpoint."""
+    m = _NUMBER.match(text)
+    if not m or abs(float(text)) >= 1e9:
+        raise ValueError(f"bad number {text!r}")
+    return float(text), len(m.group(1) or "")
+
+
+def parse(text):
+    """{node_id: [op, ...]} from a scenario file. An op is a tuple:
+    ("set", text), ("wait", ms), ("ramp", key, from, to, ms, step, decimals),
+    ("repeat", count), ("end",). Raises ScenarioError."""
+    programs, current, depth = {}, None, 0
+    for n, raw in enumerate(text.splitlines(), 1):
+        words = raw.split("#", 1)[0].split()
+        if not words:
+            continue
+        cmd, args = words[0].lower(), words[1:]
+        try:
+            if cmd == "node":
+                if depth:
+                    raise ValueError("repeat without end before the next node block")
+                if not args:
+                    raise ValueError("node needs an id")
+                current = []
+                for nid in args:
+                    if nid in programs:
+                        raise ValueError(f"{nid} has two blocks")
+                    programs[nid] = current
+                continue
+            if current is None:
+                raise ValueError(f"{cmd!r} before the first node block")
+            if cmd == "set":
+                body = " ".join(args)
+                if not args or len(body.encode()) > TEXT_MAX:
+                    raise ValueError(f"set needs 1..{TEXT_MAX} bytes of tokens")
+                current.append(("set", body))
+            elif cmd == "wait":
+                if len(args) != 1:
+                    raise ValueError("wait <duration>")
+                current.append(("wait", parse_duration(args[0])))
+            elif cmd == "ramp":
+                if len(args) not in (4, 6) or (len(args) == 6 and args[4] != "every"):
+                    raise ValueError("ramp <key> <from> <to> <duration> [every <duration>]")
+                key = args[0]
+                if not _KEY.match(key) or len(key) > KEY_MAX:
+                    raise ValueError(f"bad ramp key {key!r}")
+                (lo, d1), (hi, d2) = _number(args[1]), _number(args[2])
+                ms = parse_duration(args[3])
+                step = parse_duration(args[5]) if len(args) == 6 else DEFAULT_STEP_MS
+                if not ms or not 1 <= step <= 0xFFFF:
+                    raise ValueError("ramp needs a duration and a step of 1..65535 ms")
+                current.append(("ramp", key, lo, hi, ms, step, min(max(d1, d2), MAX_DECIMALS)))
+            elif cmd == "repeat":
+                if len(args) != 1:
+                    raise ValueError("repeat <count> | repeat forever")
+                count = 0 if args[0] == "forever" else int(args[0])
+                if not (args[0] == "forever" or 1 <= count <= 0xFFFF):
+                    raise ValueError("repeat count must be 1..65535")
+                depth += 1
+                if depth > REPEAT_DEPTH:
+                    raise ValueError(f"repeats nest at most {REPEAT_DEPTH} deep")
+                current.append(("repeat", count))
+            elif cmd == "end":
+                if not depth:
+                    raise ValueError("end without repeat")
+                depth -= 1
+                current.append(("end",))
+            else:
+                raise ValueError(f"unknown op {cmd!r}")
+        except ValueError as exc:
+            raise ScenarioError(n, str(exc)) from None
+    if depth:
+        raise ScenarioError(0, "repeat without end")
+    if not programs:
+        raise ScenarioError(0, "no node blocks")
+    return programs
+
+
+def _check_loops(ops):
+    """ScenarioError if a repeat body takes no time (the node rejects it)."""
+    timed = [False]
+    for op in ops:
+        if (op[0] == "wait" and op[1]) or op[0] == "ramp":
+            timed[-1] = True
+        elif op[0] == "repeat":
+            timed.append(False)
+        elif op[0] == "end":
+            if not timed.pop():
+                raise ScenarioError(0, "a repeat body must wait or ramp")
+            timed[-1] = True
+
+
+def assemble(ops, start_ms=0):
+    """The wr_scenario.h program for `ops`, starting at epoch `start_ms` (0 =
+    on arrival)."""
+    _check_loops(ops)
+    code = bytearray()
+    for op in ops:
+        kind = op[0]
+        if kind == "set":
+            text = op[1].encode()
+            code += bytes([SET, len(text)]) + text
+        elif kind == "wait":
+            code += struct.pack("<BI", WAIT, op[1])
+        elif kind == "ramp":
+            key, lo, hi, ms, step, decimals = op[1:]
+            code += bytes([RAMP, len(key)]) + key.encode() + _RAMP.pack(lo, hi, ms, step, decimals)
+        elif kind == "repeat":
+            code += struct.pack("<BH", REPEAT, op[1])
+        else:
+            code.append(END)
+    payload = _HEADER.pack(MAGIC, VERSION, len(code), start_ms) + bytes(code)
+    if len(payload) > MAX_BYTES:
+        raise ScenarioError(0, f"program of {len(payload)} bytes (max {MAX_BYTES})")
+    return payload
+
+
+def compile_text(text, start_ms=0):
+    """{node_id: program} for a scenario file."""
+    return {nid: assemble(ops, start_ms) for nid, ops in parse(text).items()}
+
+
+def duration_ms(ops):
+    """Run time of `ops` in ms, or None if it repeats forever."""
+    total, stack = 0, []
+    for op in ops:
+        if op[0] == "wait":
+            total += op[1]
+        elif op[0] == "ramp":
+            total += op[4]
+        elif op[0] == "repeat":
+            stack.append((total, op[1]))
+            total = 0
+        elif op[0] == "end":
+            outer, count = stack.pop()
+            if not count:
+                return None
+            total = outer + total * count
+    return total
+
+
+def disassemble(payload):
+    """(start_ms, [line, ...]) for a program, in scenario-file syntax; ValueError
+    if malformed."""
+    if len(payload) < _HEADER.size:
+        raise ValueError("short program")
+    magic, version, size, start = _HEADER.unpack_from(payload)
+    if magic != MAGIC or version != VERSION or size != len(payload) - _HEADER.size:
+        raise ValueError(f"not a v{VERSION} scenario program")
+    lines, depth, pc = [], 0, _HEADER.size
+    try:
+        while pc < len(payload):
+            op = payload[pc]
+            pad = "  " * depth
+            if op == SET:
+                n = payload[pc + 1]
+                lines.append(f"{pad}set {payload[pc + 2:pc + 2 + n].decode()}")
+                pc += 2 + n
+            elif op == WAIT:
+                (ms,) = struct.unpack_from("<I", payload, pc + 1)
+                lines.append(f"{pad}wait {ms}ms")
+                pc += 5
+            elif op == RAMP:
+                n = payload[pc + 1]
+                key = payload[pc + 2:pc + 2 + n].decode()
+                lo, hi, ms, step, d = _RAMP.unpack_from(payload, pc + 2 + n)
+                lines.append(f"{pad}ramp {key} {lo:.{d}f} {hi:.{d}f} {ms}ms every {step}ms")
+                pc += 2 + n + _RAMP.size
+            elif op == REPEAT:
+                (count,) = struct.unpack_from("<H", payload, pc + 1)
+                lines.append(f"{pad}repeat {count or 'forever'}")
+                depth += 1
+                pc += 3
+            elif op == END:
+                depth -= 1
+                lines.append(f"{'  ' * depth}end")
+                pc += 1
+            else:
+                raise ValueError(f"bad op 0x{op:02x} at {pc}")
+    except (IndexError, struct.error):
+        raise ValueError(f"truncated op at {pc}") from None
+    if pc != len(payload) or depth:
+        raise ValueError("truncated program")
+    return start, lines
+
+
+def program_id(payload):
+    """The "program" a node reports for `payload`."""
+    return f"{zlib.crc32(payload):08x}"
+
+
+def _read(path):
+    with open(path) as f:
+        return parse(f.read())
+
+
+def cmd_compile(args):
+    try:
+        programs = _read(args.file)
+        for nid, ops in programs.items():
+            payload = assemble(ops)
+            ms = duration_ms(ops)
+            length = "forever" if ms is None else f"{ms / 1000:g} s"
+            print(f"{nid:24s} {len(payload):4d} B  {length}")
+            if args.verbose:
+                for line in disassemble(payload)[1]:
+                    print(f"    {line}")
+    except ScenarioError as exc:
+        print(f"{args.file}: {exc}")
+        return 1
+    return 0
+
+
+def cmd_push(args):
+    try:
+        programs = _read(args.file)
+    except ScenarioError as exc:
+        print(f"{args.file}: {exc}")
+        return 1
+    unknown = sorted(set(programs) - set(provision.labels(args.project)))
+    if unknown:
+        print(f"not in the roster: {', '.join(unknown)}")
+        return 1
+    if not 0 <= args.lead * 1000 <= MAX_LEAD_MS:
+        print(f"--lead must be 0..{MAX_LEAD_MS // 1000} s")
+        return 1
+    start = int(time.time() * 1000 + args.lead * 1000) if args.lead else 0
+    try:
+        payloads = {nid: assemble(ops, start) for nid, ops in programs.items()}
+    except ScenarioError as exc:
+        print(f"{args.file}: {exc}")
+        return 1
+    client = provision._client(args)
+    for nid, payload in payloads.items():
+        client.publish(TOPIC.format(nid), payload, qos=1).wait_for_publish()
+        print(f"{nid:24s} {program_id(payload)}")
+    client.loop_stop()
+    if start:
+        print(f"starts at {time.strftime('%H:%M:%S', time.localtime(start / 1000))}"
+              f".{start % 1000:03d}")
+    return 0
+
+
+def cmd_stop(args):
+    client = provision._client(args)
+    for nid in args.node_ids:
+        client.publish(TOPIC.format(nid), b"", qos=1).wait_for_publish()
+        print(f"{nid} stopped")
+    client.loop_stop()
+    return 0
+
+
+def cmd_status(args):
+    reports = {}
+
+    def on_message(_c, _u, msg):
+        try:
+            reports[msg.topic.split("/")[1]] = json.loads(msg.payload)
+        except ValueError:
+            pass
+
+    client = provision._client(args)
+    client.on_message = on_message
+    client.subscribe(STATUS_TOPIC, qos=1)
+    time.sleep(args.wait)
+    client.loop_stop()
+    print(f"{'node_id':24s} {'state':10s} {'program':10s}")
+    for nid, r in sorted(reports.items()):
+        line = f"{nid:24s} {r.get('state', '?'):10s} {r.get('program', ''):10s}"
+        if "late_ms" in r:
+            line += f" late {r['late_ms']} ms"
+        if r.get("error"):
+            line += f" {r['error']}"
+        print(line)
+    return 0
+
+
+def main(argv=None):
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[0].strip())
+    ap.add_argument("--host", default="localhost", help="MQTT broker")
+    ap.add_argument("--port", type=int, default=1883)
+    ap.add_argument("--project", default=ota.PROJECT_DIR, help="PlatformIO project (the roster)")
+    sub = ap.add_subparsers(dest="cmd", required=True)
+
+    cp = sub.add_parser("compile", help="check a scenario file, show program sizes")
+    cp.add_argument("file")
+    cp.add_argument("-v", "--verbose", action="store_true", help="disassemble each program")
+
+    pu = sub.add_parser("push", help="send each node its program")
+    pu.add_argument("file")
+    pu.add_argument("--lead", type=float, default=3.0,
+                    help="seconds from now to the common start (0: each node on arrival)")
+
+    sp = sub.add_parser("stop", help="stop the running program on nodes")
+    sp.add_argument("node_ids", nargs="+")
+
+    st = sub.add_parser("status", help="show the nodes' scenario reports")
+    st.add_argument("--wait", type=float, default=2.0, help="seconds to collect reports")
+
+    args = ap.parse_args(argv)
+    return {"compile": cmd_compile, "push": cmd_push, "stop": cmd_stop,
+            "status": cmd_status}[args.cmd](args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,312 @@
+"""
+Compact binary telemetry codec — broker side of esp32-nodes/lib/winter_river/src/wr_schema.h.
+
+Nodes built with WR_TELEMETRY_BINARY=1 (or switched at runtime with the
+ENC:BIN control token) publish a packed struct on winter-river/<node_id>/status/bin
+instead of JSON on winter-river/<node_id>/status. decode() turns one of those
+messages back into the exact dict the node's JSON payload would have parsed to,
+so the rest of the ingest path is encoding-agnostic.
+
+Layout (little-endian, no padding):
+    u8 MAGIC | u8 VERSION | u8 type_id | u48 ts_ms | u16 ts_err_us | u32 seq | fields...
+
+ts_ms is the node's disciplined epoch milliseconds (wr_time.h, 0 = no clock)
+and ts_err_us its error bound (0xFFFF = not synced to the Pi, decoded as
+None). The JSON "ts" string is rebuilt from ts_ms in the Pi's local time.
+seq is the node's telemetry sequence number (wr_seq.h, link_loss.py).
+decode_batch() splits the batches a node sends on winter-river/<node_id>/backfill
+after an outage (wr_backfill.h): the same messages, each behind a u8 length.
+Messages from nodes not yet reflashed still decode: version 2 without seq,
+version 1 (u24 seconds-since-midnight in place of the stamps) without ts_ms /
+ts_err_us either.
+
+The schema tables below MUST match wr_schema.h (and STATES must match the
+WR_STATES order in wr_state.h); tests/test_telemetry_codec.py parses both
+headers and fails on any drift.
+"""
+
+import math
+import struct
+import time
+
+MAGIC        = 0xA5
+VERSION      = 3
+TS_ERR_UNSET = 0xFFFF
+V1_TS_UNSET  = 0xFFFFFF
+
+# wr::State codes, in wr_state.h WR_STATES order.
+STATES = (
+    "NORMAL", "WARNING", "DEGRADED", "FAULT", "OFF", "NO_INPUT", "OFFLINE",
+    "GRID_OK", "SAG", "SWELL", "OUTAGE",
+    "CLOSED", "OPEN", "TRIPPED", "GENERATOR",
+    "STANDBY", "STARTING", "RUNNING",
+    "ON_BATTERY", "CHARGING",
+)
+_STATE_CODES = {name: code for code, name in enumerate(STATES)}
+
+# kind → (struct code, null sentinel or None). X10 kinds carry one decimal.
+KINDS = {
+    "U8":      ("B", None),
+    "U16":     ("H", None),
+    "I16":     ("h", -0x8000),
+    "X10_I16": ("h", -0x8000),
+    "X10_I32": ("i", -0x80000000),
+    "BOOL":    ("B", None),
+    "STATE":   ("B", None),
+}
+
+# type_id → (broker node_type, ((field, kind), ...)) — field order is the
+# node's JSON field order.
+SCHEMAS = {
+    1: ("UTILITY", (
+        ("v_out",      "X10_I16"),
+        ("freq_hz",    "X10_I16"),
+        ("load_pct",   "U8"),
+        ("state",      "STATE"),
+        ("voltage_kv", "X10_I16"),
+        ("phase",      "U8"),
+    )),
+    2: ("HV_MV_TRANSFORMER", (
+        ("input_kv",  "X10_I16"),
+        ("output_kv", "U8"),
+        ("load_pct",  "U8"),
+        ("power_mva", "X10_I16"),
+        ("temp_f",    "I16"),
+        ("state",     "STATE"),
+        ("voltage",   "U16"),
+    )),
+    3: ("MV_SWITCHGEAR", (
+        ("breaker",   "BOOL"),
+        ("current_a", "X10_I32"),
+        ("load_kw",   "X10_I32"),
+        ("load_pct",  "U8"),
+        ("state",     "STATE"),
+        ("voltage",   "U16"),
+    )),
+    4: ("MV_LV_TRANSFORMER", (
+        ("load_pct",  "U8"),
+        ("power_kva", "X10_I32"),
+        ("temp_f",    "I16"),
+        ("state",     "STATE"),
+        ("voltage",   "U16"),
+    )),
+    5: ("LV_SWITCHGEAR", (
+        ("breaker",   "BOOL"),
+        ("current_a", "X10_I32"),
+        ("load_kw",   "X10_I32"),
+        ("load_pct",  "U8"),
+        ("state",     "STATE"),
+        ("voltage",   "U16"),
+    )),
+    6: ("GENERATOR", (
+        ("fuel_pct", "U8"),
+        ("rpm",      "U16"),
+        ("output_v", "X10_I16"),
+        ("load_pct", "U8"),
+        ("state",    "STATE"),
+        ("voltage",  "U16"),
+    )),
+    7: ("UPS", (
+        ("battery_pct", "U8"),
+        ("load_pct",    "U8"),
+        ("input_v",     "X10_I16"),
+        ("output_v",    "X10_I16"),
+        ("state",       "STATE"),
+        ("voltage",     "U16"),
+    )),
+    8: ("COOLING", (
+        ("input_v",        "X10_I16"),
+        ("coolant_temp_f", "I16"),
+        ("fan_speed_pct",  "U8"),
+        ("fan_count",      "U8"),
+        ("fans_running",   "U8"),
+        ("load_pct",       "U8"),
+        ("state",          "STATE"),
+        ("voltage",        "U16"),
+    )),
+    9: ("SERVER_RACK", (
+        ("cpu_pct",  "U8"),
+        ("inlet_f",  "I16"),
+        ("power_kw", "X10_I16"),
+        ("units",    "U8"),
+        ("state",    "STATE"),
+        ("voltage",  "U16"),
+    )),
+}
+
+TYPE_IDS = {ntype: tid for tid, (ntype, _) in SCHEMAS.items()}
+
+# Header per version: magic, version, type_id, then
+#   v3: ts_ms low 32, ts_ms high 16, ts_err_us, seq
+#   v2: ts_ms low 32, ts_ms high 16, ts_err_us
+#   v1: seconds-since-midnight low 16, high 8
+_HEADERS = {3: "<BBBIHHI", 2: "<BBBIHH", 1: "<BBBHB"}
+_HEADER_VALUES = {3: 7, 2: 6, 1: 5}
+
+
+def _x10(null):
+    # Integer / 10 is correctly rounded, so 752 → 75.2 == float("75.2").
+    return lambda raw: None if raw == null else raw / 10
+
+
+def _nullable(null):
+    return lambda raw: None if raw == null else raw
+
+
+def _state(raw):
+    if raw >= len(STATES):
+        raise ValueError(f"unknown state code {raw}")
+    return STATES[raw]
+
+
+_FIXUPS = {
+    "I16":     _nullable(KINDS["I16"][1]),
+    "X10_I16": _x10(KINDS["X10_I16"][1]),
+    "X10_I32": _x10(KINDS["X10_I32"][1]),
+    "BOOL":    bool,
+    "STATE":   _state,
+}
+
+
+def _compile(header, fields):
+    """Precompute one struct + the few per-field conversions for a type, so
+    decode() is a single unpack plus a handful of calls."""
+    st = struct.Struct(header + "".join(KINDS[kind][0] for _, kind in fields))
+    names = tuple(name for name, _ in fields)
+    fixups = tuple((name, _FIXUPS[kind]) for name, kind in fields if kind in _FIXUPS)
+    return st, names, fixups
+
+
+_DECODERS = {
+    (version, tid): _compile(header, fields)
+    for version, header in _HEADERS.items()
+    for tid, (_, fields) in SCHEMAS.items()
+}
+
+
+def is_binary(payload):
+    """True if `payload` looks like a packed telemetry message (JSON never
+    starts with the magic byte)."""
+    return len(payload) > 0 and payload[0] == MAGIC
+
+
+def node_type(payload):
+    """Broker node_type named by a packed message's header, or None."""
+    if len(payload) < 3 or payload[0] != MAGIC:
+        return None
+    entry = SCHEMAS.get(payload[2])
+    return entry[0] if entry else None
+
+
+def _lround(x):
+    """C lround(): halves round away from zero (Python's round() is banker's)."""
+    return int(math.copysign(math.floor(abs(x) + 0.5), x))
+
+
+def _format_ts(secs):
+    if secs == V1_TS_UNSET or secs >= 86400:
+        return "--:--:--"
+    return "%02d:%02d:%02d" % (secs // 3600, secs // 60 % 60, secs % 60)
+
+
+def format_ts_ms(ts_ms):
+    """The firmware's "ts" text for an epoch-ms stamp, in local time."""
+    if not ts_ms:
+        return "--:--:--"
+    return time.strftime("%H:%M:%S", time.localtime(ts_ms // 1000))
+
+
+def decode(payload):
+    """Decode one packed message into the node's JSON-equivalent dict.
+
+    Raises ValueError on a bad magic byte, an unsupported version, an unknown
+    type id, a length that does not match the type's schema, or an
+    out-of-range state code.
+    """
+    if len(payload) < 6:
+        raise ValueError(f"short telemetry message ({len(payload)} B)")
+    if payload[0] != MAGIC:
+        raise ValueError(f"bad magic 0x{payload[0]:02X}")
+    version = payload[1]
+    if version not in _HEADERS:
+        raise ValueError(f"unsupported telemetry schema version {version}")
+    tid = payload[2]
+    if tid not in SCHEMAS:
+        raise ValueError(f"unknown telemetry type id {tid}")
+    st, names, fixups = _DECODERS[(version, tid)]
+    if len(payload) != st.size:
+        raise ValueError(
+            f"{SCHEMAS[tid][0]} telemetry is {len(payload)} B, schema expects {st.size} B"
+        )
+
+    values = st.unpack(payload)
+    if version == 1:
+        out = {"ts": _format_ts(values[3] | (values[4] << 16))}
+    else:
+        ts_ms = values[3] | (values[4] << 32)
+        out = {
+            "ts":        format_ts_ms(ts_ms),
+            "ts_ms":     ts_ms,
+            "ts_err_us": None if values[5] == TS_ERR_UNSET else values[5],
+        }
+        if version >= 3:
+            out["seq"] = values[6]
+    out.update(zip(names, values[_HEADER_VALUES[version]:]))
+    for name, fix in fixups:
+        out[name] = fix(out[name])
+    return out
+
+
+def decode_batch(payload):
+    """Decode a winter-river/<node_id>/backfill batch: records the node kept
+    while its link was down (wr_backfill.h), each one packed message as above
+    behind a u8 length.
+
+    Returns (records, bad). A record that does not decode is skipped and
+    counted in bad; so is a length running past the end, which ends the batch.
+    """
+    records, bad, i = [], 0, 0
+    while i < len(payload):
+        n = payload[i]
+        rec = payload[i + 1:i + 1 + n]
+        i += 1 + n
+        if not n or len(rec) != n:
+            bad += 1
+            break
+        try:
+            records.append(decode(rec))
+        except ValueError:
+            bad += 1
+    return records, bad
+
+
+def encode_batch(messages):
+    """Frame packed messages as one backfill batch (tests, load generators)."""
+    return b"".join(bytes([len(m)]) + m for m in messages)
+
+
+def encode(ntype, fields, ts_ms=0, ts_err_us=None, seq=1):
+    """Pack a telemetry dict the way the firmware does. Used by tests, the
+    benchmark and host-side load generators; the broker itself only decodes."""
+    tid = TYPE_IDS[ntype]
+    err = TS_ERR_UNSET if ts_err_us is None else max(0, min(ts_err_us, TS_ERR_UNSET - 1))
+
+    packed = []
+    for name, kind in SCHEMAS[tid][1]:
+        v = fields[name]
+        null = KINDS[kind][1]
+        if kind == "STATE":
+            packed.append(_STATE_CODES[v])
+        elif v is None:
+            packed.append(null)
+        elif kind in ("X10_I16", "X10_I32"):
+            lim = 0x7FFF if kind == "X10_I16" else 0x7FFFFFFF
+            packed.append(max(-lim, min(_lround(v * 10), lim)))
+        elif kind == "BOOL":
+            packed.append(1 if v else 0)
+        else:
+            lo, hi = {"U8": (0, 0xFF), "U16": (0, 0xFFFF), "I16": (-0x7FFF, 0x7FFF)}[kind]
+            packed.append(max(lo, min(_lround(v), hi)))
+    return _DECODERS[(VERSION, tid)][0].pack(
+        MAGIC, VERSION, tid, ts_ms & 0xFFFFFFFF, ts_ms >> 32, err, seq, *packed
+    )
@@ -0,0 +1,100 @@
+"""
+Tick frame — broker side of esp32-nodes/lib/winter_river/src/wr_tick.h.
+
+run_simulation_tick publishes one control string per node per tick. As
+separate winter-river/<node_id>/control messages that is 23 MQTT frames a
+second, each a radio wakeup on the AP. With tick_frame = true under [mqtt]
+in config.toml the engine publishes them all in one frame instead:
+
+    winter-river/tick    (non-retained, QoS control_qos)
+
+    offset 0       u8   MAGIC (0xA6) — never a valid first byte of text
+    offset 1       u8   VERSION
+    offset 2       u32  tick      engine tick number, from 1 per broker run
+    offset 6       u32  map       slot map id (below)
+    offset 10      u8   n         slots
+    offset 11      u16  end[n]    one past the last byte of each slot's text
+    offset 11+2n   the slot texts, back to back
+
+Little-endian, no padding. Slot i runs from end[i-1] (slot 0 from 11+2n) to
+end[i]; an empty slot means no control for that node this tick (the
+utility). Each text is exactly what would have gone to <node_id>/control,
+SEQ:/T: stamps included (control_latency.py), so the node's token handlers,
+loss counters and latency echo see no difference, and every node applies the
+same tick.
+
+Slots are the known node ids in sorted order. Each node learns its own from
+the retained winter-river/<node_id>/slot, "SLOT:<i> MAP:<id>", published with
+the topology blobs. MAP is the CRC-32 of the sorted ids: when the nodes table
+changes, a node still holding an old assignment ignores frames until its new
+one arrives instead of applying another node's control. A frame larger than
+MAX_BYTES (the node's receive buffer, less topic and header) is not sent; the
+engine falls back to per-node messages for that tick.
+"""
+
+import struct
+import zlib
+
+MAGIC   = 0xA6
+VERSION = 1
+
+TOPIC      = "winter-river/tick"
+SLOT_TOPIC = "winter-river/{}/slot"
+
+# wr_tick.h's TICK_FRAME_BYTES is 2048.
+MAX_BYTES = 1984
+
+_HEADER = struct.Struct("<BBIIB")
+_END    = struct.Struct("<H")
+
+
+class SlotMap:
+    """Slot assignment for one set of node ids."""
+
+    def __init__(self, node_ids):
+        self.ids = sorted(node_ids)
+        if len(self.ids) > 255:
+            raise ValueError(f"{len(self.ids)} nodes do not fit a tick frame (max 255)")
+        self.index = {nid: i for i, nid in enumerate(self.ids)}
+        self.map_id = zlib.crc32(",".join(self.ids).encode())
+
+    def assignment(self, node_id):
+        """The retained SLOT_TOPIC payload for `node_id`."""
+        return f"SLOT:{self.index[node_id]} MAP:{self.map_id}"
+
+    def encode(self, tick, commands):
+        """One frame carrying `commands` ({node_id: control string}). Ids
+        without a slot raise KeyError; nodes without a command get an empty
+        slot."""
+        texts = [b""] * len(self.ids)
+        for nid, cmd in commands.items():
+            texts[self.index[nid]] = cmd.encode()
+        at = _HEADER.size + _END.size * len(texts)
+        ends = []
+        for text in texts:
+            at += len(text)
+            ends.append(_END.pack(at))
+        if at > 0xFFFF:
+            raise ValueError(f"tick frame of {at} bytes")
+        header = _HEADER.pack(MAGIC, VERSION, tick & 0xFFFFFFFF, self.map_id, len(texts))
+        return header + b"".join(ends) + b"".join(texts)
+
+
+def decode(payload):
+    """(tick, map_id, [slot text, ...]) from a frame; ValueError if malformed."""
+    if len(payload) < _HEADER.size:
+        raise ValueError("short tick frame")
+    magic, version, tick, map_id, n = _HEADER.unpack_from(payload)
+    if magic != MAGIC or version != VERSION:
+        raise ValueError(f"not a v{VERSION} tick frame")
+    start = _HEADER.size + _END.size * n
+    if start > len(payload):
+        raise ValueError("truncated slot table")
+    texts = []
+    for i in range(n):
+        (end,) = _END.unpack_from(payload, _HEADER.size + _END.size * i)
+        if end < start or end > len(payload):
+            raise ValueError(f"slot {i} out of bounds")
+        texts.append(payload[start:end].decode())
+        start = end
+    return tick, map_id, texts
@@ -0,0 +1,104 @@
+"""
+Fleet time-sync responder — the Pi side of esp32-nodes/lib/winter_river/src/wr_time.h.
+
+Each node disciplines its monotonic µs clock against this responder with an
+NTP-style exchange over MQTT:
+
+    node → winter-river/time/request    ID:ups_a N:42
+    Pi   → winter-river/ups_a/time      N:42 T2:1760612345678123 T3:1760612345678161
+
+T2 is the Pi's epoch µs when the request was handed to us, T3 just before
+the reply is published. The node takes the round trip minus (T3 − T2), and
+trusts the exchange with the smallest round trip. Stamping must therefore be
+the first and the last thing done per message. The responder runs on its
+own MQTT connection and network thread, so a reply never waits behind
+telemetry ingest or a simulation tick on the engine's client.
+
+All nodes sync against this one clock. They agree with each other to within
+their reported ts_err_us bounds, whether or not the Pi itself runs NTP.
+
+The engine starts a responder at boot (main.py). It can also run alone:
+
+    python time_sync.py [host] [port]
+"""
+
+import logging
+import re
+import sys
+import time
+
+import paho.mqtt.client as mqtt
+
+REQUEST_TOPIC = "winter-river/time/request"
+REPLY_TOPIC   = "winter-river/{}/time"
+
+# Node ids go into the reply topic; refuse MQTT wildcards and separators.
+_NODE_ID = re.compile(r"^[A-Za-z0-9_-]{1,40}$")
+
+log = logging.getLogger("winter-river.time")
+
+
+def epoch_us():
+    """The reference clock: wall-clock epoch microseconds."""
+    return time.time_ns() // 1000
+
+
+def parse_request(payload):
+    """(node_id, n) from "ID:<node_id> N:<n>", or None if malformed."""
+    try:
+        tokens = dict(t.split(":", 1) for t in payload.decode("ascii").split())
+        node_id, n = tokens["ID"], int(tokens["N"])
+    except (UnicodeDecodeError, ValueError, KeyError):
+        return None
+    if not _NODE_ID.match(node_id) or n < 0:
+        return None
+    return node_id, n
+
+
+def build_reply(n, t2, t3):
+    return f"N:{n} T2:{t2} T3:{t3}"
+
+
+class TimeResponder:
+    def __init__(self, host, port, clock=epoch_us):
+        self._host = host
+        self._port = port
+        self._clock = clock
+        self.answered = 0
+        self.rejected = 0
+        self.client = mqtt.Client()
+        self.client.on_connect = self._on_connect
+        self.client.on_message = self.on_message
+
+    def start(self):
+        """Connect in the background; paho's thread retries until it succeeds."""
+        try:
+            self.client.connect_async(self._host, self._port, keepalive=60)
+            self.client.loop_start()
+        except Exception as exc:
+            log.warning("Time-sync responder MQTT setup failed (%s)", exc)
+
+    def _on_connect(self, client, userdata, flags, rc):
+        if rc == 0:
+            client.subscribe(REQUEST_TOPIC, qos=0)
+            log.info("Time-sync responder listening on %s", REQUEST_TOPIC)
+
+    def on_message(self, client, userdata, msg):
+        t2 = self._clock()
+        req = parse_request(msg.payload)
+        if req is None:
+            self.rejected += 1
+            return
+        node_id, n = req
+        topic = REPLY_TOPIC.format(node_id)
+        client.publish(topic, build_reply(n, t2, self._clock()), qos=0)
+        self.answered += 1
+
+
+if __name__ == "__main__":
+    logging.basicConfig(level=logging.INFO, format="%(asctime)s [%(levelname)s] %(message)s")
+    host = sys.argv[1] if len(sys.argv) > 1 else "localhost"
+    port = int(sys.argv[2]) if len(sys.argv) > 2 else 1883
+    TimeResponder(host, port).start()
+    while True:
+        time.sleep(3600)
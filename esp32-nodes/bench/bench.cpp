@@ -0,0 +1,255 @@
+// bench.cpp — host microbenchmarks for every node's hot paths.
+//
+// For each node source (bench_nodes.cpp) three cases are timed:
+//
+//   control     the node's MQTT callback over its recorded control messages
+//               (corpus/control.txt, cycled): token parse → guard
+//   json        step(true): render + flush, stats sampling, payload build and
+//               publish with JSON telemetry
+//   bin         the same with the packed binary encoding (wr_schema.h)
+//
+// Each case reports ns/op (host CPU — compare runs on one machine, not with
+// the ESP32), heap allocations/op (global operator new; the wr:: hot paths
+// are meant to stay at 0) and published bytes/op.
+//
+//   pio run -e native && .pio/build/native/program [options]
+//
+//   --corpus FILE       control messages, `mosquitto_sub -v` format
+//                       (default bench/corpus/control.txt)
+//   --filter TEXT       only cases whose "<node>/<case>" contains TEXT
+//   --min-time SEC      time each case at least this long (default 0.2)
+//   --json FILE         write the results (a JSON array, one case per line)
+//   --baseline FILE     compare with an earlier --json run; exit 1 if any
+//                       case allocates more per op, or is slower by more
+//                       than --tolerance percent (default 25)
+#include <Arduino.h>
+
+#include <chrono>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+
+// ── allocation counter ───────────────────────────────────────────────────────
+
+static unsigned long g_allocs = 0;
+
+void *operator new(size_t n) {
+  ++g_allocs;
+  if (void *p = malloc(n ? n : 1)) return p;
+  throw std::bad_alloc();
+}
+void *operator new[](size_t n) { return operator new(n); }
+void *operator new(size_t n, const std::nothrow_t &) noexcept { ++g_allocs; return malloc(n ? n : 1); }
+void *operator new[](size_t n, const std::nothrow_t &) noexcept { ++g_allocs; return malloc(n ? n : 1); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+namespace {
+
+// Virtual time per op: one stats sample (WR_STATS_HZ = 20) per step().
+constexpr unsigned long OP_ADVANCE_US = 50000;
+
+struct Message {
+  std::string topic;
+  std::vector<uint8_t> payload;
+};
+
+struct Result {
+  std::string name;
+  double ns_per_op;
+  double allocs_per_op;
+  double bytes_per_op;
+};
+
+struct Options {
+  std::string corpus = "bench/corpus/control.txt";
+  std::string filter;
+  std::string json;
+  std::string baseline;
+  double min_time = 0.2;
+  double tolerance = 25.0;
+};
+
+bool loadCorpus(const std::string &path, std::vector<Message> &out) {
+  FILE *f = fopen(path.c_str(), "r");
+  if (!f) return false;
+  char line[512];
+  while (fgets(line, sizeof(line), f)) {
+    size_t n = strlen(line);
+    while (n && (line[n - 1] == '\n' || line[n - 1] == '\r')) line[--n] = 0;
+    char *sp = strchr(line, ' ');
+    if (!n || line[0] == '#' || !sp) continue;
+    *sp = 0;
+    Message m;
+    m.topic = line;
+    m.payload.assign(reinterpret_cast<uint8_t *>(sp + 1), reinterpret_cast<uint8_t *>(line + n));
+    out.push_back(std::move(m));
+  }
+  fclose(f);
+  return true;
+}
+
+// "winter-river/<id>/control" → does <id> belong to this node source?
+bool routes(const Message &m, const bench::Node &node) {
+  const size_t a = m.topic.find('/');
+  if (a == std::string::npos) return false;
+  return m.topic.compare(a + 1, strlen(node.prefix), node.prefix) == 0;
+}
+
+// Runs op(i) in growing batches until min_time has elapsed.
+template <typename Op>
+Result measure(const std::string &name, double min_time, Op op) {
+  for (int i = 0; i < 16; ++i) op(i);   // warm-up: first-use buffer growth etc.
+  using clock = std::chrono::steady_clock;
+  unsigned long iters = 0, batch = 64;
+  const unsigned long allocs0 = g_allocs;
+  const unsigned long bytes0 = bench::publishedBytes();
+  double elapsed = 0;
+  while (elapsed < min_time) {
+    const auto t0 = clock::now();
+    for (unsigned long i = 0; i < batch; ++i) op(iters + i);
+    elapsed += std::chrono::duration<double>(clock::now() - t0).count();
+    iters += batch;
+    if (batch < (1UL << 20)) batch *= 2;
+  }
+  return Result{name, elapsed * 1e9 / iters, double(g_allocs - allocs0) / iters,
+                double(bench::publishedBytes() - bytes0) / iters};
+}
+
+void writeJson(const std::string &path, const std::vector<Result> &results) {
+  FILE *f = fopen(path.c_str(), "w");
+  if (!f) { fprintf(stderr, "cannot write %s\n", path.c_str()); return; }
+  fprintf(f, "[\n");
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result &r = results[i];
+    fprintf(f, "{\"name\":\"%s\",\"ns_per_op\":%.1f,\"allocs_per_op\":%.3f,\"bytes_per_op\":%.1f}%s\n",
+            r.name.c_str(), r.ns_per_op, r.allocs_per_op, r.bytes_per_op,
+            i + 1 < results.size() ? "," : "");
+  }
+  fprintf(f, "]\n");
+  fclose(f);
+}
+
+bool readJson(const std::string &path, std::vector<Result> &out) {
+  FILE *f = fopen(path.c_str(), "r");
+  if (!f) return false;
+  char line[256], name[128];
+  Result r;
+  while (fgets(line, sizeof(line), f)) {
+    if (sscanf(line, "{\"name\":\"%127[^\"]\",\"ns_per_op\":%lf,\"allocs_per_op\":%lf,\"bytes_per_op\":%lf",
+               name, &r.ns_per_op, &r.allocs_per_op, &r.bytes_per_op) == 4) {
+      r.name = name;
+      out.push_back(r);
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+// Returns the number of regressions against `base`.
+int compare(const std::vector<Result> &results, const std::vector<Result> &base, double tolerance) {
+  int bad = 0;
+  for (const Result &r : results) {
+    for (const Result &b : base) {
+      if (b.name != r.name) continue;
+      const double pct = b.ns_per_op > 0 ? (r.ns_per_op / b.ns_per_op - 1.0) * 100.0 : 0.0;
+      const bool alloc_up = r.allocs_per_op > b.allocs_per_op + 0.005;
+      const bool slower = pct > tolerance;
+      if (alloc_up || slower) {
+        ++bad;
+        printf("REGRESSION %-28s %+7.1f%% ns/op (%.0f → %.0f)  allocs/op %.2f → %.2f\n",
+               r.name.c_str(), pct, b.ns_per_op, r.ns_per_op, b.allocs_per_op, r.allocs_per_op);
+      }
+    }
+  }
+  return bad;
+}
+
+bool parseArgs(int argc, char **argv, Options &o) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string a = argv[i];
+    const bool has_value = i + 1 < argc;
+    if (a == "--corpus" && has_value)          o.corpus = argv[++i];
+    else if (a == "--filter" && has_value)     o.filter = argv[++i];
+    else if (a == "--json" && has_value)       o.json = argv[++i];
+    else if (a == "--baseline" && has_value)   o.baseline = argv[++i];
+    else if (a == "--min-time" && has_value)   o.min_time = atof(argv[++i]);
+    else if (a == "--tolerance" && has_value)  o.tolerance = atof(argv[++i]);
+    else {
+      fprintf(stderr, "usage: %s [--corpus FILE] [--filter TEXT] [--min-time SEC] "
+                      "[--json FILE] [--baseline FILE [--tolerance PCT]]\n", argv[0]);
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options opt;
+  if (!parseArgs(argc, argv, opt)) return 2;
+
+  std::vector<Message> corpus;
+  if (!loadCorpus(opt.corpus, corpus) && !loadCorpus("corpus/control.txt", corpus)) {
+    fprintf(stderr, "cannot read corpus %s (run from esp32-nodes/ or pass --corpus)\n",
+            opt.corpus.c_str());
+    return 2;
+  }
+
+  std::vector<Result> results;
+  printf("%-28s %10s %10s %8s\n", "case", "ns/op", "allocs/op", "B/op");
+  for (size_t n = 0; n < bench::nodeCount(); ++n) {
+    const bench::Node &node = bench::nodes()[n];
+
+    std::vector<Message> mine;
+    for (const Message &m : corpus) {
+      if (routes(m, node)) mine.push_back(m);
+    }
+    // PubSubClient hands the callback a mutable buffer; give each op its own
+    // copy so a parser that writes into it cannot change the next round.
+    std::vector<std::vector<uint8_t>> scratch;
+    for (const Message &m : mine) scratch.push_back(m.payload);
+    std::vector<char> topic(64, 0);
+
+    struct Case { const char *name; bool binary; bool control; };
+    static const Case CASES[] = {{"control", false, true}, {"json", false, false}, {"bin", true, false}};
+    for (const Case &c : CASES) {
+      const std::string name = std::string(node.name) + "/" + c.name;
+      if (!opt.filter.empty() && name.find(opt.filter) == std::string::npos) continue;
+      if (c.control && mine.empty()) continue;
+      bench::resetHelperState(c.binary);
+      Result r = c.control
+          ? measure(name, opt.min_time, [&](unsigned long i) {
+              const size_t k = i % mine.size();
+              std::vector<uint8_t> &buf = scratch[k];
+              memcpy(buf.data(), mine[k].payload.data(), buf.size());
+              node.on_mqtt(topic.data(), buf.data(), static_cast<unsigned int>(buf.size()));
+            })
+          : measure(name, opt.min_time, [&](unsigned long) {
+              native::advanceMicros(OP_ADVANCE_US);
+              node.step(true);
+            });
+      printf("%-28s %10.0f %10.2f %8.1f\n", r.name.c_str(), r.ns_per_op, r.allocs_per_op, r.bytes_per_op);
+      results.push_back(r);
+    }
+  }
+  bench::resetHelperState(false);
+
+  if (!opt.json.empty()) writeJson(opt.json, results);
+  if (!opt.baseline.empty()) {
+    std::vector<Result> base;
+    if (!readJson(opt.baseline, base)) {
+      fprintf(stderr, "cannot read baseline %s\n", opt.baseline.c_str());
+      return 2;
+    }
+    const int bad = compare(results, base, opt.tolerance);
+    printf("%d regression(s) against %s\n", bad, opt.baseline.c_str());
+    return bad ? 1 : 0;
+  }
+  return 0;
+}
@@ -0,0 +1,42 @@
+// bench.h — the node sources compiled for the host (bench_nodes.cpp), as used
+// by the native benchmark (bench.cpp) and the fleet load generator
+// (loadgen/loadgen.cpp).
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace bench {
+
+typedef void (*ControlFn)(char *topic, uint8_t *payload, unsigned int length);
+typedef void (*StepFn)(bool telemetry_tick);
+
+// One node source compiled into the benchmark.
+struct Node {
+  const char *name;       // env / source name
+  const char *prefix;     // corpus node_ids routed here (topic segment prefix)
+  ControlFn on_mqtt;      // the node's MQTT callback: parse → guard
+  StepFn step;            // render, stats, build + publish
+};
+
+const Node *nodes();
+size_t nodeCount();
+
+// Reset helper-wide runtime state (encoding, publish policy) between nodes.
+void resetHelperState(bool binary);
+
+// Bytes published since start (PubSubClient stand-in counter).
+unsigned long publishedBytes();
+
+// The most recent wr::mqtt.publish(); `count` is the running total, so a
+// caller can tell whether a step() published at all.
+struct Published {
+  unsigned long count;
+  const char *topic;        // as the node built it: winter-river/<NODE_ID>/...
+  const uint8_t *payload;
+  size_t length;
+  bool retained;
+};
+Published lastPublished();
+
+}  // namespace bench
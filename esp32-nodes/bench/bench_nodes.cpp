@@ -0,0 +1,109 @@
+// bench_nodes.cpp — every node source, compiled into one translation unit.
+//
+// Each node file is a complete sketch (file-static state, setup(), loop()),
+// so each is included inside its own namespace. The helper headers are
+// included first, at global scope, so the node files' own #includes are
+// no-ops (#pragma once) and every node shares one wr:: helper instance, as
+// on a board. One translation unit also keeps winter_river.h to a single
+// inclusion.
+#include <winter_river.h>
+#include <wr_deadband.h>
+#include <wr_json.h>
+#include <wr_latency.h>
+#include <wr_link.h>
+#include <wr_mailbox.h>
+#include <wr_node.h>
+#include <wr_oled.h>
+#include <wr_prof.h>
+#include <wr_schema.h>
+#include <wr_state.h>
+#include <wr_stats.h>
+#include <wr_tasks.h>
+#include <wr_telemetry.h>
+#include <wr_tokens.h>
+
+#include "bench.h"
+
+#define WR_NODE_ID "utility_a"
+namespace utility {
+#include "../src/utility/utility.cpp"
+}
+#undef WR_NODE_ID
+#define WR_NODE_ID "hv_mv_transformer_a"
+namespace hv_mv_transformer {
+#include "../src/hv_mv_transformer/hv_mv_transformer.cpp"
+}
+#undef WR_NODE_ID
+#define WR_NODE_ID "mv_switchgear_a"
+namespace mv_switchgear {
+#include "../src/mv_switchgear/mv_switchgear.cpp"
+}
+#undef WR_NODE_ID
+#define WR_NODE_ID "mv_lv_transformer_a"
+namespace mv_lv_transformer {
+#include "../src/mv_lv_transformer/mv_lv_transformer.cpp"
+}
+#undef WR_NODE_ID
+#define WR_NODE_ID "lv_switchgear_a"
+namespace lv_switchgear {
+#include "../src/lv_switchgear/lv_switchgear.cpp"
+}
+#undef WR_NODE_ID
+#define WR_NODE_ID "generator_a"
+namespace generator {
+#include "../src/generator/generator.cpp"
+}
+#undef WR_NODE_ID
+#define WR_NODE_ID "ups_a"
+namespace ups {
+#include "../src/ups/ups.cpp"
+}
+#undef WR_NODE_ID
+#define WR_NODE_ID "cooling_a"
+namespace cooling {
+#include "../src/cooling/cooling.cpp"
+}
+#undef WR_NODE_ID
+#define WR_NODE_ID "server_rack_a1"
+namespace server_rack {
+#include "../src/server_rack/server_rack.cpp"
+}
+#undef WR_NODE_ID
+
+namespace bench {
+
+// Each source is compiled once, as its Side A (or first rack) node id; its
+// prefix routes both sides' corpus messages to it.
+#define WR_BENCH_NODE(ns, node, prefix) {#ns, prefix, ns::node::onMqtt, ns::node::step}
+
+static const Node NODES[] = {
+  WR_BENCH_NODE(utility,            UtilityNode,          "utility_"),
+  WR_BENCH_NODE(hv_mv_transformer,  HvMvTransformerNode,  "hv_mv_transformer_"),
+  WR_BENCH_NODE(mv_switchgear,      MvSwitchgearNode,     "mv_switchgear_"),
+  WR_BENCH_NODE(mv_lv_transformer,  MvLvTransformerNode,  "mv_lv_transformer_"),
+  WR_BENCH_NODE(lv_switchgear,      LvSwitchgearNode,     "lv_switchgear_"),
+  WR_BENCH_NODE(generator,          GeneratorNode,        "generator_"),
+  WR_BENCH_NODE(ups,                UpsNode,              "ups_"),
+  WR_BENCH_NODE(cooling,            CoolingNode,          "cooling_"),
+  WR_BENCH_NODE(server_rack,        ServerRackNode,       "server_rack_"),
+};
+
+#undef WR_BENCH_NODE
+
+const Node *nodes() { return NODES; }
+size_t nodeCount() { return sizeof(NODES) / sizeof(NODES[0]); }
+
+void resetHelperState(bool binary) {
+  wr::binaryTelemetry() = binary;
+  wr::onChangeTelemetry() = false;
+}
+
+unsigned long publishedBytes() { return wr::mqtt.published_bytes; }
+
+Published lastPublished() {
+  return Published{wr::mqtt.published, wr::mqtt.last_topic,
+                   reinterpret_cast<const uint8_t *>(wr::mqtt.last), wr::mqtt.last_len,
+                   wr::mqtt.last_retained};
+}
+
+}  // namespace bench
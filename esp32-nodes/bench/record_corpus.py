@@ -0,0 +1,148 @@
+"""
+Record the control-message corpus for the native firmware benchmark.
+
+Runs the real broker engine (broker/main.py) offline — PostgreSQL replaced by
+an in-memory live_status table, MQTT by a recorder — through a Side-A utility
+outage and recovery, and writes every control message it publishes in
+`mosquitto_sub -v` format (topic, space, payload), the same format a capture
+from a live system has:
+
+    mosquitto_sub -h 192.168.4.1 -t 'winter-river/+/control' -v -C 2000 > corpus/control.txt
+
+The broker never commands utility nodes, so the operator commands for those
+(outage / sag / recovery injection) are appended by hand below.
+
+    cd esp32-nodes/bench && python3 record_corpus.py [--ticks N]
+"""
+
+import argparse
+import os
+import re
+import sys
+from unittest.mock import MagicMock
+
+HERE = os.path.abspath(os.path.dirname(__file__))
+REPO = os.path.abspath(os.path.join(HERE, "..", ".."))
+BROKER = os.path.join(REPO, "broker")
+sys.path.insert(0, BROKER)
+if not os.path.exists(os.path.join(BROKER, "config.toml")):
+    os.environ.setdefault("WINTER_RIVER_CONFIG", os.path.join(BROKER, "config.sample.toml"))
+
+import main as broker_main                     # noqa: E402
+from control_latency import ControlLatency     # noqa: E402
+from thermal import ThermalConfig, resolve_weather   # noqa: E402
+
+NODE_ROW = re.compile(r"\('(\w+)',\s*'(\w+)',\s*'(\w)',\s*(NULL|'\w+'),\s*(NULL|'\w+'),\s*([\d.]+),\s*([\d.]+)\)")
+
+# Operator commands for the utility nodes, as injected during drills.
+UTILITY_COMMANDS = [
+    "STATUS:GRID_OK", "VOLT:230000.0 STATUS:GRID_OK", "STATUS:SAG", "VOLT:207000.0",
+    "STATUS:OUTAGE", "VOLT:0", "STATUS:SWELL", "VOLT:253000.0", "STATUS:GRID_OK",
+]
+
+
+def load_nodes():
+    with open(os.path.join(REPO, "scripts", "init_db.sql")) as f:
+        sql = f.read()
+    nodes = {}
+    for nid, ntype, side, parent, secondary, rated, ratio in NODE_ROW.findall(sql):
+        nodes[nid] = {
+            "node_id": nid, "node_type": ntype, "side": side,
+            "parent_id": None if parent == "NULL" else parent.strip("'"),
+            "secondary_parent_id": None if secondary == "NULL" else secondary.strip("'"),
+            "rated_voltage": float(rated), "v_ratio": float(ratio),
+            "is_present": True, "v_in": 0.0, "v_out": 0.0, "status_msg": "NORMAL",
+            "battery_level": 100, "gen_timer": broker_main.GEN_STARTUP_TICKS,
+        }
+    for nid, n in nodes.items():
+        if n["node_type"] == "UTILITY":
+            n["status_msg"] = "GRID_OK"
+    return nodes
+
+
+class FakeDb:
+    """Just enough of psycopg2 for run_simulation_tick()."""
+
+    def __init__(self, nodes):
+        self.nodes = nodes
+
+    def cursor(self):
+        db = self
+
+        class Cursor:
+            rowcount = 0
+
+            def __enter__(self):
+                return self
+
+            def __exit__(self, *a):
+                return False
+
+            def execute(self, sql, params=()):
+                if sql.lstrip().startswith("UPDATE live_status") and "v_out=%s" in sql:
+                    v_out, status, batt, timer, nid = params
+                    db.nodes[nid].update(v_out=v_out, status_msg=status,
+                                         battery_level=batt, gen_timer=timer)
+
+            def fetchall(self):
+                return [dict(n) for n in db.nodes.values()]
+
+        return Cursor()
+
+    def commit(self):
+        pass
+
+    def rollback(self):
+        pass
+
+
+def record(ticks):
+    nodes = load_nodes()
+    eng = broker_main.WinterRiverEngine.__new__(broker_main.WinterRiverEngine)
+    eng.db = FakeDb(nodes)
+    eng.mqtt_client = MagicMock()
+    eng._thermal_cfg = ThermalConfig()
+    eng._weather = resolve_weather({"preset": broker_main.DEFAULT_WEATHER_PRESET})
+    eng._latest_thermal = None
+    eng._facility_metrics_disabled = True
+    eng._known_nodes = set(nodes)
+    eng._bin_echo = {}
+    per_side = eng._thermal_cfg.fans_per_module
+    eng._cooling_fans = {"cooling_a": per_side, "cooling_b": per_side}
+    sim_ms = [0]                                   # 1 Hz tick clock: reproducible T: stamps
+    eng._control_latency = ControlLatency(clock=lambda: sim_ms[0])
+    eng._latency_reported_at = 0.0
+    eng._load = {"ingested": 0, "rejected": 0, "controls": 0, "ticks": 0, "tick_overruns": 0}
+    eng._influx_write_api = None
+
+    lines = []
+    for tick in range(ticks):
+        if tick == ticks // 6:
+            nodes["utility_a"]["status_msg"] = "OUTAGE"       # Side-A grid loss
+        if tick == ticks // 2:
+            nodes["utility_a"]["status_msg"] = "GRID_OK"      # recovery
+        sim_ms[0] = tick * 1000
+        eng.mqtt_client.reset_mock()
+        eng.run_simulation_tick()
+        for call in eng.mqtt_client.publish.call_args_list:
+            topic, payload = call.args[0], call.args[1]
+            if topic.endswith("/control"):
+                lines.append(f"{topic} {payload}")
+    for side in "ab":
+        lines += [f"winter-river/utility_{side}/control {c}" for c in UTILITY_COMMANDS]
+    return lines
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    ap.add_argument("--ticks", type=int, default=120)
+    ap.add_argument("--out", default=os.path.join(HERE, "corpus", "control.txt"))
+    args = ap.parse_args()
+    lines = record(args.ticks)
+    with open(args.out, "w") as f:
+        f.write("\n".join(lines) + "\n")
+    print(f"{len(lines)} messages → {args.out}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,52 @@
+// winter_river.h — host stand-in for the node library's core header, for the
+// checks in this directory only.
+//
+// The helpers a check builds (wr_tick.h, wr_scenario.h, ...) reach the MQTT
+// client through wr::mqtt. This declares it, on the transport wr_mqtt.h
+// selects, plus what a whole node source needs to compile (wrnode.cpp):
+// the network settings, the display and its shared rows, and the connect
+// calls, none of which does anything. A check never connects. Put
+// check/include first on the include path.
+#pragma once
+
+#include <Arduino.h>
+#include <Adafruit_GFX.h>
+#include <Adafruit_SSD1306.h>
+#include <PubSubClient.h>
+#include <WiFi.h>
+#include <Wire.h>
+
+#include <wr_mqtt.h>
+
+namespace wr {
+
+static const char *const SSID = "check";
+static const char *const PASSWORD = "check";
+static const char *const MQTT_SERVER = "127.0.0.1";
+static const unsigned long TELEMETRY_INTERVAL_MS = 5000;
+
+inline MqttTransport &mqttClient() {
+  static MqttTransport client;
+  return client;
+}
+static MqttTransport &mqtt = mqttClient();
+
+inline Adafruit_SSD1306 &displayDevice() {
+  static Adafruit_SSD1306 d(128, 64, &Wire, -1);
+  return d;
+}
+static Adafruit_SSD1306 &display = displayDevice();
+
+inline unsigned long &messageCount() {
+  static unsigned long n = 0;
+  return n;
+}
+static unsigned long &message_count = messageCount();
+
+inline void displayHeader(const char *, const char *) {}
+inline void displayNetLine() {}
+inline void displayFooter() {}
+inline bool mqttReconnect(const char *) { return false; }
+inline void begin(const char *, void (*)(char *, byte *, unsigned int)) {}
+
+}  // namespace wr
@@ -0,0 +1,357 @@
+// wrmqtt.cpp — host check of the firmware's MQTT client (wr::AsyncMqtt, wr_mqtt.h).
+//
+// Plays the broker on a 127.0.0.1 socket in the same process and scripts the
+// bytes it sends and expects, one case per run:
+//
+//   framing      1- and 2-byte remaining lengths; a packet larger than the
+//                receive buffer is skipped and the next one still delivered
+//   split        a packet arriving one byte per read
+//   coalesced    several packets in one read; an incoming QoS 1 publish is
+//                acknowledged
+//   window       WR_MQTT_WINDOW QoS 1 publishes in flight, the next refused;
+//                PUBACKs free them, the rest go again with DUP after
+//                MQTT_RETRY_MS
+//   keepalive    PINGREQ after the keepalive; no PINGRESP by the next one
+//                drops the session (CONNECTION_TIMEOUT)
+//   refused      a CONNACK refusal code becomes state()
+//   malformed    a 5-byte remaining length after a good packet drops the
+//                session (CONNECTION_LOST) without touching the buffer
+//
+//   g++ -std=gnu++11 -pthread -DWR_MQTT_ASYNC=1 -Inative/include
+//       -Ilib/winter_river/src check/wrmqtt.cpp native/native.cpp -o wrmqtt
+//   ./wrmqtt CASE
+//
+// Time is the native env's virtual clock, moved by native::advanceMicros();
+// only connect() waits in real time. Exits 0 if the case passed, 1 with the
+// failed check on stderr. tests/test_mqtt_async.py builds and runs every case.
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <wr_mqtt.h>
+
+namespace native {
+void advanceMicros(unsigned long us);
+}
+
+namespace {
+
+#define CHECK(cond)                                                    \
+  do {                                                                 \
+    if (!(cond)) {                                                     \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      return false;                                                    \
+    }                                                                  \
+  } while (0)
+
+typedef std::vector<uint8_t> Bytes;
+
+const char TOPIC[] = "winter-river/ups_a/control";
+
+wr::AsyncMqtt client;
+std::vector<std::string> delivered;   // "topic payload", in order
+
+void onMessage(char *topic, uint8_t *payload, unsigned int len) {
+  delivered.push_back(std::string(topic) + " " + std::string(reinterpret_cast<char *>(payload), len));
+}
+
+// ── the broker end ───────────────────────────────────────────────────────
+
+int listener = -1;
+uint16_t port = 0;
+
+bool listen() {
+  listener = ::socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t n = sizeof(addr);
+  if (listener < 0 || ::bind(listener, reinterpret_cast<struct sockaddr *>(&addr), n) < 0 ||
+      ::listen(listener, 1) < 0 || getsockname(listener, reinterpret_cast<struct sockaddr *>(&addr), &n) < 0) {
+    return false;
+  }
+  port = ntohs(addr.sin_port);
+  return true;
+}
+
+bool waitFor(int fd, short events, int ms = 1000) {
+  struct pollfd p = {fd, events, 0};
+  return poll(&p, 1, ms) > 0;
+}
+
+bool readByte(int fd, Bytes &out) {
+  uint8_t b;
+  if (!waitFor(fd, POLLIN) || ::recv(fd, &b, 1, 0) != 1) return false;
+  out.push_back(b);
+  return true;
+}
+
+// One whole packet from the client, or empty after a second of silence.
+Bytes readPacket(int fd) {
+  Bytes out;
+  if (!readByte(fd, out)) return Bytes();
+  size_t remaining = 0;
+  for (int i = 0; i < 4; ++i) {
+    if (!readByte(fd, out)) return Bytes();
+    remaining |= static_cast<size_t>(out.back() & 0x7F) << (7 * i);
+    if (!(out.back() & 0x80)) break;
+  }
+  while (remaining--) {
+    if (!readByte(fd, out)) return Bytes();
+  }
+  return out;
+}
+
+bool quiet(int fd) { return !waitFor(fd, POLLIN, 50); }
+
+void sendBytes(int fd, const Bytes &b) { ::send(fd, b.data(), b.size(), 0); }
+
+Bytes publishPacket(const char *topic, const std::string &payload, uint8_t qos = 0, uint16_t id = 0) {
+  const size_t tlen = strlen(topic);
+  size_t remaining = 2 + tlen + (qos ? 2 : 0) + payload.size();
+  Bytes b(1, static_cast<uint8_t>(0x30 | qos << 1));
+  do {
+    const uint8_t v = remaining & 0x7F;
+    remaining >>= 7;
+    b.push_back(remaining ? v | 0x80 : v);
+  } while (remaining);
+  b.push_back(static_cast<uint8_t>(tlen >> 8));
+  b.push_back(static_cast<uint8_t>(tlen));
+  b.insert(b.end(), topic, topic + tlen);
+  if (qos) {
+    b.push_back(static_cast<uint8_t>(id >> 8));
+    b.push_back(static_cast<uint8_t>(id));
+  }
+  b.insert(b.end(), payload.begin(), payload.end());
+  return b;
+}
+
+Bytes ack(uint8_t type, uint16_t id) {
+  return Bytes{type, 0x02, static_cast<uint8_t>(id >> 8), static_cast<uint8_t>(id)};
+}
+
+uint16_t packetId(const Bytes &publish) {
+  const size_t at = 2 + 2 + (publish[2] << 8 | publish[3]);   // 1-byte length: our publishes are small
+  return static_cast<uint16_t>(publish[at] << 8 | publish[at + 1]);
+}
+
+// Accepts the client's connection, reads CONNECT and answers with `code` on
+// a thread, since connect() blocks until CONNACK. Returns the broker's end.
+int connectClient(uint8_t code, uint16_t keepalive_s = 15) {
+  int server = -1;
+  bool saw_connect = false;
+  std::thread broker([&] {
+    if (!waitFor(listener, POLLIN, 3000)) return;
+    server = ::accept(listener, nullptr, nullptr);
+    const Bytes connect = readPacket(server);
+    saw_connect = connect.size() > 2 && connect[0] == 0x10;
+    sendBytes(server, Bytes{0x20, 0x02, 0x00, code});
+  });
+  client.setServer("127.0.0.1", port).setCallback(onMessage).setKeepAlive(keepalive_s).setSocketTimeout(3);
+  client.connect("ups_a");
+  broker.join();
+  if (!saw_connect && server >= 0) {
+    ::close(server);
+    server = -1;
+  }
+  return server;
+}
+
+// Lets bytes the broker just sent reach the client, then runs one pass.
+void pass() {
+  if (client.fd() >= 0) waitFor(client.fd(), POLLIN, 50);
+  client.loop();
+}
+
+// ── cases ────────────────────────────────────────────────────────────────
+
+bool framing() {
+  const int server = connectClient(0);
+  CHECK(server >= 0 && client.connected());
+  const std::string small = "FANS_RUNNING:2";
+  const std::string medium(300, 'm');                        // 2-byte remaining length
+  const std::string huge(wr::MQTT_RX_BYTES + 100, 'h');      // larger than the receive buffer
+  sendBytes(server, publishPacket(TOPIC, small));
+  sendBytes(server, publishPacket(TOPIC, medium));
+  sendBytes(server, publishPacket(TOPIC, huge));
+  sendBytes(server, publishPacket(TOPIC, "after"));
+  for (int i = 0; i < 10 && delivered.size() < 3; ++i) pass();
+  CHECK(delivered.size() == 3);
+  CHECK(delivered[0] == std::string(TOPIC) + " " + small);
+  CHECK(delivered[1] == std::string(TOPIC) + " " + medium);
+  CHECK(delivered[2] == std::string(TOPIC) + " after");
+  CHECK(client.stats().oversize == 1);
+  CHECK(client.connected());
+  return true;
+}
+
+bool split() {
+  const int server = connectClient(0);
+  CHECK(server >= 0 && client.connected());
+  const Bytes packet = publishPacket(TOPIC, std::string(200, 's'));
+  for (size_t i = 0; i < packet.size(); ++i) {
+    sendBytes(server, Bytes(1, packet[i]));
+    pass();
+    CHECK(delivered.size() == (i + 1 == packet.size() ? 1u : 0u));
+  }
+  CHECK(delivered[0] == std::string(TOPIC) + " " + std::string(200, 's'));
+  CHECK(client.connected());
+  return true;
+}
+
+bool coalesced() {
+  const int server = connectClient(0);
+  CHECK(server >= 0 && client.connected());
+  Bytes burst;
+  for (const char *p : {"A:1", "B:2"}) {
+    const Bytes b = publishPacket(TOPIC, p);
+    burst.insert(burst.end(), b.begin(), b.end());
+  }
+  const Bytes qos1 = publishPacket(TOPIC, "C:3", 1, 0x1234);
+  burst.insert(burst.end(), qos1.begin(), qos1.end());
+  burst.push_back(0xD0);                                     // PINGRESP
+  burst.push_back(0x00);
+  sendBytes(server, burst);
+  pass();
+  CHECK(delivered.size() == 3);
+  CHECK(delivered[0] == std::string(TOPIC) + " A:1");
+  CHECK(delivered[2] == std::string(TOPIC) + " C:3");
+  client.loop();                                             // the PUBACK goes out
+  CHECK(readPacket(server) == ack(0x40, 0x1234));
+  CHECK(client.connected());
+  return true;
+}
+
+bool window() {
+  const int server = connectClient(0);
+  CHECK(server >= 0 && client.connected());
+  const uint8_t payload[] = "{\"seq\":1}";
+  for (int i = 0; i < WR_MQTT_WINDOW; ++i) {
+    CHECK(client.publish("winter-river/ups_a/status", payload, sizeof(payload) - 1, false, 1));
+  }
+  CHECK(!client.publish("winter-river/ups_a/status", payload, sizeof(payload) - 1, false, 1));
+  CHECK(client.stats().refused == 1);
+  CHECK(client.inFlight() == WR_MQTT_WINDOW);
+  CHECK(client.publish("winter-river/ups_a/status", payload, sizeof(payload) - 1, false, 0));
+
+  std::vector<uint16_t> ids;
+  for (int i = 0; i < WR_MQTT_WINDOW; ++i) {
+    const Bytes p = readPacket(server);
+    CHECK(p.size() > 4 && p[0] == 0x32);                     // QoS 1, no DUP
+    ids.push_back(packetId(p));
+  }
+  const Bytes q0 = readPacket(server);
+  CHECK(q0.size() > 4 && q0[0] == 0x30);
+  for (int i = 0; i < WR_MQTT_WINDOW; ++i) {
+    for (int j = 0; j < i; ++j) CHECK(ids[i] != ids[j]);
+  }
+
+  Bytes acks = ack(0x40, ids[0]);
+  const Bytes second = ack(0x40, ids[2]);
+  acks.insert(acks.end(), second.begin(), second.end());
+  sendBytes(server, acks);
+  pass();
+  CHECK(client.stats().acked == 2);
+  CHECK(client.inFlight() == WR_MQTT_WINDOW - 2);
+  CHECK(quiet(server));                                      // nothing resent yet
+
+  native::advanceMicros(wr::MQTT_RETRY_MS * 1000UL);
+  client.loop();
+  CHECK(client.stats().retries == WR_MQTT_WINDOW - 2u);
+  acks.clear();
+  for (int i = 0; i < WR_MQTT_WINDOW - 2; ++i) {
+    const Bytes p = readPacket(server);
+    CHECK(p.size() > 4 && p[0] == 0x3A);                     // QoS 1 with DUP
+    const uint16_t id = packetId(p);
+    CHECK(id == ids[1] || id == ids[3]);
+    const Bytes a = ack(0x40, id);
+    acks.insert(acks.end(), a.begin(), a.end());
+  }
+  sendBytes(server, acks);
+  pass();
+  CHECK(client.inFlight() == 0);
+  CHECK(client.stats().acked == WR_MQTT_WINDOW);
+  CHECK(client.connected());
+  return true;
+}
+
+bool keepalive() {
+  const int server = connectClient(0, 5);
+  CHECK(server >= 0 && client.connected());
+  native::advanceMicros(4900 * 1000UL);
+  client.loop();
+  CHECK(quiet(server));
+  native::advanceMicros(100 * 1000UL);
+  client.loop();
+  CHECK(readPacket(server) == Bytes({0xC0, 0x00}));
+  sendBytes(server, Bytes{0xD0, 0x00});
+  pass();
+
+  native::advanceMicros(5000 * 1000UL);
+  client.loop();
+  CHECK(readPacket(server) == Bytes({0xC0, 0x00}));         // answered: another ping
+  native::advanceMicros(5000 * 1000UL);
+  CHECK(!client.loop());                                     // not answered
+  CHECK(client.state() == wr::AsyncMqtt::CONNECTION_TIMEOUT);
+  return true;
+}
+
+bool refused() {
+  connectClient(5);                                          // not authorised
+  CHECK(!client.connected());
+  CHECK(client.state() == 5);
+  CHECK(client.fd() < 0);
+  return true;
+}
+
+bool malformed() {
+  const int server = connectClient(0);
+  CHECK(server >= 0 && client.connected());
+  Bytes b = publishPacket(TOPIC, "ok");
+  const uint8_t bad[] = {0x30, 0xFF, 0xFF, 0xFF, 0xFF, 0x01};
+  b.insert(b.end(), bad, bad + sizeof(bad));
+  sendBytes(server, b);
+  pass();
+  CHECK(delivered.size() == 1);
+  CHECK(!client.connected());
+  CHECK(client.state() == wr::AsyncMqtt::CONNECTION_LOST);
+  return true;
+}
+
+struct Case {
+  const char *name;
+  bool (*run)();
+};
+
+const Case CASES[] = {
+    {"framing", framing}, {"split", split},       {"coalesced", coalesced}, {"window", window},
+    {"keepalive", keepalive}, {"refused", refused}, {"malformed", malformed},
+};
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s CASE\n", argv[0]);
+    return 2;
+  }
+  signal(SIGPIPE, SIG_IGN);
+  for (const Case &c : CASES) {
+    if (strcmp(c.name, argv[1]) != 0) continue;
+    if (!listen()) {
+      perror("listen");
+      return 2;
+    }
+    const bool ok = c.run();
+    printf("%s: %s\n", c.name, ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+  }
+  fprintf(stderr, "unknown case: %s\n", argv[1]);
+  return 2;
+}
@@ -0,0 +1,115 @@
+// wrnode.cpp — host check of a node's telemetry through the dual-core path
+// (wr::Node<>, wr_node.h; wr::outbox(), wr_mailbox.h).
+//
+// Builds the cooling node, the type with the largest payload, with
+// WR_DUAL_CORE. Every field is set to its widest text, the stats are
+// sampled and a stamped control message is applied, so the JSON carries the
+// control echo and loss counters too. One step() then publishes it: wr_sim
+// copies it into the outbox and wr_net hands it to the MQTT client, as
+// netTask() does. Prints
+//
+//   len=<n> bound=<Node::JSON_BYTES> slot=<OutgoingMessage::CAPACITY>
+//
+// and exits 1 unless the client got the whole payload, byte for byte.
+//
+// "backfill" keeps N telemetry ticks with the link down while wr_net is
+// stuck (in a blocking CONNECT, say), then lets it collect them:
+//
+//   kept=<n> ring=<records in the backfill ring> dropped=<n>
+//
+// "control" applies one control message, as the MQTT callback does, and
+// prints the field the SPEED keyword assigns:
+//
+//   speed=<fan_speed_pct>
+//
+//   g++ -std=gnu++11 -Icheck/include -Inative/include -Ilib/winter_river/src
+//       check/wrnode.cpp native/native.cpp -o wrnode
+//   ./wrnode
+//   ./wrnode backfill N
+//   ./wrnode control "SPEED:75"
+//
+// tests/test_node_outbox.py runs it.
+#define WR_DUAL_CORE 1
+#define WR_NODE_ID "cooling_a"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/cooling/cooling.cpp"
+
+namespace native {
+void advanceMicros(unsigned long us);
+}
+
+namespace {
+
+int backfill(int n) {
+  wr::backfill().begin(WR_NODE_ID);
+  for (int i = 0; i < n; ++i) {
+    native::advanceMicros(1000 * 1000UL);
+    CoolingNode::keep();   // wr_sim, one tick each
+  }
+  wr::backfill().collect();   // wr_net, back at last
+  printf("kept=%d ring=%u dropped=%lu\n", n, static_cast<unsigned>(wr::backfill().count()),
+         wr::backfill().dropped());
+  return 0;
+}
+
+int control(char *text) {
+  wr::detail::hooks() = {WR_NODE_ID, CoolingNode::onMqtt, CoolingNode::step, CoolingNode::keep};
+  wr::detail::applyControl(micros(), reinterpret_cast<byte *>(text),
+                           static_cast<unsigned>(strlen(text)));
+  printf("speed=%d\n", fan_speed_pct);
+  return 0;
+}
+
+int payload() {
+  input_v = -99999999.9f;
+  coolant_temp_f = INT_MIN;
+  fan_speed_pct = INT_MIN;
+  fans_running = INT_MIN;
+  load_pct = INT_MIN;
+  state = wr::State::DEGRADED;
+  for (int i = 0; i < 3; ++i) {
+    coolant_stat.add(-99999999.9f);
+    fan_stat.add(-99999999.9f);
+  }
+  char stamp[] = "SEQ:4294967295 T:4294967295";
+  wr::detail::hooks() = {WR_NODE_ID, CoolingNode::onMqtt, CoolingNode::step, CoolingNode::keep};
+  wr::detail::applyControl(micros(), reinterpret_cast<byte *>(stamp), sizeof(stamp) - 1);
+  // The handler re-derived the fan state from the stamp-only message; put
+  // the widest values back.
+  input_v = -99999999.9f;
+  coolant_temp_f = fan_speed_pct = fans_running = load_pct = INT_MIN;
+
+  CoolingNode::step(true);
+  const wr::JsonWriter &json = CoolingNode::payload().json();
+  printf("len=%u bound=%u slot=%u\n", static_cast<unsigned>(json.length()),
+         static_cast<unsigned>(CoolingNode::JSON_BYTES),
+         static_cast<unsigned>(wr::OutgoingMessage::CAPACITY));
+
+  wr::OutgoingMessage *m = wr::outbox().take();
+  if (!m) {
+    puts("NOT_QUEUED");
+    return 1;
+  }
+  wr::publishNow(m->topic, m->data, m->len, m->retained);
+  if (wr::mqtt.last_len != json.length() || memcmp(wr::mqtt.last, json.c_str(), json.length()) != 0 ||
+      strcmp(wr::mqtt.last_topic, "winter-river/cooling_a/status") != 0) {
+    printf("NOT_PUBLISHED: %s\n", wr::mqtt.last_topic);
+    return 1;
+  }
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc == 3 && strcmp(argv[1], "backfill") == 0) return backfill(atoi(argv[2]));
+  if (argc == 3 && strcmp(argv[1], "control") == 0) return control(argv[2]);
+  if (argc == 1) return payload();
+  fprintf(stderr, "usage: %s [backfill N | control TOKENS]\n", argv[0]);
+  return 2;
+}
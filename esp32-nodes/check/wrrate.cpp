@@ -0,0 +1,56 @@
+// wrrate.cpp — host check of the firmware's telemetry rate (wr::TelemetryRate, wr_rate.h)
+// and the RATE: / BURST: tokens that drive it (wr::handleCommonToken(), wr_telemetry.h).
+//
+// Reads control messages on stdin, one per line as "<ms> <tokens>", and
+// delivers each at that virtual ms. In between it polls the rate every ms,
+// as the node loop does, until --until MS (default 60000). Prints
+//
+//   <ms> ctl <taken 0|1 per token> idle=<ms>     after each message
+//   <ms> tick                                    each telemetry tick
+//
+//   g++ -std=gnu++11 -Icheck/include -Inative/include -Ilib/winter_river/src
+//       check/wrrate.cpp native/native.cpp -o wrrate
+//   echo "0 RATE:2000" | ./wrrate --until 10000
+//
+// tests/test_telemetry_rate.py checks the tick times.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <wr_telemetry.h>
+
+namespace native {
+void advanceMicros(unsigned long us);
+}
+
+int main(int argc, char **argv) {
+  unsigned long until = 60000;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--until") == 0 && i + 1 < argc) until = strtoul(argv[++i], nullptr, 10);
+  }
+  wr::TelemetryRate &rate = wr::telemetryRate();
+  static char line[256];
+  unsigned long next = 0;
+  bool have = false;
+  for (unsigned long ms = 0; ms <= until; ++ms) {
+    for (;;) {
+      if (!have) {
+        if (!fgets(line, sizeof(line), stdin)) break;
+        next = strtoul(line, nullptr, 10);
+        have = true;
+      }
+      if (next > ms) break;
+      char *text = strchr(line, ' ');
+      text = text ? text + 1 : line + strlen(line);
+      text[strcspn(text, "\n")] = '\0';
+      printf("%lu ctl ", ms);
+      wr::scanTokens(reinterpret_cast<const byte *>(text), static_cast<unsigned>(strlen(text)),
+                     [](const wr::Token &tok) { putchar(wr::handleCommonToken(tok) ? '1' : '0'); });
+      printf(" idle=%lu\n", rate.idle());
+      have = false;
+    }
+    if (rate.due()) printf("%lu tick\n", ms);
+    native::advanceMicros(1000);
+  }
+  return 0;
+}
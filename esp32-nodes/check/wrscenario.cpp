@@ -0,0 +1,86 @@
+// wrscenario.cpp — host check of the firmware's drill interpreter (wr::Scenario, wr_scenario.h).
+//
+// Delivers one compiled program (broker/scenario.py) to node "x" and runs it
+// the way the simulation task does: run(), then sleep for untilNext(). Prints
+// every control line the program applies, with the virtual ms since the
+// program arrived, then the final state:
+//
+//   <ms> <control text>
+//   ...
+//   state=<DONE|STOPPED|REJECTED|...> error=<n> late_ms=<n> program=<crc32>
+//
+//   --late MS      wake up to MS late after each sleep (seeded), as a busy
+//                  task would
+//   --stop-at MS   deliver the empty stop message at MS
+//   --until MS     give up at MS (default 600000), e.g. for "repeat forever"
+//
+//   g++ -std=gnu++11 -Icheck/include -Inative/include -Ilib/winter_river/src
+//       check/wrscenario.cpp native/native.cpp -o wrscenario
+//   ./wrscenario PROGRAM              # a payload from scenario.assemble()
+//
+// tests/test_scenario.py compiles programs with scenario.py and checks the
+// timeline.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <wr_scenario.h>
+
+namespace native {
+void advanceMicros(unsigned long us);
+}
+
+namespace {
+
+unsigned long t0 = 0;
+
+void apply(char *, byte *payload, unsigned int length) {
+  printf("%lu %.*s\n", millis() - t0, static_cast<int>(length), reinterpret_cast<char *>(payload));
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  static const char *const STATES[] = {"IDLE", "WAITING", "RUNNING", "DONE", "STOPPED", "REJECTED"};
+  const char *path = nullptr;
+  unsigned long late = 0, stop_at = 0, until = 600000;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--late") == 0 && i + 1 < argc) late = strtoul(argv[++i], nullptr, 10);
+    else if (strcmp(argv[i], "--stop-at") == 0 && i + 1 < argc) stop_at = strtoul(argv[++i], nullptr, 10);
+    else if (strcmp(argv[i], "--until") == 0 && i + 1 < argc) until = strtoul(argv[++i], nullptr, 10);
+    else path = argv[i];
+  }
+  FILE *f = path ? fopen(path, "rb") : nullptr;
+  if (!f) {
+    fprintf(stderr, "usage: %s PROGRAM [--late MS] [--stop-at MS] [--until MS]\n", argv[0]);
+    return 2;
+  }
+  static uint8_t program[4096];
+  const size_t n = fread(program, 1, sizeof(program), f);
+  fclose(f);
+
+  wr::Scenario &scenario = wr::scenario();
+  scenario.begin("x");
+  native::advanceMicros(1000 * 1000UL);   // not at millis() 0
+  srand(1);
+  t0 = millis();
+  scenario.receive("winter-river/x/scenario", program, static_cast<unsigned>(n));
+  for (;;) {
+    if (stop_at && millis() - t0 >= stop_at) {
+      scenario.receive("winter-river/x/scenario", program, 0);
+      stop_at = 0;
+    }
+    scenario.run(apply);
+    const wr::Scenario::State s = scenario.state();
+    if (s != wr::Scenario::State::WAITING && s != wr::Scenario::State::RUNNING) break;
+    if (millis() - t0 >= until) break;
+    unsigned long sleep = scenario.untilNext(1000);
+    if (stop_at && stop_at - (millis() - t0) < sleep) sleep = stop_at - (millis() - t0);
+    if (sleep && late) sleep += static_cast<unsigned long>(rand()) % (late + 1);
+    native::advanceMicros(sleep * 1000UL);
+  }
+  printf("state=%s error=%d late_ms=%lu program=%08lx\n", STATES[static_cast<int>(scenario.state())],
+         static_cast<int>(scenario.error()), static_cast<unsigned long>(scenario.lateMs()),
+         static_cast<unsigned long>(scenario.program()));
+  return 0;
+}
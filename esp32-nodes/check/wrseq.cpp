@@ -0,0 +1,29 @@
+// wrseq.cpp — host check of the firmware's loss tracker (wr::SeqTracker, wr_seq.h).
+//
+// Feeds the sequence numbers on stdin, whitespace-separated, to one tracker
+// and prints what each arrival was, one per line, then the counters:
+//
+//   first | in_order | gap | duplicate | reordered | restart
+//   ...
+//   rx=<n> lost=<n> dup=<n> reord=<n> restarts=<n>
+//
+//   g++ -std=gnu++11 -Ilib/winter_river/src check/wrseq.cpp -o wrseq
+//   echo 1 2 4 3 3 | ./wrseq
+//
+// broker/link_loss.py carries the same tracker; tests/test_link_loss.py runs
+// both over the same streams and compares the output line for line.
+#include <stdio.h>
+
+#include <wr_seq.h>
+
+int main() {
+  static const char *const ARRIVALS[] = {"first", "in_order", "gap", "duplicate", "reordered", "restart"};
+  wr::SeqTracker t;
+  unsigned long seq;
+  while (scanf("%lu", &seq) == 1) {
+    puts(ARRIVALS[static_cast<int>(t.observe(static_cast<uint32_t>(seq)))]);
+  }
+  printf("rx=%lu lost=%lu dup=%lu reord=%lu restarts=%lu\n", t.received(), t.lost(), t.duplicates(),
+         t.reordered(), t.restarts());
+  return 0;
+}
@@ -0,0 +1,70 @@
+// wrtick.cpp — host check of the firmware's tick frame receiver (wr::TickFrame, wr_tick.h).
+//
+// Acts as node NODE_ID and hands it the messages on stdin, one per line as
+// "<topic> <payload in hex>" (an empty payload is "<topic> -"). For each it
+// prints what receive() left for the control handler:
+//
+//   <returned 0|1> <tick> <slot text in hex, or ->
+//
+// and a last line with the counters, "frames=<n> skipped=<n> bad=<n>". A
+// slot that points outside the message it came in prints "OUT_OF_BOUNDS"
+// and exits 1.
+//
+//   g++ -std=gnu++11 -Icheck/include -Inative/include -Ilib/winter_river/src
+//       check/wrtick.cpp native/native.cpp -o wrtick
+//   ./wrtick ups_a < messages
+//
+// tests/test_tick_frame.py encodes frames with broker/tick_frame.py and
+// checks what each node's slot decodes to.
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include <wr_tick.h>
+
+namespace {
+
+bool unhex(const char *s, std::vector<byte> &out) {
+  out.clear();
+  if (strcmp(s, "-") == 0) return true;
+  for (; s[0] && s[1]; s += 2) {
+    unsigned v;
+    if (sscanf(s, "%2x", &v) != 1) return false;
+    out.push_back(static_cast<byte>(v));
+  }
+  return !*s;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s NODE_ID < messages\n", argv[0]);
+    return 2;
+  }
+  wr::TickFrame &tick = wr::tickFrame();
+  tick.begin(argv[1]);
+  static char topic[128], hex[2 * 4096 + 2];
+  std::vector<byte> msg;
+  while (scanf("%127s %8193s", topic, hex) == 2) {
+    if (!unhex(hex, msg)) {
+      fprintf(stderr, "bad hex: %s\n", hex);
+      return 2;
+    }
+    byte *payload = msg.data();
+    unsigned int length = static_cast<unsigned int>(msg.size());
+    const bool taken = tick.receive(topic, payload, length);
+    if (length && (payload < msg.data() || payload + length > msg.data() + msg.size())) {
+      puts("OUT_OF_BOUNDS");
+      return 1;
+    }
+    printf("%d %lu ", taken, static_cast<unsigned long>(tick.tick()));
+    if (!length) fputs("-", stdout);
+    for (unsigned int i = 0; i < length; ++i) printf("%02x", payload[i]);
+    putchar('\n');
+  }
+  printf("frames=%lu skipped=%lu bad=%lu\n", tick.frames(), tick.skipped(), tick.bad());
+  return 0;
+}
@@ -0,0 +1,95 @@
+// wrtime.cpp — host check of the firmware's clock discipline (wr::TimeSync, wr_time.h).
+//
+// Plays the Pi's time responder (broker/time_sync.py) against one node on
+// virtual time: a crystal DRIFT_PPB slow, round trips of 2–20 ms, one
+// exchange per TRACK_MS. After WARMUP_S the Pi clock steps by STEP_US, as
+// when NTP corrects a Pi that booted on fake-hwclock. After every exchange
+// it compares the node's ts_ms with the Pi's clock:
+//
+//   before=<worst |ts_ms − Pi ms|, before the step> after=<same, from
+//   WINDOW + 1 exchanges after it> outside=<readings off by more than
+//   ts_err_us, same window>
+//
+//   g++ -std=gnu++11 -Icheck/include -Inative/include -Ilib/winter_river/src
+//       check/wrtime.cpp native/native.cpp -o wrtime
+//   ./wrtime STEP_US
+//
+// tests/test_time_sync.py runs it under UndefinedBehaviorSanitizer.
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <wr_time.h>
+
+namespace native {
+void advanceMicros(unsigned long us);
+}
+
+namespace {
+
+const int64_t EPOCH_US = 1760612345678000LL;   // Pi clock at local 0
+const int64_t DRIFT_PPB = 25000;
+const long WARMUP_S = 3600;
+const long AFTER_S = 600;
+
+int64_t step_us = 0;
+
+// The Pi's clock at local time `local`: it runs DRIFT_PPB fast of the node's.
+int64_t piMicros(int64_t local) {
+  return EPOCH_US + local + local / 1000 * DRIFT_PPB / 1000000 + step_us;
+}
+
+void advance(int64_t us) {
+  while (us > 0) {
+    const unsigned long n = us > 1000000 ? 1000000UL : static_cast<unsigned long>(us);
+    native::advanceMicros(n);
+    us -= n;
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s STEP_US\n", argv[0]);
+    return 2;
+  }
+  const int64_t step = strtoll(argv[1], nullptr, 10);
+  wr::TimeSync &sync = wr::timeSync();
+  sync.begin("x");
+  srand(1);
+  int64_t before = 0, after = 0;
+  long outside = 0, since_step = -1;
+  unsigned long seq = 0;
+  while (wr::monotonicMicros() < (WARMUP_S + AFTER_S) * 1000000LL) {
+    if (since_step < 0 && wr::monotonicMicros() >= WARMUP_S * 1000000LL) {
+      step_us = step;
+      since_step = 0;
+    }
+    sync.poll();   // sends request N:++seq, stamps T1
+    ++seq;
+    const int64_t rtt = 2000 + rand() % 18000;
+    advance(rtt / 2);
+    const int64_t t2 = piMicros(wr::monotonicMicros());
+    advance(40);
+    const int64_t t3 = piMicros(wr::monotonicMicros());
+    advance(rtt / 2);
+    char reply[96];
+    const int n = snprintf(reply, sizeof(reply), "N:%lu T2:%lld T3:%lld", seq,
+                           static_cast<long long>(t2), static_cast<long long>(t3));
+    sync.receive("winter-river/x/time", reinterpret_cast<const byte *>(reply), static_cast<unsigned>(n));
+
+    const wr::EpochTime t = sync.now();
+    const int64_t off = t.ms - piMicros(wr::monotonicMicros()) / 1000;
+    const int64_t abs_off = off < 0 ? -off : off;
+    if (since_step < 0) {
+      if (abs_off > before) before = abs_off;
+    } else if (++since_step > wr::TimeSync::WINDOW) {
+      if (abs_off > after) after = abs_off;
+      if (t.err_us < 0 || abs_off * 1000 > t.err_us + 1000) ++outside;
+    }
+    advance(static_cast<int64_t>(wr::TimeSync::TRACK_MS) * 1000 - rtt - 40);
+  }
+  printf("before=%lld after=%lld outside=%ld\n", static_cast<long long>(before),
+         static_cast<long long>(after), outside);
+  return 0;
+}
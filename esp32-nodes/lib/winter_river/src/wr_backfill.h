@@ -0,0 +1,317 @@
+// wr_backfill.h — store-and-forward: telemetry kept while the link is down,
+// sent in batches once it is back.
+//
+// A telemetry tick with the broker unreachable used to be skipped, so every
+// WiFi drop, hotspot reboot or Pi restart left a hole in historical_data.
+// Now the node still builds that payload, in the packed wr_schema.h layout
+// whatever it publishes live (24–28 B with the header), and keeps it:
+//
+//   RTC ring   WR_BACKFILL_RECORDS slots of BACKFILL_SLOT bytes in RTC memory.
+//              Survives restarts (OTA, provisioning, watchdog), not power
+//              loss. When it is full the oldest record is overwritten.
+//   LittleFS   -DWR_BACKFILL_SPILL=1: a full ring first moves its older half
+//              to /wr_backfill.bin, up to WR_BACKFILL_SPILL_BYTES. Only when
+//              the file is full too does the ring overwrite, so a long
+//              outage keeps its start (file) and its end (ring).
+//
+// Each record carries the ts_ms (wr_time.h) and seq (wr_seq.h) it was built
+// with. Its number is used up as if it had been sent, so the live stream
+// shows the outage as a gap and the backfill fills it in. Ticks before the
+// node has any clock (ts_ms 0) are not kept.
+//
+// Once MQTT is back, the network task sends what is stored, oldest first
+// (file, then ring), BACKFILL_BATCH records at a time and one batch per
+// BACKFILL_PACE_MS, so live telemetry and control keep the link:
+//
+//   node → winter-river/<node_id>/backfill    [u8 len][record] ...   (not retained)
+//
+// broker/main.py decodes a batch with telemetry_codec.decode_batch() and
+// inserts it into historical_data in one multi-row INSERT, at the records'
+// own timestamps. A batch leaves storage once the MQTT client has taken it:
+// with PubSubClient that is QoS 0, like status; with WR_MQTT_ASYNC
+// (wr_mqtt.h) it is QoS 1 and resent until acknowledged, and batches wait
+// while the client is congested. The read position in the file is kept in
+// RTC, so after a power cut the file is sent again from its start.
+//
+// With WR_DUAL_CORE the record is built on wr_sim and handed to wr_net
+// through wr::keptRecords(), an in-order wr::Queue of WR_BACKFILL_QUEUE
+// records (wr::keepRecord()); only wr_net touches the ring and the file. The
+// queue covers the seconds wr_net can spend in a blocking MQTT CONNECT while
+// the link is down; a record that finds it full counts as dropped.
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <winter_river.h>
+#include <wr_json.h>
+#include <wr_mailbox.h>
+#include <wr_schema.h>
+
+#ifndef WR_BACKFILL
+#define WR_BACKFILL 1
+#endif
+#ifndef WR_BACKFILL_RECORDS
+#define WR_BACKFILL_RECORDS 128   // 4 KB of RTC memory
+#endif
+#ifndef WR_BACKFILL_SPILL
+#define WR_BACKFILL_SPILL 0
+#endif
+#ifndef WR_BACKFILL_SPILL_BYTES
+#define WR_BACKFILL_SPILL_BYTES 65536
+#endif
+#ifndef WR_BACKFILL_QUEUE
+#define WR_BACKFILL_QUEUE 32      // records waiting for wr_net (WR_DUAL_CORE)
+#endif
+
+#if WR_BACKFILL_SPILL
+#include <LittleFS.h>
+#endif
+
+namespace wr {
+
+static constexpr size_t BACKFILL_SLOT = 32;              // length byte + record
+static constexpr uint8_t BACKFILL_BATCH = 16;            // records per message
+static constexpr unsigned long BACKFILL_PACE_MS = 250;   // between batches
+
+// One packed record on its way from wr_sim to wr_net (WR_DUAL_CORE).
+struct KeptRecord {
+  uint8_t len;
+  uint8_t data[BACKFILL_SLOT - 1];
+};
+
+inline Queue<KeptRecord, WR_BACKFILL_QUEUE> &keptRecords() {
+  static Queue<KeptRecord, WR_BACKFILL_QUEUE> queue;
+  return queue;
+}
+
+class Backfill {
+ public:
+  static constexpr uint32_t MAGIC = 0x57524631;   // "WRF1"
+  static constexpr uint16_t RECORDS = WR_BACKFILL_RECORDS;
+
+  // From startNode().
+  void begin(const char *node_id) {
+    snprintf(topic_, sizeof(topic_), "winter-river/%s/backfill", node_id);
+    Ring &r = ring();
+    if (!valid(r)) {
+      memset(&r, 0, sizeof(r));
+      r.magic = MAGIC;
+    }
+#if WR_BACKFILL_SPILL
+    fs_ = LittleFS.begin(true);
+    spill_size_ = 0;
+    if (fs_ && LittleFS.exists(SPILL_PATH)) {
+      File f = LittleFS.open(SPILL_PATH, "r");
+      if (f) {
+        spill_size_ = f.size();
+        f.close();
+      }
+    }
+    if (r.spill_read > spill_size_) r.spill_read = 0;
+#endif
+    if (pending()) {
+      Serial.printf("[wr] backfill: %u records kept over the restart\n",
+                    static_cast<unsigned>(r.count));
+    }
+  }
+
+  // Keep one packed record. Network task (or the only task).
+  void push(const uint8_t *rec, size_t len) {
+    Ring &r = ring();
+    if (!len || len >= BACKFILL_SLOT || rec[0] != schema::MAGIC) {
+      ++r.dropped;
+      return;
+    }
+    if (r.count == RECORDS && !spill()) {   // overwrite the oldest
+      r.head = at(r.head, 1);
+      --r.count;
+      ++r.dropped;
+    }
+    uint8_t *slot = r.slots[at(r.head, r.count)];
+    slot[0] = static_cast<uint8_t>(len);
+    memcpy(slot + 1, rec, len);
+    ++r.count;
+  }
+
+  // WR_DUAL_CORE: move the records wr_sim kept into the ring, and count the
+  // ones the queue had no room for. Network task, every pass, up or not.
+  void collect() {
+    Queue<KeptRecord, WR_BACKFILL_QUEUE> &q = keptRecords();
+    while (KeptRecord *k = q.front()) {
+      push(k->data, k->len);
+      q.pop();
+    }
+    const unsigned long dropped = q.dropped();   // wr_sim's counter: at worst a pass late
+    ring().dropped += dropped - queue_dropped_;
+    queue_dropped_ = dropped;
+  }
+
+  // Send the next batch when one is due. Network task, after mqtt.loop().
+  void poll() {
+    if (!mqtt.connected() || !pending() || mqttCongested()) return;
+    const unsigned long now = millis();
+    if (now - last_ms_ < BACKFILL_PACE_MS) return;
+    last_ms_ = now;
+#if WR_BACKFILL_SPILL
+    if (ring().spill_read < spill_size_) {
+      sendSpill();
+      return;
+    }
+#endif
+    Ring &r = ring();
+    size_t len = 0;
+    uint16_t n = 0;
+    for (; n < r.count && n < BACKFILL_BATCH; ++n) {
+      const uint8_t *slot = r.slots[at(r.head, n)];
+      memcpy(batch_ + len, slot, slot[0] + 1u);
+      len += slot[0] + 1u;
+    }
+    if (!publishNow(topic_, batch_, len, false)) return;
+    r.head = at(r.head, n);
+    r.count -= n;
+    sent_ += n;
+    if (!pending()) {
+      Serial.printf("[wr] backfill: %lu records sent, %lu dropped\n", sent_,
+                    static_cast<unsigned long>(r.dropped));
+      sent_ = 0;
+      r.dropped = 0;
+    }
+  }
+
+  bool pending() const {
+#if WR_BACKFILL_SPILL
+    if (ring().spill_read < spill_size_) return true;
+#endif
+    return ring().count != 0;
+  }
+
+  uint16_t count() const { return ring().count; }
+  unsigned long dropped() const { return ring().dropped; }
+
+ private:
+  struct Ring {
+    uint32_t magic;
+    uint16_t head;          // oldest record
+    uint16_t count;
+    uint32_t dropped;       // overwritten or unusable, since the last drain
+    uint32_t spill_read;    // bytes of the file already sent
+    uint8_t slots[WR_BACKFILL_RECORDS][BACKFILL_SLOT];
+  };
+
+  static constexpr const char *SPILL_PATH = "/wr_backfill.bin";
+
+  // RTC_NOINIT: kept across software resets, garbage after power-on
+  // (valid() tells).
+  static Ring &ring() {
+    static RTC_NOINIT_ATTR Ring r;
+    return r;
+  }
+
+  static bool valid(const Ring &r) {
+    if (r.magic != MAGIC || r.head >= RECORDS || r.count > RECORDS) return false;
+    for (uint16_t i = 0; i < r.count; ++i) {
+      const uint8_t *slot = r.slots[at(r.head, i)];
+      if (!slot[0] || slot[0] >= BACKFILL_SLOT || slot[1] != schema::MAGIC) return false;
+    }
+    return true;
+  }
+
+  static uint16_t at(uint16_t from, uint16_t n) { return (from + n) % RECORDS; }
+
+  // Move the ring's older half to the file. False if there is no room.
+  bool spill() {
+#if WR_BACKFILL_SPILL
+    Ring &r = ring();
+    const uint16_t n = RECORDS / 2;
+    size_t bytes = 0;
+    for (uint16_t i = 0; i < n; ++i) bytes += r.slots[at(r.head, i)][0] + 1u;
+    if (!fs_ || spill_size_ + bytes > WR_BACKFILL_SPILL_BYTES) return false;
+    File f = LittleFS.open(SPILL_PATH, "a");
+    if (!f) return false;
+    size_t wrote = 0;
+    for (uint16_t i = 0; i < n; ++i) {
+      const uint8_t *slot = r.slots[at(r.head, i)];
+      wrote += f.write(slot, slot[0] + 1u);
+    }
+    f.close();
+    if (wrote != bytes) return false;
+    spill_size_ += bytes;
+    r.head = at(r.head, n);
+    r.count -= n;
+    return true;
+#else
+    return false;
+#endif
+  }
+
+#if WR_BACKFILL_SPILL
+  // One batch from the file, whole records only.
+  void sendSpill() {
+    Ring &r = ring();
+    File f = LittleFS.open(SPILL_PATH, "r");
+    size_t got = 0;
+    if (f && f.seek(r.spill_read)) got = f.read(batch_, sizeof(batch_));
+    if (f) f.close();
+    size_t len = 0;
+    uint16_t n = 0;
+    while (n < BACKFILL_BATCH && len + 2 <= got) {
+      const uint8_t rec = batch_[len];
+      if (!rec || rec >= BACKFILL_SLOT || batch_[len + 1] != schema::MAGIC) {
+        len = got = 0;   // damaged: give up on the rest of the file
+        break;
+      }
+      if (len + 1 + rec > got) break;
+      len += 1u + rec;
+      ++n;
+    }
+    if (!got) {
+      dropSpill();
+      return;
+    }
+    if (!publishNow(topic_, batch_, len, false)) return;
+    sent_ += n;
+    r.spill_read += len;
+    if (r.spill_read >= spill_size_) dropSpill();
+  }
+
+  void dropSpill() {
+    LittleFS.remove(SPILL_PATH);
+    spill_size_ = 0;
+    ring().spill_read = 0;
+  }
+
+  bool fs_ = false;
+  size_t spill_size_ = 0;
+#endif
+
+  char topic_[64] = "";
+  uint8_t batch_[BACKFILL_BATCH * BACKFILL_SLOT];
+  unsigned long last_ms_ = 0;
+  unsigned long sent_ = 0;
+  unsigned long queue_dropped_ = 0;
+};
+
+inline Backfill &backfill() {
+  static Backfill b;
+  return b;
+}
+
+// Hand over a packed record built with the link down. From the node's
+// telemetry path; with WR_DUAL_CORE that is wr_sim, so it is queued for
+// wr_net's collect().
+inline void keepRecord(const uint8_t *data, size_t len) {
+#if WR_DUAL_CORE
+  if (len > sizeof(KeptRecord::data)) return;
+  KeptRecord *k = keptRecords().back();
+  if (!k) return;   // full: counted as dropped
+  memcpy(k->data, data, len);
+  k->len = static_cast<uint8_t>(len);
+  keptRecords().push();
+#else
+  backfill().push(data, len);
+#endif
+}
+
+}  // namespace wr
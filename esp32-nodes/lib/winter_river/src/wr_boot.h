@@ -0,0 +1,262 @@
+// wr_boot.h — fast boot: cached association, overlapped bring-up, boot_ms.
+//
+// wr::begin() brings a node up one step at a time: full WiFi reset, scan
+// and join, DHCP, NTP, OLED probe. After a power blip all 24 boards do that
+// at once against the same hotspot, and the broker sees them stale for
+// many seconds. With -DWR_FAST_BOOT=1, wr::startNode() brings the node up
+// through wr::boot() instead:
+//
+//   1. OLED at its cached I2C address (one ACK check; the 0x3C/0x3D probe
+//      only if that fails). It still comes before WiFi.begin().
+//   2. WiFi join on the cached BSSID and channel with the cached lease as a
+//      static IP: no scan and no DHCP. This join is started, not waited for.
+//   3. Boot screen, MQTT server and SNTP set-up while the radio associates.
+//   4. wr::link() (wr_link.h) connects MQTT as soon as the join completes.
+//      The first telemetry goes out at once, not at the next interval.
+//   5. Work nobody waits for runs after that first publish: the OTA image
+//      hash (wr_ota.h) and the NVS write of a changed cache.
+//
+// The cache (BootCache) sits in RTC memory, which survives restarts (OTA,
+// provisioning, watchdog), and in NVS (namespace "wr_boot"), which survives
+// power loss. It is written after every MQTT session start, to NVS only when
+// it changed. If the cached join fails within FAST_JOIN_WAIT_MS, or MQTT does
+// not come up on the cached lease within FAST_LINK_WAIT_MS (AP moved, lease
+// reassigned), the cache is dropped and the node falls back to scan and
+// DHCP. The next session caches the new association.
+//
+// Every build reports how long the boot took: "boot_ms" (millis() since
+// reset at the first telemetry publish) is in the first JSON payload, and in
+// every winter-river/<node_id>/perf report (wr_tasks.h) for binary nodes.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <Preferences.h>
+#include <WiFi.h>
+#include <Wire.h>
+#include <winter_river.h>
+#include <wr_delta.h>
+#include <wr_link.h>
+#include <wr_oled.h>
+
+#ifndef WR_FAST_BOOT
+#define WR_FAST_BOOT 0
+#endif
+
+namespace wr {
+
+static constexpr unsigned long FAST_JOIN_WAIT_MS = 2000;   // cached BSSID/channel join
+static constexpr unsigned long FAST_LINK_WAIT_MS = 4000;   // fast join → MQTT up
+static constexpr uint16_t MQTT_PORT = 1883;
+
+class Boot;
+inline Boot &boot();
+
+// One association worth remembering. Addresses in network byte order, as
+// IPAddress stores them.
+struct BootCache {
+  uint32_t magic;
+  uint8_t bssid[6];
+  uint8_t channel;
+  uint8_t oled;        // I2C address, 0 = not known
+  uint8_t ip[4];
+  uint8_t gateway[4];
+  uint8_t mask[4];
+  uint8_t dns[4];
+  uint32_t crc;        // wr::crc32 of everything above
+};
+
+class Boot {
+ public:
+  static constexpr uint32_t MAGIC = 0x57524231;   // "WRB1"
+  static constexpr uint8_t MAX_DEFERRED = 4;
+
+  typedef void (*Callback)(char *topic, byte *payload, unsigned int length);
+  typedef void (*Deferred)();
+
+  // From startNode() instead of wr::begin(), after link().begin().
+  void begin(const char *node_id, Callback cb) {
+    const bool cached = load();
+    Wire.begin();
+    oled_ = cache_.oled && ack(cache_.oled) ? cache_.oled : probe();
+    display.begin(SSD1306_SWITCHCAPVCC, oled_);
+
+    WiFi.mode(WIFI_STA);
+    link().joinWith(join);
+    link().joinNow();
+
+    display.clearDisplay();
+    displayHeader(node_id, "BOOT");
+    flushDisplay();
+    mqtt.setServer(MQTT_SERVER, MQTT_PORT);
+    mqtt.setCallback(cb);
+    configTime(0, 0, MQTT_SERVER, "pool.ntp.org");
+    Serial.printf("[wr] fast boot: %s join, oled 0x%02X, %lu ms\n",
+                  cached ? "cached" : "scan", oled_, millis());
+  }
+
+  // Run `fn` once the first telemetry has been published (at once if it has).
+  void defer(Deferred fn) {
+    if (published()) fn();
+    else if (ndeferred_ < MAX_DEFERRED) deferred_[ndeferred_++] = fn;
+  }
+
+  // Every MQTT session start, from the network task.
+  void linkUp() {
+    BootCache now = {};
+    now.magic = MAGIC;
+    if (const uint8_t *bssid = WiFi.BSSID()) memcpy(now.bssid, bssid, sizeof(now.bssid));
+    now.channel = static_cast<uint8_t>(WiFi.channel());
+    now.oled = oled_;
+    put(now.ip, WiFi.localIP());
+    put(now.gateway, WiFi.gatewayIP());
+    put(now.mask, WiFi.subnetMask());
+    put(now.dns, WiFi.dnsIP());
+    now.crc = crc(now);
+    if (memcmp(&now, &rtcCache(), sizeof(now)) != 0) {
+      rtcCache() = now;
+      dirty_ = true;
+    }
+    fast_ = false;
+  }
+
+  // Every loop pass, on the network task, up or not.
+  void poll() {
+    if (fast_ && link().state() != Link::State::UP &&
+        millis() - join_ms_ >= FAST_LINK_WAIT_MS) {
+      Serial.println(F("[wr] fast boot: no MQTT on the cached lease, rejoining"));
+      forget();
+      WiFi.disconnect();   // link() rejoins with scan and DHCP
+    }
+    if (!published()) return;
+    if (!ran_) {
+      ran_ = true;
+      for (uint8_t i = 0; i < ndeferred_; ++i) deferred_[i]();
+    }
+    if (dirty_) save();
+  }
+
+  // The first telemetry went out at millis() = `ms`.
+  void published(unsigned long ms) {
+    if (boot_ms_) return;
+    boot_ms_ = ms ? ms : 1;
+    Serial.printf("[wr] boot_ms=%lu\n", boot_ms_);
+  }
+  bool published() const { return boot_ms_ != 0; }
+  unsigned long bootMs() const { return boot_ms_; }
+
+  // True once, on the first pass with the link up: send telemetry now
+  // rather than at the next interval.
+  bool firstTick(bool up) {
+    if (!WR_FAST_BOOT || !up || first_tick_) return false;
+    first_tick_ = true;
+    return true;
+  }
+
+ private:
+  // RTC_NOINIT: kept across software resets, garbage after power-on (the
+  // CRC tells).
+  static BootCache &rtcCache() {
+    static RTC_NOINIT_ATTR BootCache c;
+    return c;
+  }
+
+  static uint32_t crc(const BootCache &c) {
+    return crc32(0, reinterpret_cast<const uint8_t *>(&c), offsetof(BootCache, crc));
+  }
+
+  static bool valid(const BootCache &c) { return c.magic == MAGIC && c.crc == crc(c); }
+
+  static void put(uint8_t *out, const IPAddress &ip) {
+    for (int i = 0; i < 4; ++i) out[i] = ip[i];
+  }
+
+  static IPAddress get(const uint8_t *in) { return IPAddress(in[0], in[1], in[2], in[3]); }
+
+  static bool ack(uint8_t addr) {
+    Wire.beginTransmission(addr);
+    return Wire.endTransmission() == 0;
+  }
+
+  // Same probe order as wr::begin(); the panel ACKs on exactly one.
+  static uint8_t probe() { return ack(0x3C) ? 0x3C : 0x3D; }
+
+  // RTC first (restart), else NVS (power cycle).
+  bool load() {
+    if (!valid(rtcCache())) {
+      BootCache c = {};
+      Preferences prefs;
+      prefs.begin("wr_boot", true);
+      const size_t n = prefs.getBytes("cache", &c, sizeof(c));
+      prefs.end();
+      rtcCache() = n == sizeof(c) && valid(c) ? c : BootCache{};
+    }
+    cache_ = rtcCache();
+    usable_ = valid(cache_) && cache_.channel && cache_.ip[0];
+    return usable_;
+  }
+
+  void save() {
+    Preferences prefs;
+    if (!prefs.begin("wr_boot", false)) return;
+    prefs.putBytes("cache", &rtcCache(), sizeof(BootCache));
+    prefs.end();
+    dirty_ = false;
+  }
+
+  void forget() {
+    fast_ = false;
+    usable_ = false;
+    cache_ = BootCache{};
+    rtcCache() = BootCache{};
+    Preferences prefs;
+    if (!prefs.begin("wr_boot", false)) return;
+    prefs.remove("cache");
+    prefs.end();
+  }
+
+  // wr::Link's join: the cached association first, scan and DHCP after.
+  static unsigned long join() {
+    Boot &b = boot();
+    if (!b.tried_ && b.usable_) {
+      b.tried_ = true;
+      b.fast_ = true;
+      b.static_ = true;
+      b.join_ms_ = millis();
+      WiFi.config(get(b.cache_.ip), get(b.cache_.gateway), get(b.cache_.mask), get(b.cache_.dns));
+      WiFi.begin(SSID, PASSWORD, b.cache_.channel, b.cache_.bssid);
+      return FAST_JOIN_WAIT_MS;
+    }
+    b.tried_ = true;
+    b.fast_ = false;
+    if (b.static_) {
+      b.static_ = false;
+      WiFi.config(IPAddress(), IPAddress(), IPAddress());   // back to DHCP
+    }
+    WiFi.begin(SSID, PASSWORD);
+    return WIFI_JOIN_WAIT_MS;
+  }
+
+  BootCache cache_ = {};
+  uint8_t oled_ = 0;
+  bool usable_ = false;      // cache_ holds a complete association
+  bool tried_ = false;       // the cached join has had its one chance
+  bool fast_ = false;        // on the cached association, not yet confirmed by MQTT
+  bool static_ = false;      // WiFi is configured with the cached lease
+  bool dirty_ = false;       // RTC cache differs from NVS
+  bool ran_ = false;         // deferred work done
+  bool first_tick_ = false;
+  uint8_t ndeferred_ = 0;
+  Deferred deferred_[MAX_DEFERRED];
+  unsigned long join_ms_ = 0;
+  volatile unsigned long boot_ms_ = 0;
+};
+
+inline Boot &boot() {
+  static Boot b;
+  return b;
+}
+
+}  // namespace wr
@@ -0,0 +1,147 @@
+// wr_deadband.h — on-change telemetry policy for the wr:: helper.
+//
+// In the default periodic mode every node publishes a full retained payload
+// each wr::TELEMETRY_INTERVAL_MS, whether or not anything changed. In
+// on-change mode the node samples its fields every WR_SAMPLE_INTERVAL_MS
+// and publishes only when:
+//
+//   * a field moved past its deadband since the last PUBLISHED value
+//     (default deadband 0: any change at the reported resolution), or
+//   * WR_KEYFRAME_INTERVALS telemetry intervals passed with nothing sent.
+//     This is a liveness keyframe. The default of 3 (15 s) keeps every node
+//     inside the broker's 20 s STALE_NODE_THRESHOLD_SEC watchdog.
+//
+// Every publish is a full payload, so any message is also a keyframe. The
+// retained copy on the broker is only rewritten when the node's state
+// changes (and on the first publish after boot). Deadband and keyframe
+// messages are sent non-retained.
+//
+// Deadbands are in the field's own units and are set once in setup():
+//
+//   payload.deadband("input_v", 5.0f);    // ignore < 5 V wobble
+//   payload.deadband("temp_f",  2);
+//
+// Turn the mode on with -DWR_TELEMETRY_ON_CHANGE=1, or at runtime with the
+// TX:CHANGE / TX:PERIODIC control token.
+#pragma once
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <winter_river.h>
+
+#ifndef WR_TELEMETRY_ON_CHANGE
+#define WR_TELEMETRY_ON_CHANGE 0
+#endif
+#ifndef WR_SAMPLE_INTERVAL_MS
+#define WR_SAMPLE_INTERVAL_MS 200
+#endif
+#ifndef WR_KEYFRAME_INTERVALS
+#define WR_KEYFRAME_INTERVALS 3
+#endif
+
+namespace wr {
+
+// Current publish policy for this node. Starts at the build-flag default.
+inline bool &onChangeTelemetry() {
+  static bool on = WR_TELEMETRY_ON_CHANGE != 0;
+  return on;
+}
+
+// Tracks one payload's field values between publishes. Fields are identified
+// by their position in the field() chain, which is fixed per node.
+class Deadband {
+ public:
+  static constexpr uint8_t MAX_FIELDS = 12;
+  static constexpr uint8_t MAX_BANDS  = 6;
+
+  enum class Send : uint8_t { SKIP, UPDATE, RETAINED };
+
+  void set(const char *name, float band) {
+    for (uint8_t i = 0; i < nbands_; ++i) {
+      if (strcmp(bands_[i].name, name) == 0) { bands_[i].band = band; return; }
+    }
+    if (nbands_ < MAX_BANDS) bands_[nbands_++] = {name, band};
+  }
+
+  // Called once per loop() pass. `tick` is the telemetry tick (wr_rate.h).
+  // In periodic mode only the tick samples; in on-change mode the sample
+  // clock does too.
+  bool sampleDue(bool tick) {
+    if (!onChangeTelemetry()) return tick;
+    const unsigned long now = millis();
+    if (tick || now - last_sample_ms_ >= WR_SAMPLE_INTERVAL_MS) {
+      last_sample_ms_ = now;
+      return true;
+    }
+    return false;
+  }
+
+  void start() {
+    n_ = 0;
+    changed_ = false;
+    state_changed_ = false;
+  }
+
+  // `q` is the value at reported resolution (value * scale, rounded);
+  // LONG_MIN marks a non-finite float.
+  void track(const char *name, long q, long scale) {
+    if (n_ >= MAX_FIELDS) { changed_ = true; return; }
+    const uint8_t i = n_++;
+    cur_[i] = q;
+    if (!have_last_) { changed_ = true; return; }
+    if (q == last_[i]) return;
+    if (q == LONG_MIN || last_[i] == LONG_MIN) { changed_ = true; return; }
+    const float band = bandFor(name) * scale;
+    if (static_cast<float>(labs(q - last_[i])) > band) changed_ = true;
+  }
+
+  void trackState(const char *name, uint8_t code) {
+    const uint8_t i = n_;
+    track(name, code, 1);
+    if (!have_last_ || (i < MAX_FIELDS && last_[i] != code)) state_changed_ = true;
+  }
+
+  Send decide() const {
+    if (!onChangeTelemetry() || !have_last_ || state_changed_) return Send::RETAINED;
+    if (changed_) return Send::UPDATE;
+    if (millis() - last_publish_ms_ >= WR_KEYFRAME_INTERVALS * TELEMETRY_INTERVAL_MS) {
+      return Send::UPDATE;
+    }
+    return Send::SKIP;
+  }
+
+  // The sampled values were published; they become the new reference.
+  void commit() {
+    memcpy(last_, cur_, sizeof(long) * n_);
+    have_last_ = true;
+    last_publish_ms_ = millis();
+  }
+
+ private:
+  struct Band {
+    const char *name;
+    float band;
+  };
+
+  float bandFor(const char *name) const {
+    for (uint8_t i = 0; i < nbands_; ++i) {
+      if (strcmp(bands_[i].name, name) == 0) return bands_[i].band;
+    }
+    return 0.0f;
+  }
+
+  Band bands_[MAX_BANDS];
+  uint8_t nbands_ = 0;
+  long cur_[MAX_FIELDS];
+  long last_[MAX_FIELDS];
+  uint8_t n_ = 0;
+  bool have_last_ = false;
+  bool changed_ = false;
+  bool state_changed_ = false;
+  unsigned long last_sample_ms_ = 0;
+  unsigned long last_publish_ms_ = 0;
+};
+
+}  // namespace wr
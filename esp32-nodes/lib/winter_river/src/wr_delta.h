@@ -0,0 +1,211 @@
+// wr_delta.h — streaming decoder for binary-delta firmware images.
+//
+// An OTA update (wr_ota.h) usually changes little of the running image: a
+// rebuild with one fix, or the node-specific strings. broker/ota_delta.py
+// encodes the new image as copies from the running one plus the bytes that
+// are really new, and the node rebuilds it while it downloads:
+//
+//   offset 0   "WRD1"
+//   offset 4   u32 base_size     bytes of the running image the delta reads
+//   offset 8   u32 base_crc      CRC-32 (IEEE, = zlib.crc32) of those bytes
+//   offset 12  u32 target_size
+//   offset 16  u32 target_crc    CRC-32 of the image the ops produce
+//   offset 20  ops, each an opcode byte then LEB128 varints:
+//                0x01 COPY  <base offset> <length>     from the running image
+//                0x02 DATA  <length> <length bytes>    literal
+//                0x00 END
+//
+// All integers little-endian. A full image is a delta with base_size 0 and
+// one DATA op, so a node whose running image the server does not know still
+// updates the same way.
+//
+// feed() takes the download in whatever chunks it arrives and writes the
+// output in order, so only CHUNK bytes of buffer are held. The base is read
+// through a callback (the running app partition on the node, a file on the
+// host: delta/wrdelta.cpp). The base CRC is checked as soon as the header
+// is in, before anything is written; the target size and CRC at END. Nothing
+// here depends on Arduino or ESP-IDF, so the host tool and the tests
+// (tests/test_ota_delta.py) run this exact code.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace wr {
+
+// CRC-32/IEEE, bitwise over a 16-entry table: small enough for the helper,
+// fast enough for a 1 MB image.
+inline uint32_t crc32(uint32_t crc, const uint8_t *p, size_t n) {
+  static const uint32_t T[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4,
+    0x4DB26158, 0x5005713C, 0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+  };
+  crc = ~crc;
+  while (n--) {
+    crc ^= *p++;
+    crc = (crc >> 4) ^ T[crc & 15];
+    crc = (crc >> 4) ^ T[crc & 15];
+  }
+  return ~crc;
+}
+
+class DeltaDecoder {
+ public:
+  typedef bool (*ReadFn)(void *ctx, uint32_t offset, uint8_t *buf, size_t n);
+  typedef bool (*WriteFn)(void *ctx, const uint8_t *buf, size_t n);
+
+  static constexpr size_t HEADER_BYTES = 20;
+  static constexpr size_t CHUNK = 512;
+
+  enum class Status : uint8_t { MORE, DONE, FAILED };
+  enum class Error : uint8_t { NONE, BAD_MAGIC, BASE_MISMATCH, BAD_OP, OUT_OF_RANGE, READ, WRITE,
+                               TARGET_MISMATCH };
+
+  DeltaDecoder(ReadFn read, WriteFn write, void *ctx) : read_(read), write_(write), ctx_(ctx) {}
+
+  // Consume the next `n` bytes of the delta. Anything after END is ignored.
+  Status feed(const uint8_t *p, size_t n) {
+    while (n && status_ == Status::MORE) {
+      switch (step_) {
+        case Step::HEADER: {
+          const size_t take = min(n, HEADER_BYTES - have_);
+          memcpy(buf_ + have_, p, take);
+          have_ += take; p += take; n -= take;
+          if (have_ == HEADER_BYTES) header();
+          break;
+        }
+        case Step::OP:
+          op_ = *p++; --n;
+          if (op_ == END) finish();
+          else if (op_ == COPY || op_ == DATA) startVarint(Step::ARG0);
+          else fail(Error::BAD_OP);
+          break;
+        case Step::ARG0:
+        case Step::ARG1:
+          if (varint(*p++)) argument();
+          --n;
+          break;
+        case Step::DATA: {
+          const size_t take = min(n, remaining_);
+          if (!emit(p, take)) break;
+          p += take; n -= take; remaining_ -= take;
+          if (!remaining_) step_ = Step::OP;
+          break;
+        }
+      }
+    }
+    return status_;
+  }
+
+  Status status() const { return status_; }
+  Error error() const { return error_; }
+  uint32_t baseSize() const { return base_size_; }
+  uint32_t targetSize() const { return target_size_; }
+  uint32_t targetCrc() const { return target_crc_; }
+  uint32_t written() const { return written_; }
+
+ private:
+  enum : uint8_t { END = 0x00, COPY = 0x01, DATA = 0x02 };
+  enum class Step : uint8_t { HEADER, OP, ARG0, ARG1, DATA };
+
+  static size_t min(size_t a, size_t b) { return a < b ? a : b; }
+  static uint32_t le32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+  }
+
+  void header() {
+    if (memcmp(buf_, "WRD1", 4) != 0) { fail(Error::BAD_MAGIC); return; }
+    base_size_ = le32(buf_ + 4);
+    const uint32_t base_crc = le32(buf_ + 8);
+    target_size_ = le32(buf_ + 12);
+    target_crc_ = le32(buf_ + 16);
+    uint32_t crc = 0;
+    for (uint32_t at = 0; at < base_size_;) {
+      const size_t n = min(CHUNK, base_size_ - at);
+      if (!read_(ctx_, at, buf_, n)) { fail(Error::READ); return; }
+      crc = crc32(crc, buf_, n);
+      at += n;
+    }
+    if (crc != base_crc) { fail(Error::BASE_MISMATCH); return; }
+    step_ = Step::OP;
+  }
+
+  void startVarint(Step s) {
+    step_ = s;
+    value_ = 0;
+    shift_ = 0;
+  }
+
+  // True once the varint is complete.
+  bool varint(uint8_t b) {
+    if (shift_ > 28) { fail(Error::OUT_OF_RANGE); return false; }
+    value_ |= static_cast<uint32_t>(b & 0x7F) << shift_;
+    shift_ += 7;
+    return !(b & 0x80);
+  }
+
+  void argument() {
+    if (op_ == DATA) {
+      remaining_ = value_;
+      step_ = remaining_ ? Step::DATA : Step::OP;
+    } else if (step_ == Step::ARG0) {
+      copy_from_ = value_;
+      startVarint(Step::ARG1);
+    } else {
+      copy(copy_from_, value_);
+    }
+  }
+
+  void copy(uint32_t from, uint32_t len) {
+    if (from > base_size_ || len > base_size_ - from) { fail(Error::OUT_OF_RANGE); return; }
+    while (len) {
+      const size_t n = min(CHUNK, len);
+      if (!read_(ctx_, from, buf_, n)) { fail(Error::READ); return; }
+      if (!emit(buf_, n)) return;
+      from += n;
+      len -= n;
+    }
+    step_ = Step::OP;
+  }
+
+  bool emit(const uint8_t *p, size_t n) {
+    if (n > target_size_ - written_) { fail(Error::OUT_OF_RANGE); return false; }
+    if (!write_(ctx_, p, n)) { fail(Error::WRITE); return false; }
+    crc_ = crc32(crc_, p, n);
+    written_ += n;
+    return true;
+  }
+
+  void finish() {
+    if (written_ != target_size_ || crc_ != target_crc_) fail(Error::TARGET_MISMATCH);
+    else status_ = Status::DONE;
+  }
+
+  void fail(Error e) {
+    status_ = Status::FAILED;
+    error_ = e;
+  }
+
+  ReadFn read_;
+  WriteFn write_;
+  void *ctx_;
+  Status status_ = Status::MORE;
+  Error error_ = Error::NONE;
+  Step step_ = Step::HEADER;
+  uint8_t buf_[CHUNK];
+  size_t have_ = 0;
+  uint8_t op_ = 0;
+  uint32_t value_ = 0;
+  uint8_t shift_ = 0;
+  uint32_t copy_from_ = 0;
+  size_t remaining_ = 0;
+  uint32_t base_size_ = 0;
+  uint32_t target_size_ = 0;
+  uint32_t target_crc_ = 0;
+  uint32_t written_ = 0;
+  uint32_t crc_ = 0;
+};
+
+}  // namespace wr
@@ -0,0 +1,251 @@
+// wr_identity.h — node identity from NVS, so one image serves a whole node type.
+//
+// A board used to get its node id and OLED label from build_flags, so the
+// fleet needed 24 builds of 9 sources. Now each node type builds once
+// ([env:server_rack] etc. in platformio.ini), and each board reads who it is
+// at boot. wr::Node<> asks its wr::Identity in start():
+//
+//   1. NVS (namespace "wr_id": "id", "label"), if the stored id belongs to
+//      this image's node type. Written by a provisioning message (below).
+//   2. WR_NODE_ID / WR_NODE_LABEL, if the image was built with them (the
+//      per-board envs still do). The board adopts that identity into NVS,
+//      so a fleet image flashed or OTA-updated over it (wr_ota.h) comes
+//      back as the same node. NVS wins over the build from then on: rename a
+//      board by provisioning it, not by flashing another per-board env.
+//   3. Otherwise the board is unprovisioned. It runs as "<type>_<mac>", e.g.
+//      server_rack_a1b2c3d4e5f6, which the broker ignores, and waits to be
+//      told its identity.
+//
+// Provisioning is keyed by MAC (12 lowercase hex digits, no separators):
+//
+//   Pi   → winter-river/provision/<mac>     ID:server_rack_b3 LABEL:rack_b3   (retained)
+//   node → winter-river/<id>/identity       {"mac":"a1b2c3d4e5f6","type":"SERVER_RACK",
+//                                            "label":"rack_b3","source":"NVS"}   (retained)
+//
+// broker/provision.py publishes the provisioning message from a MAC table or
+// the command line. It is retained, so a board plugged in later picks it up
+// on its first connect. An id of another node type is refused ("error" in
+// the identity report). Otherwise the new identity is written to NVS. The
+// node then clears its old retained identity report and restarts as the
+// new node. It receives the same message again on every connect, which
+// changes nothing. Swapping a spare board in is therefore: flash the type
+// image, run `provision.py set <mac> <node_id>`, plug it in.
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <Preferences.h>
+#include <winter_river.h>
+#include <wr_json.h>
+#include <wr_tokens.h>
+
+namespace wr {
+
+class Identity {
+ public:
+  static constexpr size_t ID_MAX    = 32;
+  static constexpr size_t LABEL_MAX = 32;   // OLED header; clipped there
+
+  enum class Source : uint8_t { BUILD, NVS, UNPROVISIONED };
+
+  // type: the wr_schema.h type name ("SERVER_RACK"). build_id and
+  // build_label: WR_NODE_ID / WR_NODE_LABEL, or nullptr without them.
+  Identity(const char *type, const char *build_id, const char *build_label)
+      : type_(type), build_id_(build_id), build_label_(build_label) {
+    if (build_id) set(build_id, build_label);
+  }
+
+  // Settle the identity from NVS, the build, or the MAC. From start().
+  void load() {
+    char id[ID_MAX + 1] = "";
+    char label[LABEL_MAX + 1] = "";
+    Preferences prefs;
+    prefs.begin("wr_id", true);
+    prefs.getString("id", id, sizeof(id));
+    prefs.getString("label", label, sizeof(label));
+    prefs.end();
+    if (accepts(id, strlen(id))) {
+      set(id, label);
+      source_ = Source::NVS;
+    } else if (build_id_) {
+      set(build_id_, build_label_);
+      source_ = Source::BUILD;
+      save(id_, label_);   // adopted: a fleet image flashed over it keeps the identity
+    } else {
+      snprintf(id_, sizeof(id_), "%s_%s", prefix(), mac());
+      label_[0] = '\0';
+      source_ = Source::UNPROVISIONED;
+    }
+  }
+
+  // Does `id` name a node of this image's type ("server_rack_" + [a-z0-9_])?
+  bool accepts(const char *id, size_t n) const {
+    const char *p = prefix();
+    const size_t pn = strlen(p);
+    if (n <= pn + 1 || n > ID_MAX || strncmp(id, p, pn) != 0 || id[pn] != '_') return false;
+    for (size_t i = pn + 1; i < n; ++i) {
+      const char c = id[i];
+      if (!((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_')) return false;
+    }
+    return true;
+  }
+
+  // Persist a new identity for the next boot.
+  bool save(const char *id, const char *label) {
+    Preferences prefs;
+    if (!prefs.begin("wr_id", false)) return false;
+    const bool ok = prefs.putString("id", id) > 0;
+    prefs.putString("label", label);
+    prefs.end();
+    return ok;
+  }
+
+  const char *id() const { return id_; }
+  const char *label() const { return label_[0] ? label_ : id_; }
+  const char *type() const { return type_; }
+  Source source() const { return source_; }
+
+  // Lowercase node-type prefix of every id this image accepts.
+  const char *prefix() const {
+    if (!prefix_[0]) {
+      size_t i = 0;
+      for (; type_[i] && i + 1 < sizeof(prefix_); ++i) {
+        const char c = type_[i];
+        prefix_[i] = c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+      }
+      prefix_[i] = '\0';
+    }
+    return prefix_;
+  }
+
+  // Factory MAC as 12 lowercase hex digits.
+  static const char *mac() {
+    static char buf[13];
+    if (!buf[0]) {
+      const uint64_t m = ESP.getEfuseMac();
+      for (int i = 0; i < 6; ++i) {
+        snprintf(buf + 2 * i, 3, "%02x", static_cast<unsigned>((m >> (8 * i)) & 0xFF));
+      }
+    }
+    return buf;
+  }
+
+ private:
+  void set(const char *id, const char *label) {
+    snprintf(id_, sizeof(id_), "%s", id);
+    snprintf(label_, sizeof(label_), "%s", label && label[0] ? label : "");
+  }
+
+  const char *type_;
+  const char *build_id_;
+  const char *build_label_;
+  Source source_ = Source::BUILD;
+  char id_[ID_MAX + 1] = "";
+  char label_[LABEL_MAX + 1] = "";
+  mutable char prefix_[24] = "";
+};
+
+// Network side: the identity report and provisioning messages, on the task
+// that owns PubSubClient.
+class Provisioning {
+ public:
+  static constexpr unsigned long RESTART_DELAY_MS = 500;   // let the old report clear
+
+  // From wr::Node<>::start(), after Identity::load().
+  void begin(Identity &who) {
+    who_ = &who;
+    snprintf(cmd_topic_, sizeof(cmd_topic_), "winter-river/provision/%s", Identity::mac());
+    snprintf(report_topic_, sizeof(report_topic_), "winter-river/%s/identity", who.id());
+  }
+
+  // After every MQTT (re)connect.
+  void subscribe() {
+    if (!who_) return;
+    mqtt.subscribe(cmd_topic_, 1);
+    reported_ = false;
+  }
+
+  // Route one incoming message. True if it was this board's provisioning.
+  bool receive(const char *topic, const byte *p, unsigned int l) {
+    if (!who_ || !topic || strcmp(topic, cmd_topic_) != 0) return false;
+    char id[Identity::ID_MAX + 1] = "";
+    char label[Identity::LABEL_MAX + 1] = "";
+    bool id_ok = false;
+    scanTokens(p, l, [&](const Token &tok) {
+      switch (tok.hash) {
+        case kw("ID"):
+          if (!tok.keyIs("ID")) break;
+          id_ok = who_->accepts(tok.value, tok.value_len);
+          if (id_ok) copy(id, sizeof(id), tok);
+          else copy(rejected_, sizeof(rejected_), tok);
+          break;
+        case kw("LABEL"): if (tok.keyIs("LABEL")) copy(label, sizeof(label), tok); break;
+      }
+    });
+    if (!l) return true;                                   // retained message cleared
+    if (!id_ok) {
+      reported_ = false;                                   // report the refusal
+      return true;
+    }
+    rejected_[0] = '\0';
+    if (strcmp(id, who_->id()) == 0 && strcmp(label[0] ? label : id, who_->label()) == 0) {
+      return true;                                         // already this node
+    }
+    if (who_->save(id, label)) restart_at_ = millis() + RESTART_DELAY_MS;
+    return true;
+  }
+
+  // Publish the identity report once per connection; restart when
+  // reprovisioned. Call after mqtt.loop().
+  void poll() {
+    if (!who_ || !mqtt.connected()) return;
+    if (restart_at_) {
+      if (!cleared_) {
+        cleared_ = publishNow(report_topic_, nullptr, 0, true);   // drop the old retained report
+        return;
+      }
+      if (static_cast<long>(millis() - restart_at_) >= 0) {
+        Serial.println(F("[wr] identity provisioned, restarting"));
+        ESP.restart();
+      }
+      return;
+    }
+    if (reported_) return;
+    static const char *const SOURCES[] = {"BUILD", "NVS", "UNPROVISIONED"};
+    Payload<192> msg;
+    msg.reset()
+       .field("mac", Identity::mac())
+       .field("type", who_->type())
+       .field("label", who_->label())
+       .field("source", SOURCES[static_cast<uint8_t>(who_->source())]);
+    if (rejected_[0]) msg.field("error", "WRONG_TYPE").field("rejected", rejected_);
+    if (msg.end()) {
+      reported_ = publishNow(report_topic_, reinterpret_cast<const uint8_t *>(msg.c_str()),
+                             msg.length(), true);
+    }
+  }
+
+ private:
+  static void copy(char *out, size_t cap, const Token &tok) {
+    const size_t n = tok.value_len < cap ? tok.value_len : cap - 1;
+    memcpy(out, tok.value, n);
+    out[n] = '\0';
+  }
+
+  Identity *who_ = nullptr;
+  char cmd_topic_[40] = "";
+  char report_topic_[64] = "";
+  char rejected_[Identity::ID_MAX + 1] = "";
+  bool reported_ = false;
+  bool cleared_ = false;
+  unsigned long restart_at_ = 0;
+};
+
+inline Provisioning &provisioning() {
+  static Provisioning p;
+  return p;
+}
+
+}  // namespace wr
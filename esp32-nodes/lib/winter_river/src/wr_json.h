@@ -0,0 +1,285 @@
+// wr_json.h — allocation-free telemetry payloads for the wr:: helper.
+//
+// Every node used to build its status JSON by chaining a dozen temporary
+// Arduino Strings, plus a fresh wr::statusTopic() / wr::timestamp() String, on
+// every telemetry cycle. On boards that run for weeks that churn fragments the
+// heap. This header replaces that path with:
+//
+//   wr::Topic       — "winter-river/<node_id>/<leaf>" built once at startup
+//   wr::Payload<N>  — fixed-capacity JSON object writer with typed field()
+//                     appenders, backed by an N-byte buffer owned by the node
+//   wr::publish()   — hands the buffer straight to mqtt.publish (no copy)
+//
+// Typical node usage:
+//
+//   static wr::Topic       STATUS_TOPIC(NODE_ID, "status");
+//   static wr::Payload<256> payload;
+//
+//   payload.begin()                       // {"ts":"HH:MM:SS"
+//          .field("load_pct", load_pct)
+//          .field("power_kw", power_kw, 1)
+//          .field("breaker",  breaker_closed)
+//          .field("state",    state.c_str());
+//   wr::publish(STATUS_TOPIC, payload);   // closes '}', publishes retained
+//
+// Field order and number formatting match the previous String-built payloads
+// (floats are fixed-point, same as String(x, decimals); exact .5 ties round
+// away from zero), so the broker, Telegraf and the Grafana dashboards see no
+// difference.
+#pragma once
+
+#include <cmath>
+#include <string.h>
+
+#include <winter_river.h>
+#include <wr_mailbox.h>
+#include <wr_mqtt.h>
+
+namespace wr {
+
+// Cached topic string. Constructed once (static at file scope in each node).
+class Topic {
+ public:
+  Topic(const char *node_id, const char *leaf) {
+    snprintf(buf_, sizeof(buf_), "winter-river/%s/%s", node_id, leaf);
+  }
+  const char *c_str() const { return buf_; }
+
+ private:
+  char buf_[64];
+};
+
+// JSON object writer over a caller-provided buffer. Overflow is sticky: once a
+// field does not fit, ok() stays false and publish() refuses to send a
+// truncated object rather than emitting invalid JSON.
+class JsonWriter {
+ public:
+  JsonWriter(char *buf, size_t cap) : buf_(buf), cap_(cap) {}
+
+  // Start a fresh object. Does NOT write the "ts" field — use begin() for
+  // telemetry, reset() for ad-hoc objects.
+  JsonWriter &reset() {
+    len_ = 0;
+    ok_ = true;
+    fields_ = 0;
+    closed_ = false;
+    put('{');
+    return *this;
+  }
+
+  // Start a telemetry object with the wall-clock "ts":"HH:MM:SS" field first,
+  // formatted in place (same text as wr::timestamp(), no String).
+  JsonWriter &begin() {
+    reset();
+    key("ts");
+    put('"');
+    struct tm t;
+    if (getLocalTime(&t, 0)) {
+      put2(t.tm_hour); put(':'); put2(t.tm_min); put(':'); put2(t.tm_sec);
+    } else {
+      putStr("--:--:--");
+    }
+    put('"');
+    return *this;
+  }
+
+  JsonWriter &field(const char *name, int v)           { key(name); putInt(v); return *this; }
+  JsonWriter &field(const char *name, long v)          { key(name); putInt(v); return *this; }
+  JsonWriter &field(const char *name, unsigned long v) { key(name); putUint(v); return *this; }
+  JsonWriter &field(const char *name, bool v)          { key(name); putStr(v ? "true" : "false"); return *this; }
+  JsonWriter &field(const char *name, long long v)     { key(name); putInt64(v); return *this; }
+  JsonWriter &nullField(const char *name)              { key(name); putStr("null"); return *this; }
+
+  // Fixed-point float, `decimals` places (0..4). Non-finite values become
+  // JSON null — String(NAN) used to emit the invalid token `nan`.
+  JsonWriter &field(const char *name, float v, uint8_t decimals = 1) {
+    key(name);
+    putFixed(v, decimals);
+    return *this;
+  }
+  JsonWriter &field(const char *name, double v, uint8_t decimals = 1) {
+    return field(name, static_cast<float>(v), decimals);
+  }
+
+  // "<name><suffix>": v — derived fields such as "temp_f_max" without
+  // building the key in a scratch buffer.
+  JsonWriter &field(const char *name, const char *suffix, float v, uint8_t decimals) {
+    key(name, suffix);
+    putFixed(v, decimals);
+    return *this;
+  }
+  JsonWriter &field(const char *name, const char *suffix, unsigned long v) {
+    key(name, suffix);
+    putUint(v);
+    return *this;
+  }
+
+  JsonWriter &field(const char *name, const char *v) {
+    key(name);
+    put('"');
+    for (; *v; ++v) {
+      if (*v == '"' || *v == '\\') put('\\');
+      put(*v);
+    }
+    put('"');
+    return *this;
+  }
+
+  // Close the object (idempotent). Returns false if anything overflowed.
+  bool end() {
+    if (!closed_) {
+      put('}');
+      closed_ = true;
+    }
+    buf_[ok_ ? len_ : 0] = '\0';
+    return ok_;
+  }
+
+  const char *c_str() const { return buf_; }
+  size_t length() const { return len_; }
+  size_t capacity() const { return cap_; }
+  bool ok() const { return ok_; }
+
+ protected:
+  void put(char c) {
+    if (len_ + 1 < cap_) buf_[len_++] = c;   // keep one byte for the NUL
+    else ok_ = false;
+  }
+  void putStr(const char *s) { while (*s) put(*s++); }
+  void put2(int v) { put(char('0' + (v / 10) % 10)); put(char('0' + v % 10)); }
+
+  void key(const char *name, const char *suffix = nullptr) {
+    if (fields_++ > 0) put(',');
+    put('"');
+    putStr(name);
+    if (suffix) putStr(suffix);
+    put('"');
+    put(':');
+  }
+
+  void putUint(unsigned long v) {
+    char tmp[11];
+    int n = 0;
+    do { tmp[n++] = char('0' + v % 10); v /= 10; } while (v);
+    while (n) put(tmp[--n]);
+  }
+  void putInt(long v) {
+    if (v < 0) { put('-'); putUint(0UL - static_cast<unsigned long>(v)); }
+    else       putUint(static_cast<unsigned long>(v));
+  }
+  // 64-bit values (epoch ms) without newlib's %lld.
+  void putInt64(long long v) {
+    unsigned long long u = v < 0 ? 0ULL - static_cast<unsigned long long>(v)
+                                 : static_cast<unsigned long long>(v);
+    if (v < 0) put('-');
+    char tmp[20];
+    int n = 0;
+    do { tmp[n++] = char('0' + u % 10); u /= 10; } while (u);
+    while (n) put(tmp[--n]);
+  }
+
+  void putFixed(float v, uint8_t decimals) {
+    if (!std::isfinite(v)) { putStr("null"); return; }
+    if (decimals > 4) decimals = 4;
+    static const long SCALE[] = {1, 10, 100, 1000, 10000};
+    const long scale = SCALE[decimals];
+    // Values on this fleet stay far below 2^31 / 10^4, so fixed-point in a
+    // long is exact enough and avoids newlib's dtoa (which mallocs).
+    long scaled = std::lround(v * scale);
+    if (scaled < 0) { put('-'); scaled = -scaled; }
+    putUint(static_cast<unsigned long>(scaled / scale));
+    if (decimals) {
+      put('.');
+      long frac = scaled % scale;
+      for (long div = scale / 10; div > 0; div /= 10) {
+        put(char('0' + (frac / div) % 10));
+      }
+    }
+  }
+
+ private:
+  char *buf_;
+  size_t cap_;
+  size_t len_ = 0;
+  uint8_t fields_ = 0;
+  bool ok_ = true;
+  bool closed_ = false;
+};
+
+// JsonWriter with its own N-byte buffer. Declare it static in the node so the
+// buffer lives in .bss, not on the loop() stack. wr::Node<> sizes it to the
+// field table's worst case, Node::JSON_BYTES (wr_node.h; 684 B for cooling,
+// the largest), and static_asserts that it fits OutgoingMessage::CAPACITY.
+template <size_t N>
+class Payload : public JsonWriter {
+ public:
+  Payload() : JsonWriter(storage_, N) {}
+
+ private:
+  char storage_[N];
+};
+
+// Hand one message to the MQTT client. Only the task that runs mqtt.loop()
+// may call this. PubSubClient silently drops a packet larger than its buffer
+// (256 B by default, header and topic included), so grow the buffer the
+// first time a payload needs it rather than losing that node's telemetry.
+// wr::AsyncMqtt (wr_mqtt.h) queues it at WR_MQTT_QOS into a pooled buffer,
+// and returns false when it has no room.
+inline bool publishNow(const char *topic, const uint8_t *data, size_t len, bool retained) {
+#if WR_MQTT_ASYNC
+  return mqtt.publish(topic, data, len, retained, WR_MQTT_QOS);
+#else
+  const size_t packet = 5 + 2 + strlen(topic) + len;   // fixed header + topic length
+  if (packet > mqtt.getBufferSize()) mqtt.setBufferSize(static_cast<uint16_t>(packet + 64));
+  return mqtt.publish(topic, data, static_cast<unsigned int>(len), retained);
+#endif
+}
+
+// True while the MQTT client would rather not take traffic that can wait
+// (wr_mqtt.h). Always false with PubSubClient, which has no queue.
+inline bool mqttCongested() {
+#if WR_MQTT_ASYNC
+  return mqtt.congested();
+#else
+  return false;
+#endif
+}
+
+// Single publish choke point for the helper's raw byte payloads. With
+// WR_DUAL_CORE the caller is the simulation task, so the message is copied
+// into wr::outbox() for the network task instead (wr_tasks.h); true then
+// means "queued".
+inline bool publish(const char *topic, const uint8_t *data, size_t len, bool retained) {
+#if WR_DUAL_CORE
+  OutgoingMessage &m = outbox().back();
+  if (len > sizeof(m.data) || strlen(topic) >= sizeof(m.topic)) {
+    Serial.print(F("[wr] outbox overflow, not published: "));
+    Serial.println(topic);
+    return false;
+  }
+  strcpy(m.topic, topic);
+  memcpy(m.data, data, len);
+  m.len = static_cast<uint16_t>(len);
+  m.retained = retained;
+  outbox().post();
+  return true;
+#else
+  return publishNow(topic, data, len, retained);
+#endif
+}
+
+// Close `payload`, publish it on `topic` and echo it to serial. A payload that
+// overflowed its buffer is logged and dropped instead of sent truncated.
+inline bool publish(const Topic &topic, JsonWriter &payload, bool retained = true) {
+  if (!payload.end()) {
+    Serial.print(F("[wr] payload overflow, not published: "));
+    Serial.println(topic.c_str());
+    return false;
+  }
+  bool sent = publish(topic.c_str(), reinterpret_cast<const uint8_t *>(payload.c_str()),
+                      payload.length(), retained);
+  Serial.println(payload.c_str());
+  return sent;
+}
+
+}  // namespace wr
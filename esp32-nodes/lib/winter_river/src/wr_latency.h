@@ -0,0 +1,79 @@
+// wr_latency.h — control-path latency echo for the broker's histograms.
+//
+// The broker appends two tokens to every control message it sends:
+//
+//   VOLT:480 STATUS:NORMAL SEQ:8123 T:51234567
+//
+// SEQ is a per-broker command counter and T the broker's send time (its own
+// millisecond clock; the node never interprets it). Both are consumed by
+// wr::handleCommonToken(). The helper times the message on the node side —
+// received (MQTT callback entered) and applied (node handler returned) — and
+// wr::publish() echoes the newest applied command in every JSON payload:
+//
+//   "ctl_seq":8123,"ctl_t":51234567,"ctl_apply_us":142,"ctl_age_ms":3810
+//
+//   ctl_apply_us   receive → applied. In WR_DUAL_CORE mode this includes the
+//                  wait in wr::inbox() / wr::commands() for the simulation
+//                  task.
+//   ctl_age_ms     applied → this payload was built (time spent waiting for
+//                  the next telemetry tick or on-change publish).
+//
+// The broker subtracts ctl_t from its own clock when the payload arrives and
+// takes the node-side stages out of the total, so no clock sync is needed.
+// Nothing is echoed until the first stamped command arrives, so a node run
+// against an older broker publishes exactly what it did before. Like the
+// stats fields, the echo is JSON only. The control loss counters of
+// wr::controlSeq() (wr_seq.h) ride along with it.
+#pragma once
+
+#include <winter_river.h>
+
+namespace wr {
+
+struct ControlTiming {
+  unsigned long seq;          // broker SEQ of the newest applied command
+  unsigned long sent;         // its broker T stamp, echoed verbatim
+  unsigned long apply_us;     // received → applied
+  unsigned long applied_ms;   // millis() when applied
+};
+
+class ControlClock {
+ public:
+  // A control message is about to be handled; `rx_us` is micros() when it
+  // came off the socket.
+  void received(unsigned long rx_us) {
+    rx_us_ = rx_us;
+    stamped_ = false;
+  }
+
+  // SEQ:/T: tokens of the message being handled.
+  void seq(unsigned long s) { pending_seq_ = s; stamped_ = true; }
+  void sent(unsigned long t) { pending_sent_ = t; }
+
+  // The node's handler returned. Unstamped messages (mosquitto_pub, older
+  // brokers) leave the last timing alone.
+  void applied() {
+    if (!stamped_) return;
+    stamped_ = false;
+    last_ = ControlTiming{pending_seq_, pending_sent_, micros() - rx_us_, millis()};
+    valid_ = true;
+  }
+
+  bool valid() const { return valid_; }
+  const ControlTiming &last() const { return last_; }
+
+ private:
+  unsigned long rx_us_ = 0;
+  unsigned long pending_seq_ = 0;
+  unsigned long pending_sent_ = 0;
+  bool stamped_ = false;
+  bool valid_ = false;
+  ControlTiming last_ = {0, 0, 0, 0};
+};
+
+inline ControlClock &controlClock() {
+  static ControlClock c;
+  return c;
+}
+
+}  // namespace wr
@@ -0,0 +1,223 @@
+// wr_link.h — non-blocking WiFi/MQTT connection state machine.
+//
+// The node loop used to be
+//
+//   if (!wr::mqttReconnect(NODE_ID)) { delay(1000); return; }
+//   ...
+//   delay(10);
+//
+// so every failed attempt froze the node for a second, all 24 boards retried
+// in lock-step after a hotspot restart, and every control message waited for
+// the next 10 ms slice. wr::Link replaces both delays:
+//
+//   * poll() takes one non-blocking step: start a WiFi join and return, check
+//     on it next time, and only call wr::mqttReconnect() (one CONNECT +
+//     LWT/ONLINE/subscribe) once WiFi is up and the backoff has elapsed.
+//   * Failed attempts back off exponentially (LINK_BACKOFF_MIN_MS doubling to
+//     LINK_BACKOFF_MAX_MS) with full jitter, so a fleet that lost the AP at
+//     the same instant spreads its retries across the window instead of
+//     stampeding the AP and Mosquitto together.
+//   * How a join starts is pluggable (joinWith()): wr_boot.h's fast boot
+//     joins on a cached BSSID, channel and lease first.
+//   * wait(ms) blocks in select() on the MQTT socket: it returns as soon as a
+//     control message arrives, or after `ms` for time-driven work. While the
+//     link is down it just sleeps until the next retry is due.
+//
+// Each reconnect publishes a retained counters message on
+// winter-river/<node_id>/link (see LinkStats), which Telegraf picks up:
+//
+//   {"reconnects":3,"wifi_attempts":5,"mqtt_attempts":4,"outage_ms":8120,"max_outage_ms":21400}
+#pragma once
+
+#include <stdint.h>
+
+#include <WiFi.h>
+#include <lwip/sockets.h>
+#include <winter_river.h>
+#include <wr_json.h>
+#include <wr_mqtt.h>
+
+namespace wr {
+
+static constexpr unsigned long LINK_BACKOFF_MIN_MS = 500;
+static constexpr unsigned long LINK_BACKOFF_MAX_MS = 30000;
+static constexpr unsigned long WIFI_JOIN_WAIT_MS   = 10000;   // per join attempt
+
+struct LinkStats {
+  unsigned long reconnects;      // MQTT sessions established after the first
+  unsigned long wifi_attempts;   // WiFi.begin() calls
+  unsigned long mqtt_attempts;   // wr::mqttReconnect() calls
+  unsigned long outage_ms;       // link down → up, latest outage
+  unsigned long max_outage_ms;
+};
+
+// The socket PubSubClient runs on. Owned here (instead of inside wr::begin())
+// so wait() can select() on it. wr::AsyncMqtt (wr_mqtt.h) has its own.
+inline WiFiClient &linkClient() {
+  static WiFiClient client;
+  return client;
+}
+
+class Link {
+ public:
+  enum class State : uint8_t { WIFI_DOWN, WIFI_JOINING, MQTT_DOWN, UP };
+
+  // Call once after wr::begin().
+  void begin(const char *node_id) {
+    node_id_ = node_id;
+    snprintf(topic_, sizeof(topic_), "winter-river/%s/link", node_id);
+    if (mqtt.connected()) mqtt.disconnect();   // first session goes through linkClient()
+    mqtt.setClient(linkClient());
+    down_since_ = millis();
+  }
+
+  // One non-blocking step. Returns true while MQTT is connected.
+  bool poll() {
+    const unsigned long now = millis();
+    if (mqtt.connected()) {
+      if (state_ != State::UP) up(now);
+      return true;
+    }
+    if (state_ == State::UP) {
+      state_ = State::MQTT_DOWN;
+      down_since_ = now;
+      failures_ = 0;
+      retry_at_ = now + jitter(LINK_BACKOFF_MIN_MS);   // spread the first retry too
+    }
+
+    if (WiFi.status() != WL_CONNECTED) {
+      if (state_ == State::WIFI_JOINING && now - join_started_ < join_wait_) return false;
+      if (state_ == State::WIFI_JOINING) backoff(now);      // join timed out
+      state_ = State::WIFI_DOWN;
+      if (static_cast<long>(now - retry_at_) < 0) return false;
+      WiFi.disconnect();
+      join(now);
+      return false;
+    }
+
+    if (state_ != State::MQTT_DOWN) {          // WiFi just came (back) up
+      state_ = State::MQTT_DOWN;
+      failures_ = 0;
+      retry_at_ = now + jitter(LINK_BACKOFF_MIN_MS);
+    }
+    if (static_cast<long>(now - retry_at_) < 0) return false;
+    ++stats_.mqtt_attempts;
+    if (mqttReconnect(node_id_)) {
+      up(millis());
+      return true;
+    }
+    backoff(millis());
+    return false;
+  }
+
+  // Sleep until MQTT traffic arrives or `ms` passes, whichever is first.
+  void wait(unsigned long ms) {
+#if WR_MQTT_ASYNC
+    if (state_ == State::UP && mqtt.fd() >= 0) {
+      const int fd = mqtt.fd();                      // read dry by every loop()
+#else
+    if (state_ == State::UP && linkClient().connected()) {
+      if (linkClient().available()) return;          // already buffered
+      const int fd = linkClient().fd();
+#endif
+      if (fd >= 0) {
+        fd_set rd;
+        FD_ZERO(&rd);
+        FD_SET(fd, &rd);
+        struct timeval tv = {static_cast<long>(ms / 1000), static_cast<long>((ms % 1000) * 1000)};
+        select(fd + 1, &rd, nullptr, nullptr, &tv);
+        return;
+      }
+    } else {
+      const long until_retry = static_cast<long>(retry_at_ - millis());
+      if (state_ != State::WIFI_JOINING && until_retry > 0 && static_cast<unsigned long>(until_retry) < ms) {
+        ms = until_retry;
+      }
+    }
+    delay(ms);
+  }
+
+  // Starts a WiFi join and returns how long to wait for it. Default: a plain
+  // WiFi.begin(SSID, PASSWORD) with WIFI_JOIN_WAIT_MS.
+  typedef unsigned long (*JoinFn)();
+  void joinWith(JoinFn fn) { join_fn_ = fn; }
+
+  // Start the first join now instead of on the first poll(), so it runs
+  // while the caller finishes setting up (wr_boot.h).
+  void joinNow() { join(millis()); }
+
+  State state() const { return state_; }
+  const LinkStats &stats() const { return stats_; }
+
+  // Called on every session start, after wr::mqttReconnect()'s own
+  // subscriptions — for topics the helper adds (wr_peer.h).
+  void onUp(void (*fn)()) { on_up_ = fn; }
+
+ private:
+  // Full jitter: uniform in [range / 4, range), so no two boards line up.
+  static unsigned long jitter(unsigned long range) {
+    return range / 4 + static_cast<unsigned long>(random(static_cast<long>(range - range / 4)));
+  }
+
+  void backoff(unsigned long now) {
+    unsigned long range = LINK_BACKOFF_MIN_MS << (failures_ < 6 ? failures_ : 6);
+    if (range > LINK_BACKOFF_MAX_MS) range = LINK_BACKOFF_MAX_MS;
+    if (failures_ < 255) ++failures_;
+    retry_at_ = now + jitter(range);
+  }
+
+  void join(unsigned long now) {
+    if (join_fn_) {
+      join_wait_ = join_fn_();
+    } else {
+      WiFi.begin(SSID, PASSWORD);
+      join_wait_ = WIFI_JOIN_WAIT_MS;
+    }
+    ++stats_.wifi_attempts;
+    state_ = State::WIFI_JOINING;
+    join_started_ = now;
+  }
+
+  void up(unsigned long now) {
+    if (ever_up_) {
+      ++stats_.reconnects;
+      stats_.outage_ms = now - down_since_;
+      if (stats_.outage_ms > stats_.max_outage_ms) stats_.max_outage_ms = stats_.outage_ms;
+    }
+    ever_up_ = true;
+    state_ = State::UP;
+    failures_ = 0;
+    if (on_up_) on_up_();
+
+    static Payload<160> msg;
+    msg.reset()
+       .field("reconnects",    stats_.reconnects)
+       .field("wifi_attempts", stats_.wifi_attempts)
+       .field("mqtt_attempts", stats_.mqtt_attempts)
+       .field("outage_ms",     stats_.outage_ms)
+       .field("max_outage_ms", stats_.max_outage_ms);
+    if (msg.end()) {
+      publishNow(topic_, reinterpret_cast<const uint8_t *>(msg.c_str()), msg.length(), true);
+    }
+  }
+
+  const char *node_id_ = nullptr;
+  void (*on_up_)() = nullptr;
+  JoinFn join_fn_ = nullptr;
+  char topic_[64];
+  State state_ = State::WIFI_DOWN;
+  bool ever_up_ = false;
+  uint8_t failures_ = 0;
+  unsigned long retry_at_ = 0;
+  unsigned long join_started_ = 0;
+  unsigned long join_wait_ = WIFI_JOIN_WAIT_MS;
+  unsigned long down_since_ = 0;
+  LinkStats stats_ = {0, 0, 0, 0, 0};
+};
+
+inline Link &link() {
+  static Link l;
+  return l;
+}
+
+}  // namespace wr
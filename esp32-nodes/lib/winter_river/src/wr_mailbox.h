@@ -0,0 +1,170 @@
+// wr_mailbox.h — lock-free handoff between the two node tasks.
+//
+// wr::Mailbox<T> is a single-producer / single-consumer triple buffer: the
+// producer fills back() in place and post()s it, the consumer take()s the
+// newest posted slot. Neither side ever blocks or waits on the other, and a
+// message posted before the previous one was taken simply replaces it — a
+// backlog collapses into the newest entry instead of queueing. The three
+// slots rotate through one atomic byte (index of the shared "middle" slot
+// plus a fresh bit); a T is never copied.
+//
+// wr::Queue<T, N> is the in-order counterpart for messages that must not be
+// replaced: an N-slot ring, filled in place the same way, that drops (and
+// counts) a message only when all N are waiting.
+//
+// In WR_DUAL_CORE mode (wr_tasks.h):
+//
+//   inbox()     network task → simulation task: the broker's tick control
+//               (stamped SEQ:, per-node or from the tick frame). Each one
+//               carries the node's full derived inputs, so only the newest
+//               matters; a superseded one shows as ctl_lost (wr_seq.h).
+//   commands()  network task → simulation task: every other control
+//               message, i.e. one-shot operator tokens (FANS_RUNNING:, ENC:,
+//               TX:, RATE:, ...), applied in order, WR_CONTROL_QUEUE deep.
+//   outbox()    simulation task → network task: the built telemetry
+//               message, published by the core that owns PubSubClient.
+//               Latest-wins: telemetry is only worth sending while fresh.
+//
+// Records kept for backfill go simulation → network task in order, through
+// wr_backfill.h's wr::keptRecords() queue.
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+
+#include <winter_river.h>
+
+#ifndef WR_DUAL_CORE
+#define WR_DUAL_CORE 0
+#endif
+#ifndef WR_CONTROL_QUEUE
+#define WR_CONTROL_QUEUE 4         // operator commands waiting for the simulation task
+#endif
+
+namespace wr {
+
+template <typename T>
+class Mailbox {
+ public:
+  // Producer side: the slot to fill before post().
+  T &back() { return slots_[back_]; }
+
+  // Publish back() to the consumer. Returns true if that replaced a message
+  // the consumer had not taken yet (coalesced).
+  bool post() {
+    const uint8_t prev = mid_.exchange(static_cast<uint8_t>(back_ | FRESH),
+                                       std::memory_order_acq_rel);
+    back_ = prev & INDEX;
+    ++posted_;
+    if (prev & FRESH) { ++coalesced_; return true; }
+    return false;
+  }
+
+  // Consumer side: the newest posted message, or nullptr if nothing new
+  // arrived since the last take(). Valid until the next take().
+  T *take() {
+    if (!(mid_.load(std::memory_order_relaxed) & FRESH)) return nullptr;
+    const uint8_t prev = mid_.exchange(front_, std::memory_order_acq_rel);
+    front_ = prev & INDEX;
+    return &slots_[front_];
+  }
+
+  // Producer-side counters (read them from the producer, or accept a stale
+  // value from the other core).
+  unsigned long posted() const { return posted_; }
+  unsigned long coalesced() const { return coalesced_; }
+
+ private:
+  static constexpr uint8_t INDEX = 0x03;
+  static constexpr uint8_t FRESH = 0x04;
+
+  T slots_[3];
+  uint8_t back_ = 0;                    // producer-owned
+  uint8_t front_ = 1;                   // consumer-owned
+  std::atomic<uint8_t> mid_{2};         // shared: middle index | FRESH
+  unsigned long posted_ = 0;
+  unsigned long coalesced_ = 0;
+};
+
+template <typename T, uint8_t N>
+class Queue {
+ public:
+  // Producer side: the slot to fill before push(), or nullptr when all N
+  // are waiting (counted as dropped).
+  T *back() {
+    const uint8_t head = head_.load(std::memory_order_relaxed);
+    if (static_cast<uint8_t>(head - tail_.load(std::memory_order_acquire)) == N) {
+      ++dropped_;
+      return nullptr;
+    }
+    return &slots_[head % N];
+  }
+
+  // Hand back() to the consumer.
+  void push() {
+    head_.store(static_cast<uint8_t>(head_.load(std::memory_order_relaxed) + 1),
+                std::memory_order_release);
+    ++pushed_;
+  }
+
+  // Consumer side: the oldest waiting message, or nullptr. Valid until pop().
+  T *front() {
+    const uint8_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire)) return nullptr;
+    return &slots_[tail % N];
+  }
+
+  void pop() {
+    tail_.store(static_cast<uint8_t>(tail_.load(std::memory_order_relaxed) + 1),
+                std::memory_order_release);
+  }
+
+  // Producer-side counters, as for Mailbox.
+  unsigned long pushed() const { return pushed_; }
+  unsigned long dropped() const { return dropped_; }
+
+ private:
+  static_assert(N > 0 && 256 % N == 0, "N must divide the 8-bit ring counters");
+
+  T slots_[N];
+  std::atomic<uint8_t> head_{0};        // written by the producer
+  std::atomic<uint8_t> tail_{0};        // written by the consumer
+  unsigned long pushed_ = 0;
+  unsigned long dropped_ = 0;
+};
+
+// One raw control payload, as handed to the node's MQTT callback.
+struct ControlMessage {
+  static constexpr size_t CAPACITY = 256;   // PubSubClient's default packet size
+  uint16_t len;
+  unsigned long rx_us;   // micros() when the callback copied it in (wr_latency.h)
+  byte data[CAPACITY];
+};
+
+// One outgoing telemetry message. wr::Node<> checks at compile time that its
+// largest JSON payload (Node::JSON_BYTES, 684 B for cooling) fits.
+struct OutgoingMessage {
+  static constexpr size_t CAPACITY = 768;
+  char topic[72];
+  uint16_t len;
+  bool retained;
+  uint8_t data[CAPACITY];
+};
+
+inline Mailbox<ControlMessage> &inbox() {
+  static Mailbox<ControlMessage> box;
+  return box;
+}
+
+inline Queue<ControlMessage, WR_CONTROL_QUEUE> &commands() {
+  static Queue<ControlMessage, WR_CONTROL_QUEUE> queue;
+  return queue;
+}
+
+inline Mailbox<OutgoingMessage> &outbox() {
+  static Mailbox<OutgoingMessage> box;
+  return box;
+}
+
+}  // namespace wr
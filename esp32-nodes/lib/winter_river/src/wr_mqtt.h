@@ -0,0 +1,658 @@
+// wr_mqtt.h — non-blocking, buffer-pooled MQTT 3.1.1 client.
+//
+// PubSubClient writes each publish synchronously into one packet buffer and
+// can only send QoS 0. A slow socket therefore stalls the network loop, a
+// payload larger than the buffer means a heap grow, and the broker had to
+// drop control to QoS 0 because the nodes could not keep up with PUBACKs.
+// With -DWR_MQTT_ASYNC=1, wr::MqttTransport (the type of wr::mqtt, declared
+// in winter_river.h) is wr::AsyncMqtt instead:
+//
+//   - Every outgoing packet goes into one of WR_MQTT_POOL preallocated
+//     buffers of WR_MQTT_BUF_BYTES. Nothing is allocated after boot, and a
+//     packet up to the buffer size needs no grow.
+//   - The socket is non-blocking. loop() writes what the socket takes and
+//     reads what has arrived, then returns. A partly written packet resumes
+//     on the next pass.
+//   - QoS 1 publishes are pipelined: up to WR_MQTT_WINDOW in flight, each
+//     freed by its PUBACK and resent with DUP after MQTT_RETRY_MS. Unacked
+//     QoS 1 packets are also resent after a reconnect. Incoming QoS 1
+//     publishes (control) are acknowledged.
+//   - Backpressure: publish() returns false when no buffer is free or the
+//     QoS 1 window is full, so the caller keeps its data (wr::Telemetry
+//     does not commit, wr_backfill.h keeps the batch). congested() is true a
+//     little before that, so wr_backfill.h yields to live telemetry.
+//
+// The API is the subset of PubSubClient the helpers use, plus publish() with
+// a QoS and the backpressure queries, so the rest of wr:: builds against
+// either transport. Only connect() waits, for at most the socket timeout
+// (TCP connect, then CONNACK), as PubSubClient's does; wr::link() calls it
+// as one of its reconnect steps. AsyncMqtt opens its own socket: setClient()
+// is accepted and ignored, and wr::link().wait() selects on fd().
+#pragma once
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <Arduino.h>
+#include <PubSubClient.h>
+#include <WiFi.h>
+#include <lwip/sockets.h>
+
+#ifndef WR_MQTT_ASYNC
+#define WR_MQTT_ASYNC 0
+#endif
+#ifndef WR_MQTT_POOL
+#define WR_MQTT_POOL 8             // outgoing packet buffers
+#endif
+#ifndef WR_MQTT_BUF_BYTES
+#define WR_MQTT_BUF_BYTES 768      // largest outgoing packet
+#endif
+#ifndef WR_MQTT_WINDOW
+#define WR_MQTT_WINDOW 4           // QoS 1 publishes awaiting PUBACK
+#endif
+#ifndef WR_MQTT_QOS
+#define WR_MQTT_QOS 1              // QoS of the helpers' publishes with WR_MQTT_ASYNC
+#endif
+
+namespace wr {
+
+static constexpr unsigned long MQTT_RETRY_MS = 2000;   // resend an unacknowledged packet
+static constexpr size_t MQTT_RX_BYTES = 2048;          // largest incoming packet (a tick frame, wr_tick.h)
+static constexpr size_t MQTT_TOPIC_MAX = 128;
+
+class AsyncMqtt {
+ public:
+  typedef void (*Callback)(char *topic, uint8_t *payload, unsigned int length);
+
+  // PubSubClient's state() codes.
+  static constexpr int CONNECTION_TIMEOUT = -4;
+  static constexpr int CONNECTION_LOST = -3;
+  static constexpr int CONNECT_FAILED = -2;
+  static constexpr int DISCONNECTED = -1;
+  static constexpr int CONNECTED = 0;
+
+  AsyncMqtt &setServer(const char *host, uint16_t port) {
+    host_ = host;
+    port_ = port;
+    return *this;
+  }
+  AsyncMqtt &setServer(IPAddress ip, uint16_t port) {
+    host_ = nullptr;
+    ip_ = ip;
+    port_ = port;
+    return *this;
+  }
+  AsyncMqtt &setClient(Client &) { return *this; }   // owns its socket
+  AsyncMqtt &setCallback(Callback cb) {
+    callback_ = cb;
+    return *this;
+  }
+  AsyncMqtt &setKeepAlive(uint16_t s) {
+    keepalive_ms_ = s * 1000UL;
+    return *this;
+  }
+  AsyncMqtt &setSocketTimeout(uint16_t s) {
+    timeout_ms_ = s * 1000UL;
+    return *this;
+  }
+  // Packets are pooled at a fixed size; nothing to grow.
+  bool setBufferSize(uint16_t size) { return size <= WR_MQTT_BUF_BYTES; }
+  uint16_t getBufferSize() const { return WR_MQTT_BUF_BYTES; }
+
+  bool connect(const char *id) { return connect(id, nullptr, nullptr, nullptr, 0, false, nullptr); }
+  bool connect(const char *id, const char *user, const char *pass) {
+    return connect(id, user, pass, nullptr, 0, false, nullptr);
+  }
+  bool connect(const char *id, const char *will_topic, uint8_t will_qos, bool will_retain,
+               const char *will_msg) {
+    return connect(id, nullptr, nullptr, will_topic, will_qos, will_retain, will_msg);
+  }
+  bool connect(const char *id, const char *user, const char *pass, const char *will_topic,
+               uint8_t will_qos, bool will_retain, const char *will_msg, bool clean = true) {
+    lost(DISCONNECTED);   // unacknowledged QoS 1 goes again in the new session
+    const unsigned long start = millis();
+    if (!open(start)) {
+      state_ = CONNECT_FAILED;
+      return false;
+    }
+    uint8_t flags = clean ? 0x02 : 0;
+    if (will_topic) flags |= 0x04 | (will_qos & 3) << 3 | (will_retain ? 0x20 : 0);
+    if (pass) flags |= 0x40;
+    if (user) flags |= 0x80;
+    Writer w(ctl_, sizeof(ctl_));
+    w.header(0x10, 10 + str(id) + (will_topic ? str(will_topic) + str(will_msg) : 0) +
+                       (user ? str(user) : 0) + (pass ? str(pass) : 0));
+    w.string("MQTT");
+    w.u8(4);
+    w.u8(flags);
+    w.u16(static_cast<uint16_t>(keepalive_ms_ / 1000));
+    w.string(id);
+    if (will_topic) {
+      w.string(will_topic);
+      w.string(will_msg);
+    }
+    if (user) w.string(user);
+    if (pass) w.string(pass);
+    if (!w.ok()) {
+      close();
+      state_ = CONNECT_FAILED;
+      return false;
+    }
+    ctl_len_ = w.length();
+    state_ = CONNECTING;
+    for (;;) {
+      flush();
+      receive();
+      if (state_ != CONNECTING) break;
+      const unsigned long waited = millis() - start;
+      if (waited >= timeout_ms_ || !ready(ctl_len_ > 0, timeout_ms_ - waited)) {
+        close();
+        state_ = CONNECTION_TIMEOUT;
+        break;
+      }
+    }
+    if (state_ != CONNECTED) return false;
+    last_rx_ms_ = last_tx_ms_ = millis();
+    ping_out_ = false;
+    resume();
+    flush();
+    return true;
+  }
+
+  bool connected() const { return state_ == CONNECTED; }
+  int state() const { return state_ == CONNECTING ? DISCONNECTED : state_; }
+
+  void disconnect() {
+    if (fd_ >= 0) {
+      static const uint8_t DISCONNECT[] = {0xE0, 0x00};
+      ::send(fd_, DISCONNECT, sizeof(DISCONNECT), SEND_FLAGS);
+    }
+    close();
+    state_ = DISCONNECTED;
+  }
+
+  // One non-blocking pass: resends, keepalive, write, read. True while
+  // connected.
+  bool loop() {
+    if (state_ != CONNECTED) return false;
+    const unsigned long now = millis();
+    for (Packet &p : pool_) {
+      if (p.state == Packet::WAIT_ACK && now - p.sent_ms >= MQTT_RETRY_MS) {
+        requeue(p);
+        ++stats_.retries;
+      }
+    }
+    if (now - last_rx_ms_ >= keepalive_ms_ || now - last_tx_ms_ >= keepalive_ms_) {
+      if (ping_out_) {
+        lost(CONNECTION_TIMEOUT);
+        return false;
+      }
+      static const uint8_t PINGREQ[] = {0xC0, 0x00};
+      control(PINGREQ, sizeof(PINGREQ));
+      ping_out_ = true;
+      last_rx_ms_ = last_tx_ms_ = now;   // the broker has one keepalive to answer
+    }
+    flush();
+    receive();
+    return state_ == CONNECTED;
+  }
+
+  bool publish(const char *topic, const char *payload) {
+    return publish(topic, reinterpret_cast<const uint8_t *>(payload), strlen(payload), false);
+  }
+  bool publish(const char *topic, const char *payload, bool retained) {
+    return publish(topic, reinterpret_cast<const uint8_t *>(payload), strlen(payload), retained);
+  }
+  bool publish(const char *topic, const uint8_t *payload, unsigned int len) {
+    return publish(topic, payload, len, false);
+  }
+  bool publish(const char *topic, const uint8_t *payload, unsigned int len, bool retained) {
+    return publish(topic, payload, len, retained, 0);
+  }
+  // False (and nothing queued) when disconnected, out of buffers, over the
+  // QoS 1 window, or too large for a buffer.
+  bool publish(const char *topic, const uint8_t *payload, size_t len, bool retained, uint8_t qos) {
+    if (state_ != CONNECTED) return false;
+    qos = qos ? 1 : 0;
+    if (qos && inFlight() >= WR_MQTT_WINDOW) {
+      ++stats_.refused;
+      return false;
+    }
+    Packet *p = alloc();
+    if (!p) {
+      ++stats_.refused;
+      return false;
+    }
+    Writer w(p->data, sizeof(p->data));
+    w.header(static_cast<uint8_t>(0x30 | qos << 1 | (retained ? 1 : 0)),
+             str(topic) + (qos ? 2 : 0) + len);
+    w.string(topic);
+    if (qos) w.u16(p->id = nextId());
+    w.bytes(payload, len);
+    if (!w.ok()) {
+      p->state = Packet::FREE;
+      ++stats_.oversize;
+      return false;
+    }
+    enqueue(*p, w.length(), qos);
+    ++stats_.published;
+    flush();
+    return true;
+  }
+
+  bool subscribe(const char *topic, uint8_t qos = 0) {
+    if (state_ != CONNECTED) return false;
+    Packet *p = alloc();
+    if (!p) return false;
+    Writer w(p->data, sizeof(p->data));
+    w.header(0x82, 2 + str(topic) + 1);
+    w.u16(p->id = nextId());
+    w.string(topic);
+    w.u8(qos > 1 ? 1 : qos);
+    if (!w.ok()) {
+      p->state = Packet::FREE;
+      return false;
+    }
+    enqueue(*p, w.length(), 1);
+    flush();
+    return true;
+  }
+
+  bool unsubscribe(const char *topic) {
+    if (state_ != CONNECTED) return false;
+    Packet *p = alloc();
+    if (!p) return false;
+    Writer w(p->data, sizeof(p->data));
+    w.header(0xA2, 2 + str(topic));
+    w.u16(p->id = nextId());
+    w.string(topic);
+    if (!w.ok()) {
+      p->state = Packet::FREE;
+      return false;
+    }
+    enqueue(*p, w.length(), 1);
+    flush();
+    return true;
+  }
+
+  // ── backpressure and diagnostics ──────────────────────────────────────
+
+  int fd() const { return fd_; }
+
+  // QoS 1 publishes not yet acknowledged (queued, on the wire or waiting).
+  uint8_t inFlight() const {
+    uint8_t n = 0;
+    for (const Packet &p : pool_) n += p.state != Packet::FREE && p.qos && isPublish(p);
+    return n;
+  }
+
+  uint8_t freeBuffers() const {
+    uint8_t n = 0;
+    for (const Packet &p : pool_) n += p.state == Packet::FREE;
+    return n;
+  }
+
+  // Nearly full: leave the room to live traffic.
+  bool congested() const { return freeBuffers() < 2 || inFlight() + 1 >= WR_MQTT_WINDOW; }
+
+  struct Stats {
+    unsigned long published;   // publishes accepted
+    unsigned long acked;       // PUBACKs received
+    unsigned long retries;     // packets resent after MQTT_RETRY_MS
+    unsigned long refused;     // publishes refused: no buffer or window full
+    unsigned long oversize;    // packets dropped: larger than a buffer
+    unsigned long stalls;      // writes the socket would not take
+  };
+  const Stats &stats() const { return stats_; }
+
+ private:
+  static constexpr int CONNECTING = 1000;   // internal; state() reports DISCONNECTED
+
+#ifdef MSG_NOSIGNAL
+  static constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+  static constexpr int SEND_FLAGS = 0;
+#endif
+
+  struct Packet {
+    enum State : uint8_t { FREE, QUEUED, WAIT_ACK };
+    State state = FREE;
+    uint8_t qos = 0;           // needs an acknowledgement (QoS 1 PUBLISH, SUBSCRIBE, ...)
+    uint16_t id = 0;
+    uint16_t len = 0;
+    uint16_t sent = 0;
+    uint32_t order = 0;        // enqueue order: sent oldest first
+    unsigned long sent_ms = 0;
+    uint8_t data[WR_MQTT_BUF_BYTES];
+  };
+
+  // Bounds-checked packet builder.
+  class Writer {
+   public:
+    Writer(uint8_t *buf, size_t cap) : buf_(buf), cap_(cap) {}
+    void header(uint8_t type, size_t remaining) {
+      u8(type);
+      do {
+        uint8_t b = remaining & 0x7F;
+        remaining >>= 7;
+        u8(remaining ? b | 0x80 : b);
+      } while (remaining);
+    }
+    void u8(uint8_t v) {
+      if (len_ < cap_) buf_[len_] = v;
+      ++len_;
+    }
+    void u16(uint16_t v) {
+      u8(v >> 8);
+      u8(v & 0xFF);
+    }
+    void string(const char *s) {
+      const size_t n = s ? strlen(s) : 0;
+      u16(static_cast<uint16_t>(n));
+      bytes(reinterpret_cast<const uint8_t *>(s), n);
+    }
+    void bytes(const uint8_t *p, size_t n) {
+      if (n && len_ + n <= cap_) memcpy(buf_ + len_, p, n);
+      len_ += n;
+    }
+    bool ok() const { return len_ <= cap_; }
+    size_t length() const { return len_; }
+
+   private:
+    uint8_t *buf_;
+    size_t cap_;
+    size_t len_ = 0;
+  };
+
+  static size_t str(const char *s) { return 2 + (s ? strlen(s) : 0); }
+  static bool isPublish(const Packet &p) { return (p.data[0] >> 4) == 3; }
+
+  bool open(unsigned long start) {
+    IPAddress ip = ip_;
+    if (host_ && !ip.fromString(host_) && !WiFi.hostByName(host_, ip)) return false;
+    fd_ = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (fd_ < 0) return false;
+    fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL, 0) | O_NONBLOCK);
+    int one = 1;
+    setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port_);
+    addr.sin_addr.s_addr = static_cast<uint32_t>(ip);
+    if (::connect(fd_, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0 &&
+        errno != EINPROGRESS) {
+      close();
+      return false;
+    }
+    const unsigned long waited = millis() - start;
+    int err = 0;
+    socklen_t n = sizeof(err);
+    if (waited >= timeout_ms_ || !ready(true, timeout_ms_ - waited) ||
+        getsockopt(fd_, SOL_SOCKET, SO_ERROR, &err, &n) < 0 || err) {
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  // Wait up to `ms` for the socket to be readable (or writable, if `write`).
+  bool ready(bool write, unsigned long ms) const {
+    fd_set rd, wr;
+    FD_ZERO(&rd);
+    FD_ZERO(&wr);
+    FD_SET(fd_, write ? &wr : &rd);
+    struct timeval tv = {static_cast<long>(ms / 1000), static_cast<long>((ms % 1000) * 1000)};
+    return select(fd_ + 1, &rd, &wr, nullptr, &tv) > 0;
+  }
+
+  void close() {
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+    current_ = -1;
+    ctl_len_ = ctl_sent_ = 0;
+    rx_len_ = 0;
+    skip_ = 0;
+  }
+
+  // The session dropped. QoS 1 publishes stay for the next one.
+  void lost(int why) {
+    close();
+    state_ = why;
+    for (Packet &p : pool_) {
+      if (p.state == Packet::FREE) continue;
+      if (p.qos && isPublish(p)) requeue(p);
+      else p.state = Packet::FREE;   // QoS 0 is stale by then; subscriptions are redone
+    }
+  }
+
+  // Right after CONNACK: what the last session left unacknowledged goes first.
+  void resume() {
+    for (Packet &p : pool_) {
+      if (p.state != Packet::FREE && !(p.qos && isPublish(p))) p.state = Packet::FREE;
+    }
+  }
+
+  void requeue(Packet &p) {
+    if (isPublish(p)) p.data[0] |= 0x08;   // DUP
+    p.state = Packet::QUEUED;
+    p.sent = 0;
+  }
+
+  Packet *alloc() {
+    for (Packet &p : pool_) {
+      if (p.state == Packet::FREE) {
+        p.state = Packet::QUEUED;   // claimed; enqueue() fills in the rest
+        p.len = 0;
+        return &p;
+      }
+    }
+    return nullptr;
+  }
+
+  void enqueue(Packet &p, size_t len, uint8_t needs_ack) {
+    p.len = static_cast<uint16_t>(len);
+    p.sent = 0;
+    p.qos = needs_ack;
+    p.order = ++order_;
+  }
+
+  uint16_t nextId() {
+    for (;;) {
+      if (++next_id_ == 0) next_id_ = 1;
+      bool used = false;
+      for (const Packet &p : pool_) used |= p.state != Packet::FREE && p.qos && p.id == next_id_;
+      if (!used) return next_id_;
+    }
+  }
+
+  // Acknowledgements and pings, written between pooled packets.
+  void control(const uint8_t *data, size_t len) {
+    if (ctl_len_ + len > sizeof(ctl_)) return;   // the broker resends, or the next ping goes
+    memcpy(ctl_ + ctl_len_, data, len);
+    ctl_len_ += len;
+  }
+
+  int oldestQueued() const {
+    int best = -1;
+    for (int i = 0; i < WR_MQTT_POOL; ++i) {
+      const Packet &p = pool_[i];
+      if (p.state == Packet::QUEUED && p.len && (best < 0 || p.order < pool_[best].order)) best = i;
+    }
+    return best;
+  }
+
+  // Write until the socket would block or nothing is left.
+  void flush() {
+    while (fd_ >= 0) {
+      const uint8_t *data;
+      size_t left;
+      if (current_ < 0 && ctl_len_) {
+        data = ctl_ + ctl_sent_;
+        left = ctl_len_ - ctl_sent_;
+      } else {
+        if (current_ < 0 && state_ == CONNECTED) current_ = oldestQueued();
+        if (current_ < 0) return;
+        const Packet &p = pool_[current_];
+        data = p.data + p.sent;
+        left = p.len - p.sent;
+      }
+      const ssize_t n = ::send(fd_, data, left, SEND_FLAGS);
+      if (n < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) ++stats_.stalls;
+        else lost(CONNECTION_LOST);
+        return;
+      }
+      last_tx_ms_ = millis();
+      if (current_ < 0) {
+        ctl_sent_ += n;
+        if (ctl_sent_ == ctl_len_) ctl_len_ = ctl_sent_ = 0;
+        continue;
+      }
+      Packet &p = pool_[current_];
+      p.sent += n;
+      if (p.sent < p.len) return;                      // the socket is full
+      p.state = p.qos ? Packet::WAIT_ACK : Packet::FREE;
+      p.sent_ms = last_tx_ms_;
+      current_ = -1;
+    }
+  }
+
+  // Read until the socket would block; handle every complete packet.
+  void receive() {
+    while (fd_ >= 0) {
+      const ssize_t n = ::recv(fd_, rx_ + rx_len_, sizeof(rx_) - rx_len_, 0);
+      if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        lost(CONNECTION_LOST);
+        return;
+      }
+      if (n < 0) return;
+      rx_len_ += n;
+      last_rx_ms_ = millis();
+      parse();
+    }
+  }
+
+  void parse() {
+    size_t off = 0;
+    while (off < rx_len_) {
+      if (skip_) {                                   // rest of a packet too large to keep
+        const size_t k = skip_ < rx_len_ - off ? skip_ : rx_len_ - off;
+        off += k;
+        skip_ -= k;
+        continue;
+      }
+      size_t remaining = 0, i = 1;
+      bool complete = false;
+      for (; i <= 4 && off + i < rx_len_; ++i) {
+        remaining |= static_cast<size_t>(rx_[off + i] & 0x7F) << (7 * (i - 1));
+        if (!(rx_[off + i] & 0x80)) {
+          complete = true;
+          break;
+        }
+      }
+      if (!complete) {
+        if (i > 4) {                                 // malformed length
+          lost(CONNECTION_LOST);
+          return;
+        }
+        break;
+      }
+      const size_t total = 1 + i + remaining;
+      if (total > sizeof(rx_)) {
+        skip_ = total;
+        ++stats_.oversize;
+        continue;
+      }
+      if (off + total > rx_len_) break;
+      handle(rx_[off], rx_ + off + 1 + i, remaining);
+      if (fd_ < 0) return;                           // handle() closed the session
+      off += total;
+    }
+    memmove(rx_, rx_ + off, rx_len_ - off);
+    rx_len_ -= off;
+  }
+
+  void handle(uint8_t header, uint8_t *body, size_t len) {
+    switch (header >> 4) {
+      case 2:                                                        // CONNACK
+        if (state_ == CONNECTING && len >= 2) {
+          state_ = body[1] == 0 ? CONNECTED : body[1];
+          if (body[1]) close();
+        }
+        break;
+      case 3: {                                                      // PUBLISH
+        const uint8_t qos = (header >> 1) & 3;
+        if (len < 2) return;
+        const size_t tlen = static_cast<size_t>(body[0]) << 8 | body[1];
+        size_t at = 2 + tlen + (qos ? 2 : 0);
+        if (at > len) return;
+        if (qos) {
+          const uint8_t ack[] = {0x40, 0x02, body[2 + tlen], body[3 + tlen]};
+          control(ack, sizeof(ack));
+        }
+        if (!callback_ || tlen >= sizeof(topic_)) return;
+        memcpy(topic_, body + 2, tlen);
+        topic_[tlen] = '\0';
+        callback_(topic_, body + at, static_cast<unsigned int>(len - at));
+        break;
+      }
+      case 4:                                                        // PUBACK
+      case 9:                                                        // SUBACK
+      case 11:                                                       // UNSUBACK
+        if (len >= 2) acked(static_cast<uint16_t>(body[0] << 8 | body[1]), header >> 4 == 4);
+        break;
+      case 13:                                                       // PINGRESP
+        ping_out_ = false;
+        break;
+    }
+  }
+
+  void acked(uint16_t id, bool puback) {
+    for (int i = 0; i < WR_MQTT_POOL; ++i) {
+      Packet &p = pool_[i];
+      if (p.state == Packet::FREE || !p.qos || p.id != id || i == current_) continue;
+      p.state = Packet::FREE;
+      if (puback) ++stats_.acked;
+      return;
+    }
+  }
+
+  const char *host_ = nullptr;
+  IPAddress ip_;
+  uint16_t port_ = 1883;
+  Callback callback_ = nullptr;
+  unsigned long keepalive_ms_ = 15000;   // PubSubClient's defaults
+  unsigned long timeout_ms_ = 15000;
+  int fd_ = -1;
+  int state_ = DISCONNECTED;
+  bool ping_out_ = false;
+  unsigned long last_rx_ms_ = 0;
+  unsigned long last_tx_ms_ = 0;
+
+  Packet pool_[WR_MQTT_POOL];
+  int current_ = -1;                     // pool_ index partly on the wire
+  uint32_t order_ = 0;
+  uint16_t next_id_ = 0;
+  uint8_t ctl_[256];                     // CONNECT, acknowledgements, pings
+  size_t ctl_len_ = 0;
+  size_t ctl_sent_ = 0;
+
+  uint8_t rx_[MQTT_RX_BYTES];
+  size_t rx_len_ = 0;
+  size_t skip_ = 0;
+  char topic_[MQTT_TOPIC_MAX];
+  Stats stats_ = {};
+};
+
+// What winter_river.h declares wr::mqtt as.
+#if WR_MQTT_ASYNC
+typedef AsyncMqtt MqttTransport;
+#else
+typedef PubSubClient MqttTransport;
+#endif
+
+}  // namespace wr
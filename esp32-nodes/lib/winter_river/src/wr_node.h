@@ -0,0 +1,398 @@
+// wr_node.h — a node type as one field table.
+//
+// Every node used to hand-write the same three things per field: a case in
+// handleToken(), a field() call in the telemetry chain and a print on the
+// OLED. wr::Node<Traits> generates all three — plus stats sampling — from a
+// constexpr table in the node's traits struct. The node keeps only its state
+// and the logic that is more than "assign the token's value":
+//
+//   static int   load_pct = 40;
+//   static float input_v  = 480.0f;
+//   ...
+//   struct Ups : wr::NodeTraits {
+//     static const char *id()    { return WR_NODE_ID; }
+//     static const char *label() { return WR_NODE_LABEL; }
+//     static constexpr const wr::schema::Schema &schema() { return wr::schema::UPS; }
+//     static constexpr wr::NodeField FIELDS[] = {
+//       wr::NodeField("load_pct", load_pct).control("LOAD").stats(load_stat).show("Load: ", "%"),
+//       wr::NodeField("input_v",  input_v).control("INPUT").show("Vin:  ", "V"),
+//       wr::NodeField("state",    state),
+//       wr::NodeField("voltage",  VOLTAGE_RATING),          // constant
+//     };
+//     static void afterControl() { applyGuard(); }          // optional hooks
+//   };
+//   constexpr wr::NodeField Ups::FIELDS[];
+//
+//   typedef wr::Node<Ups> UpsNode;
+//   void setup() { UpsNode::start(); }
+//   void loop()  { wr::runNode(); }
+//
+// Table order is the JSON field order and must equal the node type's
+// wr_schema.h table; that, and the field types against the wire kinds, is
+// checked at compile time. Per field:
+//
+//   .control("TOK")      TOK:<value> assigns the field (STATUS: via parseState)
+//   .stats(stat)         sampled at WR_STATS_HZ, "_min/_max/_mean" in the JSON
+//   .precision(n)        JSON decimals for a float (default 1)
+//   .show("L: ", "u", d) drawn on the OLED as "L: <value>u", floats at d places
+//   .sameLine()          ... continuing the previous shown field's line
+//
+// The table is walked by index recursion, so every access is to a constant
+// entry: the dispatcher becomes a short compare chain over the table's
+// token hashes, checking the key text only on a hit, the serializer a fixed
+// field() sequence, and nothing goes through a pointer or virtual call at
+// run time. The JSON buffer is sized
+// to the table's worst case, so a payload can never overflow it.
+//
+// Node identity is settled in start() by the node's wr::Identity
+// (wr_identity.h): the board's provisioned id and label from NVS, so one
+// image serves every node of a type, else the build's
+//   '-DWR_NODE_ID="ups_a"'                  ; optional: per-board build
+//   '-DWR_NODE_LABEL="ups_a"'               ; OLED header, defaults to the id
+// which is also what id() / label() in the traits return.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <winter_river.h>
+#include <wr_backfill.h>
+#include <wr_identity.h>
+#include <wr_json.h>
+#include <wr_latency.h>
+#include <wr_oled.h>
+#include <wr_peer.h>
+#include <wr_prof.h>
+#include <wr_rate.h>
+#include <wr_schema.h>
+#include <wr_state.h>
+#include <wr_stats.h>
+#include <wr_tasks.h>
+#include <wr_telemetry.h>
+#include <wr_tokens.h>
+
+#ifndef WR_NODE_LABEL
+#define WR_NODE_LABEL WR_NODE_ID
+#endif
+
+namespace wr {
+
+// One telemetry field: where its value lives, how it is controlled, shown
+// and published. Built with the chained constexpr setters above.
+struct NodeField {
+  enum class Type : uint8_t { INT, CONST_INT, FLOAT, BOOL, STATE };
+
+  union Ref {
+    constexpr Ref(int *p) : i(p) {}
+    constexpr Ref(const int *p) : k(p) {}
+    constexpr Ref(float *p) : f(p) {}
+    constexpr Ref(bool *p) : b(p) {}
+    constexpr Ref(State *p) : s(p) {}
+    int *i;
+    const int *k;
+    float *f;
+    bool *b;
+    State *s;
+  };
+
+  constexpr NodeField(const char *n, int &v)       : NodeField(n, Type::INT, Ref(&v)) {}
+  constexpr NodeField(const char *n, const int &v) : NodeField(n, Type::CONST_INT, Ref(&v)) {}
+  constexpr NodeField(const char *n, float &v)     : NodeField(n, Type::FLOAT, Ref(&v)) {}
+  constexpr NodeField(const char *n, bool &v)      : NodeField(n, Type::BOOL, Ref(&v)) {}
+  constexpr NodeField(const char *n, State &v)     : NodeField(n, Type::STATE, Ref(&v)) {}
+
+  constexpr NodeField control(const char *tok) const {
+    return NodeField(name, type, ref, tok, kw(tok), stat, decimals, label, unit, digits, same_line);
+  }
+  constexpr NodeField stats(Stat &s) const {
+    return NodeField(name, type, ref, keyword, token, &s, decimals, label, unit, digits, same_line);
+  }
+  constexpr NodeField precision(uint8_t d) const {
+    return NodeField(name, type, ref, keyword, token, stat, d, label, unit, digits, same_line);
+  }
+  constexpr NodeField show(const char *l, const char *u = "", uint8_t d = 0) const {
+    return NodeField(name, type, ref, keyword, token, stat, decimals, l, u, d, same_line);
+  }
+  constexpr NodeField sameLine() const {
+    return NodeField(name, type, ref, keyword, token, stat, decimals, label, unit, digits, true);
+  }
+
+  constexpr bool controlled() const { return token != 0; }
+  constexpr bool sampled() const { return stat != nullptr; }
+  constexpr bool shown() const { return label != nullptr; }
+
+  const char *name;       // JSON key = wr_schema.h field name
+  Type type;
+  Ref ref;
+  const char *keyword;    // control keyword, nullptr = none
+  uint32_t token;         // wr::kw() of it, 0 = none
+  Stat *stat;
+  uint8_t decimals;       // JSON places for FLOAT
+  const char *label;      // OLED, nullptr = not shown
+  const char *unit;
+  uint8_t digits;         // OLED places for FLOAT
+  bool same_line;
+
+ private:
+  constexpr NodeField(const char *n, Type t, Ref r)
+      : NodeField(n, t, r, nullptr, 0, nullptr, 1, nullptr, "", 0, false) {}
+  constexpr NodeField(const char *n, Type t, Ref r, const char *key, uint32_t tok, Stat *s,
+                      uint8_t dec, const char *l, const char *u, uint8_t dig, bool same)
+      : name(n), type(t), ref(r), keyword(key), token(tok), stat(s), decimals(dec), label(l),
+        unit(u), digits(dig), same_line(same) {}
+};
+
+// Default hooks; a node's traits struct hides the ones it needs.
+struct NodeTraits {
+  // Tokens with side effects beyond one field; true = consumed. Tried
+  // before the table.
+  static bool control(const Token &) { return false; }
+  static void beforeControl() {}    // once per control message, before its tokens
+  static void afterControl() {}     // ... after them: guards, derived values
+  // WR_PEER_FAST_PATH: an upstream neighbour's state changed (wr_peer.h).
+  // Runs in step(), before telemetry; set the local consequence only.
+  static void upstream(const Peers &) {}
+};
+
+namespace detail {
+
+template <size_t I> struct FieldIndex {};
+
+constexpr size_t length(const char *s) { return *s ? 1 + length(s + 1) : 0; }
+constexpr bool sameText(const char *a, const char *b) {
+  return *a == *b && (*a == '\0' || sameText(a + 1, b + 1));
+}
+
+constexpr size_t larger(size_t a, size_t b) { return a > b ? a : b; }
+
+constexpr size_t longestStateName(size_t i = 0) {
+  return i == sizeof(STATE_WIRE) / sizeof(STATE_WIRE[0])
+             ? 0
+             : larger(length(STATE_WIRE[i]), longestStateName(i + 1));
+}
+
+constexpr bool fits(NodeField::Type t, schema::Kind k) {
+  return t == NodeField::Type::STATE ? k == schema::Kind::STATE
+       : t == NodeField::Type::BOOL  ? k == schema::Kind::BOOL
+       : k != schema::Kind::STATE && k != schema::Kind::BOOL;
+}
+
+// Same names, same order, compatible kinds.
+constexpr bool matches(const NodeField *f, size_t n, const schema::Schema &s, size_t i = 0) {
+  return n == s.count &&
+         (i == n || (sameText(f[i].name, s.fields[i].name) && fits(f[i].type, s.fields[i].kind) &&
+                     matches(f, n, s, i + 1)));
+}
+
+constexpr bool controlsWritable(const NodeField *f, size_t n) {
+  return n == 0 || ((f->token == 0 || f->type != NodeField::Type::CONST_INT) &&
+                    controlsWritable(f + 1, n - 1));
+}
+
+constexpr size_t stateIndex(const NodeField *f, size_t n, size_t i = 0) {
+  return i == n || f[i].type == NodeField::Type::STATE ? i : stateIndex(f, n, i + 1);
+}
+
+constexpr size_t firstShown(const NodeField *f, size_t n, size_t i = 0) {
+  return i == n || f[i].shown() ? i : firstShown(f, n, i + 1);
+}
+
+// Worst-case JSON text for one value: sign + 10 digits for 32-bit ints and
+// wr::JsonWriter's fixed-point floats, plus '.' and the places.
+constexpr size_t valueBytes(NodeField::Type t, uint8_t decimals) {
+  return t == NodeField::Type::STATE ? longestStateName() + 2
+       : t == NodeField::Type::BOOL  ? 5
+       : t == NodeField::Type::FLOAT ? 11 + (decimals ? decimals + 1 : 0)
+       : 11;
+}
+
+constexpr size_t fieldBytes(const NodeField &f) {
+  return length(f.name) + 4 + valueBytes(f.type, f.decimals) +
+         (!f.stat ? 0
+                  : 3 * length(f.name) + 8 + 8 + 9 +
+                    2 * valueBytes(NodeField::Type::FLOAT, f.type == NodeField::Type::FLOAT ? f.decimals : 0) +
+                    valueBytes(NodeField::Type::FLOAT, (f.type == NodeField::Type::FLOAT ? f.decimals : 0) + 1));
+}
+
+// {"ts":"HH:MM:SS", ts_ms / ts_err_us / seq, the fields, boot_ms, the control
+// echo, '}' and the NUL.
+constexpr size_t jsonBytes(const NodeField *f, size_t n) {
+  return n == 0 ? 16 + EPOCH_TS_JSON_BYTES + BOOT_MS_JSON_BYTES + CONTROL_ECHO_JSON_BYTES + 2
+                : fieldBytes(*f) + jsonBytes(f + 1, n - 1);
+}
+
+}  // namespace detail
+
+template <typename Traits>
+class Node {
+ public:
+  static constexpr size_t N = sizeof(Traits::FIELDS) / sizeof(Traits::FIELDS[0]);
+  static constexpr size_t JSON_BYTES = detail::jsonBytes(Traits::FIELDS, N);
+  static constexpr size_t STATE = detail::stateIndex(Traits::FIELDS, N);
+
+  static_assert(detail::matches(Traits::FIELDS, N, Traits::schema()),
+                "field table does not match the node type's wr_schema.h table");
+  static_assert(STATE < N, "field table needs a wr::State field");
+  static_assert(detail::controlsWritable(Traits::FIELDS, N), "constant field with a control token");
+  static_assert(JSON_BYTES <= OutgoingMessage::CAPACITY,
+                "JSON payload may not fit a wr::outbox() slot (wr_mailbox.h)");
+#if WR_MQTT_ASYNC
+  static_assert(5 + 2 + sizeof(Topic) + JSON_BYTES <= WR_MQTT_BUF_BYTES,
+                "JSON payload may not fit a wr::AsyncMqtt packet buffer (wr_mqtt.h)");
+#endif
+
+  static void start() {
+    identity().load();
+    provisioning().begin(identity());
+    startNode(identity().id(), onMqtt, step, keep);
+  }
+
+  // Who this board is; the build's id until start() has loaded it.
+  static Identity &identity() {
+    static Identity who(Traits::schema().type, Traits::id(), Traits::label());
+    return who;
+  }
+
+  // For policy set-up in setup(), e.g. payload().deadband("load_pct", 2).
+  static Telemetry<JSON_BYTES> &payload() { return payload_; }
+
+  static void onMqtt(char *, byte *p, unsigned int l) {
+    Traits::beforeControl();
+    forEachToken(p, l, handleToken);
+    Traits::afterControl();
+  }
+
+  // One simulation pass; wr::runNode() calls it from loop(), or from the
+  // wr_sim task with WR_DUAL_CORE (wr_tasks.h).
+  // A change of the node's own state — from a peer or a control message —
+  // starts a telemetry burst (wr_rate.h); with WR_PEER_FAST_PATH it is also
+  // drawn and published at once.
+  static void step(bool tick) {
+    bool urgent = false;
+#if WR_PEER_FAST_PATH
+    if (peers().take()) Traits::upstream(peers());
+#endif
+    static State last = *field(STATE).ref.s;
+    if (*field(STATE).ref.s != last) {
+      last = *field(STATE).ref.s;
+      urgent = WR_PEER_FAST_PATH != 0;
+#if WR_TELEMETRY_BURST
+      telemetryRate().burst();
+#endif
+    }
+    if (tick || urgent) render();
+    if (statsDue()) sample(detail::FieldIndex<0>());
+    if (!payload_.sampleDue(tick) && !urgent) return;
+
+    payload_.begin();
+    write(detail::FieldIndex<0>());
+    if (publish(topic(), payload_)) message_count++;
+  }
+
+  // A telemetry tick with the link down (wr_tasks.h): the payload is built
+  // packed and kept for backfill (wr_backfill.h) instead.
+  static void keep() {
+    if (!timeSync().now().ms) return;   // no clock yet: nothing to file it under
+    payload_.begin(true);
+    write(detail::FieldIndex<0>());
+    BinaryWriter &bin = payload_.bin();
+    if (!bin.end()) return;
+    keepRecord(bin.data(), bin.length());
+    payload_.kept();
+  }
+
+ private:
+  typedef NodeField::Type Type;
+  static constexpr const NodeField &field(size_t i) { return Traits::FIELDS[i]; }
+
+  static void handleToken(const Token &tok) {
+    if (Traits::control(tok) || assign(tok, detail::FieldIndex<0>())) return;
+    handleCommonToken(tok);
+  }
+
+  static bool assign(const Token &, detail::FieldIndex<N>) { return false; }
+  template <size_t I>
+  static bool assign(const Token &tok, detail::FieldIndex<I>) {
+    const NodeField &f = field(I);
+    if (!f.controlled() || tok.hash != f.token || !tok.keyIs(f.keyword)) {
+      return assign(tok, detail::FieldIndex<I + 1>());
+    }
+    switch (f.type) {
+      case Type::INT:       *f.ref.i = tok.toInt();        return true;
+      case Type::FLOAT:     *f.ref.f = tok.toFloat();      return true;
+      case Type::BOOL:      *f.ref.b = tok.toInt() != 0;   return true;
+      case Type::STATE:     parseState(tok, *f.ref.s);     return true;
+      case Type::CONST_INT: return false;
+    }
+    return false;
+  }
+
+  static void sample(detail::FieldIndex<N>) {}
+  template <size_t I>
+  static void sample(detail::FieldIndex<I>) {
+    const NodeField &f = field(I);
+    if (f.sampled()) record(f.stat, f.type == Type::FLOAT ? *f.ref.f : static_cast<float>(value(f)));
+    sample(detail::FieldIndex<I + 1>());
+  }
+
+  static void write(detail::FieldIndex<N>) {}
+  template <size_t I>
+  static void write(detail::FieldIndex<I>) {
+    const NodeField &f = field(I);
+    switch (f.type) {
+      case Type::FLOAT: payload_.field(f.name, *f.ref.f, f.decimals); break;
+      case Type::BOOL:  payload_.field(f.name, *f.ref.b);             break;
+      case Type::STATE: payload_.field(f.name, *f.ref.s);             break;
+      default:          payload_.field(f.name, value(f));             break;
+    }
+    if (f.sampled()) payload_.stats(f.name, *f.stat, f.type == Type::FLOAT ? f.decimals : 0);
+    write(detail::FieldIndex<I + 1>());
+  }
+
+  static void render() {
+    prof::Scope prof(prof::Section::RENDER);
+    displayHeader(identity().label(), oledName(*field(STATE).ref.s));
+    displayNetLine();
+    draw(detail::FieldIndex<0>());
+    display.println();
+    displayFooter();
+    flushDisplay();
+  }
+
+  static void draw(detail::FieldIndex<N>) {}
+  template <size_t I>
+  static void draw(detail::FieldIndex<I>) {
+    const NodeField &f = field(I);
+    if (f.shown()) {
+      if (I != detail::firstShown(Traits::FIELDS, N) && !f.same_line) display.println();
+      display.print(f.label);
+      switch (f.type) {
+        case Type::FLOAT: display.print(*f.ref.f, f.digits);              break;
+        case Type::BOOL:  display.print(*f.ref.b ? "ON" : "OFF");         break;
+        case Type::STATE: display.print(oledName(*f.ref.s));              break;
+        default:          display.print(value(f));                        break;
+      }
+      display.print(f.unit);
+    }
+    draw(detail::FieldIndex<I + 1>());
+  }
+
+  static void record(Stat *s, float v) { s->add(v); }
+
+  // INT / CONST_INT only.
+  static int value(const NodeField &f) { return f.type == Type::CONST_INT ? *f.ref.k : *f.ref.i; }
+
+  static const Topic &topic() {
+    static const Topic t(identity().id(), "status");
+    return t;
+  }
+
+  static Telemetry<JSON_BYTES> payload_;   // reused every cycle — no heap
+};
+
+template <typename Traits> constexpr size_t Node<Traits>::N;
+template <typename Traits> constexpr size_t Node<Traits>::JSON_BYTES;
+template <typename Traits> constexpr size_t Node<Traits>::STATE;
+template <typename Traits> Telemetry<Node<Traits>::JSON_BYTES> Node<Traits>::payload_(Traits::schema());
+
+}  // namespace wr
@@ -0,0 +1,161 @@
+// wr_oled.h — incremental SSD1306 flush for the wr:: display helpers.
+//
+// display.display() pushes the whole 1 KB frame over I2C every time, which at
+// the default 100 kHz bus clock is ~95 ms of blocking transfer per render —
+// even when the only thing that changed is one digit of a reading.
+// wr::flushDisplay() is a drop-in replacement for it:
+//
+//   wr::displayHeader(LABEL, wr::oledName(state));
+//   ...
+//   wr::displayFooter();
+//   wr::flushDisplay();                    // was: wr::display.display();
+//
+// It keeps a copy of the frame as last sent and, for each of the 8 SSD1306
+// pages (one 8 px text row at text size 1), sends only the column span that
+// differs, through a PAGEADDR/COLUMNADDR window. Drawing stays exactly as it
+// was (full redraw into the RAM buffer, which is cheap); only the bus
+// traffic shrinks. An unchanged row costs nothing, a changed reading is
+// typically one page × a few glyphs: ~30 B instead of ~1050 B.
+//
+// Every WR_OLED_RESYNC_FLUSHES flushes the full frame is sent anyway, so a
+// panel that glitched (brown-out, bus error) cannot stay out of step with the
+// copy for long. WR_I2C_HZ raises the bus clock (SSD1306 is specified for
+// 400 kHz fast mode); 0 leaves Wire at its default.
+//
+// lastFlush() reports bytes on the bus and microseconds for the latest flush
+// so the two paths can be compared on a real panel.
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include <Wire.h>
+#include <winter_river.h>
+
+#ifndef WR_I2C_HZ
+#define WR_I2C_HZ 0
+#endif
+#ifndef WR_OLED_RESYNC_FLUSHES
+#define WR_OLED_RESYNC_FLUSHES 60   // 5 min at one render per telemetry interval
+#endif
+
+namespace wr {
+
+struct FlushStats {
+  uint16_t bytes;        // I2C bytes incl. address bytes, excl. start/stop/ack
+  uint8_t pages;         // pages sent
+  bool full;             // whole frame via display.display()
+  unsigned long us;
+};
+
+class OledFlusher {
+ public:
+  static constexpr uint8_t WIDTH = 128;
+  static constexpr uint8_t PAGES = 8;
+
+  void flush(Adafruit_SSD1306 &d) {
+    const unsigned long t0 = micros();
+    if (!addr_) setup();
+    const uint8_t *frame = d.getBuffer();
+    stats_ = FlushStats{0, 0, false, 0};
+
+    // Find each page's changed column span and what sending them would cost.
+    uint8_t lo[PAGES], hi[PAGES];
+    uint16_t partial = 0;
+    for (uint8_t page = 0; page < PAGES; ++page) {
+      span(frame, page, lo[page], hi[page]);
+      if (lo[page] < hi[page]) partial += pageCost(hi[page] - lo[page]);
+    }
+
+    if (!primed_ || ++since_full_ >= WR_OLED_RESYNC_FLUSHES || partial >= FULL_FRAME_BYTES) {
+      d.display();
+      memcpy(shadow_, frame, sizeof(shadow_));
+      primed_ = true;
+      since_full_ = 0;
+      stats_.full = true;
+      stats_.pages = PAGES;
+      stats_.bytes = FULL_FRAME_BYTES;
+    } else {
+      for (uint8_t page = 0; page < PAGES; ++page) {
+        if (lo[page] < hi[page]) sendPage(frame, page, lo[page], hi[page]);
+      }
+    }
+    stats_.us = micros() - t0;
+  }
+
+  const FlushStats &lastFlush() const { return stats_; }
+
+ private:
+  // Adafruit_SSD1306::display() on ESP32: one 8-byte command list, then
+  // 1024 data bytes in 127-byte chunks, each chunk with address + 0x40.
+  static constexpr uint16_t FULL_FRAME_BYTES = 8 + 1024 + 9 * 2;
+
+  // Data bytes per I2C transaction, after the 0x40 control byte.
+#ifdef I2C_BUFFER_LENGTH
+  static constexpr uint8_t CHUNK = (I2C_BUFFER_LENGTH > 128 ? 128 : I2C_BUFFER_LENGTH) - 1;
+#else
+  static constexpr uint8_t CHUNK = 31;
+#endif
+
+  void setup() {
+    if (WR_I2C_HZ) Wire.setClock(WR_I2C_HZ);
+    // Same probe order as wr::begin(); the panel ACKs on exactly one.
+    Wire.beginTransmission(0x3C);
+    addr_ = Wire.endTransmission() == 0 ? 0x3C : 0x3D;
+  }
+
+  // [lo, hi) = columns of `page` that differ from the shadow; lo == hi if none.
+  void span(const uint8_t *frame, uint8_t page, uint8_t &lo, uint8_t &hi) const {
+    const uint8_t *cur = frame + page * WIDTH;
+    const uint8_t *old = shadow_ + page * WIDTH;
+    lo = 0;
+    hi = WIDTH;
+    while (lo < WIDTH && cur[lo] == old[lo]) ++lo;
+    if (lo == WIDTH) { hi = lo; return; }
+    while (cur[hi - 1] == old[hi - 1]) --hi;
+  }
+
+  // Bus bytes for one page window of n columns (see sendPage()).
+  static uint16_t pageCost(uint8_t n) { return 8 + n + 2 * ((n + CHUNK - 1) / CHUNK); }
+
+  void sendPage(const uint8_t *frame, uint8_t page, uint8_t lo, uint8_t hi) {
+    const uint8_t *cur = frame + page * WIDTH;
+    uint8_t *old = shadow_ + page * WIDTH;
+    // Window the controller's horizontal-mode pointer to [lo, hi) of `page`.
+    const uint8_t window[] = {0x00, 0x22, page, page, 0x21, lo, static_cast<uint8_t>(hi - 1)};
+    Wire.beginTransmission(addr_);
+    Wire.write(window, sizeof(window));
+    Wire.endTransmission();
+    stats_.bytes += 1 + sizeof(window);
+
+    for (uint8_t col = lo; col < hi;) {
+      const uint8_t n = (hi - col) < CHUNK ? (hi - col) : CHUNK;
+      Wire.beginTransmission(addr_);
+      Wire.write(static_cast<uint8_t>(0x40));
+      Wire.write(cur + col, n);
+      Wire.endTransmission();
+      stats_.bytes += 2 + n;
+      col += n;
+    }
+    memcpy(old + lo, cur + lo, hi - lo);
+    ++stats_.pages;
+  }
+
+  uint8_t shadow_[PAGES * WIDTH];
+  uint8_t addr_ = 0;
+  bool primed_ = false;
+  uint16_t since_full_ = 0;
+  FlushStats stats_ = {0, 0, false, 0};
+};
+
+inline OledFlusher &oledFlusher() {
+  static OledFlusher f;
+  return f;
+}
+
+// Push the changed parts of wr::display to the panel.
+inline void flushDisplay() { oledFlusher().flush(display); }
+
+inline const FlushStats &lastFlush() { return oledFlusher().lastFlush(); }
+
+}  // namespace wr
@@ -0,0 +1,388 @@
+// wr_ota.h — over-the-air updates from the Pi, with trial boot and rollback.
+//
+// Flashing the fleet used to mean 24 serial `pio run -t upload` runs over
+// USB. With this helper a node updates itself over WiFi. broker/ota.py on
+// the Pi stores every build, serves images over HTTP, and tells each node
+// what to fetch:
+//
+//   Pi   → winter-river/<id>/ota          URL:http://192.168.4.1:8070/ups_a/1a2b3c4d-5e6f7081.wrd
+//                                         TARGET:5e6f7081
+//   node → winter-river/<id>/ota/status   {"state":"DOWNLOADING","image":"1a2b3c4d",
+//                                          "size":912384,"target":"5e6f7081",
+//                                          "bytes":4096,"total":6120,"pct":66}
+//
+// The URL names a WRD1 delta (wr_delta.h) from the running image to the new
+// one. The orchestrator learns the running image's CRC-32 from the retained
+// status ("image"). It sends a full image (a delta with no base) if it does
+// not know the running build. The download runs in its own task. The
+// decoder reads the running app partition and writes the other OTA slot
+// through esp_ota_write(). No image is ever held in RAM. Nothing is booted
+// unless the output matches the delta's target CRC and TARGET, and
+// esp_ota_end() has checked the image.
+//
+// The node then reboots into the new slot on trial. NVS (namespace
+// "wr_ota") remembers the slot it came from and counts trial boots. The
+// trial is confirmed once MQTT has stayed up for CONFIRM_MS. The node rolls
+// back to the previous slot if it boots more than MAX_TRIAL_BOOTS times
+// without confirming (a crash loop), or is not confirmed by
+// TRIAL_TIMEOUT_MS. It then reports "ROLLED_BACK". This does not rely on
+// the bootloader's app-rollback option, which the prebuilt Arduino
+// bootloader does not enable.
+//
+// states   IDLE          nothing pending (also the running image's report)
+//          DOWNLOADING   "bytes" of "total" received, "pct" done
+//          REBOOTING     new slot set; restarting once this is published
+//          TRIAL         running a new image, not yet confirmed
+//          CONFIRMED     the trial passed
+//          ROLLED_BACK   the trial failed; back on the previous image
+//          FAILED        "error": HTTP, NO_PARTITION, FLASH, TIMEOUT, TARGET,
+//                        or a wr_delta.h error (BASE_MISMATCH, ...)
+//
+// The status is published on the task that owns PubSubClient, at most once
+// a second while a download runs. Needs a partition table with two OTA app
+// slots (the Arduino default for 4 MB boards). Build with -DWR_OTA=0 to
+// ignore update commands; a running trial is still confirmed or rolled back.
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+
+#include <HTTPClient.h>
+#include <Preferences.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <winter_river.h>
+#include <wr_delta.h>
+#include <wr_json.h>
+#include <wr_tokens.h>
+
+#ifndef WR_OTA
+#define WR_OTA 1
+#endif
+#ifndef WR_NET_CORE
+#define WR_NET_CORE 0
+#endif
+
+namespace wr {
+
+class Ota {
+ public:
+  static constexpr unsigned long CONFIRM_MS        = 30000;    // MQTT up this long: trial passed
+  static constexpr unsigned long TRIAL_TIMEOUT_MS  = 180000;   // not confirmed by now: roll back
+  static constexpr uint8_t       MAX_TRIAL_BOOTS   = 3;
+  static constexpr unsigned long STALL_MS          = 15000;    // no bytes for this long: give up
+  static constexpr unsigned long PROGRESS_MS       = 1000;     // status rate while downloading
+  static constexpr unsigned long RESTART_DELAY_MS  = 500;      // let REBOOTING reach the broker
+
+  enum class State : uint8_t { IDLE, DOWNLOADING, REBOOTING, TRIAL, CONFIRMED, ROLLED_BACK, FAILED };
+
+  // From startNode(), before the link comes up. Settles a pending trial
+  // (possibly by rebooting into the previous image).
+  void begin(const char *node_id) {
+    snprintf(cmd_topic_, sizeof(cmd_topic_), "winter-river/%s/ota", node_id);
+    snprintf(status_topic_, sizeof(status_topic_), "winter-river/%s/ota/status", node_id);
+    Preferences prefs;
+    prefs.begin("wr_ota", false);
+    if (prefs.getUChar("trial", 0)) {
+      const uint8_t boots = prefs.getUChar("boots", 0) + 1;
+      prefs.putUChar("boots", boots);
+      state_ = State::TRIAL;
+      if (boots > MAX_TRIAL_BOOTS) rollBack(prefs);
+    } else if (prefs.getUChar("rolled_back", 0)) {
+      state_ = State::ROLLED_BACK;
+    }
+    prefs.end();
+  }
+
+  // Start hashing the running image for the status report. From
+  // startNode(), or after the first publish with WR_FAST_BOOT (wr_boot.h).
+  void hashImage() {
+    xTaskCreatePinnedToCore(hashTask, "wr_ota_crc", 3072, this, 1, nullptr, WR_NET_CORE);
+  }
+
+  // ── network side: the task that owns PubSubClient ────────────────────────
+
+  // After every MQTT (re)connect.
+  void subscribe() {
+    if (WR_OTA) mqtt.subscribe(cmd_topic_, 1);
+    announced_ = false;   // retained status again for the new session
+    up_since_ = millis();
+  }
+
+  // Route one incoming message. True if it was an update command (taken
+  // here whether or not it could start).
+  bool receive(const char *topic, const byte *p, unsigned int l) {
+    if (!WR_OTA || !topic || strcmp(topic, cmd_topic_) != 0) return false;
+    const State s = state_.load();
+    if (s == State::DOWNLOADING || s == State::REBOOTING || s == State::TRIAL) {
+      return true;   // one at a time; a trial settles first
+    }
+    char url[sizeof(url_)] = "";
+    uint32_t target = 0;
+    scanTokens(p, l, [&](const Token &tok) {
+      switch (tok.hash) {
+        case kw("URL"):
+          if (tok.keyIs("URL") && tok.value_len < sizeof(url)) {
+            memcpy(url, tok.value, tok.value_len);
+            url[tok.value_len] = '\0';
+          }
+          break;
+        case kw("TARGET"):
+          if (tok.keyIs("TARGET")) target = parseHex(tok.value, tok.value_len);
+          break;
+      }
+    });
+    if (!url[0] || !target) return true;
+    memcpy(url_, url, sizeof(url_));
+    target_ = target;
+    bytes_ = 0;
+    total_ = 0;
+    error_ = "";
+    state_ = State::DOWNLOADING;
+    if (xTaskCreatePinnedToCore(updateTask, "wr_ota", 6144, this, 1, nullptr, WR_NET_CORE) != 1) {
+      fail("TASK");
+    }
+    return true;
+  }
+
+  // Publish status changes, settle the trial, restart when due. Call after
+  // mqtt.loop().
+  void poll() {
+    const unsigned long now = millis();
+    const State s = state_.load();
+    if (!mqtt.connected()) {
+      up_since_ = now;
+    } else if (s == State::TRIAL && now - up_since_ >= CONFIRM_MS) {
+      confirm();
+    }
+    if (s == State::TRIAL && now >= TRIAL_TIMEOUT_MS) {
+      Preferences prefs;
+      prefs.begin("wr_ota", false);
+      rollBack(prefs);
+      prefs.end();
+    }
+    if (s == State::REBOOTING && announced_ && published_state_ == s &&
+        now - published_ms_ >= RESTART_DELAY_MS) {
+      ESP.restart();
+    }
+    publishStatus(now);
+  }
+
+  State state() const { return state_.load(); }
+  uint32_t imageCrc() const { return image_crc_.load(); }
+
+ private:
+  struct Io {
+    const esp_partition_t *running;
+    esp_ota_handle_t handle;
+  };
+
+  static const char *stateName(State s) {
+    static const char *const NAMES[] = {"IDLE", "DOWNLOADING", "REBOOTING", "TRIAL", "CONFIRMED",
+                                        "ROLLED_BACK", "FAILED"};
+    return NAMES[static_cast<uint8_t>(s)];
+  }
+
+  static const char *decoderError(DeltaDecoder::Error e) {
+    static const char *const NAMES[] = {"NONE", "BAD_MAGIC", "BASE_MISMATCH", "BAD_OP",
+                                        "OUT_OF_RANGE", "READ", "WRITE", "TARGET_MISMATCH"};
+    return NAMES[static_cast<uint8_t>(e)];
+  }
+
+  static uint32_t parseHex(const char *s, size_t n) {
+    uint32_t v = 0;
+    for (size_t i = 0; i < n && i < 8; ++i) {
+      const char c = s[i];
+      const uint32_t d = c >= '0' && c <= '9' ? c - '0'
+                       : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                       : c >= 'A' && c <= 'F' ? c - 'A' + 10 : 16;
+      if (d > 15) return 0;
+      v = v << 4 | d;
+    }
+    return v;
+  }
+
+  static bool readRunning(void *ctx, uint32_t offset, uint8_t *buf, size_t n) {
+    return esp_partition_read(static_cast<Io *>(ctx)->running, offset, buf, n) == ESP_OK;
+  }
+
+  static bool writeNext(void *ctx, const uint8_t *buf, size_t n) {
+    return esp_ota_write(static_cast<Io *>(ctx)->handle, buf, n) == ESP_OK;
+  }
+
+  // CRC-32 of the running image, as broker/ota.py records it from
+  // firmware.bin. ~1 MB of flash reads, so off the network task.
+  static void hashTask(void *arg) {
+    Ota *self = static_cast<Ota *>(arg);
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    const uint32_t size = ESP.getSketchSize();
+    uint8_t buf[DeltaDecoder::CHUNK];
+    uint32_t crc = 0;
+    bool ok = running != nullptr && size > 0;
+    for (uint32_t at = 0; ok && at < size;) {
+      const size_t n = size - at < sizeof(buf) ? size - at : sizeof(buf);
+      ok = esp_partition_read(running, at, buf, n) == ESP_OK;
+      crc = crc32(crc, buf, n);
+      at += n;
+    }
+    if (ok) {
+      self->image_size_ = size;
+      self->image_crc_ = crc;
+    }
+    vTaskDelete(nullptr);
+  }
+
+  static void updateTask(void *arg) {
+    static_cast<Ota *>(arg)->update();
+    vTaskDelete(nullptr);
+  }
+
+  void update() {
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    const esp_partition_t *next = esp_ota_get_next_update_partition(nullptr);
+    if (!running || !next) { fail("NO_PARTITION"); return; }
+
+    HTTPClient http;
+    http.setTimeout(static_cast<uint16_t>(STALL_MS));
+    if (!http.begin(url_) || http.GET() != HTTP_CODE_OK) { http.end(); fail("HTTP"); return; }
+    const int size = http.getSize();
+    total_ = size > 0 ? static_cast<uint32_t>(size) : 0;
+
+    Io io = {running, 0};
+    if (esp_ota_begin(next, OTA_SIZE_UNKNOWN, &io.handle) != ESP_OK) { http.end(); fail("FLASH"); return; }
+    DeltaDecoder dec(readRunning, writeNext, &io);
+    WiFiClient *stream = http.getStreamPtr();
+    uint8_t buf[1024];
+    unsigned long last_rx = millis();
+    while (dec.status() == DeltaDecoder::Status::MORE) {
+      const int avail = stream ? stream->available() : 0;
+      if (avail <= 0) {
+        if (!http.connected() || millis() - last_rx >= STALL_MS) break;
+        vTaskDelay(pdMS_TO_TICKS(2));
+        continue;
+      }
+      const int n = stream->read(buf, static_cast<size_t>(avail) < sizeof(buf) ? avail : sizeof(buf));
+      if (n <= 0) continue;
+      last_rx = millis();
+      dec.feed(buf, static_cast<size_t>(n));
+      bytes_ += static_cast<uint32_t>(n);
+    }
+    http.end();
+
+    const char *error = nullptr;
+    if (dec.status() == DeltaDecoder::Status::MORE) error = "TIMEOUT";
+    else if (dec.status() == DeltaDecoder::Status::FAILED) error = decoderError(dec.error());
+    else if (dec.targetCrc() != target_) error = "TARGET";
+    if (error) { esp_ota_end(io.handle); fail(error); return; }   // end() frees the handle
+    if (esp_ota_end(io.handle) != ESP_OK || esp_ota_set_boot_partition(next) != ESP_OK) {
+      fail("FLASH");
+      return;
+    }
+
+    Preferences prefs;
+    prefs.begin("wr_ota", false);
+    prefs.putString("prev", running->label);
+    prefs.putUChar("boots", 0);
+    prefs.putUChar("rolled_back", 0);
+    prefs.putUChar("trial", 1);
+    prefs.end();
+    state_ = State::REBOOTING;
+  }
+
+  void fail(const char *error) {
+    error_ = error;
+    state_ = State::FAILED;
+  }
+
+  void confirm() {
+    Preferences prefs;
+    prefs.begin("wr_ota", false);
+    prefs.putUChar("trial", 0);
+    prefs.end();
+    esp_ota_mark_app_valid_cancel_rollback();   // no-op unless the bootloader tracks it too
+    state_ = State::CONFIRMED;
+  }
+
+  // Boot the slot the trial came from. Does not return if that slot exists.
+  void rollBack(Preferences &prefs) {
+    char label[17] = "";
+    prefs.getString("prev", label, sizeof(label));
+    prefs.putUChar("trial", 0);
+    const esp_partition_t *prev =
+        esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY, label);
+    if (!prev || esp_ota_set_boot_partition(prev) != ESP_OK) {
+      state_ = State::CONFIRMED;   // nothing to go back to: keep what runs
+      return;
+    }
+    prefs.putUChar("rolled_back", 1);
+    prefs.end();
+    Serial.println(F("[wr] OTA trial failed, rolling back"));
+    ESP.restart();
+  }
+
+  void publishStatus(unsigned long now) {
+    const State s = state_.load();
+    const uint32_t crc = image_crc_.load();
+    const bool changed = s != published_state_ || crc != published_crc_;
+    const bool progress = s == State::DOWNLOADING && bytes_.load() != published_bytes_ &&
+                          now - published_ms_ >= PROGRESS_MS;
+    if (!mqtt.connected() || (announced_ && !changed && !progress)) return;
+
+    static Payload<224> msg;
+    char hex[9];
+    msg.reset().field("state", stateName(s));
+    if (crc) {
+      snprintf(hex, sizeof(hex), "%08lx", static_cast<unsigned long>(crc));
+      msg.field("image", hex).field("size", static_cast<unsigned long>(image_size_.load()));
+    } else {
+      msg.nullField("image");
+    }
+    const uint32_t bytes = bytes_.load();
+    if (s == State::DOWNLOADING || s == State::REBOOTING || s == State::FAILED) {
+      const uint32_t total = total_.load();
+      snprintf(hex, sizeof(hex), "%08lx", static_cast<unsigned long>(target_));
+      msg.field("target", hex)
+         .field("bytes", static_cast<unsigned long>(bytes))
+         .field("total", static_cast<unsigned long>(total));
+      if (total) msg.field("pct", static_cast<unsigned long>(100ULL * bytes / total));
+    }
+    if (s == State::FAILED) msg.field("error", error_);
+    if (!msg.end()) return;
+    if (publishNow(status_topic_, reinterpret_cast<const uint8_t *>(msg.c_str()), msg.length(), true)) {
+      announced_ = true;
+      published_state_ = s;
+      published_crc_ = crc;
+      published_bytes_ = bytes;
+      published_ms_ = now;
+    }
+  }
+
+  char cmd_topic_[56] = "";
+  char status_topic_[64] = "";
+  char url_[160] = "";
+  uint32_t target_ = 0;
+  const char *error_ = "";
+  // Shared with the wr_ota / wr_ota_crc tasks.
+  std::atomic<State> state_{State::IDLE};
+  std::atomic<uint32_t> bytes_{0};
+  std::atomic<uint32_t> total_{0};
+  std::atomic<uint32_t> image_crc_{0};
+  std::atomic<uint32_t> image_size_{0};
+  // Network side only.
+  unsigned long up_since_ = 0;
+  bool announced_ = false;
+  State published_state_ = State::IDLE;
+  uint32_t published_crc_ = 0;
+  uint32_t published_bytes_ = 0;
+  unsigned long published_ms_ = 0;
+};
+
+inline Ota &ota() {
+  static Ota o;
+  return o;
+}
+
+}  // namespace wr
@@ -0,0 +1,213 @@
+// wr_peer.h — edge fast path: react to the upstream neighbours directly.
+//
+// Without it a utility outage reaches the racks only through the broker: the
+// node's next telemetry (up to 5 s), the broker's 1 Hz run_simulation_tick,
+// then one control hop per tick down the chain. With -DWR_PEER_FAST_PATH=1 a
+// node also subscribes to its upstream neighbours' status and applies the
+// obvious local consequence itself, within milliseconds:
+//
+//   mv_lv_transformer_a ─┐
+//                        ├─▶ lv_switchgear_a ─▶ ups_a ─▶ server_rack_a{1..4}
+//   generator_a ─────────┘                  └─▶ cooling_a
+//
+// The broker stays authoritative: its next tick sends the full STATUS as
+// before, and that overwrites whatever the node decided locally.
+//
+// Who is upstream comes from the broker, not the firmware. It publishes a
+// retained blob per node on winter-river/<node_id>/topology, built from
+// nodes.parent_id / secondary_parent_id (scripts/init_db.sql), in the
+// control-token format:
+//
+//   PARENT:mv_lv_transformer_a SECONDARY:generator_a
+//
+// The node subscribes to it on every (re)connect, so the blob arrives with
+// the session; a changed blob swaps the peer subscriptions in place. Peer
+// status is read from <peer>/status (JSON, or the broker's JSON republish of
+// a binary node) and <peer>/status/bin, and only the state field is looked
+// at. The LWT's OFFLINE counts as a dead feed.
+//
+// The network side only parses and stores the newest state per slot (one
+// atomic byte each, latest wins); the node's reaction runs wherever its
+// control handler runs (wr_tasks.h), through the traits' upstream() hook
+// (wr_node.h). A node whose own state changes — from a peer or a control
+// message — publishes at once instead of waiting for the telemetry tick, so
+// the next hop sees it too. Build the whole fleet with the flag: a node
+// without it (the utility, say) still only reports its state every 5 s.
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+
+#include <winter_river.h>
+#include <wr_json.h>
+#include <wr_schema.h>
+#include <wr_state.h>
+#include <wr_tokens.h>
+
+#ifndef WR_PEER_FAST_PATH
+#define WR_PEER_FAST_PATH 0
+#endif
+
+namespace wr {
+
+// Whether a neighbour in `s` is feeding power downstream. Mirrors the
+// broker's v_out > 0 in _compute_node: a standby or starting generator, an
+// open or tripped breaker and a transformer without input all count as dead.
+inline bool energised(State s) {
+  switch (s) {
+    case State::NORMAL:   case State::WARNING:    case State::DEGRADED:
+    case State::GRID_OK:  case State::SAG:        case State::SWELL:
+    case State::CLOSED:   case State::GENERATOR:  case State::RUNNING:
+    case State::ON_BATTERY: case State::CHARGING:
+      return true;
+    default:
+      return false;
+  }
+}
+
+class Peers {
+ public:
+  static constexpr uint8_t SLOTS = 2;          // PARENT, SECONDARY
+  static constexpr uint8_t ID_CAPACITY = 40;
+
+  void begin(const char *node_id) {
+    snprintf(topology_, sizeof(topology_), "winter-river/%s/topology", node_id);
+  }
+
+  // ── network side: the task that owns PubSubClient ────────────────────────
+
+  // After every MQTT (re)connect: the blob topic, and the peers we know of.
+  void subscribe() {
+    mqtt.subscribe(topology_, 1);
+    for (uint8_t i = 0; i < SLOTS; ++i) watch(i, true);
+  }
+
+  // Route one incoming message. True if it was the blob or a peer status;
+  // anything else is control for the node.
+  bool receive(const char *topic, const byte *p, unsigned int l) {
+    if (!topic) return false;
+    if (strcmp(topic, topology_) == 0) {
+      configure(p, l);
+      return true;
+    }
+    for (uint8_t i = 0; i < SLOTS; ++i) {
+      const size_t n = strlen(status_[i]);
+      if (!n || strncmp(topic, status_[i], n) != 0) continue;
+      const bool bin = strcmp(topic + n, "/bin") == 0;
+      if (topic[n] != '\0' && !bin) continue;
+      State s;
+      if (bin ? stateFromBinary(p, l, s) : stateFromJson(p, l, s)) {
+        latest_[i].store(static_cast<uint8_t>(s), std::memory_order_relaxed);
+        fresh_.store(true, std::memory_order_release);
+      }
+      return true;
+    }
+    return false;
+  }
+
+  // ── node side: wherever the control handler runs ─────────────────────────
+
+  // True once per burst of peer updates.
+  bool take() { return fresh_.exchange(false, std::memory_order_acquire); }
+
+  bool known(uint8_t slot) const { return latest_[slot].load(std::memory_order_relaxed) != UNKNOWN; }
+  State state(uint8_t slot) const {
+    return static_cast<State>(latest_[slot].load(std::memory_order_relaxed));
+  }
+  // Known and feeding; an unknown or unconfigured slot is not.
+  bool live(uint8_t slot) const { return known(slot) && energised(state(slot)); }
+
+ private:
+  static constexpr uint8_t UNKNOWN = 0xFF;
+
+  void configure(const byte *p, unsigned int l) {
+    char next[SLOTS][ID_CAPACITY] = {};
+    scanTokens(p, l, [&next](const Token &tok) {
+      uint8_t slot;
+      switch (tok.hash) {
+        case kw("PARENT"):    slot = 0; break;
+        case kw("SECONDARY"): slot = 1; break;
+        default: return;
+      }
+      if (!tok.keyIs(slot ? "SECONDARY" : "PARENT")) return;
+      if (tok.value_len && tok.value_len < ID_CAPACITY) memcpy(next[slot], tok.value, tok.value_len);
+    });
+    for (uint8_t i = 0; i < SLOTS; ++i) {
+      if (strcmp(next[i], id_[i]) == 0) continue;
+      watch(i, false);
+      memcpy(id_[i], next[i], ID_CAPACITY);
+      if (id_[i][0]) snprintf(status_[i], sizeof(status_[i]), "winter-river/%s/status", id_[i]);
+      else           status_[i][0] = '\0';
+      latest_[i].store(UNKNOWN, std::memory_order_relaxed);
+      watch(i, true);
+    }
+  }
+
+  void watch(uint8_t slot, bool on) {
+    if (!status_[slot][0]) return;
+    char bin[sizeof(status_[0]) + 4];
+    snprintf(bin, sizeof(bin), "%s/bin", status_[slot]);
+    if (on) { mqtt.subscribe(status_[slot], 0); mqtt.subscribe(bin, 0); }
+    else    { mqtt.unsubscribe(status_[slot]);  mqtt.unsubscribe(bin); }
+  }
+
+  // The value of "state" (or the LWT's "status"), else a bare state name.
+  static bool stateFromJson(const byte *p, unsigned int l, State &out) {
+    const char *s = reinterpret_cast<const char *>(p);
+    const char *v = nullptr;
+    const char *end = s + l;
+    for (const char *key : {"\"state\":\"", "\"status\":\""}) {
+      const size_t n = strlen(key);
+      for (const char *c = s; c + n <= end && !v; ++c) {
+        if (memcmp(c, key, n) == 0) v = c + n;
+      }
+      if (v) break;
+    }
+    const char *e = v;
+    if (v) while (e < end && *e != '"') ++e;
+    else   { v = s; e = end; }
+    Token tok = {v, v, 0, static_cast<uint16_t>(e - v), true, 0};
+    return parseState(tok, out);
+  }
+
+  // Walk the sender's schema (wr_schema.h) to its STATE byte.
+  static bool stateFromBinary(const byte *p, unsigned int l, State &out) {
+    static const schema::Schema *const TYPES[] = {
+      &schema::UTILITY, &schema::HV_MV_TRANSFORMER, &schema::MV_SWITCHGEAR,
+      &schema::MV_LV_TRANSFORMER, &schema::LV_SWITCHGEAR, &schema::GENERATOR,
+      &schema::UPS, &schema::COOLING, &schema::SERVER_RACK,
+    };
+    if (l < schema::HEADER_BYTES || p[0] != schema::MAGIC || p[1] != schema::VERSION) return false;
+    const schema::Schema *type = nullptr;
+    for (const schema::Schema *t : TYPES) if (t->type_id == p[2]) type = t;
+    if (!type) return false;
+    unsigned int at = schema::HEADER_BYTES;
+    for (uint8_t i = 0; i < type->count && at < l; ++i) {
+      switch (type->fields[i].kind) {
+        case schema::Kind::STATE:
+          if (p[at] >= sizeof(detail::STATE_WIRE) / sizeof(detail::STATE_WIRE[0])) return false;
+          out = static_cast<State>(p[at]);
+          return true;
+        case schema::Kind::U8:
+        case schema::Kind::BOOL:    at += 1; break;
+        case schema::Kind::X10_I32: at += 4; break;
+        default:                    at += 2; break;
+      }
+    }
+    return false;
+  }
+
+  char topology_[64] = {};
+  char id_[SLOTS][ID_CAPACITY] = {};
+  char status_[SLOTS][ID_CAPACITY + 24] = {};
+  std::atomic<uint8_t> latest_[SLOTS] = {{UNKNOWN}, {UNKNOWN}};
+  std::atomic<bool> fresh_{false};
+};
+
+inline Peers &peers() {
+  static Peers p;
+  return p;
+}
+
+}  // namespace wr
@@ -0,0 +1,188 @@
+// wr_prof.h — on-device hot-path profiler and heap health.
+//
+// wr::prof::Scope times a block with the CPU cycle counter (one register
+// read at each end) into a fixed-size histogram for its section:
+//
+//   static void render() {
+//     wr::prof::Scope prof(wr::prof::Section::RENDER);
+//     ...
+//   }
+//
+// The helper times every hot path itself, the OLED render included
+// (wr::Node<>::render(), wr_node.h):
+//
+//   MQTT      each mqtt.loop() call. In single-core mode this includes the
+//             control handler, which runs inside it.
+//   CONTROL   the node's MQTT callback: wr::forEachToken() + its handlers
+//   RENDER    the OLED layout, drawing and wr::flushDisplay()
+//   BUILD     payload.begin() → wr::publish(), the field() chain
+//   PUBLISH   wr::publish() itself: encode, hand to PubSubClient (in
+//             WR_DUAL_CORE mode: copy into wr::outbox())
+//
+// Histograms have 4 buckets per octave from 1 µs to ~130 ms (±12 %), plus an
+// exact max, and restart every report. Heap is sampled once a second: free
+// bytes, the all-time low, and the largest allocatable block — a shrinking
+// largest block with steady free bytes is fragmentation, which is what
+// eventually fails a PubSubClient buffer grow or a WiFi reconnect.
+//
+// Every PERF_REPORT_MS the node publishes one retained message on
+// winter-river/<node_id>/perf (wr_tasks.h), all times in µs, stack in bytes:
+//
+//   {"up_s":86400,"heap":201340,"heap_min":187220,"blk":110580,"blk_min":94196,
+//    "stk_net":3120,"stk_sim":2410,"mqtt_n":6000,"mqtt_p50":14,"mqtt_p99":96,
+//    "mqtt_max":2310,...,"render_p50":2740,...}
+//
+// Build with -DWR_PROF=0 to compile every Scope away.
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include <winter_river.h>
+#include <wr_json.h>
+
+#ifndef WR_PROF
+#define WR_PROF 1
+#endif
+
+namespace wr {
+namespace prof {
+
+static constexpr unsigned long PERF_REPORT_MS  = 60000;
+static constexpr unsigned long HEAP_SAMPLE_MS  = 1000;
+
+enum class Section : uint8_t { MQTT, CONTROL, RENDER, BUILD, PUBLISH, COUNT };
+
+inline const char *sectionName(Section s) {
+  static const char *const NAMES[] = {"mqtt", "control", "render", "build", "publish"};
+  return NAMES[static_cast<uint8_t>(s)];
+}
+
+inline uint32_t cycles() { return ESP.getCycleCount(); }
+
+// Fixed-size µs histogram: 0..3 µs exact, then 4 sub-buckets per octave.
+class Histogram {
+ public:
+  static constexpr uint8_t BUCKETS = 64;
+
+  void add(uint32_t us) {
+    ++counts_[bucket(us)];
+    ++n_;
+    if (us > max_) max_ = us;
+  }
+
+  void reset() {
+    memset(counts_, 0, sizeof(counts_));
+    n_ = 0;
+    max_ = 0;
+  }
+
+  uint32_t count() const { return n_; }
+  uint32_t max() const { return max_; }
+
+  // Upper bound of the bucket holding quantile q (capped at max()).
+  uint32_t percentile(float q) const {
+    if (!n_) return 0;
+    uint32_t rank = static_cast<uint32_t>(q * n_ + 0.5f);
+    if (rank < 1) rank = 1;
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < BUCKETS; ++i) {
+      seen += counts_[i];
+      if (seen >= rank) {
+        const uint32_t hi = i == BUCKETS - 1 ? max_ : upper(i);   // last one is open-ended
+        return hi < max_ ? hi : max_;
+      }
+    }
+    return max_;
+  }
+
+ private:
+  static uint8_t bucket(uint32_t us) {
+    if (us < 4) return static_cast<uint8_t>(us);
+    const uint8_t octave = static_cast<uint8_t>(31 - __builtin_clz(us));   // ≥ 2
+    const uint32_t idx = (octave - 1) * 4u + ((us >> (octave - 2)) & 3u);
+    return idx < BUCKETS ? static_cast<uint8_t>(idx) : BUCKETS - 1;
+  }
+
+  // Largest µs value that lands in bucket i.
+  static uint32_t upper(uint8_t i) {
+    if (i < 4) return i;
+    const uint8_t octave = i / 4 + 1;
+    return ((5u + i % 4) << (octave - 2)) - 1;
+  }
+
+  uint32_t counts_[BUCKETS] = {};
+  uint32_t n_ = 0;
+  uint32_t max_ = 0;
+};
+
+inline Histogram &histogram(Section s) {
+  static Histogram h[static_cast<uint8_t>(Section::COUNT)];
+  return h[static_cast<uint8_t>(s)];
+}
+
+inline void record(Section s, uint32_t elapsed_cycles) {
+  static const uint32_t mhz = getCpuFrequencyMhz();
+  histogram(s).add(elapsed_cycles / mhz);
+}
+
+class Scope {
+ public:
+#if WR_PROF
+  explicit Scope(Section s) : section_(s), start_(cycles()) {}
+  ~Scope() { record(section_, cycles() - start_); }
+
+ private:
+  Section section_;
+  uint32_t start_;
+#else
+  explicit Scope(Section) {}
+#endif
+};
+
+// For a span that is not one C++ scope: start() at its beginning, stop() at
+// its end.
+inline uint32_t start() { return WR_PROF ? cycles() : 0; }
+inline void stop(Section s, uint32_t started) {
+  if (WR_PROF) record(s, cycles() - started);
+}
+
+struct HeapHealth {
+  uint32_t free;
+  uint32_t free_min;        // low-water mark since boot (IDF-tracked)
+  uint32_t largest;         // largest allocatable block, latest sample
+  uint32_t largest_min;     // ... lowest sample since boot
+};
+
+// Samples at most every HEAP_SAMPLE_MS (the largest-block query walks the heap).
+inline const HeapHealth &heap() {
+  static HeapHealth h = {0, 0, 0, UINT32_MAX};
+  static unsigned long last_ms = 0;
+  const unsigned long now = millis();
+  if (h.largest_min == UINT32_MAX || now - last_ms >= HEAP_SAMPLE_MS) {
+    last_ms = now;
+    h.free = ESP.getFreeHeap();
+    h.free_min = ESP.getMinFreeHeap();
+    h.largest = ESP.getMaxAllocHeap();
+    if (h.largest < h.largest_min) h.largest_min = h.largest;
+  }
+  return h;
+}
+
+// Append every section's histogram ("<name>_n", "_p50", "_p99", "_max") to
+// `out` and start a new window. Sections with no samples are skipped.
+inline void writeSections(JsonWriter &out) {
+  for (uint8_t i = 0; i < static_cast<uint8_t>(Section::COUNT); ++i) {
+    const Section s = static_cast<Section>(i);
+    Histogram &h = histogram(s);
+    if (!h.count()) continue;
+    out.field(sectionName(s), "_n",   static_cast<unsigned long>(h.count()))
+       .field(sectionName(s), "_p50", static_cast<unsigned long>(h.percentile(0.50f)))
+       .field(sectionName(s), "_p99", static_cast<unsigned long>(h.percentile(0.99f)))
+       .field(sectionName(s), "_max", static_cast<unsigned long>(h.max()));
+    h.reset();   // racy against the other core by design, as loopStats()
+  }
+}
+
+}  // namespace prof
+}  // namespace wr
@@ -0,0 +1,99 @@
+// wr_rate.h — runtime telemetry rate with bursts around events.
+//
+// The telemetry tick used to be wr::dueForTelemetry(), a fixed
+// TELEMETRY_INTERVAL_MS (5 s). A generator transfer takes a few seconds, so
+// historical_data and the Grafana timelines got one or two points of it.
+// wr::telemetryRate() now drives the tick (wr_tasks.h):
+//
+//   idle    the interval between events. Starts at TELEMETRY_INTERVAL_MS;
+//           RATE:<ms> sets it (RATE_MIN_MS..RATE_MAX_MS, RATE:0 restores
+//           the default).
+//   burst   WR_BURST_INTERVAL_MS for WR_BURST_WINDOW_MS after an event,
+//           starting with a tick at once. Another event extends the window.
+//   decay   after the window the interval doubles each tick until it is
+//           back at idle, so the end of an event is still well sampled.
+//
+// An event is a change of the node's own state (wr::Node<>, wr_node.h), or
+// BURST:<ms> from the broker, which sends it to the whole fleet when a tick
+// changes the state of several nodes at once (an outage cascade). Between
+// events there is no extra traffic.
+//
+// RATE_MAX_MS keeps an idle node inside the broker's 20 s
+// STALE_NODE_THRESHOLD_SEC. -DWR_TELEMETRY_BURST=0 leaves out the bursts on
+// state change; RATE: and BURST: still apply.
+#pragma once
+
+#include <Arduino.h>
+#include <winter_river.h>
+
+#ifndef WR_TELEMETRY_BURST
+#define WR_TELEMETRY_BURST 1
+#endif
+#ifndef WR_BURST_INTERVAL_MS
+#define WR_BURST_INTERVAL_MS 250
+#endif
+#ifndef WR_BURST_WINDOW_MS
+#define WR_BURST_WINDOW_MS 10000
+#endif
+
+namespace wr {
+
+static constexpr unsigned long RATE_MIN_MS = 100;
+static constexpr unsigned long RATE_MAX_MS = 15000;
+static constexpr unsigned long BURST_MAX_WINDOW_MS = 60000;
+
+static_assert(WR_BURST_INTERVAL_MS >= RATE_MIN_MS, "WR_BURST_INTERVAL_MS below RATE_MIN_MS");
+
+class TelemetryRate {
+ public:
+  // True when a telemetry tick is due. Once per task loop pass, in place of
+  // wr::dueForTelemetry().
+  bool due() {
+    const unsigned long now = millis();
+    if (!now_ && now - last_ms_ < step_ms_) return false;
+    now_ = false;
+    last_ms_ = now;
+    if (static_cast<long>(burst_until_ - now) > 0) step_ms_ = WR_BURST_INTERVAL_MS;
+    else if (step_ms_ < idle_ms_) step_ms_ = step_ms_ * 2 < idle_ms_ ? step_ms_ * 2 : idle_ms_;
+    else step_ms_ = idle_ms_;
+    return true;
+  }
+
+  // Sample at the burst rate for `window_ms` from now, with a tick at once.
+  void burst(unsigned long window_ms = WR_BURST_WINDOW_MS) {
+    if (!window_ms) return;
+    if (window_ms > BURST_MAX_WINDOW_MS) window_ms = BURST_MAX_WINDOW_MS;
+    const unsigned long until = millis() + window_ms;
+    if (!bursting() || static_cast<long>(until - burst_until_) > 0) burst_until_ = until;
+    if (step_ms_ > WR_BURST_INTERVAL_MS) now_ = true;
+    step_ms_ = WR_BURST_INTERVAL_MS;
+    ++bursts_;
+  }
+
+  // RATE:<ms>. 0 restores the build default.
+  void setIdle(unsigned long ms) {
+    if (!ms) ms = TELEMETRY_INTERVAL_MS;
+    idle_ms_ = ms < RATE_MIN_MS ? RATE_MIN_MS : ms > RATE_MAX_MS ? RATE_MAX_MS : ms;
+    if (!bursting()) step_ms_ = idle_ms_;
+  }
+
+  unsigned long idle() const { return idle_ms_; }
+  unsigned long interval() const { return step_ms_; }   // current
+  bool bursting() const { return static_cast<long>(burst_until_ - millis()) > 0; }
+  unsigned long bursts() const { return bursts_; }
+
+ private:
+  unsigned long idle_ms_ = TELEMETRY_INTERVAL_MS;
+  unsigned long step_ms_ = TELEMETRY_INTERVAL_MS;
+  unsigned long last_ms_ = 0;
+  unsigned long burst_until_ = 0;
+  unsigned long bursts_ = 0;
+  bool now_ = false;
+};
+
+inline TelemetryRate &telemetryRate() {
+  static TelemetryRate r;
+  return r;
+}
+
+}  // namespace wr
@@ -0,0 +1,439 @@
+// wr_scenario.h — timed fault-injection scenarios, run on the node.
+//
+// Training drills used to be driven by hand: an operator sends STATUS:OUTAGE
+// to utility_a, then FANS_RUNNING:2 to cooling_a a few seconds later, and
+// the timing is whatever the human and the network made of it. A scenario
+// is the same sequence compiled once on the Pi (broker/scenario.py) and
+// pushed to each node as a small program, which this interpreter runs
+// against the node's own clock:
+//
+//   Pi   → winter-river/<id>/scenario          the program (QoS 1, never
+//                                              retained); empty = stop
+//   node → winter-river/<id>/scenario/status   {"state":"DONE",
+//                                               "program":"1a2b3c4d","late_ms":2}
+//
+//   offset 0    u8   MAGIC (0xA7)
+//   offset 1    u8   VERSION
+//   offset 2    u16  code bytes that follow the header
+//   offset 4    i64  start, epoch ms (wr_time.h); 0 = on arrival
+//   offset 12   ops, little-endian, no padding:
+//
+//     0x01 SET     u8 n, n bytes of control text       "STATUS:OUTAGE VOLT:0"
+//     0x02 WAIT    u32 ms
+//     0x03 RAMP    u8 n, n bytes of key, f32 from, f32 to, u32 ms,
+//                  u16 step ms, u8 decimals            KEY:<value> every step
+//     0x04 REPEAT  u16 count (0 = until stopped)       body runs up to END
+//     0x05 END
+//
+// Ops are applied as control text through the node's MQTT handler, exactly
+// as if the broker had sent them, so a scenario can drive anything a node
+// takes a token for; a RAMP is one such message per step, with `to` sent
+// exactly at its end. Time only passes in WAIT and RAMP, and every
+// deadline is the previous one plus the op's duration rather than "now
+// plus", so a late step never shifts the rest of the program: a 60 s
+// drill ends on the same millisecond it would have with no hiccups. The
+// broker pushes a fleet-wide drill with one start time for every node, and
+// the synced fleet clock turns it into each node's own millis().
+//
+// The program is checked in full before it runs (bounds, nesting up to
+// REPEAT_DEPTH, a REPEAT body that takes no time); a bad one is REJECTED
+// with an "error". A new program replaces the running one. Nothing is
+// allocated: programs arrive through a wr::Mailbox<> (wr_mailbox.h) of
+// WR_SCENARIO_BYTES slots and run in place.
+//
+// states   IDLE      nothing loaded since boot
+//          WAITING   loaded, start time not reached
+//          RUNNING
+//          DONE      ran to the end; "late_ms" is the worst lateness of an op
+//          STOPPED   an empty message ended it
+//          REJECTED  "error": TOO_LONG, HEADER, TRUNCATED, BAD_OP, NESTING,
+//                    ZERO_LOOP, RAMP or START (more than MAX_LEAD_MS away)
+//
+// The broker re-sends each node's derived inputs every tick (INPUT:, TEMP:,
+// ...), which overwrite a scenario's value of the same token within a
+// second; drills drive the exogenous ones (utility STATUS:/VOLT:/FREQ:,
+// FANS_RUNNING:, CPU:, ...). Build with -DWR_SCENARIO=0 to leave it out.
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+
+#include <winter_river.h>
+#include <wr_delta.h>
+#include <wr_json.h>
+#include <wr_mailbox.h>
+#include <wr_mqtt.h>
+#include <wr_time.h>
+
+#ifndef WR_SCENARIO
+#define WR_SCENARIO 1
+#endif
+#ifndef WR_SCENARIO_BYTES
+#define WR_SCENARIO_BYTES 512      // largest program, header included
+#endif
+
+namespace wr {
+
+// One program as received; len is TOO_LONG when it did not fit.
+struct ScenarioProgram {
+  static constexpr size_t CAPACITY = WR_SCENARIO_BYTES;
+  static constexpr uint16_t TOO_LONG = 0xFFFF;
+  uint16_t len;
+  uint8_t data[CAPACITY];
+};
+
+#if WR_MQTT_ASYNC
+static_assert(MQTT_RX_BYTES >= WR_SCENARIO_BYTES + 64, "AsyncMqtt cannot receive a scenario");
+#endif
+
+class Scenario {
+ public:
+  static constexpr uint8_t MAGIC = 0xA7;
+  static constexpr uint8_t VERSION = 1;
+  static constexpr uint8_t HEADER_BYTES = 12;
+  static constexpr uint8_t REPEAT_DEPTH = 4;
+  static constexpr uint8_t TEXT_MAX = 63;               // SET text
+  static constexpr uint8_t KEY_MAX = 15;                // RAMP key
+  static constexpr uint8_t OPS_PER_RUN = 32;            // bound on one run() pass
+  static constexpr unsigned long MAX_LEAD_MS = 600000;  // furthest start accepted
+
+  enum Op : uint8_t { SET = 0x01, WAIT = 0x02, RAMP = 0x03, REPEAT = 0x04, END = 0x05 };
+  enum class State : uint8_t { IDLE, WAITING, RUNNING, DONE, STOPPED, REJECTED };
+  enum class Error : uint8_t { NONE, TOO_LONG, HEADER, TRUNCATED, BAD_OP, NESTING, ZERO_LOOP,
+                               RAMP, START };
+
+  typedef void (*ApplyFn)(char *topic, byte *payload, unsigned int length);
+
+  // From startNode(). A program is larger than PubSubClient's default
+  // 256-byte buffer.
+  void begin(const char *node_id) {
+    snprintf(cmd_topic_, sizeof(cmd_topic_), "winter-river/%s/scenario", node_id);
+    snprintf(status_topic_, sizeof(status_topic_), "winter-river/%s/scenario/status", node_id);
+    if (mqtt.getBufferSize() < WR_SCENARIO_BYTES + 64) mqtt.setBufferSize(WR_SCENARIO_BYTES + 64);
+  }
+
+  // ── network side: the task that owns PubSubClient ────────────────────────
+
+  // After every MQTT (re)connect.
+  void subscribe() {
+    mqtt.subscribe(cmd_topic_, 1);
+    announced_ = false;   // retained status again for the new session
+  }
+
+  // Route one incoming message. True if it was a program (or a stop); it is
+  // run by the simulation side, run().
+  bool receive(const char *topic, const byte *p, unsigned int l) {
+    if (!topic || strcmp(topic, cmd_topic_) != 0) return false;
+    ScenarioProgram &m = programs_.back();
+    if (l > sizeof(m.data)) {
+      m.len = ScenarioProgram::TOO_LONG;
+    } else {
+      memcpy(m.data, p, l);
+      m.len = static_cast<uint16_t>(l);
+    }
+    programs_.post();
+    return true;
+  }
+
+  // Publish status changes. Call after mqtt.loop().
+  void poll() {
+    const State s = state_.load();
+    const uint32_t crc = crc_.load();
+    if (!mqtt.connected() || (announced_ && s == published_state_ && crc == published_crc_)) return;
+
+    static Payload<128> msg;
+    char hex[9];
+    msg.reset().field("state", stateName(s));
+    if (crc) {
+      snprintf(hex, sizeof(hex), "%08lx", static_cast<unsigned long>(crc));
+      msg.field("program", hex);
+    }
+    if (s == State::REJECTED) msg.field("error", errorName(error_.load()));
+    if (s == State::DONE || s == State::STOPPED) {
+      msg.field("late_ms", static_cast<unsigned long>(late_ms_.load()));
+    }
+    if (!msg.end()) return;
+    if (publishNow(status_topic_, reinterpret_cast<const uint8_t *>(msg.c_str()), msg.length(), true)) {
+      announced_ = true;
+      published_state_ = s;
+      published_crc_ = crc;
+    }
+  }
+
+  // ── simulation side: the task that owns node state ───────────────────────
+
+  // Load a new program if one arrived, then apply every op that is due.
+  // Once per task loop pass, before step().
+  void run(ApplyFn apply) {
+    if (ScenarioProgram *m = programs_.take()) load(*m);
+    const State s = state_.load();
+    if (s != State::WAITING && s != State::RUNNING) return;
+    const unsigned long now = millis();
+    if (static_cast<long>(now - next_) < 0) return;
+    if (s == State::WAITING) state_ = State::RUNNING;
+    for (uint8_t n = 0; n < OPS_PER_RUN && static_cast<long>(now - next_) >= 0; ++n) {
+      const unsigned long late = now - next_;
+      if (late > late_ms_.load()) late_ms_ = static_cast<uint32_t>(late);
+      if (!exec(now, apply)) {
+        state_ = State::DONE;
+        Serial.printf("[wr] scenario %08lx done, late %lu ms\n",
+                      static_cast<unsigned long>(crc_.load()),
+                      static_cast<unsigned long>(late_ms_.load()));
+        return;
+      }
+    }
+  }
+
+  // How long the simulation task may sleep before the next op, at most `ms`.
+  unsigned long untilNext(unsigned long ms) const {
+    const State s = state_.load();
+    if (s != State::WAITING && s != State::RUNNING) return ms;
+    const long left = static_cast<long>(next_ - millis());
+    if (left <= 0) return 0;
+    return static_cast<unsigned long>(left) < ms ? static_cast<unsigned long>(left) : ms;
+  }
+
+  State state() const { return state_.load(); }
+  uint32_t program() const { return crc_.load(); }   // CRC-32 of the running program
+  uint32_t lateMs() const { return late_ms_.load(); }
+  Error error() const { return error_.load(); }        // of the last REJECTED
+
+ private:
+  struct Loop {
+    uint16_t body;   // pc of the first op after REPEAT
+    uint16_t left;   // 0 = until stopped
+  };
+
+  static const char *stateName(State s) {
+    static const char *const NAMES[] = {"IDLE", "WAITING", "RUNNING", "DONE", "STOPPED", "REJECTED"};
+    return NAMES[static_cast<uint8_t>(s)];
+  }
+
+  static const char *errorName(Error e) {
+    static const char *const NAMES[] = {"NONE", "TOO_LONG", "HEADER", "TRUNCATED", "BAD_OP",
+                                        "NESTING", "ZERO_LOOP", "RAMP", "START"};
+    return NAMES[static_cast<uint8_t>(e)];
+  }
+
+  static uint16_t le16(const uint8_t *p) { return static_cast<uint16_t>(p[0] | p[1] << 8); }
+  static uint32_t le32(const uint8_t *p) {
+    return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 |
+           static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+  }
+  static float f32(const uint8_t *p) {
+    const uint32_t bits = le32(p);
+    float v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+  }
+
+  // Bytes of the op at p[0], 0 if it runs past `end`. RAMP: n, key, from,
+  // to, ms, step, decimals.
+  static size_t opBytes(const uint8_t *p, const uint8_t *end) {
+    const size_t left = end - p;
+    size_t n = 0;
+    switch (p[0]) {
+      case SET:    n = left >= 2 ? 2 + p[1] : 0;              break;
+      case WAIT:   n = 5;                                     break;
+      case RAMP:   n = left >= 2 ? 2 + p[1] + 15 : 0;         break;
+      case REPEAT: n = 3;                                     break;
+      case END:    n = 1;                                     break;
+    }
+    return n && n <= left ? n : 0;
+  }
+
+  // The whole program, before any of it runs.
+  static Error check(const uint8_t *p, size_t len) {
+    if (len < HEADER_BYTES || p[0] != MAGIC || p[1] != VERSION ||
+        le16(p + 2) != len - HEADER_BYTES) {
+      return Error::HEADER;
+    }
+    const uint8_t *end = p + len;
+    bool timed[REPEAT_DEPTH + 1] = {false};
+    uint8_t depth = 0;
+    for (const uint8_t *op = p + HEADER_BYTES; op < end;) {
+      if (op[0] < SET || op[0] > END) return Error::BAD_OP;
+      const size_t n = opBytes(op, end);
+      if (!n) return Error::TRUNCATED;
+      switch (op[0]) {
+        case SET:
+          if (!op[1] || op[1] > TEXT_MAX) return Error::BAD_OP;
+          break;
+        case WAIT:
+          if (le32(op + 1)) timed[depth] = true;
+          break;
+        case RAMP: {
+          const uint8_t *tail = op + 2 + op[1];
+          if (!op[1] || op[1] > KEY_MAX || !le32(tail + 8) || !le16(tail + 12) || tail[14] > 6) {
+            return Error::RAMP;
+          }
+          timed[depth] = true;
+          break;
+        }
+        case REPEAT:
+          if (depth == REPEAT_DEPTH) return Error::NESTING;
+          timed[++depth] = false;
+          break;
+        case END:
+          if (!depth) return Error::NESTING;
+          if (!timed[depth]) return Error::ZERO_LOOP;
+          timed[--depth] = true;
+          break;
+      }
+      op += n;
+    }
+    return depth ? Error::NESTING : Error::NONE;
+  }
+
+  void load(const ScenarioProgram &m) {
+    ramping_ = false;
+    depth_ = 0;
+    if (!m.len) {
+      code_ = nullptr;
+      const State s = state_.load();
+      if (s == State::WAITING || s == State::RUNNING) state_ = State::STOPPED;
+      return;
+    }
+    if (m.len == ScenarioProgram::TOO_LONG) {
+      reject(0, Error::TOO_LONG);
+      return;
+    }
+    late_ms_ = 0;
+    const uint32_t crc = crc32(0, m.data, m.len);
+    const Error e = check(m.data, m.len);
+    if (e != Error::NONE) {
+      reject(crc, e);
+      return;
+    }
+    int64_t start = 0;
+    for (int i = 7; i >= 0; --i) start = start << 8 | m.data[4 + i];
+    // A start already past (a late push), or no fleet clock yet: at once.
+    const unsigned long now = millis();
+    next_ = now;
+    const int64_t epoch = start ? timeSync().now().ms : 0;
+    if (epoch && start > epoch) {
+      if (start - epoch > static_cast<int64_t>(MAX_LEAD_MS)) {
+        reject(crc, Error::START);
+        return;
+      }
+      next_ = now + static_cast<unsigned long>(start - epoch);
+    }
+    code_ = m.data;
+    len_ = m.len;
+    pc_ = HEADER_BYTES;
+    crc_ = crc;
+    state_ = State::WAITING;
+    Serial.printf("[wr] scenario %08lx: %u bytes, starts in %lu ms\n",
+                  static_cast<unsigned long>(crc), static_cast<unsigned>(m.len), next_ - now);
+  }
+
+  void reject(uint32_t crc, Error e) {
+    code_ = nullptr;
+    error_ = e;
+    crc_ = crc;
+    state_ = State::REJECTED;
+    Serial.printf("[wr] scenario rejected: %s\n", errorName(e));
+  }
+
+  // The op at pc_, due at next_. False once the program has ended.
+  bool exec(unsigned long now, ApplyFn apply) {
+    if (pc_ >= len_) return false;
+    const uint8_t *op = code_ + pc_;
+    const uint16_t n = static_cast<uint16_t>(opBytes(op, code_ + len_));
+    switch (op[0]) {
+      case SET:
+        memcpy(line_, op + 2, op[1]);
+        apply(nullptr, reinterpret_cast<byte *>(line_), op[1]);
+        break;
+      case WAIT:
+        next_ += le32(op + 1);
+        break;
+      case RAMP:
+        if (!ramp(now, op, apply)) return true;   // more steps to come
+        break;
+      case REPEAT:
+        stack_[depth_++] = Loop{static_cast<uint16_t>(pc_ + n), le16(op + 1)};
+        break;
+      case END: {
+        Loop &top = stack_[depth_ - 1];
+        if (!top.left || --top.left) {
+          pc_ = top.body;
+          return true;
+        }
+        --depth_;
+        break;
+      }
+    }
+    pc_ += n;
+    return true;
+  }
+
+  // One step of the RAMP at `op`. True when it has sent `to`. Values follow
+  // the clock: a step that is late is skipped rather than replayed.
+  bool ramp(unsigned long now, const uint8_t *op, ApplyFn apply) {
+    const uint8_t klen = op[1];
+    const uint8_t *tail = op + 2 + klen;
+    const float from = f32(tail), to = f32(tail + 4);
+    const uint32_t dur = le32(tail + 8);
+    const uint16_t step = le16(tail + 12);
+    if (!ramping_) {
+      ramping_ = true;
+      ramp_t0_ = next_;
+      ramp_k_ = 0;
+    }
+    const uint32_t behind = static_cast<uint32_t>(now - ramp_t0_) / step;
+    if (behind > ramp_k_) ramp_k_ = behind;
+    const uint64_t t = static_cast<uint64_t>(ramp_k_) * step;
+    const bool last = t >= dur;
+    const float v = last ? to : from + (to - from) * static_cast<float>(t) / static_cast<float>(dur);
+    const int len = snprintf(line_, sizeof(line_), "%.*s:%.*f", klen,
+                             reinterpret_cast<const char *>(op + 2), tail[14], v);
+    if (len > 0 && len < static_cast<int>(sizeof(line_))) apply(nullptr, reinterpret_cast<byte *>(line_), static_cast<unsigned>(len));
+    if (last) {
+      ramping_ = false;
+      next_ = ramp_t0_ + dur;
+      return true;
+    }
+    ++ramp_k_;
+    const uint64_t at = static_cast<uint64_t>(ramp_k_) * step;
+    next_ = ramp_t0_ + static_cast<unsigned long>(at < dur ? at : dur);
+    return false;
+  }
+
+  Mailbox<ScenarioProgram> programs_;
+
+  // Simulation side.
+  const uint8_t *code_ = nullptr;   // a programs_ slot, valid until the next take()
+  uint16_t len_ = 0;
+  uint16_t pc_ = 0;
+  unsigned long next_ = 0;          // millis() the op at pc_ is due
+  Loop stack_[REPEAT_DEPTH];
+  uint8_t depth_ = 0;
+  bool ramping_ = false;
+  unsigned long ramp_t0_ = 0;
+  uint32_t ramp_k_ = 0;
+  char line_[TEXT_MAX + 1];         // SET text, or "KEY:<value>"
+
+  // Shared: written by the simulation side, published by the network side.
+  std::atomic<State> state_{State::IDLE};
+  std::atomic<Error> error_{Error::NONE};
+  std::atomic<uint32_t> crc_{0};
+  std::atomic<uint32_t> late_ms_{0};
+
+  // Network side.
+  char cmd_topic_[64] = "";
+  char status_topic_[72] = "";
+  bool announced_ = false;
+  State published_state_ = State::IDLE;
+  uint32_t published_crc_ = 0;
+};
+
+inline Scenario &scenario() {
+  static Scenario s;
+  return s;
+}
+
+}  // namespace wr
@@ -0,0 +1,159 @@
+// wr_schema.h — per-node-type field schemas for compact binary telemetry.
+//
+// One table per node type, listing the telemetry fields in the same order
+// as the node's JSON payload, each with its wire encoding. The broker's
+// decoder (broker/telemetry_codec.py) carries the same tables;
+// tests/test_telemetry_codec.py parses this header and fails if the two
+// drift apart.
+//
+// Message layout (little-endian, no padding):
+//
+//   offset 0  u8   MAGIC (0xA5) — never a valid first byte of JSON text
+//   offset 1  u8   VERSION — bump on ANY change to the tables below
+//   offset 2  u8   type_id (Schema::type_id)
+//   offset 3  u48  ts_ms, epoch milliseconds (wr_time.h); 0 = clock not set
+//   offset 9  u16  ts_err_us, saturating; 0xFFFF = not synced to the Pi
+//   offset 11 u32  seq, the node's telemetry sequence number (wr_seq.h)
+//   offset 15 ...  fields, in table order
+//
+// Appending a field, reordering, or changing a kind is a format change: bump
+// VERSION here and in the decoder together. Do not renumber type ids.
+// Versions 2 (no seq, fields at 11) and 1 (u24 seconds since local midnight
+// at offset 3, fields at 6) are still decoded by the broker.
+#pragma once
+
+#include <stdint.h>
+
+namespace wr {
+namespace schema {
+
+static constexpr uint8_t MAGIC   = 0xA5;
+static constexpr uint8_t VERSION = 3;
+static constexpr uint8_t HEADER_BYTES = 15;
+static constexpr uint16_t TS_ERR_UNSET = 0xFFFF;
+
+// Wire encodings. Integer kinds saturate at their range; X10 kinds carry one
+// decimal place (value * 10, rounded). A non-finite float is sent as the
+// signed kind's minimum and decodes to JSON null.
+enum class Kind : uint8_t {
+  U8,        // 1 B  0..255
+  U16,       // 2 B  0..65535
+  I16,       // 2 B
+  X10_I16,   // 2 B  ±3276.7
+  X10_I32,   // 4 B
+  BOOL,      // 1 B  0 / 1
+  STATE,     // 1 B  wr::State code (wr_state.h order)
+};
+
+struct Field {
+  const char *name;
+  Kind kind;
+};
+
+struct Schema {
+  uint8_t type_id;
+  const char *type;          // broker node_type
+  const Field *fields;
+  uint8_t count;
+};
+
+static constexpr Field UTILITY_FIELDS[] = {
+  {"v_out",      Kind::X10_I16},
+  {"freq_hz",    Kind::X10_I16},
+  {"load_pct",   Kind::U8},
+  {"state",      Kind::STATE},
+  {"voltage_kv", Kind::X10_I16},
+  {"phase",      Kind::U8},
+};
+
+static constexpr Field HV_MV_TRANSFORMER_FIELDS[] = {
+  {"input_kv",  Kind::X10_I16},
+  {"output_kv", Kind::U8},
+  {"load_pct",  Kind::U8},
+  {"power_mva", Kind::X10_I16},
+  {"temp_f",    Kind::I16},
+  {"state",     Kind::STATE},
+  {"voltage",   Kind::U16},
+};
+
+static constexpr Field MV_SWITCHGEAR_FIELDS[] = {
+  {"breaker",   Kind::BOOL},
+  {"current_a", Kind::X10_I32},
+  {"load_kw",   Kind::X10_I32},
+  {"load_pct",  Kind::U8},
+  {"state",     Kind::STATE},
+  {"voltage",   Kind::U16},
+};
+
+static constexpr Field MV_LV_TRANSFORMER_FIELDS[] = {
+  {"load_pct",  Kind::U8},
+  {"power_kva", Kind::X10_I32},
+  {"temp_f",    Kind::I16},
+  {"state",     Kind::STATE},
+  {"voltage",   Kind::U16},
+};
+
+static constexpr Field LV_SWITCHGEAR_FIELDS[] = {
+  {"breaker",   Kind::BOOL},
+  {"current_a", Kind::X10_I32},
+  {"load_kw",   Kind::X10_I32},
+  {"load_pct",  Kind::U8},
+  {"state",     Kind::STATE},
+  {"voltage",   Kind::U16},
+};
+
+static constexpr Field GENERATOR_FIELDS[] = {
+  {"fuel_pct", Kind::U8},
+  {"rpm",      Kind::U16},
+  {"output_v", Kind::X10_I16},
+  {"load_pct", Kind::U8},
+  {"state",    Kind::STATE},
+  {"voltage",  Kind::U16},
+};
+
+static constexpr Field UPS_FIELDS[] = {
+  {"battery_pct", Kind::U8},
+  {"load_pct",    Kind::U8},
+  {"input_v",     Kind::X10_I16},
+  {"output_v",    Kind::X10_I16},
+  {"state",       Kind::STATE},
+  {"voltage",     Kind::U16},
+};
+
+static constexpr Field COOLING_FIELDS[] = {
+  {"input_v",        Kind::X10_I16},
+  {"coolant_temp_f", Kind::I16},
+  {"fan_speed_pct",  Kind::U8},
+  {"fan_count",      Kind::U8},
+  {"fans_running",   Kind::U8},
+  {"load_pct",       Kind::U8},
+  {"state",          Kind::STATE},
+  {"voltage",        Kind::U16},
+};
+
+static constexpr Field SERVER_RACK_FIELDS[] = {
+  {"cpu_pct",  Kind::U8},
+  {"inlet_f",  Kind::I16},
+  {"power_kw", Kind::X10_I16},
+  {"units",    Kind::U8},
+  {"state",    Kind::STATE},
+  {"voltage",  Kind::U16},
+};
+
+#define WR_SCHEMA(id, TYPE) \
+  static constexpr Schema TYPE = {id, #TYPE, TYPE##_FIELDS, sizeof(TYPE##_FIELDS) / sizeof(Field)};
+
+WR_SCHEMA(1, UTILITY)
+WR_SCHEMA(2, HV_MV_TRANSFORMER)
+WR_SCHEMA(3, MV_SWITCHGEAR)
+WR_SCHEMA(4, MV_LV_TRANSFORMER)
+WR_SCHEMA(5, LV_SWITCHGEAR)
+WR_SCHEMA(6, GENERATOR)
+WR_SCHEMA(7, UPS)
+WR_SCHEMA(8, COOLING)
+WR_SCHEMA(9, SERVER_RACK)
+
+#undef WR_SCHEMA
+
+}  // namespace schema
+}  // namespace wr
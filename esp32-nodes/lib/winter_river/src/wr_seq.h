@@ -0,0 +1,104 @@
+// wr_seq.h — sequence numbers and loss accounting, both directions.
+//
+// Control goes out at QoS 0 (broker/main.py, run_simulation_tick), so a
+// dropped command used to be invisible. Both directions now carry a
+// per-sender sequence number, starting at 1 and +1 per message:
+//
+//   broker → node   SEQ:<n> on every control message, counted per node
+//                   (broker/control_latency.py; also the wr_latency.h echo)
+//   node → broker   "seq":<n> in every telemetry payload, or the u32 seq
+//                   of the binary header (wr_schema.h)
+//
+// The receiver runs a wr::SeqTracker over them. It remembers the highest
+// number seen and which of the WINDOW below it arrived, and counts
+//
+//   received     distinct messages
+//   lost         numbers skipped and not (yet) filled in by a late arrival
+//   duplicates   a number seen twice
+//   reordered    a late arrival inside the window; it is taken off lost
+//   restarts     the sender started over: n == 1 again, or n far below the
+//                window (a reboot, or a broker restart)
+//
+// The node keeps one for control (wr::controlSeq(), fed by
+// wr::handleCommonToken()) and reports it cumulatively in every JSON
+// payload, next to the latency echo:
+//
+//   "ctl_rx":8123,"ctl_lost":4,"ctl_dup":0,"ctl_reord":1
+//
+// The broker keeps one per node for telemetry, takes window deltas of the
+// node's control counters, and publishes both loss rates
+// (broker/link_loss.py). broker/link_loss.py implements the same tracker;
+// keep the two in step (tests/test_link_loss.py runs both, the firmware's
+// through check/wrseq.cpp, over the same streams).
+//
+// Telemetry numbers count messages actually handed to MQTT: a payload the
+// wr_deadband.h policy skips takes no number, so on-change mode shows no
+// false loss. In WR_DUAL_CORE mode a tick's control superseded in
+// wr::inbox() by the next tick's before wr_sim applied it counts as lost;
+// inbox().coalesced() tells the two apart.
+#pragma once
+
+#include <stdint.h>
+
+namespace wr {
+
+class SeqTracker {
+ public:
+  static constexpr uint32_t WINDOW = 32;   // bits in seen_
+
+  enum class Arrival : uint8_t { FIRST, IN_ORDER, GAP, DUPLICATE, REORDERED, RESTART };
+
+  Arrival observe(uint32_t seq) {
+    if (!started_ || seq == 1 || seq + WINDOW <= high_) {
+      const Arrival a = started_ ? Arrival::RESTART : Arrival::FIRST;
+      if (started_) ++restarts_;
+      started_ = true;
+      high_ = seq;
+      seen_ = 0xFFFFFFFFu;   // nothing below the first number is owed
+      ++received_;
+      return a;
+    }
+    if (seq > high_) {
+      const uint32_t d = seq - high_;
+      lost_ += d - 1;
+      seen_ = d >= WINDOW ? 1u : (seen_ << d) | 1u;
+      high_ = seq;
+      ++received_;
+      return d == 1 ? Arrival::IN_ORDER : Arrival::GAP;
+    }
+    const uint32_t bit = 1u << (high_ - seq);
+    if (seen_ & bit) {
+      ++duplicates_;
+      return Arrival::DUPLICATE;
+    }
+    seen_ |= bit;
+    --lost_;
+    ++reordered_;
+    ++received_;
+    return Arrival::REORDERED;
+  }
+
+  unsigned long received() const { return received_; }
+  unsigned long lost() const { return lost_; }
+  unsigned long duplicates() const { return duplicates_; }
+  unsigned long reordered() const { return reordered_; }
+  unsigned long restarts() const { return restarts_; }
+
+ private:
+  bool started_ = false;
+  uint32_t high_ = 0;
+  uint32_t seen_ = 0;   // bit i: high_ - i arrived
+  unsigned long received_ = 0;
+  unsigned long lost_ = 0;
+  unsigned long duplicates_ = 0;
+  unsigned long reordered_ = 0;
+  unsigned long restarts_ = 0;
+};
+
+// Broker SEQ of the control messages this node applied.
+inline SeqTracker &controlSeq() {
+  static SeqTracker t;
+  return t;
+}
+
+}  // namespace wr
@@ -0,0 +1,92 @@
+// wr_state.h — interned node states for the wr:: helper.
+//
+// Nodes used to keep `static String state` and run their guards as string
+// compares (`state == "RUNNING"`, `state != "FAULT"`), re-assigning literals
+// into the String on every transition. The state is now a one-byte
+// wr::State; guards are integer compares, STATUS: tokens are parsed straight
+// into the enum, and the names only exist in flash:
+//
+//   static wr::State state = wr::State::STANDBY;
+//   ...
+//   case wr::kw("STATUS"): wr::parseState(tok, state); break;
+//   ...
+//   if (state == wr::State::RUNNING && rpm < 800) state = wr::State::FAULT;
+//   ...
+//   wr::displayHeader(LABEL, wr::oledName(state));
+//   payload.field("state", wr::stateName(state));
+//
+// The vocabulary is the broker's (broker/main.py _compute_node), so it is one
+// fleet-wide table rather than one enum per node type: the broker sends
+// NO_INPUT to transformers and switchgear alike, and every type shares
+// NORMAL/FAULT. Each node's header comment lists the subset it uses.
+#pragma once
+
+#include <wr_tokens.h>
+
+namespace wr {
+
+// X(code, wire name, OLED name). Wire names are what the broker sends and
+// Telegraf stores — do not change them. OLED names fit the header row next
+// to the longest node label.
+#define WR_STATES(X)                           \
+  X(NORMAL,     "NORMAL",     "NORMAL")        \
+  X(WARNING,    "WARNING",    "WARNING")       \
+  X(DEGRADED,   "DEGRADED",   "DEGRADED")      \
+  X(FAULT,      "FAULT",      "FAULT")         \
+  X(OFF,        "OFF",        "OFF")           \
+  X(NO_INPUT,   "NO_INPUT",   "NO INPUT")      \
+  X(OFFLINE,    "OFFLINE",    "OFFLINE")       \
+  X(GRID_OK,    "GRID_OK",    "GRID OK")       \
+  X(SAG,        "SAG",        "SAG")           \
+  X(SWELL,      "SWELL",      "SWELL")         \
+  X(OUTAGE,     "OUTAGE",     "OUTAGE")        \
+  X(CLOSED,     "CLOSED",     "CLOSED")        \
+  X(OPEN,       "OPEN",       "OPEN")          \
+  X(TRIPPED,    "TRIPPED",    "TRIPPED")       \
+  X(GENERATOR,  "GENERATOR",  "ON GEN")        \
+  X(STANDBY,    "STANDBY",    "STANDBY")       \
+  X(STARTING,   "STARTING",   "STARTING")      \
+  X(RUNNING,    "RUNNING",    "RUNNING")       \
+  X(ON_BATTERY, "ON_BATTERY", "ON BATT")       \
+  X(CHARGING,   "CHARGING",   "CHARGING")
+
+enum class State : uint8_t {
+#define WR_STATE_ENUM(code, wire, oled) code,
+  WR_STATES(WR_STATE_ENUM)
+#undef WR_STATE_ENUM
+};
+
+namespace detail {
+#define WR_STATE_WIRE(code, wire, oled) wire,
+#define WR_STATE_OLED(code, wire, oled) oled,
+static constexpr const char *STATE_WIRE[] = {WR_STATES(WR_STATE_WIRE)};
+static constexpr const char *STATE_OLED[] = {WR_STATES(WR_STATE_OLED)};
+#undef WR_STATE_WIRE
+#undef WR_STATE_OLED
+}  // namespace detail
+
+// Name as sent on the wire / stored in Influx.
+inline const char *stateName(State s) { return detail::STATE_WIRE[static_cast<uint8_t>(s)]; }
+
+// Short name for the OLED header row.
+inline const char *oledName(State s) { return detail::STATE_OLED[static_cast<uint8_t>(s)]; }
+
+// Parse a STATUS: token's value into `out`. Unknown names leave `out`
+// untouched and return false (the old String path would have echoed them
+// back verbatim; the broker never sends one).
+inline bool parseState(const Token &tok, State &out) {
+  State s;
+  switch (kwHash(tok.value, tok.value_len)) {
+#define WR_STATE_CASE(code, wire, oled) \
+    case kw(wire): s = State::code; break;
+    WR_STATES(WR_STATE_CASE)
+#undef WR_STATE_CASE
+    default:
+      return false;
+  }
+  if (!tok.valueIs(stateName(s))) return false;   // hash hit on a foreign name
+  out = s;
+  return true;
+}
+
+}  // namespace wr
@@ -0,0 +1,80 @@
+// wr_stats.h — high-rate local sampling with per-interval min/max/mean.
+//
+// A node's simulated quantities only change when a control token lands, and
+// the status payload is a single snapshot per interval, so a TEMP:250 that
+// is reverted two seconds later never reaches the broker. wr::Stat keeps a
+// running min/max/mean of one quantity, sampled on its own clock
+// (WR_STATS_HZ, default 20 Hz) between publishes:
+//
+//   static wr::Stat temp_stat;
+//   ...
+//   if (wr::statsDue()) temp_stat.add(temp_f);        // every loop() pass
+//   ...
+//   payload.begin()
+//          .field("temp_f", temp_f)                    // last (current) value
+//          .stats("temp_f", temp_stat)                 // temp_f_min/_max/_mean
+//
+// Everything is O(1) per sample with no buffer of past samples and no heap:
+// the mean is Welford's running form, so it does not drift however many
+// samples a window holds. A window closes when its payload is actually
+// published (wr::publish() resets every Stat the payload carried), so in
+// on-change mode the figures cover the span since the previous message.
+//
+// Stats ride in the JSON payload only; the packed binary layout
+// (wr_schema.h) keeps the last value per field.
+#pragma once
+
+#include <cmath>
+
+#include <winter_river.h>
+
+#ifndef WR_STATS_HZ
+#define WR_STATS_HZ 20
+#endif
+
+static_assert(WR_STATS_HZ >= 1 && WR_STATS_HZ <= 100,
+              "WR_STATS_HZ must be 1..100 (loop() idles 10 ms per pass)");
+
+namespace wr {
+
+// True once per 1/WR_STATS_HZ. Call every loop() pass, before any early
+// return, so sampling does not stall between publishes.
+inline bool statsDue() {
+  static unsigned long last_ms = 0;
+  const unsigned long now = millis();
+  if (now - last_ms < 1000UL / WR_STATS_HZ) return false;
+  last_ms = now;
+  return true;
+}
+
+// Running min/max/mean of one quantity since the last publish.
+class Stat {
+ public:
+  void add(float v) {
+    if (!std::isfinite(v)) return;          // a NAN reading is a gap, not a value
+    if (n_ == 0) {
+      min_ = max_ = mean_ = v;
+    } else {
+      if (v < min_) min_ = v;
+      if (v > max_) max_ = v;
+      mean_ += (v - mean_) / static_cast<float>(n_ + 1);
+    }
+    ++n_;
+  }
+
+  void reset() { n_ = 0; }
+
+  bool empty() const { return n_ == 0; }
+  unsigned long count() const { return n_; }
+  float min() const  { return n_ ? min_  : NAN; }
+  float max() const  { return n_ ? max_  : NAN; }
+  float mean() const { return n_ ? mean_ : NAN; }
+
+ private:
+  float min_ = 0.0f;
+  float max_ = 0.0f;
+  float mean_ = 0.0f;
+  unsigned long n_ = 0;
+};
+
+}  // namespace wr
@@ -0,0 +1,484 @@
+// wr_tasks.h — node main loop, optionally split across both ESP32 cores.
+//
+// A node hands the helper its MQTT callback and a step() function (display,
+// stats sampling, telemetry) and lets wr::runNode() drive them:
+//
+//   static void step(bool tick) { ... }      // tick = wr::telemetryRate().due()
+//   void setup() { wr::startNode(NODE_ID, onMqtt, step); }
+//   void loop()  { wr::runNode(); }
+//
+// Connectivity is wr::link() (wr_link.h): non-blocking reconnect steps with
+// jittered backoff, and a select() on the MQTT socket instead of fixed
+// delays. step() runs every STEP_PERIOD_MS, or at once when control
+// arrives; while the link is down it still runs (stats keep sampling) but
+// with tick = false, so the helper's connection-failure screen stays up.
+// The tick comes from wr::telemetryRate() (wr_rate.h): the idle interval
+// (RATE:), or a faster one for a while after the node's state changes or the
+// broker sends BURST:.
+//
+// Default (WR_DUAL_CORE=0): one Arduino loop() does link().poll(),
+// mqtt.loop(), then step().
+//
+// WR_DUAL_CORE=1: two FreeRTOS tasks, and Arduino's loop() task retires.
+//
+//   wr_net  core 0   link().poll(), mqtt.loop(), time-sync requests, OTA status,
+//                    scenario status, publish wr::outbox(), backfill
+//   wr_sim  core 1   apply wr::inbox() control, due scenario ops, step()
+//
+// The MQTT callback no longer runs the node's token handler; it copies the
+// payload into wr::inbox() if it is the broker's tick control (SEQ:
+// stamped; only the newest matters) or else into the wr::commands() queue
+// (wr_mailbox.h), wakes wr_sim with a task notification and returns, so a
+// slow SSD1306 flush or a reconnect on one core never holds up the other.
+// wr_sim applies the queued commands in order, then the newest tick
+// control. Node state is only ever touched by wr_sim — the mailboxes and the
+// queue (and, with WR_PEER_FAST_PATH, the peer state bytes) are the only
+// data the cores share, and none of them takes a lock.
+//
+// In either mode the MQTT callback first takes time-sync replies for
+// wr::timeSync() (wr_time.h), stamped the moment they arrive, and the task
+// that owns PubSubClient sends its requests. Update commands go to
+// wr::ota() (wr_ota.h), which downloads in a task of its own and reports on
+// the same network task. Provisioning messages go to wr::provisioning()
+// (wr_identity.h).
+//
+// A telemetry tick with the link down goes to the node's keep() hook, which
+// builds the payload anyway and hands it to wr::backfill() (wr_backfill.h);
+// with WR_DUAL_CORE through the wr::keptRecords() queue, never the
+// latest-wins outbox. The network task sends what was kept once the link is
+// back.
+//
+// With WR_FAST_BOOT, startNode() brings the node up through wr::boot()
+// (wr_boot.h) instead of wr::begin(): cached WiFi association, set-up
+// overlapped with the join, first telemetry as soon as MQTT is up, and the
+// OTA image hash deferred until after it. With WR_PEER_FAST_PATH
+// (wr_peer.h) it then offers each message to wr::peers(): the topology blob
+// and neighbour status stop there, and the node applies them in its next
+// step().
+//
+// With WR_TICK_FRAME (wr_tick.h) the broker's per-tick control arrives as one
+// frame on winter-river/tick; wr::tickFrame() narrows it to the node's own
+// slot and the rest of the path (inbox, applyControl()) is the same as for a
+// <node_id>/control message.
+//
+// Scenario programs (wr_scenario.h) arrive on the network side and run on
+// the one that owns node state, just before step(); that task sleeps no
+// longer than the next scenario op is due, so ops land on their millisecond
+// rather than on the next STEP_PERIOD_MS.
+//
+// Both modes record per-task loop time (µs) and print min/mean/max every
+// TASK_REPORT_MS, with the cost of the latest OLED flush (wr_oled.h):
+//
+//   [wr] loop net: 41/88/2310 us n=11754 | sim: 12/95/21800 us n=5847 coalesced=3 dropped=0 oled=31B/2710us
+//
+// and publish the wr_prof.h section histograms, heap health and each task's
+// stack high-water mark on winter-river/<node_id>/perf every PERF_REPORT_MS.
+#pragma once
+
+#include <winter_river.h>
+#include <wr_backfill.h>
+#include <wr_boot.h>
+#include <wr_identity.h>
+#include <wr_json.h>
+#include <wr_latency.h>
+#include <wr_link.h>
+#include <wr_mailbox.h>
+#include <wr_mqtt.h>
+#include <wr_oled.h>
+#include <wr_ota.h>
+#include <wr_peer.h>
+#include <wr_prof.h>
+#include <wr_rate.h>
+#include <wr_scenario.h>
+#include <wr_stats.h>
+#include <wr_tick.h>
+#include <wr_time.h>
+#include <wr_tokens.h>
+
+#ifndef WR_NET_CORE
+#define WR_NET_CORE 0
+#endif
+#ifndef WR_SIM_CORE
+#define WR_SIM_CORE 1
+#endif
+
+namespace wr {
+
+static constexpr unsigned long TASK_REPORT_MS = 60000;
+static constexpr unsigned long STEP_PERIOD_MS = 1000UL / WR_STATS_HZ;   // time-driven work
+static constexpr unsigned long NET_WAIT_MS    = 10;   // wr_net: longest an outbox message waits
+
+typedef void (*ControlFn)(char *topic, byte *payload, unsigned int length);
+typedef void (*StepFn)(bool telemetry_tick);
+typedef void (*KeepFn)();
+
+enum class Task : uint8_t { NET, SIM };
+
+// Loop time of each task over the current report window, in µs. In
+// single-core mode the whole loop() is accounted to Task::SIM.
+inline Stat &loopStats(Task t) {
+  static Stat stats[2];
+  return stats[static_cast<uint8_t>(t)];
+}
+
+namespace detail {
+
+struct NodeHooks {
+  const char *node_id;
+  ControlFn control;
+  StepFn step;
+  KeepFn keep;   // optional
+};
+
+inline NodeHooks &hooks() {
+  static NodeHooks h = {nullptr, nullptr, nullptr, nullptr};
+  return h;
+}
+
+// One step() pass; a tick the link cannot carry is kept for backfill.
+inline void step(bool tick, bool up) {
+  hooks().step(tick && up);
+#if WR_BACKFILL
+  if (tick && !up && hooks().keep) hooks().keep();
+#endif
+}
+
+// PubSubClient's loop() handles one packet per call; drain a burst in one
+// pass. wr::AsyncMqtt's (wr_mqtt.h) reads the socket dry in one.
+inline void pumpMqtt() {
+#if WR_MQTT_ASYNC
+  prof::Scope timer(prof::Section::MQTT);
+  mqtt.loop();
+#else
+  uint8_t n = 0;
+  do {
+    prof::Scope timer(prof::Section::MQTT);
+    mqtt.loop();
+  } while (linkClient().available() && ++n < 8);
+#endif
+}
+
+// Every MQTT (re)connect: the helper's own subscriptions.
+inline void linkUp() {
+#if WR_FAST_BOOT
+  boot().linkUp();
+#endif
+  timeSync().subscribe();
+  ota().subscribe();
+  provisioning().subscribe();
+#if WR_PEER_FAST_PATH
+  peers().subscribe();
+#endif
+#if WR_TICK_FRAME
+  tickFrame().subscribe();
+#endif
+#if WR_SCENARIO
+  scenario().subscribe();
+#endif
+}
+
+// Run the node's handler on one control message and record its timing for
+// the wr_latency.h echo.
+inline void applyControl(unsigned long rx_us, byte *payload, unsigned int length) {
+  controlClock().received(rx_us);
+  {
+    prof::Scope timer(prof::Section::CONTROL);
+    hooks().control(nullptr, payload, length);
+  }
+  controlClock().applied();
+}
+
+// Times one pass of a task loop into loopStats().
+class LoopTimer {
+ public:
+  explicit LoopTimer(Task t) : task_(t), start_(micros()) {}
+  ~LoopTimer() { loopStats(task_).add(static_cast<float>(micros() - start_)); }
+
+ private:
+  Task task_;
+  unsigned long start_;
+};
+
+inline void reportLoopStats() {
+  static unsigned long last_ms = 0;
+  const unsigned long now = millis();
+  if (now - last_ms < TASK_REPORT_MS) return;
+  last_ms = now;
+  Stat &net = loopStats(Task::NET);
+  Stat &sim = loopStats(Task::SIM);
+  if (!net.empty()) {
+    Serial.printf("[wr] loop net: %lu/%lu/%lu us n=%lu | ",
+                  static_cast<unsigned long>(net.min()), static_cast<unsigned long>(net.mean()),
+                  static_cast<unsigned long>(net.max()), net.count());
+  } else {
+    Serial.print(F("[wr] loop "));
+  }
+  Serial.printf("sim: %lu/%lu/%lu us n=%lu coalesced=%lu dropped=%lu oled=%uB/%luus\n",
+                static_cast<unsigned long>(sim.min()), static_cast<unsigned long>(sim.mean()),
+                static_cast<unsigned long>(sim.max()), sim.count(), inbox().coalesced(),
+                commands().dropped(),
+                static_cast<unsigned>(lastFlush().bytes), lastFlush().us);
+#if WR_MQTT_ASYNC
+  const AsyncMqtt::Stats &mq = mqtt.stats();
+  Serial.printf("[wr] mqtt: pub=%lu ack=%lu retry=%lu refused=%lu oversize=%lu stalls=%lu inflight=%u\n",
+                mq.published, mq.acked, mq.retries, mq.refused, mq.oversize, mq.stalls,
+                static_cast<unsigned>(mqtt.inFlight()));
+#endif
+  net.reset();   // racy against wr_net's add() by design: worst case one sample lands in the old window
+  sim.reset();
+}
+
+#if WR_DUAL_CORE
+inline TaskHandle_t &simHandle() {
+  static TaskHandle_t h = nullptr;
+  return h;
+}
+
+inline TaskHandle_t &netHandle() {
+  static TaskHandle_t h = nullptr;
+  return h;
+}
+#endif
+
+// Publish the wr_prof.h report. Runs on the task that owns PubSubClient.
+inline void reportPerf() {
+  static unsigned long last_ms = 0;
+  const unsigned long now = millis();
+  const prof::HeapHealth &heap = prof::heap();
+  if (now - last_ms < prof::PERF_REPORT_MS || !mqtt.connected()) return;
+  last_ms = now;
+
+  static char topic[64];
+  if (!topic[0]) snprintf(topic, sizeof(topic), "winter-river/%s/perf", hooks().node_id);
+  static Payload<576> msg;   // worst case ~530 B
+  msg.reset()
+     .field("up_s",     now / 1000)
+     .field("heap",     static_cast<unsigned long>(heap.free))
+     .field("heap_min", static_cast<unsigned long>(heap.free_min))
+     .field("blk",      static_cast<unsigned long>(heap.largest))
+     .field("blk_min",  static_cast<unsigned long>(heap.largest_min));
+  if (boot().published()) msg.field("boot_ms", boot().bootMs());
+#if WR_DUAL_CORE
+  msg.field("stk_net", static_cast<unsigned long>(uxTaskGetStackHighWaterMark(netHandle())))
+     .field("stk_sim", static_cast<unsigned long>(uxTaskGetStackHighWaterMark(simHandle())));
+#else
+  msg.field("stk_sim", static_cast<unsigned long>(uxTaskGetStackHighWaterMark(nullptr)));
+#endif
+  prof::writeSections(msg);
+  if (msg.end()) {
+    publishNow(topic, reinterpret_cast<const uint8_t *>(msg.c_str()), msg.length(), true);
+  }
+}
+
+#if WR_DUAL_CORE
+
+// The broker stamps its tick control SEQ: (wr_latency.h); an operator's
+// command has no stamp.
+inline bool isTickControl(const byte *payload, unsigned int length) {
+  bool stamped = false;
+  scanTokens(payload, length, [&](const Token &tok) { stamped |= tok.hash == kw("SEQ") && tok.keyIs("SEQ"); });
+  return stamped;
+}
+
+// MQTT callback in dual-core mode (runs inside mqtt.loop() on wr_net).
+inline void postControl(char *topic, byte *payload, unsigned int length) {
+  if (timeSync().receive(topic, payload, length)) return;
+  if (ota().receive(topic, payload, length)) return;
+  if (provisioning().receive(topic, payload, length)) return;
+#if WR_SCENARIO
+  if (scenario().receive(topic, payload, length)) {   // wr_sim loads it
+    if (simHandle()) xTaskNotifyGive(simHandle());
+    return;
+  }
+#endif
+#if WR_TICK_FRAME
+  if (tickFrame().receive(topic, payload, length) && !length) return;   // else: our slot
+#endif
+#if WR_PEER_FAST_PATH
+  if (peers().receive(topic, payload, length)) {   // wr_sim applies it in step()
+    if (simHandle()) xTaskNotifyGive(simHandle());
+    return;
+  }
+#endif
+  if (length > ControlMessage::CAPACITY) {
+    Serial.println(F("[wr] control message too long, dropped"));
+    return;
+  }
+  const bool tick = isTickControl(payload, length);
+  ControlMessage *m = tick ? &inbox().back() : commands().back();
+  if (!m) {
+    Serial.println(F("[wr] control queue full, command dropped"));
+    return;
+  }
+  memcpy(m->data, payload, length);
+  m->len = static_cast<uint16_t>(length);
+  m->rx_us = micros();
+  if (tick) inbox().post();
+  else commands().push();
+  if (simHandle()) xTaskNotifyGive(simHandle());
+}
+
+inline void netTask(void *) {
+  for (;;) {
+    {
+      LoopTimer timer(Task::NET);
+      const bool up = link().poll();
+      if (up) {
+        pumpMqtt();
+        timeSync().poll();
+        ota().poll();
+        provisioning().poll();
+#if WR_SCENARIO
+        scenario().poll();
+#endif
+      }
+      // Taken up or not: live telemetry taken with the link down is stale
+      // by the time it is back.
+      if (OutgoingMessage *m = outbox().take()) {
+        if (up) publishNow(m->topic, m->data, m->len, m->retained);
+      }
+#if WR_BACKFILL
+      backfill().collect();
+      if (up) backfill().poll();
+#endif
+      boot().poll();
+    }
+    reportPerf();
+    link().wait(NET_WAIT_MS);
+  }
+}
+
+inline void simTask(void *) {
+  for (;;) {
+    {
+      LoopTimer timer(Task::SIM);
+      while (ControlMessage *m = commands().front()) {
+        applyControl(m->rx_us, m->data, m->len);
+        commands().pop();
+      }
+      if (ControlMessage *m = inbox().take()) applyControl(m->rx_us, m->data, m->len);
+#if WR_SCENARIO
+      scenario().run(hooks().control);
+#endif
+      const bool up = link().state() == Link::State::UP;
+      const bool tick = telemetryRate().due() || boot().firstTick(up);
+      step(tick, up);
+    }
+    reportLoopStats();
+#if WR_SCENARIO
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(scenario().untilNext(STEP_PERIOD_MS)));
+#else
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(STEP_PERIOD_MS));
+#endif
+  }
+}
+#else
+// MQTT callback in single-core mode: the handler runs right here.
+inline void timedControl(char *topic, byte *payload, unsigned int length) {
+  if (timeSync().receive(topic, payload, length)) return;
+  if (ota().receive(topic, payload, length)) return;
+  if (provisioning().receive(topic, payload, length)) return;
+#if WR_SCENARIO
+  if (scenario().receive(topic, payload, length)) return;   // loaded by runNode()
+#endif
+#if WR_TICK_FRAME
+  if (tickFrame().receive(topic, payload, length) && !length) return;   // else: our slot
+#endif
+#if WR_PEER_FAST_PATH
+  if (peers().receive(topic, payload, length)) return;   // applied by the next step()
+#endif
+  applyControl(micros(), payload, length);
+}
+#endif
+
+// Display, WiFi and MQTT: wr::begin(), or wr::boot() with WR_FAST_BOOT.
+inline void bringUp(const char *node_id, ControlFn control) {
+#if WR_FAST_BOOT
+  link().begin(node_id);
+  boot().begin(node_id, control);
+#else
+  begin(node_id, control);
+  link().begin(node_id);
+#endif
+}
+
+}  // namespace detail
+
+// Call once from setup(). Brings up display, WiFi and MQTT via wr::begin()
+// (or wr::boot(), WR_FAST_BOOT), then (WR_DUAL_CORE) starts the two pinned
+// tasks. `keep` (optional) builds a telemetry payload for backfill when a
+// tick comes with the link down.
+inline void startNode(const char *node_id, ControlFn control, StepFn step,
+                      KeepFn keep = nullptr) {
+  detail::hooks() = {node_id, control, step, keep};
+  timeSync().begin(node_id);
+#if WR_BACKFILL
+  backfill().begin(node_id);
+#endif
+  ota().begin(node_id);
+#if WR_FAST_BOOT
+  boot().defer([] { ota().hashImage(); });
+#else
+  ota().hashImage();
+#endif
+#if WR_PEER_FAST_PATH
+  peers().begin(node_id);
+#endif
+#if WR_TICK_FRAME
+  tickFrame().begin(node_id);
+#endif
+#if WR_SCENARIO
+  scenario().begin(node_id);
+#endif
+  link().onUp(detail::linkUp);
+#if WR_DUAL_CORE
+  detail::bringUp(node_id, detail::postControl);
+  // wr_net outranks wr_sim so keepalives and control intake never wait on
+  // the display; both stay below the WiFi/lwIP tasks.
+  xTaskCreatePinnedToCore(detail::netTask, "wr_net", 6144, nullptr, 3, &detail::netHandle(),
+                          WR_NET_CORE);
+  xTaskCreatePinnedToCore(detail::simTask, "wr_sim", 6144, nullptr, 2, &detail::simHandle(),
+                          WR_SIM_CORE);
+#else
+  detail::bringUp(node_id, detail::timedControl);
+#endif
+}
+
+// Call from loop().
+inline void runNode() {
+#if WR_DUAL_CORE
+  vTaskDelete(nullptr);   // Arduino's loop task has nothing left to do
+#else
+  {
+    detail::LoopTimer timer(Task::SIM);
+    const bool up = link().poll();
+    if (up) {
+      detail::pumpMqtt();   // drain queued control + service keepalive
+      timeSync().poll();
+      ota().poll();
+      provisioning().poll();
+#if WR_SCENARIO
+      scenario().poll();
+#endif
+#if WR_BACKFILL
+      backfill().poll();
+#endif
+    }
+    boot().poll();
+#if WR_SCENARIO
+    scenario().run(detail::hooks().control);
+#endif
+    const bool tick = telemetryRate().due() || boot().firstTick(up);
+    detail::step(tick, up);
+  }
+  detail::reportLoopStats();
+  detail::reportPerf();
+#if WR_SCENARIO
+  link().wait(scenario().untilNext(STEP_PERIOD_MS));
+#else
+  link().wait(STEP_PERIOD_MS);
+#endif
+#endif
+}
+
+}  // namespace wr
@@ -0,0 +1,391 @@
+// wr_telemetry.h — telemetry writer with an opt-in compact binary encoding.
+//
+// wr::Telemetry<N> has the same field() chain as wr::Payload<N>, but can emit
+// either the usual JSON object or a packed struct laid out by the node type's
+// wr::schema table (wr_schema.h). Packed, a node payload is 24–28 B with
+// the 15 B header. The JSON, with the stats, timestamps and control echo, is
+// bounded per node type by wr::Node<>::JSON_BYTES (wr_node.h): 501–684 B,
+// cooling the largest, checked there against the outbox slot.
+//
+//   static const wr::Topic STATUS_TOPIC(NODE_ID, "status");
+//   static wr::Telemetry<N> payload(wr::schema::UPS);   // N: the JSON worst case
+//   ...
+//   payload.begin()
+//          .field("battery_pct", battery_pct)
+//          ...
+//          .field("state",       state)           // wr::State
+//          .stats("load_pct",    load_stat);      // wr_stats.h, JSON only
+//   wr::publish(STATUS_TOPIC, payload);
+//
+// When a message is actually sent is up to the publish policy in
+// wr_deadband.h (periodic by default, on-change opt-in).
+//
+// JSON goes to winter-river/<node>/status as before (retained). Binary goes
+// to winter-river/<node>/status/bin, NOT retained: the broker decodes it,
+// ingests it like JSON, and republishes the JSON form on /status (retained)
+// so Telegraf, Grafana and status.sh are unchanged. JSON and binary nodes
+// can be mixed freely during a rollout.
+//
+// The encoding is chosen per node with a build flag and can be flipped at
+// runtime with a control token:
+//
+//   build_flags = -DWR_TELEMETRY_BINARY=1        ; platformio.ini env
+//   mosquitto_pub -t winter-river/ups_a/control -m "ENC:BIN"   ; or ENC:JSON
+//
+// Field names are checked against the schema while encoding; a node whose
+// field chain does not match its table logs and drops the message instead
+// of sending something the broker would mis-decode.
+#pragma once
+
+#include <cmath>
+#include <limits.h>
+#include <string.h>
+
+#include <winter_river.h>
+#include <wr_boot.h>
+#include <wr_deadband.h>
+#include <wr_json.h>
+#include <wr_latency.h>
+#include <wr_prof.h>
+#include <wr_rate.h>
+#include <wr_schema.h>
+#include <wr_seq.h>
+#include <wr_state.h>
+#include <wr_stats.h>
+#include <wr_time.h>
+#include <wr_tokens.h>
+
+#ifndef WR_TELEMETRY_BINARY
+#define WR_TELEMETRY_BINARY 0
+#endif
+
+namespace wr {
+
+// Current encoding for this node. Starts at the build-flag default.
+inline bool &binaryTelemetry() {
+  static bool on = WR_TELEMETRY_BINARY != 0;
+  return on;
+}
+
+// Control tokens every node understands. Call from the node's handleToken
+// `default:` branch; returns true if the token was consumed.
+//   ENC:BIN | ENC:JSON        telemetry encoding
+//   TX:CHANGE | TX:PERIODIC   publish policy (wr_deadband.h)
+//   RATE:<ms> | BURST:<ms>    idle telemetry interval, burst window (wr_rate.h)
+//   SEQ:<n> T:<ms>            broker command stamp (wr_latency.h, wr_seq.h)
+inline bool handleCommonToken(const Token &tok) {
+  switch (tok.hash) {
+    case kw("ENC"):
+      if (!tok.keyIs("ENC")) return false;
+      if (tok.valueIs("BIN"))       binaryTelemetry() = true;
+      else if (tok.valueIs("JSON")) binaryTelemetry() = false;
+      else return false;
+      return true;
+    case kw("TX"):
+      if (!tok.keyIs("TX")) return false;
+      if (tok.valueIs("CHANGE"))        onChangeTelemetry() = true;
+      else if (tok.valueIs("PERIODIC")) onChangeTelemetry() = false;
+      else return false;
+      return true;
+    case kw("RATE"):
+      if (!tok.keyIs("RATE")) return false;
+      telemetryRate().setIdle(static_cast<unsigned long>(tok.toInt() > 0 ? tok.toInt() : 0));
+      return true;
+    case kw("BURST"):
+      if (!tok.keyIs("BURST")) return false;
+      telemetryRate().burst(static_cast<unsigned long>(tok.toInt() > 0 ? tok.toInt() : 0));
+      return true;
+    case kw("SEQ"):
+      if (!tok.keyIs("SEQ")) return false;
+      controlClock().seq(static_cast<unsigned long>(tok.toInt()));
+      controlSeq().observe(static_cast<uint32_t>(tok.toInt()));
+      return true;
+    case kw("T"):
+      if (!tok.keyIs("T")) return false;
+      controlClock().sent(static_cast<unsigned long>(tok.toInt()));
+      return true;
+  }
+  return false;
+}
+
+// Packed encoder for one schema. Longest current message is 28 B.
+class BinaryWriter {
+ public:
+  static constexpr size_t CAPACITY = 48;
+
+  explicit BinaryWriter(const schema::Schema &s) : schema_(s) {}
+
+  BinaryWriter &begin(const EpochTime &t, uint32_t seq) {
+    len_ = 0;
+    next_ = 0;
+    ok_ = true;
+    put8(schema::MAGIC);
+    put8(schema::VERSION);
+    put8(schema_.type_id);
+    const uint64_t ms = static_cast<uint64_t>(t.ms);
+    put32(static_cast<uint32_t>(ms));
+    put16(static_cast<uint32_t>(ms >> 32));
+    put16(t.err_us < 0 ? schema::TS_ERR_UNSET
+                       : static_cast<uint32_t>(clamp(t.err_us, 0, schema::TS_ERR_UNSET - 1)));
+    put32(seq);
+    return *this;
+  }
+
+  void integer(const char *name, long v) {
+    const schema::Kind k = expect(name);
+    if (!ok_) return;
+    switch (k) {
+      case schema::Kind::X10_I16:
+      case schema::Kind::X10_I32: put(k, v * 10); break;
+      default:                    put(k, v);      break;
+    }
+  }
+
+  void real(const char *name, float v) {
+    const schema::Kind k = expect(name);
+    if (!ok_) return;
+    if (!std::isfinite(v)) { putNull(k); return; }
+    const bool x10 = k == schema::Kind::X10_I16 || k == schema::Kind::X10_I32;
+    put(k, std::lround(x10 ? v * 10.0f : v));
+  }
+
+  void state(const char *name, State s) {
+    const schema::Kind k = expect(name);
+    if (!ok_) return;
+    if (k != schema::Kind::STATE) { ok_ = false; return; }
+    put8(static_cast<uint8_t>(s));
+  }
+
+  // True once every schema field was written, in order, without overflow.
+  bool end() const { return ok_ && next_ == schema_.count; }
+
+  const uint8_t *data() const { return buf_; }
+  size_t length() const { return len_; }
+  const schema::Schema &schemaDef() const { return schema_; }
+
+ private:
+  schema::Kind expect(const char *name) {
+    if (!ok_ || next_ >= schema_.count || strcmp(schema_.fields[next_].name, name) != 0) {
+      ok_ = false;
+      return schema::Kind::U8;
+    }
+    return schema_.fields[next_++].kind;
+  }
+
+  static long clamp(long v, long lo, long hi) { return v < lo ? lo : (v > hi ? hi : v); }
+
+  void put(schema::Kind k, long v) {
+    switch (k) {
+      case schema::Kind::U8:      put8(clamp(v, 0, 255)); break;
+      case schema::Kind::BOOL:    put8(v != 0);          break;
+      case schema::Kind::U16:     put16(clamp(v, 0, 65535)); break;
+      case schema::Kind::I16:
+      case schema::Kind::X10_I16: put16(clamp(v, -32767, 32767)); break;
+      case schema::Kind::X10_I32: put32(clamp(v, -2147483647L, 2147483647L)); break;
+      case schema::Kind::STATE:   ok_ = false; break;   // use state()
+    }
+  }
+
+  void putNull(schema::Kind k) {
+    switch (k) {
+      case schema::Kind::I16:
+      case schema::Kind::X10_I16: put16(0x8000); break;
+      case schema::Kind::X10_I32: put32(0x80000000UL); break;
+      default:                    ok_ = false; break;   // unsigned kinds have no null
+    }
+  }
+
+  void put8(uint32_t v) {
+    if (len_ < CAPACITY) buf_[len_++] = static_cast<uint8_t>(v);
+    else ok_ = false;
+  }
+  void put16(uint32_t v) { put8(v); put8(v >> 8); }
+  void put32(uint32_t v) { put16(v); put16(v >> 16); }
+
+  const schema::Schema &schema_;
+  uint8_t buf_[CAPACITY];
+  size_t len_ = 0;
+  uint8_t next_ = 0;
+  bool ok_ = true;
+};
+
+// Dual-encoding telemetry payload with the wr_deadband.h publish policy. N is
+// the JSON buffer size, as for wr::Payload<N>.
+template <size_t N>
+class Telemetry {
+ public:
+  explicit Telemetry(const schema::Schema &s) : bin_(s) {}
+
+  // Per-field deadband in the field's units (on-change mode only).
+  Telemetry &deadband(const char *name, float band) {
+    policy_.set(name, band);
+    return *this;
+  }
+
+  // Replaces the bare telemetry-tick check in loop().
+  bool sampleDue(bool telemetry_tick) { return policy_.sampleDue(telemetry_tick); }
+
+  Telemetry &begin() { return begin(binaryTelemetry()); }
+
+  // Build in the given encoding, whatever the node publishes live.
+  Telemetry &begin(bool binary) {
+    build_start_ = prof::start();
+    binary_ = binary;
+    nstats_ = 0;
+    policy_.start();
+    // Not deadband-tracked: a timestamp or number alone is no reason to
+    // publish.
+    const EpochTime t = timeSync().now();
+    if (binary_) {
+      bin_.begin(t, seq_);
+    } else {
+      json_.begin().field("ts_ms", static_cast<long long>(t.ms));
+      if (t.err_us >= 0) json_.field("ts_err_us", t.err_us);
+      else               json_.nullField("ts_err_us");
+      json_.field("seq", static_cast<unsigned long>(seq_));
+    }
+    return *this;
+  }
+
+  Telemetry &field(const char *name, int v)  { return integer(name, v); }
+  Telemetry &field(const char *name, long v) { return integer(name, v); }
+  Telemetry &field(const char *name, unsigned long v) {
+    return integer(name, static_cast<long>(v));
+  }
+  Telemetry &field(const char *name, bool v) {
+    policy_.track(name, v ? 1 : 0, 1);
+    if (binary_) bin_.integer(name, v ? 1 : 0);
+    else         json_.field(name, v);
+    return *this;
+  }
+  Telemetry &field(const char *name, float v, uint8_t decimals = 1) {
+    static const long SCALE[] = {1, 10, 100, 1000, 10000};
+    const long scale = SCALE[decimals > 4 ? 4 : decimals];
+    policy_.track(name, std::isfinite(v) ? std::lround(v * scale) : LONG_MIN, scale);
+    if (binary_) bin_.real(name, v);
+    else         json_.field(name, v, decimals);
+    return *this;
+  }
+  Telemetry &field(const char *name, double v, uint8_t decimals = 1) {
+    return field(name, static_cast<float>(v), decimals);
+  }
+  Telemetry &field(const char *name, State s) {
+    policy_.trackState(name, static_cast<uint8_t>(s));
+    if (binary_) bin_.state(name, s);
+    else         json_.field(name, stateName(s));
+    return *this;
+  }
+
+  // "<name>_min", "<name>_max" at `decimals`, "<name>_mean" one place finer.
+  // JSON only — the packed layout is fixed by the schema — and omitted while
+  // the window holds no samples. The Stat is reset once this payload is sent.
+  Telemetry &stats(const char *name, Stat &s, uint8_t decimals = 0) {
+    if (nstats_ < MAX_STATS) stats_[nstats_++] = &s;
+    if (binary_ || s.empty()) return *this;
+    json_.field(name, "_min",  s.min(),  decimals)
+         .field(name, "_max",  s.max(),  decimals)
+         .field(name, "_mean", s.mean(), decimals + 1);
+    return *this;
+  }
+
+  // The payload was sent: its values become the deadband reference, its
+  // stats windows start over and the next payload takes the next number.
+  void commit() {
+    ++seq_;
+    policy_.commit();
+    for (uint8_t i = 0; i < nstats_; ++i) stats_[i]->reset();
+  }
+
+  // The payload was kept for backfill (wr_backfill.h) instead: it uses up
+  // its number, but is no deadband reference, and the stats windows run on
+  // into the next live payload.
+  void kept() { ++seq_; }
+
+  bool binary() const { return binary_; }
+  uint32_t buildStart() const { return build_start_; }
+  BinaryWriter &bin() { return bin_; }
+  JsonWriter &json() { return json_; }
+  Deadband &policy() { return policy_; }
+
+ private:
+  Telemetry &integer(const char *name, long v) {
+    policy_.track(name, v, 1);
+    if (binary_) bin_.integer(name, v);
+    else         json_.field(name, v);
+    return *this;
+  }
+
+  static constexpr uint8_t MAX_STATS = 4;
+
+  Payload<N> json_;
+  BinaryWriter bin_;
+  Deadband policy_;
+  Stat *stats_[MAX_STATS];
+  uint8_t nstats_ = 0;
+  bool binary_ = false;
+  uint32_t build_start_ = 0;
+  uint32_t seq_ = 1;   // wr_seq.h: number of the payload being built
+};
+
+// Most JSON that begin() writes after "ts":
+// ,"ts_ms":<int64>,"ts_err_us":<long>,"seq":<32-bit unsigned>.
+static constexpr size_t EPOCH_TS_JSON_BYTES = (1 + 8 + 20) + (1 + 12 + 11) + (1 + 6 + 10);
+
+// ,"boot_ms":<32-bit unsigned>, on the first payload only (wr_boot.h).
+static constexpr size_t BOOT_MS_JSON_BYTES = 1 + 10 + 10;
+
+// Most JSON that publish() appends for the control echo and the control
+// loss counters: eight ,"ctl_…":<32-bit unsigned> fields.
+static constexpr size_t CONTROL_ECHO_JSON_BYTES =
+    (7 + 5 + 12 + 10) + (6 + 8 + 7 + 9) + 8 * (4 + 10);
+
+// Publish a Telemetry payload in whichever encoding it was built with, if the
+// publish policy says so. Returns true only when a message was sent.
+template <size_t N>
+inline bool publish(const Topic &topic, Telemetry<N> &payload) {
+  prof::stop(prof::Section::BUILD, payload.buildStart());
+  const Deadband::Send send = payload.policy().decide();
+  if (send == Deadband::Send::SKIP) return false;
+  prof::Scope timer(prof::Section::PUBLISH);
+
+  const unsigned long now_ms = millis();
+  bool sent;
+  if (!payload.binary()) {
+    if (!boot().published()) payload.json().field("boot_ms", now_ms);
+    if (controlClock().valid()) {
+      const ControlTiming &c = controlClock().last();
+      payload.json().field("ctl_seq",      c.seq)
+                    .field("ctl_t",        c.sent)
+                    .field("ctl_apply_us", c.apply_us)
+                    .field("ctl_age_ms",   millis() - c.applied_ms)
+                    .field("ctl_rx",       controlSeq().received())
+                    .field("ctl_lost",     controlSeq().lost())
+                    .field("ctl_dup",      controlSeq().duplicates())
+                    .field("ctl_reord",    controlSeq().reordered());
+    }
+    sent = publish(topic, payload.json(), send == Deadband::Send::RETAINED);
+  } else {
+    BinaryWriter &bin = payload.bin();
+    if (!bin.end()) {
+      Serial.print(F("[wr] telemetry does not match schema "));
+      Serial.print(bin.schemaDef().type);
+      Serial.print(F(", not published: "));
+      Serial.println(topic.c_str());
+      return false;
+    }
+    char bin_topic[72];
+    snprintf(bin_topic, sizeof(bin_topic), "%s/bin", topic.c_str());
+    sent = publish(bin_topic, bin.data(), bin.length(), false);
+    Serial.print(F("[wr] "));
+    Serial.print(static_cast<unsigned>(bin.length()));
+    Serial.print(F(" B binary → "));
+    Serial.println(bin_topic);
+  }
+  if (sent) {
+    payload.commit();
+    boot().published(now_ms);
+  }
+  return sent;
+}
+
+}  // namespace wr
@@ -0,0 +1,163 @@
+// wr_tick.h — one broadcast control frame per broker tick.
+//
+// The broker's run_simulation_tick sends every node its control string. As
+// one winter-river/<node_id>/control message each, that is 23 MQTT frames a
+// second and 23 AP wakeups. With tick_frame = true in the broker's config it
+// sends them all in a single frame on winter-river/tick instead
+// (broker/tick_frame.py has the layout): a header with the tick number and
+// slot map id, a table of slot end offsets, then the per-node control
+// strings back to back, SEQ:/T: stamps included.
+//
+// Build every node with -DWR_TICK_FRAME=1 before turning it on. The node
+// then also subscribes to:
+//
+//   winter-river/<node_id>/slot   retained "SLOT:<i> MAP:<id>"; the broker
+//                                 republishes it on every connect
+//   winter-river/tick             the frame
+//
+// receive() checks the header, finds the node's slot through the offset
+// table and narrows the callback's payload/length to it, in place; the
+// handler then runs on those bytes inside the MQTT buffer exactly as on a
+// <node_id>/control message (wr_tasks.h). A frame built for another slot
+// map (nodes table changed, new assignment not here yet) is ignored. The
+// per-node control topic stays subscribed: the broker falls back to it when
+// a frame would not fit, and operator commands still go there.
+//
+// The frame is larger than PubSubClient's default 256-byte buffer, so
+// begin() grows it to TICK_FRAME_BYTES; wr::AsyncMqtt (wr_mqtt.h) receives
+// into a buffer of that size already.
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <winter_river.h>
+#include <wr_mqtt.h>
+#include <wr_tokens.h>
+
+#ifndef WR_TICK_FRAME
+#define WR_TICK_FRAME 0
+#endif
+
+namespace wr {
+
+static constexpr uint16_t TICK_FRAME_BYTES = 2048;   // MQTT packet buffer for a frame
+
+#if WR_MQTT_ASYNC
+static_assert(MQTT_RX_BYTES >= TICK_FRAME_BYTES, "AsyncMqtt cannot receive a tick frame");
+#endif
+
+class TickFrame {
+ public:
+  static constexpr uint8_t MAGIC = 0xA6;
+  static constexpr uint8_t VERSION = 1;
+  static constexpr uint8_t HEADER_BYTES = 11;
+  static constexpr const char *TOPIC = "winter-river/tick";
+
+  // From startNode().
+  void begin(const char *node_id) {
+    snprintf(slot_topic_, sizeof(slot_topic_), "winter-river/%s/slot", node_id);
+    if (mqtt.getBufferSize() < TICK_FRAME_BYTES) mqtt.setBufferSize(TICK_FRAME_BYTES);
+  }
+
+  // After every MQTT (re)connect.
+  void subscribe() {
+    mqtt.subscribe(slot_topic_, 1);
+    mqtt.subscribe(TOPIC, 1);
+  }
+
+  // Route one incoming message. True if it was the slot assignment or a
+  // frame. For a frame, payload/length are narrowed to this node's slot;
+  // length is 0 when there is nothing to apply (empty slot, no assignment
+  // yet, another slot map, malformed frame).
+  bool receive(const char *topic, byte *&payload, unsigned int &length) {
+    if (!topic) return false;
+    if (strcmp(topic, slot_topic_) == 0) {
+      assign(payload, length);
+      length = 0;
+      return true;
+    }
+    if (strcmp(topic, TOPIC) != 0) return false;
+    const byte *p = payload;
+    const unsigned int n = length;
+    length = 0;
+    if (n < HEADER_BYTES || p[0] != MAGIC || p[1] != VERSION) {
+      ++bad_;
+      return true;
+    }
+    if (slot_ == NONE || le32(p + 6) != map_) {
+      ++skipped_;
+      return true;
+    }
+    const uint8_t slots = p[10];
+    const unsigned int table = HEADER_BYTES + 2u * slots;
+    if (slot_ >= slots || table > n) {
+      ++bad_;
+      return true;
+    }
+    const unsigned int start = slot_ ? le16(p + HEADER_BYTES + 2u * (slot_ - 1)) : table;
+    const unsigned int end = le16(p + HEADER_BYTES + 2u * slot_);
+    if (start < table || end < start || end > n) {
+      ++bad_;
+      return true;
+    }
+    tick_ = le32(p + 2);
+    ++frames_;
+    payload += start;
+    length = end - start;
+    return true;
+  }
+
+  bool assigned() const { return slot_ != NONE; }
+  uint16_t slot() const { return slot_; }
+  uint32_t tick() const { return tick_; }          // of the last frame taken
+  unsigned long frames() const { return frames_; }
+  unsigned long skipped() const { return skipped_; }
+  unsigned long bad() const { return bad_; }
+
+ private:
+  static constexpr uint16_t NONE = 0xFFFF;
+
+  static uint16_t le16(const byte *p) { return static_cast<uint16_t>(p[0] | p[1] << 8); }
+  static uint32_t le32(const byte *p) {
+    return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 |
+           static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+  }
+
+  // An empty payload (retained message cleared) drops the assignment.
+  void assign(const byte *p, unsigned int l) {
+    long slot = -1;
+    int64_t map = -1;
+    scanTokens(p, l, [&](const Token &tok) {
+      switch (tok.hash) {
+        case kw("SLOT"): if (tok.keyIs("SLOT")) slot = tok.toInt();   break;
+        case kw("MAP"):  if (tok.keyIs("MAP"))  map  = tok.toInt64(); break;
+      }
+    });
+    if (slot < 0 || slot > 0xFE || map < 0 || map > 0xFFFFFFFFLL) {
+      slot_ = NONE;
+      return;
+    }
+    if (slot_ != slot || map_ != static_cast<uint32_t>(map)) {
+      Serial.printf("[wr] tick frame: slot %ld, map %lu\n", slot, static_cast<unsigned long>(map));
+    }
+    slot_ = static_cast<uint16_t>(slot);
+    map_ = static_cast<uint32_t>(map);
+  }
+
+  char slot_topic_[64] = "";
+  uint16_t slot_ = NONE;
+  uint32_t map_ = 0;
+  uint32_t tick_ = 0;
+  unsigned long frames_ = 0;
+  unsigned long skipped_ = 0;
+  unsigned long bad_ = 0;
+};
+
+inline TickFrame &tickFrame() {
+  static TickFrame t;
+  return t;
+}
+
+}  // namespace wr
@@ -0,0 +1,270 @@
+// wr_time.h — fleet time sync: disciplined epoch-millisecond timestamps.
+//
+// The "ts" telemetry field is the SNTP-set wall clock as "HH:MM:SS". That
+// cannot order events inside one second, measure one-way latency, or line
+// up the 24 nodes' telemetry during a cascade. wr::timeSync() disciplines
+// the node's monotonic µs clock (esp_timer, 64-bit, never steps) against a
+// responder on the Pi (broker/time_sync.py). The exchange is NTP-style,
+// over MQTT:
+//
+//   node → winter-river/time/request     ID:ups_a N:42
+//   Pi   → winter-river/ups_a/time       N:42 T2:<epoch µs, received> T3:<epoch µs, sent>
+//
+// The node stamps T1 just before publishing and T4 when its MQTT callback
+// is entered, both on its own clock. Each exchange then gives
+//
+//   round trip  d = (T4 − T1) − (T3 − T2)
+//   offset      θ = ((T2 − T1) + (T3 − T4)) / 2      (Pi epoch − local clock)
+//
+// θ is off by at most d/2, however asymmetric the path. WiFi queueing only
+// ever adds delay, so the filter keeps the last WINDOW exchanges and trusts
+// the one with the smallest round trip. The oscillator's rate error is the
+// slope of θ between a reference exchange and the current best. Its
+// uncertainty is their combined d/2 over the span, so a new slope only
+// replaces the old one when it is at least as certain. The reference moves
+// up every REF_SPAN_MS, so the estimate follows slow temperature changes.
+// The node extrapolates between exchanges with that rate. Every telemetry
+// payload carries the result (wr_telemetry.h):
+//
+//   "ts_ms":1760612345678,"ts_err_us":840
+//
+// ts_ms is epoch milliseconds and never goes backwards. ts_err_us bounds its
+// error: half the reference round trip, plus a drift allowance for the time
+// since. Every node syncs against the same Pi clock, so two nodes agree to
+// within the sum of their bounds, whether or not the Pi itself runs NTP.
+// Until the first exchange completes, ts_ms falls back to the SNTP system
+// clock (0 if unset) and ts_err_us is null.
+//
+// Requests go out every ACQUIRE_MS until the window is full, then every
+// TRACK_MS. The exchange runs on the task that owns PubSubClient. The
+// resulting fix reaches the telemetry side through a latest-wins
+// wr::Mailbox (wr_mailbox.h). Build with -DWR_TIME_SYNC=0 to send no
+// requests; the fallback clock is then used throughout.
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <esp_timer.h>
+#include <winter_river.h>
+#include <wr_json.h>
+#include <wr_mailbox.h>
+#include <wr_tokens.h>
+
+#ifndef WR_TIME_SYNC
+#define WR_TIME_SYNC 1
+#endif
+
+namespace wr {
+
+static constexpr const char *TIME_REQUEST_TOPIC = "winter-river/time/request";
+
+// µs since boot. 64-bit, so it does not wrap like micros().
+inline int64_t monotonicMicros() { return esp_timer_get_time(); }
+
+// One reading of the disciplined clock.
+struct EpochTime {
+  int64_t ms;     // epoch milliseconds; 0 = no clock at all
+  long err_us;    // error bound; -1 = not synced to the Pi
+};
+
+// Network side → telemetry side, after each accepted exchange.
+struct ClockFix {
+  int64_t local_us;       // reference exchange (midpoint), local clock
+  int64_t offset_us;      // Pi epoch − local clock at local_us
+  int32_t drift_ppb;      // local rate error; > 0: the local clock runs slow
+  uint32_t drift_err_ppb; // bound on drift_ppb's error
+  uint32_t half_rtt_us;   // offset error bound at local_us
+};
+
+class TimeSync {
+ public:
+  static constexpr uint8_t WINDOW = 8;
+  static constexpr unsigned long ACQUIRE_MS    = 250;
+  static constexpr unsigned long TRACK_MS      = 4000;
+  static constexpr unsigned long TIMEOUT_MS    = 1000;
+  static constexpr unsigned long DRIFT_SPAN_MS = 60000;     // shortest slope
+  static constexpr unsigned long REF_SPAN_MS   = 1800000;   // reference moves up
+  // ESP32 crystals are within ±40 ppm before the drift is measured; after,
+  // allow 1 ppm of wander on top of the slope's own error.
+  static constexpr uint32_t UNRATED_PPB = 40000;
+  static constexpr uint32_t WANDER_PPB  = 1000;
+  // A larger apparent drift is a step of the Pi clock, not the crystal.
+  static constexpr int64_t MAX_DRIFT_PPB = 200000;
+
+  void begin(const char *node_id) {
+    node_id_ = node_id;
+    snprintf(reply_, sizeof(reply_), "winter-river/%s/time", node_id);
+  }
+
+  // ── network side: the task that owns PubSubClient ────────────────────────
+
+  // After every MQTT (re)connect.
+  void subscribe() {
+    mqtt.subscribe(reply_, 0);
+    pending_ = false;
+  }
+
+  // Send the next request when one is due. Call after mqtt.loop().
+  void poll() {
+    if (!WR_TIME_SYNC || !node_id_ || !mqtt.connected()) return;
+    const unsigned long now = millis();
+    if (pending_) {
+      if (now - sent_ms_ < TIMEOUT_MS) return;
+      pending_ = false;
+      ++timeouts_;
+    }
+    const unsigned long period = count_ < WINDOW ? ACQUIRE_MS : TRACK_MS;
+    if (started_ && now - sent_ms_ < period) return;
+
+    char msg[64];
+    const int n = snprintf(msg, sizeof(msg), "ID:%s N:%lu", node_id_, ++seq_);
+    started_ = true;
+    sent_ms_ = now;
+    t1_ = monotonicMicros();
+    pending_ = publishNow(TIME_REQUEST_TOPIC, reinterpret_cast<const uint8_t *>(msg),
+                          static_cast<size_t>(n), false);
+  }
+
+  // Route one incoming message. True if it was a time reply (taken here
+  // whether or not it was usable); anything else is for the node.
+  bool receive(const char *topic, const byte *p, unsigned int l) {
+    if (!topic || strcmp(topic, reply_) != 0) return false;
+    const int64_t t4 = monotonicMicros();
+    unsigned long n = 0;
+    int64_t t2 = 0, t3 = 0;
+    scanTokens(p, l, [&](const Token &tok) {
+      switch (tok.hash) {
+        case kw("N"):  if (tok.keyIs("N"))  n  = static_cast<unsigned long>(tok.toInt()); break;
+        case kw("T2"): if (tok.keyIs("T2")) t2 = tok.toInt64(); break;
+        case kw("T3"): if (tok.keyIs("T3")) t3 = tok.toInt64(); break;
+      }
+    });
+    if (!pending_ || n != seq_ || t2 <= 0 || t3 < t2) return true;   // late or foreign
+    pending_ = false;
+    const int64_t rtt = (t4 - t1_) - (t3 - t2);
+    if (rtt < 0) return true;
+    add(Sample{t1_ + (t4 - t1_) / 2, ((t2 - t1_) + (t3 - t4)) / 2, static_cast<uint32_t>(rtt)});
+    return true;
+  }
+
+  unsigned long exchanges() const { return exchanges_; }
+  unsigned long timeouts() const { return timeouts_; }
+
+  // ── telemetry side ───────────────────────────────────────────────────────
+
+  // The disciplined clock, now. Single consumer: the task that builds
+  // telemetry.
+  EpochTime now() {
+    if (ClockFix *f = fixes_.take()) {
+      fix_ = *f;
+      synced_ = true;
+    }
+    const int64_t local = monotonicMicros();
+    if (!synced_) {
+      struct timeval tv;
+      gettimeofday(&tv, nullptr);
+      const bool set = tv.tv_sec > 1600000000;   // SNTP has run (after 2020)
+      return EpochTime{set ? static_cast<int64_t>(tv.tv_sec) * 1000 + tv.tv_usec / 1000 : 0, -1};
+    }
+    const int64_t since = local - fix_.local_us;
+    const int64_t us = local + fix_.offset_us + since * fix_.drift_ppb / 1000000000LL;
+    int64_t ms = us / 1000;
+    if (ms < last_ms_) ms = last_ms_;   // a new fix can move it back: hold until it catches up
+    last_ms_ = ms;
+    const int64_t err = fix_.half_rtt_us +
+                        (since < 0 ? -since : since) * fix_.drift_err_ppb / 1000000000LL;
+    return EpochTime{ms, err < 0x7FFFFFFF ? static_cast<long>(err) : 0x7FFFFFFFL};
+  }
+
+ private:
+  struct Sample {
+    int64_t local_us;
+    int64_t offset_us;
+    uint32_t rtt_us;
+  };
+
+  void add(const Sample &s) {
+    window_[next_] = s;
+    next_ = (next_ + 1) % WINDOW;
+    if (count_ < WINDOW) ++count_;
+    ++exchanges_;
+
+    const Sample *best = &window_[0];
+    for (uint8_t i = 1; i < count_; ++i) {
+      if (window_[i].rtt_us < best->rtt_us) best = &window_[i];
+    }
+
+    const int64_t span = best->local_us - ref_.local_us;
+    if (!have_ref_) {
+      ref_ = *best;
+      have_ref_ = true;
+    } else if (span >= static_cast<int64_t>(DRIFT_SPAN_MS) * 1000) {
+      // A step of the Pi clock (NTP correcting fake-hwclock after boot) can
+      // be hours: compare the offset change with the largest drift before
+      // scaling it to ppb, which would overflow. Past the check |delta| is
+      // at most span / 5000, so delta * 1e9 fits for spans up to 1.5 years.
+      const int64_t delta = best->offset_us - ref_.offset_us;
+      const int64_t max_delta = span / (1000000000LL / MAX_DRIFT_PPB);
+      if (delta > max_delta || delta < -max_delta) {   // Pi clock stepped: start over
+        drift_ppb_ = 0;
+        drift_err_ppb_ = UNRATED_PPB;
+        // Drop the samples from before the step, or they would stay "best"
+        // for up to WINDOW exchanges and hold the old offset.
+        window_[0] = *best;
+        next_ = 1;
+        count_ = 1;
+        best = &window_[0];
+        ref_ = *best;
+      } else {
+        const int64_t ppb = delta * 1000000000LL / span;
+        const int64_t err = (static_cast<int64_t>(ref_.rtt_us) + best->rtt_us) / 2 * 1000000000LL / span;
+        if (err + WANDER_PPB <= drift_err_ppb_) {
+          drift_ppb_ = static_cast<int32_t>(ppb);
+          drift_err_ppb_ = static_cast<uint32_t>(err + WANDER_PPB);
+        }
+        if (span >= static_cast<int64_t>(REF_SPAN_MS) * 1000) {
+          ref_ = *best;
+          drift_err_ppb_ += WANDER_PPB;   // let the next span's slope take over
+        }
+      }
+    }
+
+    fixes_.back() = ClockFix{best->local_us, best->offset_us, drift_ppb_, drift_err_ppb_,
+                             best->rtt_us / 2};
+    fixes_.post();
+  }
+
+  // Network side.
+  const char *node_id_ = nullptr;
+  char reply_[64] = {};
+  unsigned long seq_ = 0;
+  unsigned long sent_ms_ = 0;
+  int64_t t1_ = 0;
+  bool pending_ = false;
+  bool started_ = false;
+  Sample window_[WINDOW] = {};
+  uint8_t next_ = 0;
+  uint8_t count_ = 0;
+  Sample ref_ = {};
+  bool have_ref_ = false;
+  int32_t drift_ppb_ = 0;
+  uint32_t drift_err_ppb_ = UNRATED_PPB;
+  unsigned long exchanges_ = 0;
+  unsigned long timeouts_ = 0;
+
+  Mailbox<ClockFix> fixes_;
+
+  // Telemetry side.
+  ClockFix fix_ = {};
+  bool synced_ = false;
+  int64_t last_ms_ = 0;
+};
+
+inline TimeSync &timeSync() {
+  static TimeSync t;
+  return t;
+}
+
+}  // namespace wr
@@ -0,0 +1,146 @@
+// wr_tokens.h — zero-copy control-token parsing for the wr:: helper.
+//
+// Control messages are space-delimited tokens ("INPUT:480.0 BATT:72
+// STATUS:CHARGING"). The String-based path allocated one String per token,
+// plus a substring() per value. Here the raw PubSubClient buffer is walked
+// once and each token is handed to the node as a non-owning wr::Token view;
+// values are parsed in place.
+//
+// Nodes dispatch on a compile-time hash of the keyword:
+//
+//   static void handleToken(const wr::Token &tok) {
+//     switch (tok.hash) {
+//       case wr::kw("LOAD"):  if (tok.keyIs("LOAD"))  load_pct = tok.toInt();    break;
+//       case wr::kw("INPUT"): if (tok.keyIs("INPUT")) input_v  = tok.toFloat();  break;
+//       case wr::kw("CLOSE"): if (tok.keyIs("CLOSE")) breaker_closed = true;     break;   // bare word
+//     }
+//   }
+//   ...
+//   wr::forEachToken(p, l, handleToken);
+//
+// The case labels are the node's keyword table: the compiler lowers the
+// switch to a jump/binary search over constants, and two keywords that hash
+// alike are a compile error (duplicate case value). That only keeps the
+// known keywords apart: an unknown or misspelled key can still hash like one
+// of them, so every case confirms the text with keyIs() before acting. Keys
+// are matched exactly ("LOADX:5" no longer matches "LOAD:"), which the
+// broker's fixed vocabulary never relies on.
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include <winter_river.h>
+
+namespace wr {
+
+// FNV-1a, usable in case labels. The runtime tokenizer hashes the key bytes
+// with the same function.
+constexpr uint32_t kw(const char *s, uint32_t h = 2166136261u) {
+  return *s ? kw(s + 1, (h ^ static_cast<uint8_t>(*s)) * 16777619u) : h;
+}
+
+inline uint32_t kwHash(const char *s, size_t n) {
+  uint32_t h = 2166136261u;
+  while (n--) h = (h ^ static_cast<uint8_t>(*s++)) * 16777619u;
+  return h;
+}
+
+// One control token. `key`/`value` point into the MQTT receive buffer and are
+// only valid for the duration of the callback. Bare words (CLOSE, OPEN) have
+// has_value == false and an empty value.
+struct Token {
+  const char *key;
+  const char *value;
+  uint16_t key_len;
+  uint16_t value_len;
+  bool has_value;
+  uint32_t hash;   // wr::kw() of the key
+
+  // Same leniency as String::toInt(): leading sign and digits, stops at the
+  // first non-digit ("94.7" → 94), 0 when there are no digits.
+  long toInt() const {
+    const char *s = value, *end = value + value_len;
+    bool neg = false;
+    if (s < end && (*s == '-' || *s == '+')) neg = (*s++ == '-');
+    long v = 0;
+    for (; s < end && *s >= '0' && *s <= '9'; ++s) v = v * 10 + (*s - '0');
+    return neg ? -v : v;
+  }
+
+  // toInt() for values past 32 bits (epoch microseconds, wr_time.h).
+  int64_t toInt64() const {
+    const char *s = value, *end = value + value_len;
+    bool neg = false;
+    if (s < end && (*s == '-' || *s == '+')) neg = (*s++ == '-');
+    int64_t v = 0;
+    for (; s < end && *s >= '0' && *s <= '9'; ++s) v = v * 10 + (*s - '0');
+    return neg ? -v : v;
+  }
+
+  // Plain decimal ("-12.5", "230000.0"); the broker never sends exponents.
+  // Stops at the first character that is not part of the number. The
+  // fraction is accumulated as an integer and scaled once, which keeps the
+  // result within an ulp of atof() instead of drifting per digit.
+  float toFloat() const {
+    static const float POW10[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f};
+    const char *s = value, *end = value + value_len;
+    bool neg = false;
+    if (s < end && (*s == '-' || *s == '+')) neg = (*s++ == '-');
+    float v = 0.0f;
+    for (; s < end && *s >= '0' && *s <= '9'; ++s) v = v * 10.0f + (*s - '0');
+    if (s < end && *s == '.') {
+      uint32_t frac = 0;
+      uint8_t digits = 0;
+      for (++s; s < end && *s >= '0' && *s <= '9'; ++s) {
+        if (digits < 6) { frac = frac * 10 + (*s - '0'); ++digits; }
+      }
+      v += frac / POW10[digits];
+    }
+    return neg ? -v : v;
+  }
+
+  // The key text, after a hash match (see above): one length check and a
+  // compare of a few bytes.
+  bool keyIs(const char *s) const {
+    return strncmp(key, s, key_len) == 0 && s[key_len] == '\0';
+  }
+
+  bool valueIs(const char *s) const {
+    return strncmp(value, s, value_len) == 0 && s[value_len] == '\0';
+  }
+};
+
+// Split a raw control payload into tokens and call fn once per token, in
+// order. Runs of spaces/CR/LF/tabs are skipped; nothing is copied.
+template <typename Fn>
+inline void scanTokens(const byte *p, unsigned int l, Fn fn) {
+  const char *s = reinterpret_cast<const char *>(p);
+  const char *end = s + l;
+  while (s < end) {
+    while (s < end && (*s == ' ' || *s == '\t' || *s == '\r' || *s == '\n')) ++s;
+    const char *start = s;
+    const char *colon = nullptr;
+    while (s < end && *s != ' ' && *s != '\t' && *s != '\r' && *s != '\n') {
+      if (*s == ':' && !colon) colon = s;
+      ++s;
+    }
+    if (s == start) break;
+    Token tok;
+    tok.key = start;
+    tok.key_len = static_cast<uint16_t>((colon ? colon : s) - start);
+    tok.has_value = colon != nullptr;
+    tok.value = colon ? colon + 1 : s;
+    tok.value_len = static_cast<uint16_t>(s - tok.value);
+    tok.hash = kwHash(tok.key, tok.key_len);
+    fn(tok);
+  }
+}
+
+// View-based overload of the helper's forEachToken(): pick it by giving the
+// handler a `const wr::Token &` parameter.
+inline void forEachToken(byte *p, unsigned int l, void (*fn)(const Token &)) {
+  scanTokens(p, l, fn);
+}
+
+}  // namespace wr
@@ -0,0 +1,602 @@
+// loadgen.cpp — virtual fleet load generator for broker capacity planning.
+//
+// Runs hundreds or thousands of emulated nodes in one Linux process against
+// a local Mosquitto + broker/main.py. Each emulated node has its own MQTT
+// connection, client id, retained LWT, status/control topics and ONLINE
+// message, exactly as a board does (README "MQTT LWT / Online Pattern"), and
+// its payloads come from the real node sources (bench/bench_nodes.cpp):
+// control is fed to the node's MQTT callback, telemetry is what its step()
+// publishes. Instances of one node type share that type's node state (the
+// node files keep it in file statics), so payload shape and size are exact
+// while values follow the most recent control to any instance of the type.
+//
+// The fleet is the 24-node baseplate repeated --blocks times. Block 0 uses
+// the real node ids; block k appends "_x<k>". Seed the broker's topology for
+// the extra blocks first (the broker ignores node ids it does not know):
+//
+//   .pio/build/loadgen/program --blocks 20 --sql | psql -U postgres winter_river
+//   .pio/build/loadgen/program --blocks 20 --rate 1 --duration 120
+//
+// Every --report seconds it prints one row:
+//
+//   conn        emulated nodes connected
+//   tx/s        telemetry published by the fleet
+//   ctl/s       control messages received by the fleet (broker fan-out as
+//               delivered)
+//   period      broker tick cadence seen by the nodes: p50/p99 of the
+//               difference between consecutive T: stamps to one node (ms)
+//   drop        telemetry the fleet could not send (socket backlog full)
+//   ingest/s    messages the engine ingested (winter-river/broker/status)
+//   fanout/s    control messages the engine published
+//   tick_ms     slowest engine tick in the window
+//   overrun     ticks whose work exceeded the tick rate
+//   mosq_rx/s   Mosquitto $SYS messages received (10 s $SYS granularity)
+//   mosq_drop   Mosquitto $SYS publish/messages/dropped in the window
+//
+// and a summary at exit (also written by --json FILE) with the totals and,
+// counted from the first engine status after the whole fleet is connected,
+// the messages lost in each direction: fleet telemetry not ingested by the
+// engine, and engine control not received by the fleet. Those two assume the
+// fleet is the only set of nodes on the broker.
+#include <Arduino.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <wr_prof.h>
+
+#include "../bench/bench.h"
+#include "mqtt_conn.h"
+
+namespace {
+
+// One baseplate (scripts/init_db.sql, platformio.ini).
+const char *const BASEPLATE[] = {
+  "utility_a", "hv_mv_transformer_a", "mv_switchgear_a", "mv_lv_transformer_a",
+  "lv_switchgear_a", "generator_a", "ups_a", "cooling_a",
+  "server_rack_a1", "server_rack_a2", "server_rack_a3", "server_rack_a4",
+  "utility_b", "hv_mv_transformer_b", "mv_switchgear_b", "mv_lv_transformer_b",
+  "lv_switchgear_b", "generator_b", "ups_b", "cooling_b",
+  "server_rack_b1", "server_rack_b2", "server_rack_b3", "server_rack_b4",
+};
+constexpr size_t BASEPLATE_NODES = sizeof(BASEPLATE) / sizeof(BASEPLATE[0]);
+
+constexpr uint64_t RECONNECT_MS = 2000;
+constexpr uint64_t SCAN_MS      = 10;      // keepalive / telemetry schedule granularity
+
+const char *const BROKER_STATUS = "winter-river/broker/status";
+const char *const SYS_TOPICS[] = {
+  "$SYS/broker/messages/received",
+  "$SYS/broker/publish/messages/dropped",
+  "$SYS/broker/clients/connected",
+};
+
+struct Options {
+  std::string host = "127.0.0.1";
+  uint16_t port = 1883;
+  unsigned blocks = 1;
+  double rate_hz = 1000.0 / wr::TELEMETRY_INTERVAL_MS;
+  double duration_s = 60;
+  double report_s = 5;
+  double ramp = 200;            // connections opened per second
+  uint16_t keepalive_s = 15;
+  bool binary = false;
+  bool sql = false;
+  std::string json;
+};
+
+class Fleet;
+
+struct Instance {
+  Fleet *fleet = nullptr;
+  std::string id;
+  const bench::Node *type = nullptr;
+  std::string status_topic;
+  std::vector<char> control_topic;   // NUL-terminated, writable for the callback
+  loadgen::MqttConn conn;
+  uint64_t next_tx_ms = 0;
+  uint64_t retry_ms = 0;
+  long last_t = -1;                  // T: of the previous control message
+};
+
+// Fleet-side counters; `Window` is reset at every report.
+struct Window {
+  uint64_t tx = 0, rx_ctl = 0, drops = 0;
+  double tick_ms_max = 0;
+  wr::prof::Histogram period;        // ms between consecutive T: stamps
+};
+
+struct Totals {
+  uint64_t tx = 0, tx_bytes = 0, rx_ctl = 0, drops = 0, connects = 0, disconnects = 0;
+};
+
+// Latest cumulative counters from winter-river/broker/status and $SYS.
+struct BrokerView {
+  bool seen = false;
+  double tick_ms = 0;
+  uint64_t ingested = 0, controls = 0, tick_overruns = 0, ticks = 0;
+  bool sys_seen = false;
+  uint64_t mosq_rx = 0, mosq_dropped = 0, mosq_clients = 0;
+};
+
+volatile sig_atomic_t g_stop = 0;
+
+uint64_t nowMs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Keep the node code's millis()/micros() on real time.
+void syncClock() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  static uint64_t epoch_us = 0;
+  const uint64_t us = static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+  if (!epoch_us) epoch_us = us;
+  const uint64_t target = us - epoch_us;
+  if (target > micros()) native::advanceMicros(static_cast<unsigned long>(target - micros()));
+}
+
+// `"key":<number>` in a flat JSON object; false if absent.
+bool jsonNumber(const char *json, const char *key, double &out) {
+  char pat[48];
+  snprintf(pat, sizeof(pat), "\"%s\":", key);
+  const char *p = strstr(json, pat);
+  if (!p) return false;
+  char *end = nullptr;
+  out = strtod(p + strlen(pat), &end);
+  return end != p + strlen(pat);
+}
+
+// Broker T: stamp in a control payload, or -1.
+long controlStamp(const uint8_t *payload, size_t len) {
+  for (size_t i = 0; i + 2 < len; ++i) {
+    if ((i == 0 || payload[i - 1] == ' ') && payload[i] == 'T' && payload[i + 1] == ':') {
+      long t = 0;
+      size_t j = i + 2;
+      if (j >= len || payload[j] < '0' || payload[j] > '9') return -1;
+      for (; j < len && payload[j] >= '0' && payload[j] <= '9'; ++j) t = t * 10 + (payload[j] - '0');
+      return t;
+    }
+  }
+  return -1;
+}
+
+const bench::Node *nodeType(const char *base_id) {
+  for (size_t i = 0; i < bench::nodeCount(); ++i) {
+    const bench::Node &n = bench::nodes()[i];
+    if (strncmp(base_id, n.prefix, strlen(n.prefix)) == 0) return &n;
+  }
+  return nullptr;
+}
+
+std::string nodeId(unsigned block, const char *base) {
+  return block ? std::string(base) + "_x" + std::to_string(block) : std::string(base);
+}
+
+// Topology rows for blocks 1..N-1, cloned from the seeded baseplate.
+void printSql(unsigned blocks) {
+  printf("-- Winter River loadgen: baseplate copies 1..%u (run after scripts/init_db.sql)\n",
+         blocks ? blocks - 1 : 0);
+  if (blocks < 2) return;
+  printf("INSERT INTO nodes (node_id, node_type, side, parent_id, secondary_parent_id,\n"
+         "                   rated_voltage, v_ratio)\n"
+         "SELECT n.node_id || '_x' || k, n.node_type, n.side,\n"
+         "       n.parent_id || '_x' || k, n.secondary_parent_id || '_x' || k,\n"
+         "       n.rated_voltage, n.v_ratio\n"
+         "FROM nodes n, generate_series(1, %u) AS k\n"
+         "WHERE n.node_id IN (",
+         blocks - 1);
+  for (size_t i = 0; i < BASEPLATE_NODES; ++i) printf("%s'%s'", i ? ", " : "", BASEPLATE[i]);
+  printf(")\nON CONFLICT (node_id) DO NOTHING;\n"
+         "INSERT INTO live_status (node_id) SELECT node_id FROM nodes\n"
+         "ON CONFLICT (node_id) DO NOTHING;\n");
+}
+
+class Fleet {
+ public:
+  explicit Fleet(const Options &opt) : opt_(opt) {}
+
+  bool init() {
+    addr_.sin_family = AF_INET;
+    addr_.sin_port = htons(opt_.port);
+    if (inet_pton(AF_INET, opt_.host.c_str(), &addr_.sin_addr) != 1) {
+      fprintf(stderr, "--host must be an IPv4 address: %s\n", opt_.host.c_str());
+      return false;
+    }
+    epoll_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_ < 0) return false;
+
+    for (unsigned b = 0; b < opt_.blocks; ++b) {
+      for (size_t i = 0; i < BASEPLATE_NODES; ++i) {
+        nodes_.emplace_back();
+        Instance &n = nodes_.back();
+        n.fleet = this;
+        n.id = nodeId(b, BASEPLATE[i]);
+        n.type = nodeType(BASEPLATE[i]);
+        n.status_topic = "winter-river/" + n.id + "/status";
+        const std::string ctl = "winter-river/" + n.id + "/control";
+        n.control_topic.assign(ctl.begin(), ctl.end());
+        n.control_topic.push_back(0);
+      }
+    }
+    bench::resetHelperState(opt_.binary);
+    return true;
+  }
+
+  void run() {
+    const uint64_t start = nowMs();
+    const uint64_t end = opt_.duration_s > 0 ? start + static_cast<uint64_t>(opt_.duration_s * 1000) : 0;
+    uint64_t last_scan = 0, last_report = start, last_ramp = start;
+    double ramp_credit = 0;
+    size_t next_open = 0;
+    printHeader();
+
+    std::vector<epoll_event> events(1024);
+    while (!g_stop && (!end || nowMs() < end)) {
+      const uint64_t now = nowMs();
+
+      // Ramp: open at most opt_.ramp connections per second, then retry
+      // dropped ones after RECONNECT_MS.
+      ramp_credit += (now - last_ramp) * opt_.ramp / 1000.0;
+      last_ramp = now;
+      if (ramp_credit > opt_.ramp) ramp_credit = opt_.ramp;
+      if (!monitor_open_ && now >= monitor_retry_ms_) openMonitor(now);
+      for (size_t scanned = 0; ramp_credit >= 1 && scanned < nodes_.size(); ++scanned) {
+        Instance &n = nodes_[next_open];
+        next_open = (next_open + 1) % nodes_.size();
+        if (n.conn.state() == loadgen::MqttConn::State::CLOSED && now >= n.retry_ms) {
+          open(n, now);
+          ramp_credit -= 1;
+        }
+      }
+
+      const int ready = epoll_wait(epoll_, events.data(), static_cast<int>(events.size()),
+                                   static_cast<int>(SCAN_MS));
+      for (int i = 0; i < ready; ++i) handle(events[i], nowMs());
+
+      if (nowMs() - last_scan >= SCAN_MS) {
+        last_scan = nowMs();
+        scan(last_scan);
+      }
+      if (nowMs() - last_report >= opt_.report_s * 1000) {
+        report((nowMs() - last_report) / 1000.0, (nowMs() - start) / 1000.0);
+        last_report = nowMs();
+      }
+    }
+
+    for (Instance &n : nodes_) n.conn.disconnect();   // clean: no LWT storm
+    monitor_.disconnect();
+    summary((nowMs() - start) / 1000.0);
+  }
+
+ private:
+  void open(Instance &n, uint64_t now) {
+    const loadgen::MqttConn::Will will = {
+      n.status_topic, "{\"node\":\"" + n.id + "\",\"status\":\"OFFLINE\"}"};
+    n.conn.tick(now);
+    if (!n.conn.open(addr_, n.id, &will, opt_.keepalive_s)) {
+      n.retry_ms = now + RECONNECT_MS;
+      return;
+    }
+    watch(n.conn, &n);
+  }
+
+  void openMonitor(uint64_t now) {
+    char id[48];
+    snprintf(id, sizeof(id), "loadgen-monitor-%d", static_cast<int>(getpid()));
+    monitor_.tick(now);
+    if (monitor_.open(addr_, id, nullptr, opt_.keepalive_s)) {
+      watch(monitor_, nullptr);
+      monitor_open_ = true;
+    } else {
+      monitor_retry_ms_ = now + RECONNECT_MS;
+    }
+  }
+
+  void watch(loadgen::MqttConn &c, Instance *n) {
+    epoll_event ev = {};
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = n;
+    epoll_ctl(epoll_, EPOLL_CTL_ADD, c.fd(), &ev);
+  }
+
+  void handle(const epoll_event &ev, uint64_t now) {
+    Instance *n = static_cast<Instance *>(ev.data.ptr);
+    loadgen::MqttConn &c = n ? n->conn : monitor_;
+    if (c.fd() < 0) return;                   // dropped earlier in this batch
+    bool ok = true;
+    if (ev.events & (EPOLLOUT | EPOLLERR)) ok = c.onWritable();
+    if (ok && (ev.events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP))) {
+      ok = n ? c.onReadable(&Fleet::onControl, n) : c.onReadable(&Fleet::onMonitor, this);
+    }
+    if (ok && c.takeConnected()) {
+      if (n) {
+        ++totals_.connects;
+        c.subscribe(n->control_topic.data());
+        publishOnline(*n);
+        // Spread the fleet's telemetry over one interval.
+        n->next_tx_ms = now + static_cast<uint64_t>(random(static_cast<long>(intervalMs())));
+      } else {
+        c.subscribe(BROKER_STATUS);
+        for (const char *t : SYS_TOPICS) c.subscribe(t);
+      }
+    }
+    if (!ok) drop(c, n, now);
+  }
+
+  void drop(loadgen::MqttConn &c, Instance *n, uint64_t now) {
+    const bool was_connected = c.connected();
+    c.close();                                // closing the fd removes it from epoll
+    if (n) {
+      if (was_connected) ++totals_.disconnects;
+      n->retry_ms = now + RECONNECT_MS + static_cast<uint64_t>(random(1000));
+      n->last_t = -1;
+    } else {
+      monitor_open_ = false;
+      monitor_retry_ms_ = now + RECONNECT_MS;
+    }
+  }
+
+  void scan(uint64_t now) {
+    if (!monitor_.tick(now)) drop(monitor_, nullptr, now);
+    for (Instance &n : nodes_) {
+      if (n.conn.state() == loadgen::MqttConn::State::CLOSED) continue;
+      if (!n.conn.tick(now)) {
+        drop(n.conn, &n, now);
+        continue;
+      }
+      if (n.conn.connected() && now >= n.next_tx_ms) {
+        n.next_tx_ms += intervalMs();
+        if (n.next_tx_ms <= now) n.next_tx_ms = now + intervalMs();   // fell behind: skip
+        publishTelemetry(n);
+      }
+    }
+  }
+
+  uint64_t intervalMs() const {
+    return static_cast<uint64_t>(1000.0 / (opt_.rate_hz > 0 ? opt_.rate_hz : 0.001));
+  }
+
+  void publishOnline(Instance &n) {
+    char msg[160];
+    const int len = snprintf(msg, sizeof(msg), "{\"ts\":\"%s\",\"node\":\"%s\",\"status\":\"ONLINE\"}",
+                             wr::timestamp().c_str(), n.id.c_str());
+    send(n, n.status_topic.c_str(), reinterpret_cast<const uint8_t *>(msg), static_cast<size_t>(len), true);
+  }
+
+  void publishTelemetry(Instance &n) {
+    syncClock();
+    const unsigned long before = bench::lastPublished().count;
+    n.type->step(true);
+    const bench::Published p = bench::lastPublished();
+    if (p.count == before) return;                    // on-change: nothing this tick
+    // winter-river/<NODE_ID>/status[/bin] → winter-river/<instance id>/status[/bin]
+    const char *suffix = strchr(p.topic, '/');
+    suffix = suffix ? strchr(suffix + 1, '/') : nullptr;
+    if (!suffix) return;
+    char topic[128];
+    snprintf(topic, sizeof(topic), "winter-river/%s%s", n.id.c_str(), suffix);
+    send(n, topic, p.payload, p.length, p.retained);
+  }
+
+  void send(Instance &n, const char *topic, const uint8_t *payload, size_t len, bool retained) {
+    if (n.conn.publish(topic, payload, len, retained)) {
+      ++window_.tx;
+      ++totals_.tx;
+      totals_.tx_bytes += len;
+    } else {
+      ++window_.drops;
+      ++totals_.drops;
+    }
+  }
+
+  static void onControl(void *ctx, const char *, size_t, uint8_t *payload, size_t len) {
+    Instance &n = *static_cast<Instance *>(ctx);
+    Fleet &f = *n.fleet;
+    ++f.window_.rx_ctl;
+    ++f.totals_.rx_ctl;
+    const long t = controlStamp(payload, len);
+    if (t >= 0 && n.last_t >= 0 && t > n.last_t) {
+      f.window_.period.add(static_cast<uint32_t>(t - n.last_t));
+    }
+    if (t >= 0) n.last_t = t;
+    syncClock();
+    n.type->on_mqtt(n.control_topic.data(), payload, static_cast<unsigned int>(len));
+  }
+
+  static void onMonitor(void *ctx, const char *topic, size_t, uint8_t *payload, size_t len) {
+    Fleet &f = *static_cast<Fleet *>(ctx);
+    char buf[512];
+    const size_t n = len < sizeof(buf) - 1 ? len : sizeof(buf) - 1;
+    memcpy(buf, payload, n);
+    buf[n] = 0;
+    BrokerView &b = f.broker_;
+    if (strcmp(topic, BROKER_STATUS) == 0) {
+      double v;
+      if (jsonNumber(buf, "ingested", v)) b.ingested = static_cast<uint64_t>(v);
+      if (jsonNumber(buf, "controls", v)) b.controls = static_cast<uint64_t>(v);
+      if (jsonNumber(buf, "ticks", v)) b.ticks = static_cast<uint64_t>(v);
+      if (jsonNumber(buf, "tick_overruns", v)) b.tick_overruns = static_cast<uint64_t>(v);
+      if (jsonNumber(buf, "tick_ms", v)) {
+        b.tick_ms = v;
+        if (v > f.window_.tick_ms_max) f.window_.tick_ms_max = v;
+      }
+      b.seen = true;
+      // Loss accounting compares engine and fleet counters at the same
+      // instants: from the first status with the whole fleet connected (no
+      // ramp-up control to unsubscribed nodes) to the latest one.
+      if (!f.baseline_ && f.connectedCount() == f.nodes_.size()) {
+        f.baseline_ = true;
+        f.broker_start_ = b;
+        f.tx_base_ = f.totals_.tx;
+        f.rx_base_ = f.totals_.rx_ctl;
+      }
+      f.tx_at_status_ = f.totals_.tx;
+      f.rx_at_status_ = f.totals_.rx_ctl;
+      return;
+    }
+    const uint64_t v = strtoull(buf, nullptr, 10);
+    if (strcmp(topic, SYS_TOPICS[0]) == 0) b.mosq_rx = v;
+    else if (strcmp(topic, SYS_TOPICS[1]) == 0) b.mosq_dropped = v;
+    else if (strcmp(topic, SYS_TOPICS[2]) == 0) b.mosq_clients = v;
+    if (!b.sys_seen && strcmp(topic, SYS_TOPICS[0]) == 0) {
+      f.broker_start_.mosq_rx = b.mosq_rx;
+      f.broker_start_.mosq_dropped = b.mosq_dropped;
+      b.sys_seen = true;
+    }
+  }
+
+  size_t connectedCount() const {
+    size_t c = 0;
+    for (const Instance &n : nodes_) c += n.conn.connected();
+    return c;
+  }
+
+  void printHeader() const {
+    printf("%7s %6s %8s %8s %11s %6s | %9s %9s %8s %7s | %9s %9s\n", "t_s", "conn", "tx/s",
+           "ctl/s", "period", "drop", "ingest/s", "fanout/s", "tick_ms", "overrun", "mosq_rx/s",
+           "mosq_drop");
+  }
+
+  void report(double dt, double t) {
+    const BrokerView &b = broker_;
+    char period[24];
+    if (window_.period.count()) {
+      snprintf(period, sizeof(period), "%u/%u", window_.period.percentile(0.50f),
+               window_.period.percentile(0.99f));
+    } else {
+      snprintf(period, sizeof(period), "-");
+    }
+    auto rate = [dt](uint64_t now, uint64_t then) { return now >= then ? (now - then) / dt : 0.0; };
+    printf("%7.1f %6zu %8.1f %8.1f %11s %6llu | %9.1f %9.1f %8.1f %7llu | %9.1f %9llu\n", t,
+           connectedCount(), window_.tx / dt, window_.rx_ctl / dt, period,
+           static_cast<unsigned long long>(window_.drops), rate(b.ingested, prev_.ingested),
+           rate(b.controls, prev_.controls), window_.tick_ms_max,
+           static_cast<unsigned long long>(b.tick_overruns - prev_.tick_overruns),
+           rate(b.mosq_rx, prev_.mosq_rx),
+           static_cast<unsigned long long>(b.mosq_dropped - prev_.mosq_dropped));
+    fflush(stdout);
+    prev_ = b;
+    window_.tx = window_.rx_ctl = window_.drops = 0;
+    window_.tick_ms_max = 0;
+    window_.period.reset();
+  }
+
+  void summary(double elapsed) {
+    const BrokerView &b = broker_, &s = broker_start_;
+    const bool have = baseline_;
+    const long long ingested = have ? static_cast<long long>(b.ingested - s.ingested) : -1;
+    const long long fanout = have ? static_cast<long long>(b.controls - s.controls) : -1;
+    const long long lost_tx = have ? static_cast<long long>(tx_at_status_ - tx_base_) - ingested : -1;
+    const long long lost_ctl = have ? fanout - static_cast<long long>(rx_at_status_ - rx_base_) : -1;
+
+    char json[1024];
+    snprintf(json, sizeof(json),
+             "{\"nodes\":%zu,\"blocks\":%u,\"rate_hz\":%.3f,\"elapsed_s\":%.1f,"
+             "\"tx\":%llu,\"tx_bytes\":%llu,\"rx_ctl\":%llu,\"local_drops\":%llu,"
+             "\"connects\":%llu,\"disconnects\":%llu,"
+             "\"engine_ingested\":%lld,\"engine_controls\":%lld,\"engine_ticks\":%lld,"
+             "\"tick_overruns\":%lld,\"lost_telemetry\":%lld,\"lost_control\":%lld,"
+             "\"mosquitto_dropped\":%lld}",
+             nodes_.size(), opt_.blocks, opt_.rate_hz, elapsed,
+             static_cast<unsigned long long>(totals_.tx), static_cast<unsigned long long>(totals_.tx_bytes),
+             static_cast<unsigned long long>(totals_.rx_ctl), static_cast<unsigned long long>(totals_.drops),
+             static_cast<unsigned long long>(totals_.connects),
+             static_cast<unsigned long long>(totals_.disconnects), ingested, fanout,
+             have ? static_cast<long long>(b.ticks - s.ticks) : -1LL,
+             have ? static_cast<long long>(b.tick_overruns - s.tick_overruns) : -1LL, lost_tx,
+             lost_ctl, b.sys_seen ? static_cast<long long>(b.mosq_dropped - s.mosq_dropped) : -1LL);
+    printf("\n%s\n", json);
+    if (!b.seen) {
+      printf("no %s received — is broker/main.py running against this Mosquitto?\n", BROKER_STATUS);
+    }
+    if (!opt_.json.empty()) {
+      if (FILE *f = fopen(opt_.json.c_str(), "w")) {
+        fprintf(f, "%s\n", json);
+        fclose(f);
+      }
+    }
+  }
+
+  const Options &opt_;
+  sockaddr_in addr_ = {};
+  int epoll_ = -1;
+  std::deque<Instance> nodes_;          // stable addresses: epoll holds Instance*
+  loadgen::MqttConn monitor_;
+  bool monitor_open_ = false;
+  uint64_t monitor_retry_ms_ = 0;
+  Window window_;
+  Totals totals_;
+  BrokerView broker_, broker_start_, prev_;
+  bool baseline_ = false;
+  uint64_t tx_base_ = 0, rx_base_ = 0;          // fleet totals when broker_start_ was taken
+  uint64_t tx_at_status_ = 0, rx_at_status_ = 0;   // ... when broker_ was last updated
+};
+
+bool parseArgs(int argc, char **argv, Options &o) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string a = argv[i];
+    const bool has_value = i + 1 < argc;
+    if (a == "--host" && has_value)            o.host = argv[++i];
+    else if (a == "--port" && has_value)       o.port = static_cast<uint16_t>(atoi(argv[++i]));
+    else if (a == "--blocks" && has_value)     o.blocks = static_cast<unsigned>(atoi(argv[++i]));
+    else if (a == "--rate" && has_value)       o.rate_hz = atof(argv[++i]);
+    else if (a == "--duration" && has_value)   o.duration_s = atof(argv[++i]);
+    else if (a == "--report" && has_value)     o.report_s = atof(argv[++i]);
+    else if (a == "--ramp" && has_value)       o.ramp = atof(argv[++i]);
+    else if (a == "--keepalive" && has_value)  o.keepalive_s = static_cast<uint16_t>(atoi(argv[++i]));
+    else if (a == "--json" && has_value)       o.json = argv[++i];
+    else if (a == "--bin")                     o.binary = true;
+    else if (a == "--sql")                     o.sql = true;
+    else {
+      fprintf(stderr,
+              "usage: %s [--host IP] [--port N] [--blocks N] [--rate HZ] [--duration SEC]\n"
+              "          [--report SEC] [--ramp CONN_PER_SEC] [--keepalive SEC] [--bin]\n"
+              "          [--json FILE] | --blocks N --sql\n",
+              argv[0]);
+      return false;
+    }
+  }
+  if (o.blocks < 1 || o.ramp <= 0 || o.report_s <= 0 || o.keepalive_s < 2) {
+    fprintf(stderr, "--blocks, --ramp, --report must be positive and --keepalive at least 2\n");
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options opt;
+  if (!parseArgs(argc, argv, opt)) return 2;
+  if (opt.sql) {
+    printSql(opt.blocks);
+    return 0;
+  }
+
+  // One socket per node: raise the soft fd limit as far as the hard one.
+  rlimit rl;
+  if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+  }
+  signal(SIGINT, [](int) { g_stop = 1; });
+  signal(SIGTERM, [](int) { g_stop = 1; });
+  randomSeed(static_cast<unsigned long>(getpid()));
+
+  Fleet fleet(opt);
+  if (!fleet.init()) return 2;
+  fleet.run();
+  return 0;
+}
@@ -0,0 +1,254 @@
+// mqtt_conn.cpp — see mqtt_conn.h.
+#include "mqtt_conn.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace loadgen {
+
+namespace {
+
+enum : uint8_t {
+  CONNECT = 0x10, CONNACK = 0x20, PUBLISH = 0x30, PUBACK = 0x40,
+  SUBSCRIBE = 0x82, SUBACK = 0x90, PINGREQ = 0xC0, PINGRESP = 0xD0, DISCONNECT = 0xE0,
+};
+
+void putLength(std::string &out, size_t n) {
+  do {
+    uint8_t b = n % 128;
+    n /= 128;
+    if (n) b |= 0x80;
+    out.push_back(static_cast<char>(b));
+  } while (n);
+}
+
+void putString(std::string &out, const char *s, size_t n) {
+  out.push_back(static_cast<char>(n >> 8));
+  out.push_back(static_cast<char>(n & 0xFF));
+  out.append(s, n);
+}
+
+void putString(std::string &out, const std::string &s) { putString(out, s.data(), s.size()); }
+
+// Header byte + remaining length + body.
+std::string packet(uint8_t header, const std::string &body) {
+  std::string p;
+  p.reserve(body.size() + 5);
+  p.push_back(static_cast<char>(header));
+  putLength(p, body.size());
+  p += body;
+  return p;
+}
+
+}  // namespace
+
+bool MqttConn::open(const sockaddr_in &addr, const std::string &client_id, const Will *will,
+                    uint16_t keepalive_s) {
+  close();
+  fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd_ < 0) return false;
+  const int one = 1;
+  setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  if (::connect(fd_, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) < 0 &&
+      errno != EINPROGRESS) {
+    close();
+    return false;
+  }
+  state_ = State::CONNECTING;
+  keepalive_s_ = keepalive_s;
+  last_rx_ms_ = now_ms_;
+
+  std::string body;
+  putString(body, "MQTT", 4);
+  body.push_back(4);                                   // protocol level 3.1.1
+  uint8_t flags = 0x02;                                // clean session
+  if (will) flags |= 0x04 | 0x08 | 0x20;               // will, QoS 1, retained
+  body.push_back(static_cast<char>(flags));
+  body.push_back(static_cast<char>(keepalive_s >> 8));
+  body.push_back(static_cast<char>(keepalive_s & 0xFF));
+  putString(body, client_id);
+  if (will) {
+    putString(body, will->topic);
+    putString(body, will->payload);
+  }
+  const std::string p = packet(CONNECT, body);
+  out_.assign(p);
+  out_pos_ = 0;
+  return true;
+}
+
+void MqttConn::disconnect() {
+  if (state_ == State::CONNECTED) {
+    const uint8_t bye[2] = {DISCONNECT, 0};
+    queue(bye, sizeof(bye));
+  }
+  close();
+}
+
+void MqttConn::close() {
+  if (fd_ >= 0) ::close(fd_);
+  fd_ = -1;
+  state_ = State::CLOSED;
+  just_connected_ = false;
+  out_.clear();
+  out_pos_ = 0;
+  in_.clear();
+}
+
+bool MqttConn::onWritable() {
+  if (state_ == State::CONNECTING) {
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (getsockopt(fd_, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err) return false;
+    state_ = State::WAIT_CONNACK;
+  }
+  return flush();
+}
+
+bool MqttConn::flush() {
+  if (state_ == State::CONNECTING) return true;   // wait for the connect to finish
+  while (out_pos_ < out_.size()) {
+    const ssize_t n = ::send(fd_, out_.data() + out_pos_, out_.size() - out_pos_, MSG_NOSIGNAL);
+    if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK;
+    out_pos_ += static_cast<size_t>(n);
+  }
+  out_.clear();
+  out_pos_ = 0;
+  return true;
+}
+
+bool MqttConn::queue(const uint8_t *data, size_t len) {
+  if (out_.size() - out_pos_ + len > MAX_PENDING) return false;
+  if (out_pos_ > 4096 && out_pos_ * 2 > out_.size()) {   // drop the sent prefix
+    out_.erase(0, out_pos_);
+    out_pos_ = 0;
+  }
+  out_.append(reinterpret_cast<const char *>(data), len);
+  return flush();
+}
+
+bool MqttConn::publish(const char *topic, const uint8_t *payload, size_t len, bool retained) {
+  if (state_ != State::CONNECTED) return false;
+  const size_t tlen = strlen(topic);
+  uint8_t head[8];
+  size_t h = 0;
+  head[h++] = PUBLISH | (retained ? 0x01 : 0x00);
+  size_t rem = 2 + tlen + len;
+  do {
+    uint8_t b = rem % 128;
+    rem /= 128;
+    if (rem) b |= 0x80;
+    head[h++] = b;
+  } while (rem);
+  head[h++] = static_cast<uint8_t>(tlen >> 8);
+  head[h++] = static_cast<uint8_t>(tlen & 0xFF);
+  if (out_.size() - out_pos_ + h + tlen + len > MAX_PENDING) return false;
+  return queue(head, h) && queue(reinterpret_cast<const uint8_t *>(topic), tlen) &&
+         queue(payload, len);
+}
+
+bool MqttConn::subscribe(const char *topic) {
+  std::string body;
+  body.push_back(static_cast<char>(next_packet_id_ >> 8));
+  body.push_back(static_cast<char>(next_packet_id_ & 0xFF));
+  if (++next_packet_id_ == 0) next_packet_id_ = 1;
+  putString(body, topic, strlen(topic));
+  body.push_back(0);                                   // QoS 0
+  const std::string p = packet(SUBSCRIBE, body);
+  return queue(reinterpret_cast<const uint8_t *>(p.data()), p.size());
+}
+
+bool MqttConn::tick(uint64_t now_ms) {
+  now_ms_ = now_ms;
+  if (state_ == State::CLOSED) return true;
+  const uint64_t limit = keepalive_s_ * 1500ULL;
+  if (now_ms - last_rx_ms_ > limit) return false;       // also bounds connect time
+  // Ping on a fixed half-keepalive cadence rather than when idle: utility
+  // nodes are never sent control, so PINGRESP is all they ever receive.
+  if (state_ == State::CONNECTED && now_ms - last_ping_ms_ >= keepalive_s_ * 1000ULL / 2) {
+    last_ping_ms_ = now_ms;
+    const uint8_t ping[2] = {PINGREQ, 0};
+    return queue(ping, sizeof(ping));
+  }
+  return true;
+}
+
+bool MqttConn::onReadable(MessageFn fn, void *ctx) {
+  char buf[16384];
+  for (;;) {
+    const ssize_t n = ::recv(fd_, buf, sizeof(buf), 0);
+    if (n == 0) return false;                          // broker closed
+    if (n < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+      return false;
+    }
+    in_.append(buf, static_cast<size_t>(n));
+    last_rx_ms_ = now_ms_;
+  }
+
+  size_t pos = 0;
+  while (in_.size() - pos >= 2) {
+    size_t len = 0, mult = 1, i = pos + 1;
+    for (;; ++i) {
+      if (i >= in_.size()) goto partial;
+      const uint8_t b = static_cast<uint8_t>(in_[i]);
+      len += (b & 0x7F) * mult;
+      mult *= 128;
+      if (!(b & 0x80)) break;
+      if (i - pos >= 4) return false;                   // malformed length
+    }
+    if (in_.size() - (i + 1) < len) break;
+    if (!handlePacket(static_cast<uint8_t>(in_[pos]),
+                      reinterpret_cast<uint8_t *>(&in_[i + 1]), len, fn, ctx)) {
+      return false;
+    }
+    if (fd_ < 0) return false;
+    pos = i + 1 + len;
+  }
+partial:
+  in_.erase(0, pos);
+  return true;
+}
+
+bool MqttConn::handlePacket(uint8_t header, uint8_t *body, size_t len, MessageFn fn, void *ctx) {
+  switch (header & 0xF0) {
+    case CONNACK:
+      if (len < 2 || body[1] != 0) return false;       // refused
+      state_ = State::CONNECTED;
+      just_connected_ = true;
+      last_ping_ms_ = now_ms_;
+      return true;
+    case PUBLISH: {
+      if (len < 2) return false;
+      const size_t tlen = (static_cast<size_t>(body[0]) << 8) | body[1];
+      size_t off = 2 + tlen;
+      const uint8_t qos = (header >> 1) & 0x03;
+      if (qos) off += 2;
+      if (off > len) return false;
+      if (qos == 1) {
+        const uint8_t ack[4] = {PUBACK, 2, body[2 + tlen], body[3 + tlen]};
+        if (!queue(ack, sizeof(ack))) return false;
+      }
+      // Topic is not NUL-terminated in the packet; the payload follows it,
+      // so copy it out before handing the payload over.
+      char topic[256];
+      const size_t tcopy = tlen < sizeof(topic) - 1 ? tlen : sizeof(topic) - 1;
+      memcpy(topic, body + 2, tcopy);
+      topic[tcopy] = 0;
+      fn(ctx, topic, tcopy, body + off, len - off);
+      return true;
+    }
+    case SUBACK:
+    case PINGRESP:
+    case PUBACK:
+      return true;
+    default:
+      return true;                                     // ignore anything else
+  }
+}
+
+}  // namespace loadgen
@@ -0,0 +1,89 @@
+// mqtt_conn.h — minimal non-blocking MQTT 3.1.1 client for the load generator.
+//
+// One MqttConn is one emulated node's TCP connection. It only speaks what the
+// nodes do: CONNECT (clean session, keepalive, optional retained LWT),
+// SUBSCRIBE, QoS 0 PUBLISH both ways, PINGREQ. The socket is non-blocking and
+// driven by the caller's epoll loop (loadgen.cpp): call onReadable() /
+// onWritable() on readiness and tick() about once a second.
+#pragma once
+
+#include <netinet/in.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+namespace loadgen {
+
+class MqttConn {
+ public:
+  enum class State : uint8_t { CLOSED, CONNECTING, WAIT_CONNACK, CONNECTED };
+
+  // Called for every PUBLISH received. `payload` is writable and only valid
+  // for the duration of the call.
+  typedef void (*MessageFn)(void *ctx, const char *topic, size_t topic_len,
+                            uint8_t *payload, size_t len);
+
+  struct Will {
+    std::string topic;
+    std::string payload;
+  };
+
+  // Outgoing bytes buffered beyond this are refused: publish() returns false
+  // and the message counts as dropped (the broker is not keeping up).
+  static constexpr size_t MAX_PENDING = 64 * 1024;
+
+  MqttConn() = default;
+  MqttConn(const MqttConn &) = delete;
+  MqttConn &operator=(const MqttConn &) = delete;
+  ~MqttConn() { close(); }
+
+  // Start a non-blocking connect and queue CONNECT. Returns false if the
+  // socket could not be created; the fd is then -1.
+  bool open(const sockaddr_in &addr, const std::string &client_id, const Will *will,
+            uint16_t keepalive_s);
+  void close();
+  void disconnect();    // clean DISCONNECT (no LWT), then close()
+
+  int fd() const { return fd_; }
+  State state() const { return state_; }
+  bool connected() const { return state_ == State::CONNECTED; }
+
+  // Readiness handlers. Return false when the connection has failed or was
+  // closed by the broker; the caller then close()s and reconnects later.
+  bool onReadable(MessageFn fn, void *ctx);
+  bool onWritable();
+
+  // Keepalive: sends PINGREQ when idle. Returns false if the broker has been
+  // silent for 1.5 × keepalive.
+  bool tick(uint64_t now_ms);
+
+  bool publish(const char *topic, const uint8_t *payload, size_t len, bool retained);
+  bool subscribe(const char *topic);
+
+  // CONNACK arrived since the last call (one-shot).
+  bool takeConnected() {
+    const bool c = just_connected_;
+    just_connected_ = false;
+    return c;
+  }
+
+ private:
+  bool queue(const uint8_t *data, size_t len);
+  bool flush();
+  bool handlePacket(uint8_t header, uint8_t *body, size_t len, MessageFn fn, void *ctx);
+
+  int fd_ = -1;
+  State state_ = State::CLOSED;
+  bool just_connected_ = false;
+  uint16_t keepalive_s_ = 15;
+  uint16_t next_packet_id_ = 1;
+  uint64_t last_rx_ms_ = 0;
+  uint64_t last_ping_ms_ = 0;
+  uint64_t now_ms_ = 0;
+  std::string out_;            // pending outgoing bytes (front = oldest)
+  size_t out_pos_ = 0;
+  std::string in_;             // partial incoming packet(s)
+};
+
+}  // namespace loadgen
@@ -0,0 +1,65 @@
+// Adafruit_GFX.h — host (native env) stand-in for the text API the nodes use.
+//
+// Text is "rendered" as a 6×8 cell per character whose column bytes depend on
+// the character, so a changed reading changes the frame buffer the way the
+// real font would and wr::flushDisplay() sees realistic diffs.
+#pragma once
+
+#include <Arduino.h>
+
+#define WHITE 1
+#define BLACK 0
+
+class Adafruit_GFX : public Print {
+ public:
+  Adafruit_GFX(int16_t w, int16_t h) : width_(w), height_(h) {}
+
+  void setCursor(int16_t x, int16_t y) { x_ = x; y_ = y; }
+  void setTextSize(uint8_t s) { size_ = s ? s : 1; }
+  void setTextColor(uint16_t c) { color_ = c; }
+  void setTextColor(uint16_t c, uint16_t) { color_ = c; }
+  void setTextWrap(bool) {}
+  int16_t getCursorX() const { return x_; }
+  int16_t getCursorY() const { return y_; }
+  int16_t width() const { return width_; }
+  int16_t height() const { return height_; }
+
+  virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+
+  void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t c) { for (int16_t i = 0; i < w; ++i) drawPixel(x + i, y, c); }
+  void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t c) { for (int16_t i = 0; i < h; ++i) drawPixel(x, y + i, c); }
+  void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t c) {
+    if (y0 == y1) drawFastHLine(x0 < x1 ? x0 : x1, y0, abs(x1 - x0) + 1, c);
+    else if (x0 == x1) drawFastVLine(x0, y0 < y1 ? y0 : y1, abs(y1 - y0) + 1, c);
+  }
+  void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t c) {
+    drawFastHLine(x, y, w, c); drawFastHLine(x, y + h - 1, w, c);
+    drawFastVLine(x, y, h, c); drawFastVLine(x + w - 1, y, h, c);
+  }
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t c) {
+    for (int16_t i = 0; i < h; ++i) drawFastHLine(x, y + i, w, c);
+  }
+
+  size_t write(uint8_t c) override {
+    if (c == '\n') { x_ = 0; y_ += 8 * size_; return 1; }
+    if (c == '\r') return 1;
+    for (int16_t col = 0; col < 5; ++col) {
+      const uint8_t bits = static_cast<uint8_t>((c * 37u + col * 11u) & 0x7F);
+      for (int16_t row = 0; row < 8; ++row) {
+        for (uint8_t s = 0; s < size_ * size_; ++s) {
+          drawPixel(x_ + col * size_ + s % size_, y_ + row * size_ + s / size_,
+                    (bits >> row) & 1 ? color_ : !color_);
+        }
+      }
+    }
+    x_ += 6 * size_;
+    return 1;
+  }
+  using Print::write;
+
+ protected:
+  int16_t width_, height_;
+  int16_t x_ = 0, y_ = 0;
+  uint8_t size_ = 1;
+  uint16_t color_ = WHITE;
+};
@@ -0,0 +1,39 @@
+// Adafruit_SSD1306.h — host (native env) stand-in: a 128×64 frame buffer in
+// the controller's page layout; display() counts the bytes a real full-frame
+// push would put on the I2C bus.
+#pragma once
+
+#include <Adafruit_GFX.h>
+#include <SPI.h>
+#include <Wire.h>
+
+#define SSD1306_SWITCHCAPVCC 0x02
+#define SSD1306_EXTERNALVCC  0x01
+#define SSD1306_WHITE 1
+#define SSD1306_BLACK 0
+
+class Adafruit_SSD1306 : public Adafruit_GFX {
+ public:
+  Adafruit_SSD1306(uint8_t w = 128, uint8_t h = 64, TwoWire * = &Wire, int8_t = -1)
+      : Adafruit_GFX(w, h) {}
+
+  bool begin(uint8_t = SSD1306_SWITCHCAPVCC, uint8_t = 0x3C, bool = true, bool = true) { return true; }
+  void clearDisplay() { memset(buffer_, 0, sizeof(buffer_)); }
+  void display() { Wire.bytes += 8 + sizeof(buffer_) + 9 * 2; ++full_frames; }
+  void dim(bool) {}
+  void invertDisplay(bool) {}
+  void ssd1306_command(uint8_t) {}
+  uint8_t *getBuffer() { return buffer_; }
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override {
+    if (x < 0 || y < 0 || x >= width_ || y >= height_) return;
+    uint8_t &b = buffer_[x + (y / 8) * 128];
+    if (color) b |= static_cast<uint8_t>(1 << (y & 7));
+    else       b &= static_cast<uint8_t>(~(1 << (y & 7)));
+  }
+
+  unsigned long full_frames = 0;   // native only
+
+ private:
+  uint8_t buffer_[128 * 64 / 8] = {};
+};
@@ -0,0 +1,255 @@
+// Arduino.h — host (native env) stand-in for the subset of the Arduino-ESP32
+// core the wr:: helpers and node sources use. Not for device builds.
+//
+// Time is virtual: millis()/micros() only move when native::advanceMicros()
+// or delay() moves them, so benchmark runs are deterministic.
+#pragma once
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <string>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define F(s) (s)
+#define PROGMEM
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+#define DEC 10
+#define HEX 16
+
+namespace native {
+void advanceMicros(unsigned long us);
+void setSerialEcho(bool on);   // print Serial output to stdout (default off)
+}  // namespace native
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+inline void yield() {}
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+// ── String ────────────────────────────────────────────────────────────────────
+// Heap-backed like the real one, so allocations show up in the benchmark.
+class String {
+ public:
+  String() {}
+  String(const char *s) : s_(s ? s : "") {}
+  String(const String &) = default;
+  String(String &&) = default;
+  explicit String(char c) : s_(1, c) {}
+  String(int v, unsigned char base = 10) { fromInt(v, base); }
+  String(unsigned v, unsigned char base = 10) { fromUint(v, base); }
+  String(long v, unsigned char base = 10) { fromInt(v, base); }
+  String(unsigned long v, unsigned char base = 10) { fromUint(v, base); }
+  String(float v, unsigned char decimals = 2) { fromDouble(v, decimals); }
+  String(double v, unsigned char decimals = 2) { fromDouble(v, decimals); }
+
+  String &operator=(const String &) = default;
+  String &operator=(String &&) = default;
+  String &operator=(const char *s) { s_ = s ? s : ""; return *this; }
+
+  String &operator+=(const String &o) { s_ += o.s_; return *this; }
+  String &operator+=(const char *s) { if (s) s_ += s; return *this; }
+  String &operator+=(char c) { s_ += c; return *this; }
+  String &operator+=(int v) { return *this += String(v); }
+  String &operator+=(unsigned v) { return *this += String(v); }
+  String &operator+=(long v) { return *this += String(v); }
+  String &operator+=(unsigned long v) { return *this += String(v); }
+  String &operator+=(float v) { return *this += String(v); }
+  String &operator+=(double v) { return *this += String(v); }
+  bool concat(const String &o) { s_ += o.s_; return true; }
+  bool concat(const char *s) { if (s) s_ += s; return true; }
+  bool concat(const char *s, unsigned n) { s_.append(s, n); return true; }
+  bool concat(char c) { s_ += c; return true; }
+
+  friend String operator+(const String &a, const String &b) { String r(a); r += b; return r; }
+  friend String operator+(const String &a, const char *b) { String r(a); r += b; return r; }
+  friend String operator+(const char *a, const String &b) { String r(a); r += b; return r; }
+
+  bool operator==(const String &o) const { return s_ == o.s_; }
+  bool operator==(const char *s) const { return s && s_ == s; }
+  bool operator!=(const String &o) const { return !(*this == o); }
+  bool operator!=(const char *s) const { return !(*this == s); }
+  bool operator<(const String &o) const { return s_ < o.s_; }
+  bool equals(const String &o) const { return *this == o; }
+  bool equalsIgnoreCase(const String &o) const {
+    if (s_.size() != o.s_.size()) return false;
+    for (size_t i = 0; i < s_.size(); ++i) {
+      if (tolower(static_cast<unsigned char>(s_[i])) != tolower(static_cast<unsigned char>(o.s_[i]))) return false;
+    }
+    return true;
+  }
+  char operator[](unsigned i) const { return i < s_.size() ? s_[i] : 0; }
+  char &operator[](unsigned i) { return s_[i]; }
+  char charAt(unsigned i) const { return (*this)[i]; }
+
+  unsigned length() const { return static_cast<unsigned>(s_.size()); }
+  bool isEmpty() const { return s_.empty(); }
+  bool reserve(unsigned n) { s_.reserve(n); return true; }
+  const char *c_str() const { return s_.c_str(); }
+
+  bool startsWith(const String &p) const { return s_.compare(0, p.s_.size(), p.s_) == 0; }
+  bool startsWith(const char *p) const { return s_.rfind(p, 0) == 0; }
+  bool endsWith(const String &p) const {
+    return s_.size() >= p.s_.size() && s_.compare(s_.size() - p.s_.size(), p.s_.size(), p.s_) == 0;
+  }
+  int indexOf(char c, unsigned from = 0) const { return pos(s_.find(c, from)); }
+  int indexOf(const String &p, unsigned from = 0) const { return pos(s_.find(p.s_, from)); }
+  int indexOf(const char *p, unsigned from = 0) const { return pos(s_.find(p, from)); }
+  int lastIndexOf(char c) const { return pos(s_.rfind(c)); }
+  String substring(unsigned from) const { return from < s_.size() ? String(s_.substr(from).c_str()) : String(); }
+  String substring(unsigned from, unsigned to) const {
+    if (from > to) std::swap(from, to);
+    if (from >= s_.size()) return String();
+    return String(s_.substr(from, to - from).c_str());
+  }
+  void trim() {
+    const size_t a = s_.find_first_not_of(" \t\r\n");
+    if (a == std::string::npos) { s_.clear(); return; }
+    s_ = s_.substr(a, s_.find_last_not_of(" \t\r\n") - a + 1);
+  }
+  void toUpperCase() { for (char &c : s_) c = static_cast<char>(toupper(static_cast<unsigned char>(c))); }
+  void toLowerCase() { for (char &c : s_) c = static_cast<char>(tolower(static_cast<unsigned char>(c))); }
+  void replace(const String &from, const String &to) {
+    if (from.s_.empty()) return;
+    for (size_t p = 0; (p = s_.find(from.s_, p)) != std::string::npos; p += to.s_.size()) {
+      s_.replace(p, from.s_.size(), to.s_);
+    }
+  }
+  long toInt() const { return atol(s_.c_str()); }
+  float toFloat() const { return static_cast<float>(atof(s_.c_str())); }
+  double toDouble() const { return atof(s_.c_str()); }
+
+ private:
+  static int pos(size_t p) { return p == std::string::npos ? -1 : static_cast<int>(p); }
+  void fromInt(long v, unsigned char base) {
+    if (v < 0 && base == 10) { fromUint(static_cast<unsigned long>(-v), base); s_.insert(0, 1, '-'); }
+    else fromUint(static_cast<unsigned long>(v), base);
+  }
+  void fromUint(unsigned long v, unsigned char base) {
+    char buf[33];
+    char *p = buf + sizeof(buf);
+    *--p = 0;
+    do { const unsigned d = v % base; *--p = static_cast<char>(d < 10 ? '0' + d : 'A' + d - 10); v /= base; } while (v);
+    s_ = p;
+  }
+  void fromDouble(double v, unsigned char decimals) {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", decimals, v);
+    s_ = buf;
+  }
+
+  std::string s_;
+};
+
+// ── Print ─────────────────────────────────────────────────────────────────────
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buf, size_t n) {
+    size_t k = 0;
+    while (n--) k += write(*buf++);
+    return k;
+  }
+  size_t write(const char *s) { return s ? write(reinterpret_cast<const uint8_t *>(s), strlen(s)) : 0; }
+
+  size_t print(const char *s) { return write(s); }
+  size_t print(const String &s) { return write(s.c_str()); }
+  size_t print(char c) { return write(static_cast<uint8_t>(c)); }
+  size_t print(unsigned char v, int base = DEC) { return printUint(v, base); }
+  size_t print(int v, int base = DEC) { return printInt(v, base); }
+  size_t print(unsigned v, int base = DEC) { return printUint(v, base); }
+  size_t print(long v, int base = DEC) { return printInt(v, base); }
+  size_t print(unsigned long v, int base = DEC) { return printUint(v, base); }
+  size_t print(double v, int digits = 2) {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", digits, v);
+    return write(buf);
+  }
+
+  size_t println() { return write("\r\n"); }
+  template <typename T> size_t println(const T &v) { const size_t n = print(v); return n + println(); }
+  template <typename T> size_t println(const T &v, int fmt) { const size_t n = print(v, fmt); return n + println(); }
+
+  size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3))) {
+    char buf[256];
+    va_list ap;
+    va_start(ap, fmt);
+    const int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    return n > 0 ? write(buf) : 0;
+  }
+
+ private:
+  size_t printInt(long v, int base) {
+    if (v < 0 && base == DEC) return write('-') + printUint(static_cast<unsigned long>(-v), base);
+    return printUint(static_cast<unsigned long>(v), base);
+  }
+  size_t printUint(unsigned long v, int base) {
+    char buf[33];
+    char *p = buf + sizeof(buf);
+    *--p = 0;
+    do { const unsigned d = v % base; *--p = static_cast<char>(d < 10 ? '0' + d : 'A' + d - 10); v /= base; } while (v);
+    return write(p);
+  }
+};
+
+class HardwareSerial : public Print {
+ public:
+  void begin(unsigned long) {}
+  size_t write(uint8_t c) override;
+  using Print::write;
+  int available() { return 0; }
+  int read() { return -1; }
+  void flush() {}
+  explicit operator bool() const { return true; }
+};
+extern HardwareSerial Serial;
+
+// ── ESP32 core ────────────────────────────────────────────────────────────────
+class EspClass {
+ public:
+  uint32_t getCycleCount();          // host time at 240 MHz
+  uint32_t getFreeHeap() { return 200000; }
+  uint32_t getMinFreeHeap() { return 180000; }
+  uint32_t getMaxAllocHeap() { return 110000; }
+  uint32_t getHeapSize() { return 327680; }
+  uint64_t getEfuseMac() { return 0x0000A1B2C3D4E5F6ULL; }
+  uint32_t getSketchSize() { return 0; }   // no app partition
+  void restart() { exit(0); }
+};
+extern EspClass ESP;
+
+inline uint32_t getCpuFrequencyMhz() { return 240; }
+
+void configTime(long gmt_offset_sec, int daylight_offset_sec, const char *server1,
+                const char *server2 = nullptr, const char *server3 = nullptr);
+bool getLocalTime(struct tm *info, uint32_t ms = 5000);
+
+// ── FreeRTOS (the native env runs single-core; these only need to compile) ───
+typedef void *TaskHandle_t;
+typedef uint32_t TickType_t;
+typedef unsigned UBaseType_t;
+#define pdTRUE 1
+#define pdMS_TO_TICKS(ms) (static_cast<TickType_t>(ms))
+inline int xTaskCreatePinnedToCore(void (*)(void *), const char *, uint32_t, void *, unsigned,
+                                   TaskHandle_t *, int) { return 1; }
+inline void vTaskDelay(TickType_t ticks) { delay(ticks); }
+inline void vTaskDelete(TaskHandle_t) {}
+inline void xTaskNotifyGive(TaskHandle_t) {}
+inline uint32_t ulTaskNotifyTake(int, TickType_t) { return 0; }
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 4096; }
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return nullptr; }
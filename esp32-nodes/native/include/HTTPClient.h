@@ -0,0 +1,18 @@
+// HTTPClient.h — host (native env) stand-in: no network, every request fails.
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+#define HTTP_CODE_OK 200
+
+class HTTPClient {
+ public:
+  bool begin(const char *) { return false; }
+  void setTimeout(uint16_t) {}
+  int GET() { return -1; }
+  int getSize() { return -1; }
+  WiFiClient *getStreamPtr() { return nullptr; }
+  bool connected() { return false; }
+  void end() {}
+};
@@ -0,0 +1,60 @@
+// LittleFS.h — host (native env) stand-in: files as in-memory byte strings
+// that last for the process.
+#pragma once
+
+#include <Arduino.h>
+
+#include <map>
+#include <string>
+
+class File {
+ public:
+  File() {}
+  File(std::string *data, bool append) : data_(data), pos_(append ? data->size() : 0) {}
+  explicit operator bool() const { return data_ != nullptr; }
+  size_t size() const { return data_ ? data_->size() : 0; }
+  bool seek(size_t pos) {
+    if (!data_ || pos > data_->size()) return false;
+    pos_ = pos;
+    return true;
+  }
+  size_t read(uint8_t *buf, size_t n) {
+    if (!data_) return 0;
+    if (n > data_->size() - pos_) n = data_->size() - pos_;
+    memcpy(buf, data_->data() + pos_, n);
+    pos_ += n;
+    return n;
+  }
+  size_t write(const uint8_t *buf, size_t n) {
+    if (!data_) return 0;
+    data_->replace(pos_, n, reinterpret_cast<const char *>(buf), n);
+    pos_ += n;
+    return n;
+  }
+  void close() { data_ = nullptr; }
+
+ private:
+  std::string *data_ = nullptr;
+  size_t pos_ = 0;
+};
+
+class LittleFSFS {
+ public:
+  bool begin(bool = false) { return true; }
+  bool exists(const char *path) { return files().count(path) != 0; }
+  bool remove(const char *path) { return files().erase(path) > 0; }
+  File open(const char *path, const char *mode) {
+    if (mode[0] == 'r' && !exists(path)) return File();
+    std::string &f = files()[path];
+    if (mode[0] == 'w') f.clear();
+    return File(&f, mode[0] == 'a');
+  }
+
+ private:
+  static std::map<std::string, std::string> &files() {
+    static std::map<std::string, std::string> f;
+    return f;
+  }
+};
+
+static LittleFSFS LittleFS;
@@ -0,0 +1,49 @@
+// Preferences.h — host (native env) stand-in: NVS as an in-memory map that
+// lasts for the process, shared by every namespace.
+#pragma once
+
+#include <Arduino.h>
+
+#include <map>
+#include <string>
+
+class Preferences {
+ public:
+  bool begin(const char *ns, bool = false) { ns_ = ns; return true; }
+  void end() {}
+  uint8_t getUChar(const char *key, uint8_t def = 0) {
+    const std::string *v = find(key);
+    return v ? static_cast<uint8_t>(atoi(v->c_str())) : def;
+  }
+  size_t putUChar(const char *key, uint8_t v) { store()[ns_ + "/" + key] = std::to_string(v); return 1; }
+  size_t getString(const char *key, char *out, size_t max) {
+    const std::string *v = find(key);
+    if (!v || v->size() + 1 > max) return 0;
+    memcpy(out, v->c_str(), v->size() + 1);
+    return v->size() + 1;
+  }
+  size_t putString(const char *key, const char *v) { store()[ns_ + "/" + key] = v; return strlen(v); }
+  size_t getBytes(const char *key, void *out, size_t max) {
+    const std::string *v = find(key);
+    if (!v || v->size() > max) return 0;
+    memcpy(out, v->data(), v->size());
+    return v->size();
+  }
+  size_t putBytes(const char *key, const void *v, size_t n) {
+    store()[ns_ + "/" + key] = std::string(static_cast<const char *>(v), n);
+    return n;
+  }
+  bool remove(const char *key) { return store().erase(ns_ + "/" + key) > 0; }
+
+ private:
+  static std::map<std::string, std::string> &store() {
+    static std::map<std::string, std::string> s;
+    return s;
+  }
+  const std::string *find(const char *key) {
+    auto it = store().find(ns_ + "/" + key);
+    return it == store().end() ? nullptr : &it->second;
+  }
+
+  std::string ns_;
+};
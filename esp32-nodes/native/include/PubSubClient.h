@@ -0,0 +1,79 @@
+// PubSubClient.h — host (native env) stand-in for knolleary/PubSubClient.
+//
+// publish() keeps the last message and its topic in fixed buffers (no allocation) and
+// counts messages and bytes; inject() delivers a message to the callback as
+// if it had arrived from the broker.
+#pragma once
+
+#include <functional>
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+#define MQTT_MAX_PACKET_SIZE 256
+#define MQTT_CALLBACK_SIGNATURE std::function<void(char *, uint8_t *, unsigned int)> callback
+
+class PubSubClient {
+ public:
+  PubSubClient() {}
+  explicit PubSubClient(Client &) {}
+
+  PubSubClient &setServer(const char *, uint16_t) { return *this; }
+  PubSubClient &setClient(Client &) { return *this; }
+  PubSubClient &setCallback(MQTT_CALLBACK_SIGNATURE) { callback_ = callback; return *this; }
+  PubSubClient &setKeepAlive(uint16_t) { return *this; }
+  PubSubClient &setSocketTimeout(uint16_t) { return *this; }
+  bool setBufferSize(uint16_t size) { buffer_size_ = size; return true; }
+  uint16_t getBufferSize() const { return buffer_size_; }
+
+  bool connect(const char *) { return connected_ = true; }
+  bool connect(const char *, const char *, const char *) { return connected_ = true; }
+  bool connect(const char *, const char *, uint8_t, bool, const char *) { return connected_ = true; }
+  bool connect(const char *, const char *, const char *, const char *, uint8_t, bool, const char *,
+               bool = true) { return connected_ = true; }
+  void disconnect() { connected_ = false; }
+  bool connected() const { return connected_; }
+  int state() const { return connected_ ? 0 : -1; }
+  bool loop() { return connected_; }
+
+  bool subscribe(const char *, uint8_t = 0) { return true; }
+  bool unsubscribe(const char *) { return true; }
+
+  bool publish(const char *topic, const char *payload) {
+    return publish(topic, reinterpret_cast<const uint8_t *>(payload), strlen(payload), false);
+  }
+  bool publish(const char *topic, const char *payload, bool retained) {
+    return publish(topic, reinterpret_cast<const uint8_t *>(payload), strlen(payload), retained);
+  }
+  bool publish(const char *topic, const uint8_t *payload, unsigned int len) {
+    return publish(topic, payload, len, false);
+  }
+  bool publish(const char *topic, const uint8_t *payload, unsigned int len, bool retained) {
+    if (5 + 2 + strlen(topic) + len > buffer_size_) return false;   // as the real client
+    ++published;
+    published_bytes += len;
+    last_len = len < sizeof(last) ? len : sizeof(last) - 1;
+    memcpy(last, payload, last_len);
+    last[last_len] = 0;
+    last_retained = retained;
+    strncpy(last_topic, topic, sizeof(last_topic) - 1);
+    last_topic[sizeof(last_topic) - 1] = 0;
+    return true;
+  }
+
+  // native only
+  void inject(char *topic, uint8_t *payload, unsigned int len) {
+    if (callback_) callback_(topic, payload, len);
+  }
+  unsigned long published = 0;
+  unsigned long published_bytes = 0;
+  char last[1024];
+  char last_topic[128] = {};
+  size_t last_len = 0;
+  bool last_retained = false;
+
+ private:
+  std::function<void(char *, uint8_t *, unsigned int)> callback_;
+  uint16_t buffer_size_ = MQTT_MAX_PACKET_SIZE;
+  bool connected_ = true;
+};
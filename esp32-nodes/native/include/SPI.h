@@ -0,0 +1,5 @@
+// SPI.h — host (native env) stand-in; present only because display headers
+// include it.
+#pragma once
+
+#include <Arduino.h>
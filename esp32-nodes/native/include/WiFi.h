@@ -0,0 +1,92 @@
+// WiFi.h — host (native env) stand-in: a station that is always associated.
+#pragma once
+
+#include <Arduino.h>
+
+typedef enum {
+  WL_IDLE_STATUS = 0, WL_NO_SSID_AVAIL = 1, WL_SCAN_COMPLETED = 2, WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4, WL_CONNECTION_LOST = 5, WL_DISCONNECTED = 6,
+} wl_status_t;
+
+typedef enum { WIFI_OFF = 0, WIFI_STA = 1, WIFI_AP = 2, WIFI_AP_STA = 3 } wifi_mode_t;
+
+class IPAddress {
+ public:
+  IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : b_{a, b, c, d} {}
+  uint8_t operator[](int i) const { return b_[i]; }
+  operator uint32_t() const {   // network byte order, as on the ESP32
+    uint32_t v;
+    memcpy(&v, b_, sizeof(v));
+    return v;
+  }
+  bool fromString(const char *s) {
+    unsigned a, b, c, d;
+    char end;
+    if (sscanf(s, "%u.%u.%u.%u%c", &a, &b, &c, &d, &end) != 4 || a > 255 || b > 255 || c > 255 ||
+        d > 255) {
+      return false;
+    }
+    *this = IPAddress(a, b, c, d);
+    return true;
+  }
+  String toString() const {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u", b_[0], b_[1], b_[2], b_[3]);
+    return String(buf);
+  }
+
+ private:
+  uint8_t b_[4];
+};
+
+class Client : public Print {
+ public:
+  virtual int connected() = 0;
+  virtual int available() = 0;
+  virtual void stop() = 0;
+};
+
+class WiFiClient : public Client {
+ public:
+  int connected() override { return 1; }
+  int available() override { return 0; }
+  void stop() override {}
+  int read(uint8_t *, size_t) { return -1; }
+  size_t write(uint8_t) override { return 1; }
+  using Print::write;
+  int fd() const { return -1; }   // no socket: wr::link().wait() falls back to delay()
+};
+
+class WiFiClass {
+ public:
+  wl_status_t begin(const char *, const char *) { status_ = WL_CONNECTED; return status_; }
+  wl_status_t begin(const char *ssid, const char *pass, int32_t, const uint8_t * = nullptr,
+                    bool = true) {
+    return begin(ssid, pass);
+  }
+  bool config(IPAddress, IPAddress, IPAddress, IPAddress = IPAddress(), IPAddress = IPAddress()) {
+    return true;
+  }
+  bool disconnect(bool = false, bool = false) { return true; }
+  wl_status_t status() const { return status_; }
+  bool mode(wifi_mode_t) { return true; }
+  bool setSleep(bool) { return true; }
+  bool setAutoReconnect(bool) { return true; }
+  bool setHostname(const char *) { return true; }
+  IPAddress localIP() const { return IPAddress(192, 168, 4, 100); }
+  IPAddress gatewayIP() const { return IPAddress(192, 168, 4, 1); }
+  IPAddress subnetMask() const { return IPAddress(255, 255, 255, 0); }
+  IPAddress dnsIP(uint8_t = 0) const { return IPAddress(192, 168, 4, 1); }
+  uint8_t *BSSID() { return bssid_; }
+  int32_t channel() const { return 6; }
+  int8_t RSSI() const { return -55; }
+  String macAddress() const { return String("A1:B2:C3:D4:E5:F6"); }
+  int hostByName(const char *host, IPAddress &ip) { return ip.fromString(host); }
+
+  void setStatus(wl_status_t s) { status_ = s; }   // native only
+
+ private:
+  wl_status_t status_ = WL_CONNECTED;
+  uint8_t bssid_[6] = {0x02, 0x57, 0x52, 0x00, 0x00, 0x01};
+};
+extern WiFiClass WiFi;
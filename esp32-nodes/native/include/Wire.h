@@ -0,0 +1,18 @@
+// Wire.h — host (native env) stand-in: an I2C bus where every device ACKs.
+#pragma once
+
+#include <Arduino.h>
+
+class TwoWire {
+ public:
+  bool begin() { return true; }
+  bool begin(int, int, uint32_t = 0) { return true; }
+  bool setClock(uint32_t) { return true; }
+  void beginTransmission(uint8_t) {}
+  size_t write(uint8_t) { ++bytes; return 1; }
+  size_t write(const uint8_t *, size_t n) { bytes += n; return n; }
+  uint8_t endTransmission(bool = true) { return 0; }
+
+  unsigned long bytes = 0;   // native only: data bytes written
+};
+extern TwoWire Wire;
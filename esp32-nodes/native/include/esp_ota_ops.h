@@ -0,0 +1,20 @@
+// esp_ota_ops.h — host (native env) stand-in: no OTA slots, every call fails.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <esp_err.h>
+#include <esp_partition.h>
+
+typedef uint32_t esp_ota_handle_t;
+
+#define OTA_SIZE_UNKNOWN 0xffffffff
+
+inline const esp_partition_t *esp_ota_get_running_partition() { return nullptr; }
+inline const esp_partition_t *esp_ota_get_next_update_partition(const esp_partition_t *) { return nullptr; }
+inline esp_err_t esp_ota_begin(const esp_partition_t *, size_t, esp_ota_handle_t *) { return ESP_FAIL; }
+inline esp_err_t esp_ota_write(esp_ota_handle_t, const void *, size_t) { return ESP_FAIL; }
+inline esp_err_t esp_ota_end(esp_ota_handle_t) { return ESP_FAIL; }
+inline esp_err_t esp_ota_set_boot_partition(const esp_partition_t *) { return ESP_FAIL; }
+inline esp_err_t esp_ota_mark_app_valid_cancel_rollback() { return ESP_OK; }
@@ -0,0 +1,26 @@
+// esp_partition.h — host (native env) stand-in: there is no flash, so no
+// partition is ever found and every read fails.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <esp_err.h>
+
+typedef enum { ESP_PARTITION_TYPE_APP = 0x00, ESP_PARTITION_TYPE_DATA = 0x01 } esp_partition_type_t;
+typedef enum { ESP_PARTITION_SUBTYPE_ANY = 0xff } esp_partition_subtype_t;
+
+typedef struct {
+  esp_partition_type_t type;
+  esp_partition_subtype_t subtype;
+  uint32_t address;
+  uint32_t size;
+  char label[17];
+  bool encrypted;
+} esp_partition_t;
+
+inline const esp_partition_t *esp_partition_find_first(esp_partition_type_t, esp_partition_subtype_t,
+                                                       const char *) {
+  return nullptr;
+}
+inline esp_err_t esp_partition_read(const esp_partition_t *, size_t, void *, size_t) { return ESP_FAIL; }
@@ -0,0 +1,7 @@
+// esp_timer.h — host (native env) stand-in: the 64-bit µs clock, on the same
+// virtual time as micros().
+#pragma once
+
+#include <Arduino.h>
+
+int64_t esp_timer_get_time();
@@ -0,0 +1,9 @@
+// lwip/sockets.h — host (native env) stand-in: the POSIX socket and select() API.
+#pragma once
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
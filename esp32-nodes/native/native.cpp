@@ -0,0 +1,60 @@
+// native.cpp — definitions behind the native env's Arduino/ESP32 stand-ins
+// (native/include). Linked into host builds only.
+#include <Arduino.h>
+#include <PubSubClient.h>
+#include <WiFi.h>
+#include <Wire.h>
+#include <esp_timer.h>
+
+#include <chrono>
+#include <random>
+
+namespace {
+unsigned long long now_us = 0;
+bool serial_echo = false;
+std::minstd_rand rng(1);
+}  // namespace
+
+namespace native {
+void advanceMicros(unsigned long us) { now_us += us; }
+void setSerialEcho(bool on) { serial_echo = on; }
+}  // namespace native
+
+unsigned long millis() { return static_cast<unsigned long>(now_us / 1000); }
+unsigned long micros() { return static_cast<unsigned long>(now_us); }
+void delay(unsigned long ms) { now_us += ms * 1000ULL; }
+int64_t esp_timer_get_time() { return static_cast<int64_t>(now_us); }
+
+long random(long max) { return max > 0 ? static_cast<long>(rng() % static_cast<unsigned long>(max)) : 0; }
+long random(long min, long max) { return max > min ? min + random(max - min) : min; }
+void randomSeed(unsigned long seed) { rng.seed(static_cast<std::minstd_rand::result_type>(seed ? seed : 1)); }
+
+size_t HardwareSerial::write(uint8_t c) {
+  if (serial_echo) fputc(c, stdout);
+  return 1;
+}
+
+uint32_t EspClass::getCycleCount() {
+  using namespace std::chrono;
+  const auto ns = duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+  return static_cast<uint32_t>(ns * 240 / 1000);
+}
+
+void configTime(long, int, const char *, const char *, const char *) {}
+
+// Wall clock = 12:00:00 at boot plus virtual uptime.
+bool getLocalTime(struct tm *info, uint32_t) {
+  const unsigned long secs = 12 * 3600UL + millis() / 1000;
+  memset(info, 0, sizeof(*info));
+  info->tm_hour = static_cast<int>(secs / 3600 % 24);
+  info->tm_min = static_cast<int>(secs / 60 % 60);
+  info->tm_sec = static_cast<int>(secs % 60);
+  info->tm_year = 126;
+  info->tm_mday = 1;
+  return true;
+}
+
+HardwareSerial Serial;
+EspClass ESP;
+WiFiClass WiFi;
+TwoWire Wire;
@@ -0,0 +1,112 @@
+// cooling.cpp — CRAC/CRAH fan bank, 480 V. One image for cooling_a and _b;
+// id and OLED label come from NVS at boot (wr_identity.h), or from
+// build_flags ('-DWR_NODE_ID="cooling_a"' '-DWR_NODE_LABEL="cool_a"').
+// Simulates 55 fans. Side A + Side B → 110 fans total feeding the thermal model.
+// States: NORMAL, DEGRADED, FAULT, OFF
+#include <winter_river.h>
+#include <wr_node.h>
+#include <wr_state.h>
+#include <wr_stats.h>
+#include <wr_tokens.h>
+
+#ifndef WR_NODE_ID
+#define WR_NODE_ID nullptr   // fleet image: identity from NVS (wr_identity.h)
+#endif
+
+static constexpr int VOLTAGE_RATING = 480;
+static constexpr int FAN_COUNT      = 55;   // physical fans modeled by this node
+
+static float  input_v        = 480.0f;
+static int    coolant_temp_f = 65;
+static int    fan_speed_pct  = 60;
+static int    fans_running   = FAN_COUNT;
+static int    load_pct       = 60;
+static wr::State state       = wr::State::NORMAL;
+
+// Sampled at WR_STATS_HZ between publishes (wr_stats.h).
+static wr::Stat coolant_stat;
+static wr::Stat fan_stat;
+
+static void recomputeFanState() {
+  if (fans_running < 0)             fans_running = 0;
+  if (fans_running > FAN_COUNT)     fans_running = FAN_COUNT;
+
+  // Fan-bank degradation overrides input-derived state but never improves it.
+  if (input_v < 48.0f) {
+    state = wr::State::OFF;
+  } else if (fans_running == 0) {
+    state = wr::State::FAULT;
+  } else if (fans_running < (FAN_COUNT * 8) / 10) {   // <80 % running
+    if (state != wr::State::FAULT) state = wr::State::DEGRADED;
+  }
+}
+
+struct Cooling : wr::NodeTraits {
+  static const char *id()    { return WR_NODE_ID; }
+  static const char *label() { return WR_NODE_LABEL; }
+  static constexpr const wr::schema::Schema &schema() { return wr::schema::COOLING; }
+
+  static constexpr wr::NodeField FIELDS[] = {
+    wr::NodeField("input_v",        input_v).show("Vin: ", "V"),
+    wr::NodeField("coolant_temp_f", coolant_temp_f).stats(coolant_stat).show("CoolT:", "F"),
+    wr::NodeField("fan_speed_pct",  fan_speed_pct).control("SPEED").stats(fan_stat)
+                                                  .show(" Spd:", "%").sameLine(),
+    wr::NodeField("fan_count",      FAN_COUNT).show("Fans:"),
+    wr::NodeField("fans_running",   fans_running).show(" run:").sameLine(),
+    wr::NodeField("load_pct",       load_pct),
+    wr::NodeField("state",          state),
+    wr::NodeField("voltage",        VOLTAGE_RATING),
+  };
+
+  static bool control(const wr::Token &tok) {
+    switch (tok.hash) {
+      case wr::kw("INPUT"):
+        if (!tok.keyIs("INPUT")) return false;
+        input_v = tok.toFloat();
+        if (input_v < 48.0f)         state = wr::State::OFF;
+        else if (state == wr::State::OFF)     state = wr::State::NORMAL;
+        return true;
+      case wr::kw("TEMP"):
+        if (!tok.keyIs("TEMP")) return false;
+        coolant_temp_f = tok.toInt();
+        if (coolant_temp_f > 80)       state = wr::State::FAULT;
+        else if (coolant_temp_f > 72)  state = wr::State::DEGRADED;
+        return true;
+      case wr::kw("FANS_RUNNING"):
+        if (!tok.keyIs("FANS_RUNNING")) return false;
+        fans_running = tok.toInt();
+        recomputeFanState();
+        return true;
+      case wr::kw("STATUS"):
+        if (!tok.keyIs("STATUS")) return false;
+        wr::parseState(tok, state);
+        if (state == wr::State::FAULT) fans_running = 0;
+        if (state == wr::State::OFF)   input_v = 0.0f;
+        return true;
+    }
+    return false;
+  }
+
+  static void afterControl() {
+    load_pct = fan_speed_pct;
+    recomputeFanState();
+  }
+
+  // WR_PEER_FAST_PATH: the fans stop with the LV bus and restart with it.
+  static void upstream(const wr::Peers &p) {
+    if (!p.known(0)) return;
+    if (p.live(0)) {
+      input_v = VOLTAGE_RATING;
+      if (state == wr::State::OFF) state = wr::State::NORMAL;
+    } else {
+      input_v = 0.0f;
+      state = wr::State::OFF;
+    }
+  }
+};
+constexpr wr::NodeField Cooling::FIELDS[];
+
+typedef wr::Node<Cooling> CoolingNode;
+
+void setup() { CoolingNode::start(); }
+void loop()  { wr::runNode(); }
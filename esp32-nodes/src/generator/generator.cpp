@@ -0,0 +1,64 @@
+// generator.cpp — 480 V diesel standby generator. One image for generator_a
+// and _b; id and OLED label come from NVS at boot (wr_identity.h), or from
+// build_flags ('-DWR_NODE_ID="generator_a"' '-DWR_NODE_LABEL="gen_a"').
+// States: STANDBY, STARTING, RUNNING, FAULT
+#include <winter_river.h>
+#include <wr_node.h>
+#include <wr_state.h>
+#include <wr_stats.h>
+#include <wr_tokens.h>
+
+#ifndef WR_NODE_ID
+#define WR_NODE_ID nullptr   // fleet image: identity from NVS (wr_identity.h)
+#endif
+
+static constexpr int VOLTAGE_RATING = 480;
+
+static int    fuel_pct = 85;
+static int    rpm      = 0;
+static float  output_v = 0.0f;
+static int    load_pct = 0;
+static wr::State state = wr::State::STANDBY;
+
+// Sampled at WR_STATS_HZ between publishes (wr_stats.h).
+static wr::Stat rpm_stat;
+static wr::Stat load_stat;
+
+static void deriveStateFromRPM() {
+  if (rpm > 1500)    { state = wr::State::RUNNING;  output_v = VOLTAGE_RATING; }
+  else if (rpm > 0)  { state = wr::State::STARTING; output_v = 0.0f; }
+  else               { state = wr::State::STANDBY;  output_v = 0.0f; }
+}
+
+static void applyFaultGuard() {
+  if (fuel_pct < 5 || (state == wr::State::RUNNING && rpm < 800)) state = wr::State::FAULT;
+}
+
+struct Generator : wr::NodeTraits {
+  static const char *id()    { return WR_NODE_ID; }
+  static const char *label() { return WR_NODE_LABEL; }
+  static constexpr const wr::schema::Schema &schema() { return wr::schema::GENERATOR; }
+
+  static constexpr wr::NodeField FIELDS[] = {
+    wr::NodeField("fuel_pct", fuel_pct).control("FUEL").show("Fuel: ", "%"),
+    wr::NodeField("rpm",      rpm).stats(rpm_stat).show("RPM:  "),
+    wr::NodeField("output_v", output_v).show("Vout: ", "V"),
+    wr::NodeField("load_pct", load_pct).control("LOAD").stats(load_stat),
+    wr::NodeField("state",    state).control("STATUS"),
+    wr::NodeField("voltage",  VOLTAGE_RATING),
+  };
+
+  static bool control(const wr::Token &tok) {
+    if (tok.hash != wr::kw("RPM") || !tok.keyIs("RPM")) return false;
+    rpm = tok.toInt();
+    deriveStateFromRPM();
+    return true;
+  }
+  static void afterControl() { applyFaultGuard(); }
+};
+constexpr wr::NodeField Generator::FIELDS[];
+
+typedef wr::Node<Generator> GeneratorNode;
+
+void setup() { GeneratorNode::start(); }
+void loop()  { wr::runNode(); }
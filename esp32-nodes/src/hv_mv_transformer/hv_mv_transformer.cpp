@@ -0,0 +1,70 @@
+// hv_mv_transformer.cpp — 230 kV → 34.5 kV step-down transformer. One image
+// for hv_mv_transformer_a and _b; id and OLED label come from NVS at boot
+// (wr_identity.h), or from build_flags
+// ('-DWR_NODE_ID="hv_mv_transformer_a"' '-DWR_NODE_LABEL="hv_trf_a"').
+// First on-site equipment in its side's power chain. Fed directly from
+// utility_<side>; its 34.5 kV output feeds mv_switchgear_<side>.
+// States: NORMAL, WARNING, FAULT.
+#include <winter_river.h>
+#include <wr_node.h>
+#include <wr_state.h>
+#include <wr_stats.h>
+#include <wr_tokens.h>
+
+#ifndef WR_NODE_ID
+#define WR_NODE_ID nullptr   // fleet image: identity from NVS (wr_identity.h)
+#endif
+
+static constexpr int   OUTPUT_KV       = 35;       // 34.5 kV (nominal MV bus)
+static constexpr int   OUTPUT_V        = OUTPUT_KV * 1000;
+static constexpr float INPUT_KV_NOM    = 230.0f;   // 230 kV utility input
+static constexpr int   CAPACITY_MVA    = 50;       // 50 MVA nameplate
+
+static int    load_pct  = 35;
+static float  power_mva = 17.5f;
+static int    temp_f    = 105;
+static float  input_kv  = INPUT_KV_NOM;
+static wr::State state  = wr::State::NORMAL;
+
+// Sampled at WR_STATS_HZ between publishes (wr_stats.h).
+static wr::Stat load_stat;
+static wr::Stat temp_stat;
+
+static void applyGuard() {
+  if (load_pct > 95 || temp_f > 200 || input_kv < 100.0f) state = wr::State::FAULT;
+  else if (load_pct > 80 || temp_f > 160)                 state = wr::State::WARNING;
+}
+
+struct HvMvTransformer : wr::NodeTraits {
+  static const char *id()    { return WR_NODE_ID; }
+  static const char *label() { return WR_NODE_LABEL; }
+  static constexpr const wr::schema::Schema &schema() { return wr::schema::HV_MV_TRANSFORMER; }
+
+  static constexpr wr::NodeField FIELDS[] = {
+    wr::NodeField("input_kv",  input_kv).control("INPUT_KV").show("In: ", "kV"),
+    wr::NodeField("output_kv", OUTPUT_KV).show("Out: ", "kV"),
+    wr::NodeField("load_pct",  load_pct).control("LOAD").stats(load_stat).show("  L:", "%").sameLine(),
+    wr::NodeField("power_mva", power_mva),
+    wr::NodeField("temp_f",    temp_f).control("TEMP").stats(temp_stat).show("Temp: ", "F"),
+    wr::NodeField("state",     state).control("STATUS"),
+    wr::NodeField("voltage",   OUTPUT_V),
+  };
+
+  static void afterControl() {
+    power_mva = (load_pct / 100.0f) * CAPACITY_MVA;
+    applyGuard();
+  }
+
+  // WR_PEER_FAST_PATH: follow the feed; a FAULT stays for the broker to clear.
+  static void upstream(const wr::Peers &p) {
+    if (!p.known(0) || state == wr::State::FAULT) return;
+    if (!p.live(0))                          state = wr::State::NO_INPUT;
+    else if (state == wr::State::NO_INPUT)   state = wr::State::NORMAL;
+  }
+};
+constexpr wr::NodeField HvMvTransformer::FIELDS[];
+
+typedef wr::Node<HvMvTransformer> HvMvTransformerNode;
+
+void setup() { HvMvTransformerNode::start(); }
+void loop()  { wr::runNode(); }
@@ -0,0 +1,98 @@
+// lv_switchgear.cpp — LV switchgear, 480 V LV transfer point. One image for
+// lv_switchgear_a and _b; id and OLED label come from NVS at boot
+// (wr_identity.h), or from build_flags
+// ('-DWR_NODE_ID="lv_switchgear_a"' '-DWR_NODE_LABEL="lv_sw_a"').
+// Operates on the 480 V LV bus, downstream of mv_lv_transformer_<side>. This is
+// the utility↔generator transfer point (it absorbed the former ATS role): the
+// broker closes it onto the MV/LV-transformer path or the generator, and its
+// output energises ups_<side> + cooling_<side> in parallel.
+// States: CLOSED (utility path), GENERATOR (on backup), NO_INPUT (both sources
+// dead), OPEN (operator), TRIPPED, FAULT. The broker owns the STATUS string;
+// this firmware just renders it.
+#include <winter_river.h>
+#include <wr_node.h>
+#include <wr_state.h>
+#include <wr_stats.h>
+#include <wr_tokens.h>
+
+#ifndef WR_NODE_ID
+#define WR_NODE_ID nullptr   // fleet image: identity from NVS (wr_identity.h)
+#endif
+
+static constexpr int VOLTAGE_RATING = 480;      // 480 V LV bus
+
+static bool   breaker_closed = true;
+static float  current_a      = 625.0f;    // ~300 kW / 480 V (illustrative)
+static float  load_kw        = 300.0f;
+static int    load_pct       = 30;
+static wr::State state       = wr::State::CLOSED;
+
+// Sampled at WR_STATS_HZ between publishes (wr_stats.h).
+static wr::Stat load_stat;
+
+static void applyGuard() {
+  if (current_a > 2000.0f || load_pct > 95) {
+    state = wr::State::TRIPPED;
+    breaker_closed = false;
+  } else if (current_a > 1670.0f || load_pct > 80) {
+    state = wr::State::FAULT;
+  }
+}
+
+struct LvSwitchgear : wr::NodeTraits {
+  static const char *id()    { return WR_NODE_ID; }
+  static const char *label() { return WR_NODE_LABEL; }
+  static constexpr const wr::schema::Schema &schema() { return wr::schema::LV_SWITCHGEAR; }
+
+  static constexpr wr::NodeField FIELDS[] = {
+    wr::NodeField("breaker",   breaker_closed),
+    wr::NodeField("current_a", current_a).show("Current: ", "A"),
+    wr::NodeField("load_kw",   load_kw),
+    wr::NodeField("load_pct",  load_pct).control("LOAD").stats(load_stat).show("Load:    ", "%"),
+    wr::NodeField("state",     state).control("STATUS"),
+    wr::NodeField("voltage",   VOLTAGE_RATING).show("Vout: ", "V"),
+  };
+
+  static bool control(const wr::Token &tok) {
+    switch (tok.hash) {
+      case wr::kw("CLOSE"):
+        if (!tok.keyIs("CLOSE")) return false;
+        breaker_closed = true;
+        state = wr::State::CLOSED;
+        return true;
+      case wr::kw("OPEN"):
+        if (!tok.keyIs("OPEN")) return false;
+        breaker_closed = false;
+        state = wr::State::OPEN;
+        return true;
+    }
+    return false;
+  }
+
+  static void afterControl() {
+    // 100% ≈ 1000 kW at 480 V (1000 kVA transformer envelope)
+    load_kw   = load_pct * 10.0f;
+    current_a = (load_kw * 1000.0f) / VOLTAGE_RATING;
+    applyGuard();
+  }
+
+  // WR_PEER_FAST_PATH: the transfer itself. Utility path first, then the
+  // generator (SECONDARY); OPEN / TRIPPED / FAULT are sticky.
+  static void upstream(const wr::Peers &p) {
+    if (!(p.known(0) || p.known(1)) || sticky()) return;
+    breaker_closed = p.live(0) || p.live(1);
+    state = p.live(0) ? wr::State::CLOSED
+          : p.live(1) ? wr::State::GENERATOR
+          : wr::State::NO_INPUT;
+  }
+
+  static bool sticky() {
+    return state == wr::State::OPEN || state == wr::State::TRIPPED || state == wr::State::FAULT;
+  }
+};
+constexpr wr::NodeField LvSwitchgear::FIELDS[];
+
+typedef wr::Node<LvSwitchgear> LvSwitchgearNode;
+
+void setup() { LvSwitchgearNode::start(); }
+void loop()  { wr::runNode(); }
@@ -0,0 +1,63 @@
+// mv_lv_transformer.cpp — 34.5 kV → 480 V transformer, 1000 kVA. One image
+// for mv_lv_transformer_a and _b; id and OLED label come from NVS at boot
+// (wr_identity.h), or from build_flags
+// ('-DWR_NODE_ID="mv_lv_transformer_a"' '-DWR_NODE_LABEL="mv_trf_a"').
+// States: NORMAL, WARNING, FAULT
+#include <winter_river.h>
+#include <wr_node.h>
+#include <wr_state.h>
+#include <wr_stats.h>
+#include <wr_tokens.h>
+
+#ifndef WR_NODE_ID
+#define WR_NODE_ID nullptr   // fleet image: identity from NVS (wr_identity.h)
+#endif
+
+static constexpr int VOLTAGE_RATING = 480;
+static constexpr int CAPACITY_KVA   = 1000;
+
+static int    load_pct  = 45;
+static float  power_kva = 450.0f;
+static int    temp_f    = 112;
+static wr::State state  = wr::State::NORMAL;
+
+// Sampled at WR_STATS_HZ between publishes (wr_stats.h).
+static wr::Stat load_stat;
+static wr::Stat temp_stat;
+
+static void applyGuard() {
+  if (load_pct > 90 || temp_f > 185)      state = wr::State::FAULT;
+  else if (load_pct > 75 || temp_f > 149) state = wr::State::WARNING;
+}
+
+struct MvLvTransformer : wr::NodeTraits {
+  static const char *id()    { return WR_NODE_ID; }
+  static const char *label() { return WR_NODE_LABEL; }
+  static constexpr const wr::schema::Schema &schema() { return wr::schema::MV_LV_TRANSFORMER; }
+
+  static constexpr wr::NodeField FIELDS[] = {
+    wr::NodeField("load_pct",  load_pct).control("LOAD").stats(load_stat).show("Load: ", "%"),
+    wr::NodeField("power_kva", power_kva).show(" (", "kVA)").sameLine(),
+    wr::NodeField("temp_f",    temp_f).control("TEMP").stats(temp_stat).show("Temp: ", " F"),
+    wr::NodeField("state",     state).control("STATUS"),
+    wr::NodeField("voltage",   VOLTAGE_RATING).show("", "V out"),
+  };
+
+  static void afterControl() {
+    power_kva = (load_pct / 100.0f) * CAPACITY_KVA;
+    applyGuard();
+  }
+
+  // WR_PEER_FAST_PATH: follow the feed; a FAULT stays for the broker to clear.
+  static void upstream(const wr::Peers &p) {
+    if (!p.known(0) || state == wr::State::FAULT) return;
+    if (!p.live(0))                          state = wr::State::NO_INPUT;
+    else if (state == wr::State::NO_INPUT)   state = wr::State::NORMAL;
+  }
+};
+constexpr wr::NodeField MvLvTransformer::FIELDS[];
+
+typedef wr::Node<MvLvTransformer> MvLvTransformerNode;
+
+void setup() { MvLvTransformerNode::start(); }
+void loop()  { wr::runNode(); }
@@ -0,0 +1,92 @@
+// mv_switchgear.cpp — MV switchgear. One image for mv_switchgear_a and _b;
+// id and OLED label come from NVS at boot (wr_identity.h), or from
+// build_flags ('-DWR_NODE_ID="mv_switchgear_a"' '-DWR_NODE_LABEL="mv_sw_a"').
+// Operates on the 34.5 kV MV bus, downstream of hv_mv_transformer_<side>; its
+// output feeds mv_lv_transformer_<side>.
+// States: CLOSED, NO_INPUT (unfed — clears when re-energised), OPEN
+// (operator), TRIPPED, FAULT. The broker owns the STATUS string.
+#include <winter_river.h>
+#include <wr_node.h>
+#include <wr_state.h>
+#include <wr_stats.h>
+#include <wr_tokens.h>
+
+#ifndef WR_NODE_ID
+#define WR_NODE_ID nullptr   // fleet image: identity from NVS (wr_identity.h)
+#endif
+
+static constexpr int VOLTAGE_RATING = 34500;    // 34.5 kV MV bus
+
+static bool   breaker_closed = true;
+static float  current_a      = 116.0f;    // ~4 MW / 34.5 kV (illustrative)
+static float  load_kw        = 4000.0f;
+static int    load_pct       = 25;
+static wr::State state       = wr::State::CLOSED;
+
+// Sampled at WR_STATS_HZ between publishes (wr_stats.h).
+static wr::Stat load_stat;
+
+static void applyGuard() {
+  if (current_a > 1400.0f || load_pct > 95) {
+    state = wr::State::TRIPPED;
+    breaker_closed = false;
+  } else if (current_a > 1150.0f || load_pct > 80) {
+    state = wr::State::FAULT;
+  }
+}
+
+struct MvSwitchgear : wr::NodeTraits {
+  static const char *id()    { return WR_NODE_ID; }
+  static const char *label() { return WR_NODE_LABEL; }
+  static constexpr const wr::schema::Schema &schema() { return wr::schema::MV_SWITCHGEAR; }
+
+  static constexpr wr::NodeField FIELDS[] = {
+    wr::NodeField("breaker",   breaker_closed),
+    wr::NodeField("current_a", current_a).show("Current: ", "A"),
+    wr::NodeField("load_kw",   load_kw),
+    wr::NodeField("load_pct",  load_pct).control("LOAD").stats(load_stat).show("Load:    ", "%"),
+    wr::NodeField("state",     state).control("STATUS"),
+    wr::NodeField("voltage",   VOLTAGE_RATING).show("Vout: ", "V"),
+  };
+
+  static bool control(const wr::Token &tok) {
+    switch (tok.hash) {
+      case wr::kw("CLOSE"):
+        if (!tok.keyIs("CLOSE")) return false;
+        breaker_closed = true;
+        state = wr::State::CLOSED;
+        return true;
+      case wr::kw("OPEN"):
+        if (!tok.keyIs("OPEN")) return false;
+        breaker_closed = false;
+        state = wr::State::OPEN;
+        return true;
+    }
+    return false;
+  }
+
+  static void afterControl() {
+    // 100% ≈ 16 MW at 34.5 kV (rough envelope for the simulated DC)
+    load_kw   = load_pct * 160.0f;
+    current_a = (load_kw * 1000.0f) / VOLTAGE_RATING;
+    applyGuard();
+  }
+
+  // WR_PEER_FAST_PATH: as the broker — OPEN / TRIPPED / FAULT are sticky,
+  // NO_INPUT is not.
+  static void upstream(const wr::Peers &p) {
+    if (!p.known(0) || sticky()) return;
+    breaker_closed = p.live(0);
+    state = breaker_closed ? wr::State::CLOSED : wr::State::NO_INPUT;
+  }
+
+  static bool sticky() {
+    return state == wr::State::OPEN || state == wr::State::TRIPPED || state == wr::State::FAULT;
+  }
+};
+constexpr wr::NodeField MvSwitchgear::FIELDS[];
+
+typedef wr::Node<MvSwitchgear> MvSwitchgearNode;
+
+void setup() { MvSwitchgearNode::start(); }
+void loop()  { wr::runNode(); }
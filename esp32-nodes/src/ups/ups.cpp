@@ -0,0 +1,80 @@
+// ups.cpp — 480 V UPS. One image for ups_a and ups_b; the node id comes
+// from NVS at boot (wr_identity.h), or from build_flags
+// ('-DWR_NODE_ID="ups_a"').
+// States: NORMAL, ON_BATTERY, CHARGING, FAULT
+#include <winter_river.h>
+#include <wr_node.h>
+#include <wr_state.h>
+#include <wr_stats.h>
+#include <wr_tokens.h>
+
+#ifndef WR_NODE_ID
+#define WR_NODE_ID nullptr   // fleet image: identity from NVS (wr_identity.h)
+#endif
+
+static constexpr int VOLTAGE_RATING = 480;
+
+static int    battery_pct = 100;
+static int    load_pct    = 40;
+static float  input_v     = 480.0f;
+static float  output_v    = 480.0f;
+static wr::State state    = wr::State::NORMAL;
+
+// Sampled at WR_STATS_HZ between publishes (wr_stats.h).
+static wr::Stat load_stat;
+static wr::Stat input_stat;
+
+// Set true when a control message carried an explicit STATUS: token, so the
+// broker's authoritative state is not second-guessed by the local guard below.
+// Mirrors the status_set pattern in server_rack.cpp.
+static bool status_set = false;
+
+// Standalone fallback only. When main.py is driving it sends an explicit STATUS
+// every tick (NORMAL / CHARGING / ON_BATTERY / FAULT) and that wins — otherwise a
+// low-but-charging battery (input restored, battery still <25%) would be wrongly
+// pinned to ON_BATTERY here, masking the CHARGING recovery.
+static void applyGuard() {
+  if (battery_pct < 10 || input_v < 400.0f)      state = wr::State::FAULT;
+  else if (battery_pct < 25 || input_v < 440.0f) state = wr::State::ON_BATTERY;
+}
+
+struct Ups : wr::NodeTraits {
+  static const char *id()    { return WR_NODE_ID; }
+  static const char *label() { return WR_NODE_LABEL; }
+  static constexpr const wr::schema::Schema &schema() { return wr::schema::UPS; }
+
+  static constexpr wr::NodeField FIELDS[] = {
+    wr::NodeField("battery_pct", battery_pct).control("BATT").show("Batt: ", "%"),
+    wr::NodeField("load_pct",    load_pct).control("LOAD").stats(load_stat).show("Load: ", "%"),
+    wr::NodeField("input_v",     input_v).control("INPUT").stats(input_stat).show("Vin:  ", "V"),
+    wr::NodeField("output_v",    output_v),
+    wr::NodeField("state",       state),
+    wr::NodeField("voltage",     VOLTAGE_RATING),
+  };
+
+  static bool control(const wr::Token &tok) {
+    if (tok.hash != wr::kw("STATUS") || !tok.keyIs("STATUS")) return false;
+    if (wr::parseState(tok, state)) status_set = true;
+    return true;
+  }
+  static void beforeControl() { status_set = false; }
+  static void afterControl()  { if (!status_set) applyGuard(); }
+
+  // WR_PEER_FAST_PATH: island on the battery the moment the LV bus drops.
+  static void upstream(const wr::Peers &p) {
+    if (!p.known(0)) return;
+    if (p.live(0)) {
+      input_v = VOLTAGE_RATING;
+      state = battery_pct >= 100 ? wr::State::NORMAL : wr::State::CHARGING;
+    } else {
+      input_v = 0.0f;
+      state = battery_pct > 0 ? wr::State::ON_BATTERY : wr::State::FAULT;
+    }
+  }
+};
+constexpr wr::NodeField Ups::FIELDS[];
+
+typedef wr::Node<Ups> UpsNode;
+
+void setup() { UpsNode::start(); }
+void loop()  { wr::runNode(); }
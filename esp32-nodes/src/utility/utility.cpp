@@ -0,0 +1,75 @@
+// utility.cpp — Root utility grid (230 kV / 60 Hz / 3-phase). One image for
+// utility_a and utility_b; the node id comes from NVS at boot
+// (wr_identity.h), or from build_flags ('-DWR_NODE_ID="utility_a"').
+// States: GRID_OK, SAG, SWELL, OUTAGE, FAULT
+#include <winter_river.h>
+#include <wr_node.h>
+#include <wr_state.h>
+#include <wr_stats.h>
+#include <wr_tokens.h>
+
+#ifndef WR_NODE_ID
+#define WR_NODE_ID nullptr   // fleet image: identity from NVS (wr_identity.h)
+#endif
+
+static constexpr float NOMINAL_KV = 230.0f;
+static constexpr int   PHASE_COUNT = 3;
+
+static float  voltage_kv = NOMINAL_KV;
+static float  freq_hz    = 60.0f;
+static int    load_pct   = 12;
+static wr::State state   = wr::State::GRID_OK;
+
+// Sampled at WR_STATS_HZ between publishes (wr_stats.h).
+static wr::Stat volt_stat;
+static wr::Stat freq_stat;
+
+struct Utility : wr::NodeTraits {
+  static const char *id()    { return WR_NODE_ID; }
+  static const char *label() { return WR_NODE_LABEL; }
+  static constexpr const wr::schema::Schema &schema() { return wr::schema::UTILITY; }
+
+  static constexpr wr::NodeField FIELDS[] = {
+    wr::NodeField("v_out",      voltage_kv).stats(volt_stat).show("Vout: ", "kV"),
+    wr::NodeField("freq_hz",    freq_hz).stats(freq_stat).show("Freq: ", "Hz", 2),
+    wr::NodeField("load_pct",   load_pct).control("LOAD").show("Load: ", "%"),
+    wr::NodeField("state",      state),
+    wr::NodeField("voltage_kv", voltage_kv),
+    wr::NodeField("phase",      PHASE_COUNT),
+  };
+
+  static bool control(const wr::Token &tok) {
+    switch (tok.hash) {
+      case wr::kw("STATUS"):
+        if (!tok.keyIs("STATUS")) return false;
+        wr::parseState(tok, state);
+        if      (state == wr::State::OUTAGE) voltage_kv = 0.0f;
+        else if (state == wr::State::SAG)    voltage_kv = NOMINAL_KV * 0.88f;
+        else if (state == wr::State::SWELL)  voltage_kv = NOMINAL_KV * 1.10f;
+        else                                 voltage_kv = NOMINAL_KV;
+        return true;
+      case wr::kw("VOLT"): {
+        if (!tok.keyIs("VOLT")) return false;
+        voltage_kv = tok.toFloat();
+        float ratio = voltage_kv / NOMINAL_KV;
+        if      (voltage_kv <= 0.0f) state = wr::State::OUTAGE;
+        else if (ratio < 0.90f)      state = wr::State::SAG;
+        else if (ratio > 1.10f)      state = wr::State::SWELL;
+        else                         state = wr::State::GRID_OK;
+        return true;
+      }
+      case wr::kw("FREQ"):
+        if (!tok.keyIs("FREQ")) return false;
+        freq_hz = tok.toFloat();
+        if (freq_hz < 59.3f || freq_hz > 60.7f) state = wr::State::FAULT;
+        return true;
+    }
+    return false;
+  }
+};
+constexpr wr::NodeField Utility::FIELDS[];
+
+typedef wr::Node<Utility> UtilityNode;
+
+void setup() { UtilityNode::start(); }
+void loop()  { wr::runNode(); }
@@ -1,15 +1,53 @@
 import os
 import shutil
+import subprocess
 import sys
+import tempfile
+
+import pytest
 
 REPO_ROOT  = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
 BROKER_DIR = os.path.join(REPO_ROOT, "broker")
+NODES_DIR  = os.path.join(REPO_ROOT, "esp32-nodes")
 
 sys.path.insert(0, BROKER_DIR)
 
-# broker/main.py reads broker/config.toml at import time. Tests must work in a
-# fresh checkout where config.toml hasn't been created yet, so seed it from the
-# tracked sample when missing.
-_cfg = os.path.join(BROKER_DIR, "config.toml")
-if not os.path.exists(_cfg):
-    shutil.copy(os.path.join(BROKER_DIR, "config.sample.toml"), _cfg)
+# broker/main.py reads its config at import time. Point it at a copy of the
+# tracked sample in a temporary directory, so tests work in a fresh checkout
+# and never create or read a developer's git-ignored broker/config.toml.
+_cfg_dir = tempfile.mkdtemp(prefix="winter-river-tests-")
+_cfg = os.path.join(_cfg_dir, "config.toml")
+shutil.copy(os.path.join(BROKER_DIR, "config.sample.toml"), _cfg)
+os.environ["WINTER_RIVER_CONFIG"] = _cfg
+
+
+def pytest_unconfigure(config):
+    shutil.rmtree(_cfg_dir, ignore_errors=True)
+
+
+@pytest.fixture(scope="session")
+def host_check(tmp_path_factory):
+    """Builds one of the firmware's host checks (esp32-nodes/check/*.cpp)
+    against the native env's stand-ins, with AddressSanitizer where the
+    compiler has it. Skips the test without a C++ compiler."""
+    cxx = shutil.which("g++") or shutil.which("clang++")
+    if not cxx:
+        pytest.skip("no C++ compiler")
+    built = {}
+
+    def build(name, *flags):
+        if name not in built:
+            exe = str(tmp_path_factory.mktemp(name) / name)
+            cmd = [cxx, "-std=gnu++11", "-O1", "-g", "-Wall", "-pthread", *flags,
+                   "-I" + os.path.join(NODES_DIR, "check", "include"),
+                   "-I" + os.path.join(NODES_DIR, "native", "include"),
+                   "-I" + os.path.join(NODES_DIR, "lib", "winter_river", "src"),
+                   os.path.join(NODES_DIR, "check", name + ".cpp"),
+                   os.path.join(NODES_DIR, "native", "native.cpp"), "-o", exe]
+            if subprocess.run(cmd[:1] + ["-fsanitize=address"] + cmd[1:],
+                              capture_output=True).returncode != 0:
+                subprocess.run(cmd, check=True)
+            built[name] = exe
+        return built[name]
+
+    return build
@@ -0,0 +1,121 @@
+"""Unit tests for broker/control_latency.py.
+
+The token and field names are a contract with the firmware's wr_latency.h /
+wr_telemetry.h, so the first test greps those headers for them. The rest
+drive ControlLatency with a fake clock.
+"""
+
+import os
+
+import pytest
+
+import control_latency as cl
+
+REPO_ROOT = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+
+WR_SRC = os.path.join(REPO_ROOT, "esp32-nodes", "lib", "winter_river", "src")
+
+
+class FakeClock:
+    def __init__(self, t=1000):
+        self.t = t
+
+    def __call__(self):
+        return self.t
+
+
+def _echo(seq, t, apply_us=200, age_ms=0):
+    return {"state": "NORMAL", "ctl_seq": seq, "ctl_t": t,
+            "ctl_apply_us": apply_us, "ctl_age_ms": age_ms}
+
+
+@pytest.fixture
+def clock():
+    return FakeClock()
+
+
+@pytest.fixture
+def lat(clock):
+    return cl.ControlLatency(clock=clock)
+
+
+def test_firmware_speaks_the_same_tokens_and_fields():
+    with open(os.path.join(WR_SRC, "wr_telemetry.h")) as f:
+        src = f.read()
+    assert 'kw("SEQ")' in src and 'kw("T")' in src
+    for name in ("ctl_seq", "ctl_t", "ctl_apply_us", "ctl_age_ms"):
+        assert f'"{name}"' in src
+
+
+class TestHistogram:
+    def test_empty_has_no_percentiles(self):
+        assert cl.Histogram().percentile(0.5) is None
+
+    def test_percentile_is_within_one_bucket(self):
+        h = cl.Histogram()
+        for ms in range(1, 101):
+            h.add(float(ms))
+        step = 2 ** (1 / cl.BUCKETS_PER_OCTAVE)
+        for q, true in ((0.50, 50), (0.95, 95), (0.99, 99)):
+            assert true <= h.percentile(q) < true * step
+
+    def test_out_of_range_samples_clamp_to_end_buckets(self):
+        h = cl.Histogram()
+        h.add(-3.0)
+        h.add(1e9)
+        assert h.counts[0] == 1 and h.counts[-1] == 1
+
+
+class TestControlLatency:
+    def test_stamp_appends_seq_and_send_time(self, lat, clock):
+        assert lat.stamp("ups_a", "STATUS:NORMAL") == "STATUS:NORMAL SEQ:1 T:1000"
+        clock.t = 2000
+        assert lat.stamp("ups_a", "STATUS:NORMAL") == "STATUS:NORMAL SEQ:2 T:2000"
+
+    def test_seq_counts_per_node(self, lat):
+        lat.stamp("ups_a", "STATUS:NORMAL")
+        lat.stamp("ups_a", "STATUS:NORMAL")
+        assert lat.stamp("ups_b", "CLOSE STATUS:CLOSED") == "CLOSE STATUS:CLOSED SEQ:1 T:1000"
+
+    def test_stages_split_the_round_trip(self, lat, clock):
+        lat.stamp("ups_a", "STATUS:NORMAL")
+        clock.t = 1000 + 3100          # 3.1 s after send
+        assert lat.observe("ups_a", _echo(1, 1000, apply_us=2000, age_ms=3000))
+        row = lat.report()["ups_a"]
+        assert row["n"] == 1
+        step = 2 ** (1 / cl.BUCKETS_PER_OCTAVE)
+        for stage, true in (("total", 3100), ("wait", 3000), ("apply", 2), ("transit", 98)):
+            assert true <= row[f"{stage}_p50_ms"] < true * step
+
+    def test_same_seq_is_counted_once(self, lat, clock):
+        lat.stamp("ups_a", "STATUS:NORMAL")
+        assert lat.observe("ups_a", _echo(1, 1000))
+        assert not lat.observe("ups_a", _echo(1, 1000))
+
+    def test_echo_of_unknown_or_mismatched_command_is_ignored(self, lat):
+        lat.stamp("ups_a", "STATUS:NORMAL")
+        assert not lat.observe("ups_a", _echo(7, 1000))        # never sent
+        assert not lat.observe("ups_a", _echo(1, 999))         # T does not match
+        assert not lat.observe("ups_b", _echo(1, 1000))        # sent to another node
+        assert not lat.observe("ups_a", {"state": "NORMAL"})   # no echo (old firmware)
+        assert lat.report() == {}
+
+    def test_send_clock_wrap(self, clock):
+        clock.t = cl.CLOCK_MOD - 10
+        lat = cl.ControlLatency(clock=clock)
+        lat.stamp("ups_a", "STATUS:NORMAL")
+        clock.t = 40
+        assert lat.observe("ups_a", _echo(1, cl.CLOCK_MOD - 10, apply_us=0))
+        assert 50 <= lat.report()["ups_a"]["total_p50_ms"] < 50 * 1.2
+
+    def test_history_is_bounded(self, lat):
+        for _ in range(cl.SENT_HISTORY + 1):
+            lat.stamp("ups_a", "STATUS:NORMAL")
+        assert not lat.observe("ups_a", _echo(1, 1000))
+        assert lat.observe("ups_a", _echo(cl.SENT_HISTORY + 1, 1000))
+
+    def test_report_starts_a_new_window(self, lat):
+        lat.stamp("ups_a", "STATUS:NORMAL")
+        lat.observe("ups_a", _echo(1, 1000))
+        assert "ups_a" in lat.report()
+        assert lat.report() == {}
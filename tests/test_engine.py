@@ -13,6 +13,10 @@ from unittest.mock import MagicMock
 import pytest
 
 import main as broker_main
+import telemetry_codec
+import tick_frame
+from control_latency import ControlLatency
+from link_loss import LinkLoss
 from main import GEN_STARTUP_TICKS, WinterRiverEngine
 from thermal import ThermalConfig, resolve_weather
 
@@ -409,6 +413,102 @@ class TestControlCmd:
         assert "TEMP:94.7" in out and "INPUT:480.0" in out
 
 
+# ── topology blobs (firmware peer fast path) ──────────────────────────────────
+
+class _RowsCursor:
+    def __init__(self, rows): self._rows = rows
+    def __enter__(self):  return self
+    def __exit__(self, *a): return False
+    def execute(self, sql, params=()): pass
+    def fetchall(self): return self._rows
+
+
+class TestTopology:
+    def test_blob_names_both_parents(self):
+        assert broker_main.topology_blob("mv_lv_transformer_a", "generator_a") == \
+            "PARENT:mv_lv_transformer_a SECONDARY:generator_a"
+
+    def test_blob_single_parent_and_root(self):
+        assert broker_main.topology_blob("ups_a", None) == "PARENT:ups_a"
+        assert broker_main.topology_blob(None, None) == ""
+
+    def test_load_builds_blobs_and_connect_publishes_them_retained(self, engine, monkeypatch):
+        monkeypatch.setattr(broker_main, "TICK_FRAME", True)
+        engine.db.cursor = lambda: _RowsCursor([
+            {"node_id": "utility_a", "parent_id": None, "secondary_parent_id": None},
+            {"node_id": "lv_switchgear_a", "parent_id": "mv_lv_transformer_a",
+             "secondary_parent_id": "generator_a"},
+        ])
+        assert engine._load_known_nodes() == {"utility_a", "lv_switchgear_a"}
+
+        client = MagicMock()
+        engine._on_mqtt_connect(client, None, None, 0)
+        sent = {c.args[0]: c for c in client.publish.call_args_list}
+        lv = sent["winter-river/lv_switchgear_a/topology"]
+        assert lv.args[1] == "PARENT:mv_lv_transformer_a SECONDARY:generator_a"
+        assert lv.kwargs == {"qos": 1, "retain": True}
+        assert sent["winter-river/utility_a/topology"].args[1] == ""
+        map_id = tick_frame.SlotMap({"utility_a", "lv_switchgear_a"}).map_id
+        slot = sent["winter-river/utility_a/slot"]
+        assert slot.args[1] == f"SLOT:1 MAP:{map_id}"
+        assert slot.kwargs == {"qos": 1, "retain": True}
+
+    def test_no_slots_without_tick_frame(self, engine, monkeypatch):
+        monkeypatch.setattr(broker_main, "TICK_FRAME", False)
+        engine.db.cursor = lambda: _RowsCursor([
+            {"node_id": "utility_a", "parent_id": None, "secondary_parent_id": None},
+        ])
+        assert engine._load_known_nodes() == {"utility_a"}
+        assert engine._slots is None
+        client = MagicMock()
+        engine._on_mqtt_connect(client, None, None, 0)
+        assert not [c for c in client.publish.call_args_list if c.args[0].endswith("/slot")]
+
+    @pytest.mark.parametrize("tick", [False, True])
+    def test_fleet_larger_than_a_frame_still_loads(self, engine, monkeypatch, caplog, tick):
+        # loadgen --blocks 11 and up: more than 255 nodes.
+        monkeypatch.setattr(broker_main, "TICK_FRAME", tick)
+        rows = [{"node_id": f"server_rack_x{i}", "parent_id": None, "secondary_parent_id": None}
+                for i in range(300)]
+        engine.db.cursor = lambda: _RowsCursor(rows)
+        assert len(engine._load_known_nodes()) == 300
+        assert len(engine._load_known_nodes()) == 300
+        assert engine._slots is None
+        warned = [r for r in caplog.records if "Tick frame off" in r.getMessage()]
+        assert len(warned) == (1 if tick else 0)
+
+        engine.mqtt_client = MagicMock()
+        engine._load = {"controls": 0}
+        engine._publish_control({"server_rack_x1": "INPUT:480.0", "server_rack_x2": "INPUT:0.0"})
+        topics = [c.args[0] for c in engine.mqtt_client.publish.call_args_list]
+        assert topics == ["winter-river/server_rack_x1/control", "winter-river/server_rack_x2/control"]
+
+    def test_connect_before_load_publishes_nothing(self, engine):
+        client = MagicMock()
+        engine._on_mqtt_connect(client, None, None, 0)
+        client.publish.assert_not_called()
+
+
+# ── status cascade → fleet telemetry burst (firmware wr_rate.h) ───────────────
+
+class TestCascade:
+    @staticmethod
+    def _tick(engine, statuses):
+        return engine._cascade({nid: {"status_msg": s} for nid, s in statuses.items()})
+
+    def test_first_tick_is_no_cascade(self, engine):
+        engine._prev_status = None
+        assert not self._tick(engine, {"a": "OFF", "b": "OFF", "c": "OFF"})
+
+    def test_cascade_needs_enough_changes(self, engine):
+        engine._prev_status = None
+        base = {"a": "NORMAL", "b": "NORMAL", "c": "NORMAL", "d": "NORMAL"}
+        self._tick(engine, base)
+        assert not self._tick(engine, {**base, "a": "OFF", "b": "OFF"})
+        assert self._tick(engine, {"a": "OFF", "b": "ON_BATTERY", "c": "OFF", "d": "OFF"})
+        assert not self._tick(engine, {"a": "OFF", "b": "ON_BATTERY", "c": "OFF", "d": "OFF"})
+
+
 # ── on_message — MQTT ingestion ───────────────────────────────────────────────
 
 class _FakeCursor:
@@ -450,6 +550,14 @@ def ingest_engine():
     eng._thermal_cfg = ThermalConfig()
     eng._cooling_fans = {"cooling_a": 55, "cooling_b": 55}
     eng._known_nodes = {"utility_a", "cooling_a", "cooling_b", "ups_a"}
+    eng._known_loaded_at = float("-inf")
+    eng._unknown_nodes = set()
+    eng._bin_echo = {}
+    eng._control_latency = ControlLatency(clock=lambda: 1000)
+    eng._link_loss = LinkLoss()
+    eng._load = {"ingested": 0, "rejected": 0, "controls": 0,
+                 "ticks": 0, "tick_overruns": 0}
+    eng.mqtt_client = MagicMock()
     eng._exec_log = []
 
     eng.db = MagicMock()
@@ -458,7 +566,7 @@ def ingest_engine():
 
 
 class TestOnMessage:
-    @pytest.mark.parametrize("node_id", ["facility", "weather"])
+    @pytest.mark.parametrize("node_id", ["facility", "weather", "broker"])
     def test_virtual_status_messages_bypass_db_validation(self, ingest_engine, node_id):
         msg = _make_msg(f"winter-river/{node_id}/status", '{"status":"ONLINE"}')
         ingest_engine.on_message(None, None, msg)
@@ -473,6 +581,43 @@ class TestOnMessage:
         assert len(sqls) == 1 and "SELECT" in sqls[0]
         ingest_engine.db.commit.assert_not_called()
 
+    def test_unknown_node_reload_is_rate_limited(self, ingest_engine, monkeypatch, caplog):
+        # An unprovisioned board publishes as <type>_<mac> at telemetry rate.
+        clock = [1000.0]
+        monkeypatch.setattr(broker_main.time, "monotonic", lambda: clock[0])
+        rows = [{"node_id": nid, "parent_id": None, "secondary_parent_id": None}
+                for nid in sorted(ingest_engine._known_nodes)]
+        loads = []
+
+        def cursor():
+            loads.append(clock[0])
+            return _RowsCursor(rows)
+
+        ingest_engine.db.cursor = cursor
+        msg = _make_msg("winter-river/ups_3c61a0b2c4d8/status", '{"status":"ONLINE"}')
+        for _ in range(50):
+            ingest_engine.on_message(None, None, msg)
+        assert loads == [1000.0]
+        assert ingest_engine._load["rejected"] == 50
+        warned = [r for r in caplog.records if "unknown node_id" in r.getMessage()]
+        assert len(warned) == 1
+
+        clock[0] += broker_main.UNKNOWN_NODE_RELOAD_SEC - 1
+        ingest_engine.on_message(None, None, msg)
+        assert len(loads) == 1
+        clock[0] += 1
+        ingest_engine.on_message(None, None, msg)
+        assert len(loads) == 2
+        assert len([r for r in caplog.records if "unknown node_id" in r.getMessage()]) == 1
+
+        # Provisioned and seeded mid-session: taken on the next reload.
+        rows.append({"node_id": "ups_3c61a0b2c4d8", "parent_id": None, "secondary_parent_id": None})
+        clock[0] += broker_main.UNKNOWN_NODE_RELOAD_SEC
+        ingest_engine.on_message(None, None, msg)
+        assert "ups_3c61a0b2c4d8" in ingest_engine._known_nodes
+        assert ingest_engine._unknown_nodes == set()
+        assert ingest_engine._load["rejected"] == 52
+
     def test_malformed_json_defaults_to_online(self, ingest_engine):
         msg = _make_msg("winter-river/utility_a/status", b"\xff not-json")
         ingest_engine.on_message(None, None, msg)
@@ -505,6 +650,130 @@ class TestOnMessage:
         )
         assert ingest_engine._cooling_fans["cooling_b"] == 0
 
+    def test_binary_telemetry_is_decoded_and_republished_as_json(self, ingest_engine):
+        packed = telemetry_codec.encode(
+            "UPS",
+            {"battery_pct": 72, "load_pct": 40, "input_v": 0.0, "output_v": 480.0,
+             "state": "ON_BATTERY", "voltage": 480},
+            ts_ms=1760612345678, ts_err_us=840,
+        )
+        ingest_engine.on_message(
+            None, None, _make_msg("winter-river/ups_a/status/bin", packed)
+        )
+        update = next(p for s, p in ingest_engine._exec_log if "UPDATE live_status" in s)
+        assert update == (True, "ON_BATTERY", "ups_a")
+        metrics = next(p for s, p in ingest_engine._exec_log if "historical_data" in s)[1]
+        assert json.loads(metrics)["battery_pct"] == 72
+
+        topic, raw = ingest_engine.mqtt_client.publish.call_args.args
+        assert topic == "winter-river/ups_a/status"
+        assert raw == metrics.encode()
+        assert ingest_engine.mqtt_client.publish.call_args.kwargs["retain"] is True
+
+    def test_republished_json_echo_is_not_ingested_twice(self, ingest_engine):
+        packed = telemetry_codec.encode(
+            "UPS",
+            {"battery_pct": 72, "load_pct": 40, "input_v": 0.0, "output_v": 480.0,
+             "state": "ON_BATTERY", "voltage": 480},
+        )
+        ingest_engine.on_message(
+            None, None, _make_msg("winter-river/ups_a/status/bin", packed)
+        )
+        writes = len(ingest_engine._exec_log)
+        _, raw = ingest_engine.mqtt_client.publish.call_args.args
+        ingest_engine.on_message(None, None, _make_msg("winter-river/ups_a/status", raw))
+        assert len(ingest_engine._exec_log) == writes
+
+        # A genuine JSON message from the same node (e.g. its LWT) still lands.
+        ingest_engine.on_message(
+            None, None, _make_msg("winter-river/ups_a/status", '{"status":"OFFLINE"}')
+        )
+        assert len(ingest_engine._exec_log) > writes
+
+    def test_malformed_binary_telemetry_is_dropped(self, ingest_engine):
+        ingest_engine.on_message(
+            None, None, _make_msg("winter-river/ups_a/status/bin", b"\xa5\x09\x07")
+        )
+        assert ingest_engine._exec_log == []
+        ingest_engine.mqtt_client.publish.assert_not_called()
+
+    def test_backfill_batch_is_one_bulk_insert_at_record_times(self, ingest_engine):
+        ups = {"battery_pct": 72, "load_pct": 40, "input_v": 0.0, "output_v": 480.0,
+               "state": "ON_BATTERY", "voltage": 480}
+        batch = telemetry_codec.encode_batch([
+            telemetry_codec.encode("UPS", ups, ts_ms=1760612345000 + 5000 * i, seq=10 + i)
+            for i in range(3)
+        ] + [telemetry_codec.encode("UPS", ups, ts_ms=0, seq=13)])   # no clock: skipped
+        ingest_engine.on_message(
+            None, None, _make_msg("winter-river/ups_a/backfill", batch)
+        )
+        inserts = [(s, p) for s, p in ingest_engine._exec_log if "historical_data" in s]
+        assert len(inserts) == 1
+        sql, params = inserts[0]
+        assert sql.count("to_timestamp(%s)") == 3
+        assert params[0::3] == ["ups_a"] * 3
+        assert params[1::3] == [1760612345.0, 1760612350.0, 1760612355.0]
+        assert [json.loads(m)["seq"] for m in params[2::3]] == [10, 11, 12]
+        assert not any("live_status" in s for s, _ in ingest_engine._exec_log)
+        ingest_engine.mqtt_client.publish.assert_not_called()
+        ingest_engine.db.commit.assert_called_once()
+        assert ingest_engine._load["ingested"] == 3
+        assert ingest_engine._load["rejected"] == 1
+
+    def test_backfill_fills_the_live_sequence_gap(self, ingest_engine):
+        ups = {"battery_pct": 72, "load_pct": 40, "input_v": 0.0, "output_v": 480.0,
+               "state": "ON_BATTERY", "voltage": 480}
+        for seq in (1, 60):
+            ingest_engine.on_message(None, None, _make_msg(
+                "winter-river/ups_a/status/bin",
+                telemetry_codec.encode("UPS", ups, ts_ms=1760612345000, seq=seq)))
+        batch = telemetry_codec.encode_batch([
+            telemetry_codec.encode("UPS", ups, ts_ms=1760612345000, seq=seq)
+            for seq in range(2, 60)
+        ])
+        ingest_engine.on_message(None, None, _make_msg("winter-river/ups_a/backfill", batch))
+        row = ingest_engine._link_loss.report()["ups_a"]
+        assert (row["telemetry_rx"], row["telemetry_lost"]) == (60, 0)
+        assert row["telemetry_reord"] == 58
+
+    def test_backfill_from_unknown_node_is_rejected(self, ingest_engine):
+        ingest_engine.on_message(
+            None, None, _make_msg("winter-river/ghost/backfill", b"\x01\xa5")
+        )
+        assert not any("historical_data" in s for s, _ in ingest_engine._exec_log)
+        assert ingest_engine._load["rejected"] == 1
+
+    def test_control_echo_feeds_latency_histograms(self, ingest_engine):
+        cmd = ingest_engine._control_latency.stamp("ups_a", "STATUS:NORMAL")
+        assert cmd == "STATUS:NORMAL SEQ:1 T:1000"
+        payload = json.dumps({"state": "NORMAL", "ctl_seq": 1, "ctl_t": 1000,
+                              "ctl_apply_us": 500, "ctl_age_ms": 0})
+        ingest_engine.on_message(
+            None, None, _make_msg("winter-river/ups_a/status", payload)
+        )
+        ingest_engine._latency_reported_at = -broker_main.LATENCY_REPORT_SEC
+        ingest_engine.mqtt_client.reset_mock()
+        ingest_engine._publish_control_latency()
+        topic, raw = ingest_engine.mqtt_client.publish.call_args.args
+        assert topic == "winter-river/ups_a/latency"
+        assert json.loads(raw)["n"] == 1
+        assert ingest_engine.mqtt_client.publish.call_args.kwargs["retain"] is True
+
+    def test_telemetry_gaps_are_published_as_loss(self, ingest_engine):
+        for seq in (1, 2, 4):
+            payload = json.dumps({"state": "NORMAL", "seq": seq})
+            ingest_engine.on_message(
+                None, None, _make_msg("winter-river/ups_a/status", payload)
+            )
+        ingest_engine._loss_reported_at = -broker_main.LOSS_REPORT_SEC
+        ingest_engine.mqtt_client.reset_mock()
+        ingest_engine._publish_link_loss()
+        topic, raw = ingest_engine.mqtt_client.publish.call_args.args
+        assert topic == "winter-river/ups_a/loss"
+        row = json.loads(raw)
+        assert (row["telemetry_rx"], row["telemetry_lost"]) == (3, 1)
+        assert ingest_engine._link_loss.summary()["telemetry_loss_pct"] == 25.0
+
     def test_db_error_triggers_rollback(self, ingest_engine):
         # First execute (the FK pre-check) raises — must hit the except / rollback.
         boom = MagicMock()
@@ -517,6 +786,56 @@ class TestOnMessage:
         )
         ingest_engine.db.rollback.assert_called_once()
 
+    def test_load_counters_track_ingest_and_rejects(self, ingest_engine):
+        ok = _make_msg("winter-river/ups_a/status", '{"state":"NORMAL"}')
+        ingest_engine.on_message(None, None, ok)
+        ingest_engine.on_message(None, None, ok)
+        ingest_engine.on_message(
+            None, None, _make_msg("winter-river/ghost/status", '{"status":"ONLINE"}')
+        )
+        assert ingest_engine._load["ingested"] == 2
+        assert ingest_engine._load["rejected"] == 1
+
+    def test_control_goes_per_node_without_tick_frame(self, ingest_engine):
+        ingest_engine._slots = tick_frame.SlotMap(ingest_engine._known_nodes)
+        ingest_engine._publish_control({"ups_a": "STATUS:NORMAL", "cooling_a": "OPEN"})
+        topics = [c.args[0] for c in ingest_engine.mqtt_client.publish.call_args_list]
+        assert topics == ["winter-river/ups_a/control", "winter-river/cooling_a/control"]
+        assert ingest_engine._load["controls"] == 2
+
+    def test_tick_frame_carries_every_node(self, ingest_engine, monkeypatch):
+        monkeypatch.setattr(broker_main, "TICK_FRAME", True)
+        ingest_engine._slots = tick_frame.SlotMap(ingest_engine._known_nodes)
+        ingest_engine._tick_seq = 0
+        for _ in range(2):
+            ingest_engine._publish_control({"ups_a": "STATUS:NORMAL", "cooling_a": "OPEN"})
+        pub = ingest_engine.mqtt_client.publish
+        assert pub.call_count == 2
+        topic, frame = pub.call_args.args
+        assert topic == "winter-river/tick"
+        tick, map_id, texts = tick_frame.decode(frame)
+        assert (tick, map_id) == (2, ingest_engine._slots.map_id)
+        assert dict(zip(ingest_engine._slots.ids, texts)) == {
+            "cooling_a": "OPEN", "cooling_b": "", "ups_a": "STATUS:NORMAL", "utility_a": ""}
+        assert ingest_engine._load["controls"] == 4
+
+    def test_oversize_tick_frame_falls_back_to_per_node(self, ingest_engine, monkeypatch):
+        monkeypatch.setattr(broker_main, "TICK_FRAME", True)
+        ingest_engine._slots = tick_frame.SlotMap(ingest_engine._known_nodes)
+        ingest_engine._tick_seq = 0
+        ingest_engine._publish_control({"ups_a": "X" * tick_frame.MAX_BYTES})
+        assert ingest_engine.mqtt_client.publish.call_args.args[0] == "winter-river/ups_a/control"
+        assert ingest_engine._tick_seq == 0
+
+    def test_broker_status_counts_tick_overruns(self, ingest_engine):
+        ingest_engine._publish_broker_status(0.05)
+        ingest_engine._publish_broker_status(broker_main.TICK_RATE + 0.5)
+        topic, raw = ingest_engine.mqtt_client.publish.call_args.args
+        assert topic == broker_main.BROKER_STATUS_TOPIC
+        status = json.loads(raw)
+        assert status["ticks"] == 2 and status["tick_overruns"] == 1
+        assert status["tick_ms"] == round((broker_main.TICK_RATE + 0.5) * 1000, 1)
+
 
 # ── weather MQTT control ──────────────────────────────────────────────────────
 
@@ -573,6 +892,8 @@ class TestWeatherStartup:
         constructed_engine._on_mqtt_connect(client, None, None, 0)
         subscribed = [c.args[0] for c in client.subscribe.call_args_list]
         assert "winter-river/+/status" in subscribed
+        assert "winter-river/+/status/bin" in subscribed
+        assert "winter-river/+/backfill" in subscribed
         assert "winter-river/weather/control" in subscribed
 
     def test_on_connect_failure_subscribes_nothing(self, constructed_engine):
@@ -681,8 +1002,8 @@ class TestWeatherControl:
 # ── module-level smoke ────────────────────────────────────────────────────────
 
 def test_module_loads_with_seeded_config():
-    """conftest copies config.sample.toml → config.toml when missing, so just
-    re-importing should never raise. Guards against accidental drift between
+    """conftest points WINTER_RIVER_CONFIG at a copy of config.sample.toml, so
+    importing should never raise. Guards against accidental drift between
     sample and the keys main.py reads (mqtt.broker_host, database.dsn, etc.).
     """
     assert hasattr(broker_main, "WinterRiverEngine")
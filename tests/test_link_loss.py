@@ -0,0 +1,176 @@
+"""Unit tests for broker/link_loss.py.
+
+SeqTracker mirrors the firmware's wr_seq.h and the control counters are
+named by wr_telemetry.h, so the first test greps those headers. The rest
+drive the tracker and LinkLoss with hand-built payloads, and run the
+firmware's own tracker (esp32-nodes/check/wrseq.cpp, built with the system
+compiler) over the same streams.
+"""
+
+import os
+import random
+import subprocess
+
+import pytest
+
+import link_loss as ll
+
+REPO_ROOT = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+
+WR_SRC = os.path.join(REPO_ROOT, "esp32-nodes", "lib", "winter_river", "src")
+
+
+def _feed(seqs):
+    t = ll.SeqTracker()
+    return t, [t.observe(s) for s in seqs]
+
+
+def test_firmware_speaks_the_same_fields_and_window():
+    with open(os.path.join(WR_SRC, "wr_telemetry.h")) as f:
+        telemetry = f.read()
+    with open(os.path.join(WR_SRC, "wr_seq.h")) as f:
+        seq = f.read()
+    for name in ll.CONTROL_FIELDS + ("seq",):
+        assert f'"{name}"' in telemetry
+    assert f"WINDOW = {ll.WINDOW};" in seq
+
+
+class TestSeqTracker:
+    def test_in_order(self):
+        t, kinds = _feed([1, 2, 3])
+        assert kinds == ["first", "in_order", "in_order"]
+        assert t.counters() == (3, 0, 0, 0)
+
+    def test_gap_then_late_arrival_is_a_reorder_not_a_loss(self):
+        t, kinds = _feed([1, 2, 5, 3])
+        assert kinds[2:] == ["gap", "reordered"]
+        assert t.counters() == (4, 1, 0, 1)
+
+    def test_duplicate(self):
+        t, kinds = _feed([1, 2, 3, 2])
+        assert kinds[-1] == "duplicate"
+        assert t.counters() == (3, 0, 1, 0)
+
+    def test_gap_wider_than_the_window(self):
+        t, _ = _feed([1, 2, 100, 99])
+        assert t.counters() == (4, 96, 0, 1)
+
+    @pytest.mark.parametrize("restart", [1, 2])
+    def test_sender_restart(self, restart):
+        t, kinds = _feed([50, 51, 52, 100, restart])
+        assert kinds[-1] == "restart"
+        assert t.restarts == 1
+        assert t.observe(restart + 1) == "in_order"
+
+    def test_first_number_owes_nothing_below_it(self):
+        t, kinds = _feed([500, 499])
+        assert kinds == ["first", "duplicate"]
+        assert t.lost == 0
+
+
+def _stream(seed, n=400):
+    """A lossy, duplicating, reordering sender with the odd restart."""
+    rng = random.Random(seed)
+    out, seq = [], 0
+    for _ in range(n):
+        r = rng.random()
+        if r < 0.01:
+            seq = rng.randrange(1, 5)                           # reboot
+        elif r < 0.1:
+            seq += rng.randrange(2, 45)                         # a burst lost, some past the window
+        else:
+            seq += 1
+        out.append(seq)
+        if rng.random() < 0.1:
+            out.append(max(1, seq - rng.randrange(0, 40)))      # late or repeated
+    return out
+
+
+@pytest.mark.parametrize("seqs", [
+    [1, 2, 3], [1, 2, 5, 3], [1, 2, 3, 2], [1, 2, 100, 99], [50, 51, 52, 100, 1, 2],
+    [500, 499], [40, 8, 9, 41],
+] + [_stream(seed) for seed in range(6)])
+def test_firmware_tracker_matches(host_check, seqs):
+    exe = host_check("wrseq")
+    r = subprocess.run([exe], input=" ".join(map(str, seqs)), capture_output=True, text=True,
+                       check=True)
+    t, kinds = _feed(seqs)
+    rx, lost, dup, reord = t.counters()
+    assert r.stdout.splitlines() == kinds + [
+        f"rx={rx} lost={lost} dup={dup} reord={reord} restarts={t.restarts}"]
+
+
+def _ctl(rx, lost=0, dup=0, reord=0):
+    return {"ctl_rx": rx, "ctl_lost": lost, "ctl_dup": dup, "ctl_reord": reord}
+
+
+class TestLinkLoss:
+    def test_telemetry_window(self):
+        loss = ll.LinkLoss()
+        for seq in (1, 2, 3, 5):
+            loss.observe("ups_a", {"seq": seq})
+        row = loss.report()["ups_a"]
+        assert row["telemetry_rx"] == 4 and row["telemetry_lost"] == 1
+        assert row["telemetry_loss_pct"] == 20.0
+        assert loss.report() == {}
+
+    def test_control_counters_are_deltas_from_the_first_payload(self):
+        loss = ll.LinkLoss()
+        loss.observe("ups_a", _ctl(1000, lost=7))          # baseline
+        loss.observe("ups_a", _ctl(1090, lost=17))
+        row = loss.report()["ups_a"]
+        assert (row["control_rx"], row["control_lost"]) == (90, 10)
+        assert row["control_loss_pct"] == 10.0
+        assert "telemetry_rx" not in row
+
+    def test_node_reboot_restarts_the_control_counters(self):
+        loss = ll.LinkLoss()
+        loss.observe("ups_a", _ctl(1000))
+        loss.observe("ups_a", _ctl(5, lost=1))
+        assert loss.report()["ups_a"]["control_rx"] == 5
+
+    def test_summary_is_fleet_wide(self):
+        loss = ll.LinkLoss()
+        assert loss.summary() == {"telemetry_loss_pct": None, "control_loss_pct": None}
+        for seq in (1, 3):
+            loss.observe("ups_a", {"seq": seq})
+        for seq in (1, 2):
+            loss.observe("ups_b", {"seq": seq})
+        loss.report()
+        assert loss.summary()["telemetry_loss_pct"] == 20.0
+
+    def test_payloads_without_numbers_are_ignored(self):
+        loss = ll.LinkLoss()
+        loss.observe("ups_a", {"status": "OFFLINE"})
+        loss.observe("ups_a", {"seq": True, "ctl_rx": "x"})
+        assert loss.report() == {}
+
+
+class TestBackfill:
+    def test_outage_records_fill_the_gap_however_long(self):
+        loss = ll.LinkLoss()
+        for seq in (1, 2, 100):
+            loss.observe("ups_a", {"seq": seq})
+        for seq in range(3, 100):
+            loss.backfilled("ups_a", seq)
+        row = loss.report()["ups_a"]
+        assert (row["telemetry_rx"], row["telemetry_lost"], row["telemetry_reord"]) == (100, 0, 97)
+
+    def test_backfill_before_the_first_live_payload(self):
+        loss = ll.LinkLoss()
+        loss.observe("ups_a", {"seq": 1})
+        for seq in (2, 3):
+            loss.backfilled("ups_a", seq)
+        loss.observe("ups_a", {"seq": 4})
+        row = loss.report()["ups_a"]
+        assert (row["telemetry_rx"], row["telemetry_lost"]) == (4, 0)
+
+    def test_resent_records_are_not_counted_twice(self):
+        loss = ll.LinkLoss()
+        for seq in (1, 100):
+            loss.observe("ups_a", {"seq": seq})
+        for seq in list(range(2, 100)) + [5, 98]:
+            loss.backfilled("ups_a", seq)
+        row = loss.report()["ups_a"]
+        assert (row["telemetry_rx"], row["telemetry_lost"]) == (100, 0)
+        assert row["telemetry_dup"] == 1                  # 98 is still in the window
@@ -0,0 +1,19 @@
+"""Host tests for the firmware's non-blocking MQTT client (wr::AsyncMqtt,
+esp32-nodes/lib/winter_river/src/wr_mqtt.h).
+
+esp32-nodes/check/wrmqtt.cpp plays the broker on a loopback socket and
+scripts each case byte by byte; see its header for what each one covers.
+"""
+
+import subprocess
+
+import pytest
+
+CASES = ["framing", "split", "coalesced", "window", "keepalive", "refused", "malformed"]
+
+
+@pytest.mark.parametrize("case", CASES)
+def test_async_mqtt(host_check, case):
+    exe = host_check("wrmqtt", "-DWR_MQTT_ASYNC=1")
+    r = subprocess.run([exe, case], capture_output=True, text=True, timeout=30)
+    assert r.returncode == 0, r.stdout + r.stderr
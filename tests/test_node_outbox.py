@@ -0,0 +1,41 @@
+"""Host test of a node's telemetry through the dual-core outbox
+(esp32-nodes/lib/winter_river/src/wr_node.h, wr_mailbox.h).
+
+esp32-nodes/check/wrnode.cpp builds the cooling node, the largest payload
+in the fleet, with WR_DUAL_CORE and every field at its widest, keeps
+backfill records through the wr_sim → wr_net queue (wr_backfill.h) and
+applies control messages to its fields; see its header for the paths it
+drives.
+"""
+
+import re
+import subprocess
+
+import pytest
+
+
+def test_largest_payload_reaches_the_mqtt_client(host_check):
+    r = subprocess.run([host_check("wrnode")], capture_output=True, text=True, timeout=30)
+    assert r.returncode == 0, r.stdout + r.stderr
+    m = re.search(r"len=(\d+) bound=(\d+) slot=(\d+)", r.stdout)
+    length, bound, slot = map(int, m.groups())
+    assert length < bound <= slot
+
+
+@pytest.mark.parametrize("kept, ring, dropped", [(20, 20, 0), (40, 32, 8)])
+def test_records_kept_while_wr_net_is_busy_are_queued(host_check, kept, ring, dropped):
+    # Up to WR_BACKFILL_QUEUE (32) records wait for wr_net in order; past
+    # that they are counted as dropped, never silently replaced.
+    r = subprocess.run([host_check("wrnode"), "backfill", str(kept)], capture_output=True,
+                       text=True, timeout=30)
+    assert r.returncode == 0, r.stdout + r.stderr
+    assert f"kept={kept} ring={ring} dropped={dropped}" in r.stdout
+
+
+@pytest.mark.parametrize("tokens, speed", [("SPEED:75", 75), ("FT_RRFF:75", 60)])
+def test_field_control_matches_the_keyword_text(host_check, tokens, speed):
+    # "FT_RRFF" has SPEED's FNV-1a hash; the node default speed is 60.
+    r = subprocess.run([host_check("wrnode"), "control", tokens], capture_output=True,
+                       text=True, timeout=30)
+    assert r.returncode == 0, r.stdout + r.stderr
+    assert f"speed={speed}" in r.stdout
@@ -0,0 +1,171 @@
+"""Unit tests for broker/ota.py.
+
+The topics, tokens and states are a contract with the firmware's wr_ota.h,
+so the first test greps that header for them. The rest drive ImageStore and
+Orchestrator with a temporary store, a fake clock and a recording publish.
+"""
+
+import os
+import re
+
+import pytest
+
+import ota
+import ota_delta
+
+REPO_ROOT = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+
+WR_SRC = os.path.join(REPO_ROOT, "esp32-nodes", "lib", "winter_river", "src")
+
+OLD = bytes(range(256)) * 64
+NEW = OLD[:5000] + b"patched" + OLD[5007:]
+
+
+class Clock:
+    def __init__(self):
+        self.t = 1000.0
+
+    def __call__(self):
+        return self.t
+
+
+@pytest.fixture
+def store(tmp_path):
+    s = ota.ImageStore(str(tmp_path))
+    for node_id in ("ups_a", "ups_b", "cooling_a"):
+        s.record(node_id, OLD)
+        s.record(node_id, NEW)
+    return s
+
+
+def _orch(store, nodes, **kw):
+    sent = []
+    clock = Clock()
+    o = ota.Orchestrator(store, lambda t, p: sent.append((t, p)), "http://pi:8070", nodes,
+                         clock=clock, **kw)
+    return o, sent, clock
+
+
+def _tokens(payload):
+    return dict(t.split(":", 1) for t in payload.split())
+
+
+def test_firmware_contract():
+    with open(os.path.join(WR_SRC, "wr_ota.h")) as f:
+        src = f.read()
+    assert '"winter-river/%s/ota"' in src
+    assert '"winter-river/%s/ota/status"' in src
+    for token in ("URL", "TARGET"):
+        assert f'kw("{token}")' in src
+    for state in ("DOWNLOADING", "REBOOTING", "TRIAL", "CONFIRMED", "ROLLED_BACK", "FAILED"):
+        assert f'"{state}"' in src
+    assert ota.COMMAND_TOPIC.format("x") == "winter-river/x/ota"
+
+
+def test_store_record_and_target(store):
+    assert store.target("ups_a") == ota.crc_hex(NEW)
+    assert store.image("ups_a", ota.crc_hex(OLD)) == OLD
+    assert store.nodes() == ["cooling_a", "ups_a", "ups_b"]
+    with pytest.raises(ValueError):
+        store.record("../etc", NEW)
+
+
+def test_store_delta_cached_and_served(store):
+    old, new = ota.crc_hex(OLD), ota.crc_hex(NEW)
+    name = store.delta_name("ups_a", old, new)
+    assert name == f"{old}-{new}.wrd"
+    path = store.path(f"/ups_a/{name}")
+    with open(path, "rb") as f:
+        assert ota_delta.apply(OLD, f.read()) == NEW
+    assert store.path("/ups_a/../../x.wrd") is None
+    assert store.path(f"/ups_b/{name}") is None          # not built for that node
+
+
+def test_unknown_base_gets_full_image(store):
+    new = ota.crc_hex(NEW)
+    assert store.delta_name("ups_a", None, new) == f"00000000-{new}.wrd"
+    assert store.delta_name("ups_a", "deadbeef", new) == f"00000000-{new}.wrd"
+
+
+def test_command_format(store):
+    o, sent, _ = _orch(store, ["ups_a"])
+    o.on_status("ups_a", {"state": "IDLE", "image": ota.crc_hex(OLD), "size": len(OLD)})
+    o.step()
+    topic, payload = sent[0]
+    assert topic == "winter-river/ups_a/ota"
+    tok = _tokens(payload)
+    assert tok["TARGET"] == ota.crc_hex(NEW)
+    assert re.fullmatch(r"http://pi:8070/ups_a/[0-9a-f]{8}-[0-9a-f]{8}\.wrd", tok["URL"])
+    assert o.result["ups_a"] == "sent"
+    assert o.detail["ups_a"] == "delta"
+
+
+def test_parallel_limit(store):
+    o, sent, _ = _orch(store, ["ups_a", "ups_b", "cooling_a"], parallel=2)
+    for n in ("ups_a", "ups_b", "cooling_a"):
+        o.on_status(n, {"state": "IDLE", "image": ota.crc_hex(OLD)})
+    o.step()
+    assert len(sent) == 2
+    o.on_status("cooling_a", {"state": "CONFIRMED", "image": ota.crc_hex(NEW)})
+    o.step()
+    assert len(sent) == 3
+
+
+def test_success_needs_target_image(store):
+    o, _, _ = _orch(store, ["ups_a"])
+    o.on_status("ups_a", {"state": "IDLE", "image": ota.crc_hex(OLD)})
+    o.step()
+    o.on_status("ups_a", {"state": "DOWNLOADING", "image": ota.crc_hex(OLD), "pct": 40})
+    assert o.detail["ups_a"] == "40%"
+    o.on_status("ups_a", {"state": "IDLE", "image": ota.crc_hex(OLD)})   # not it yet
+    assert o.result["ups_a"] == "sent"
+    o.on_status("ups_a", {"state": "TRIAL", "image": ota.crc_hex(NEW)})
+    assert o.result["ups_a"] == "sent"
+    o.on_status("ups_a", {"state": "CONFIRMED", "image": ota.crc_hex(NEW)})
+    assert o.result["ups_a"] == "ok"
+    assert o.step() is True
+
+
+def test_failures(store):
+    o, _, clock = _orch(store, ["ups_a", "ups_b", "cooling_a"], timeout=60)
+    for n in ("ups_a", "ups_b", "cooling_a"):
+        o.on_status(n, {"state": "IDLE", "image": ota.crc_hex(OLD)})
+    o.step()
+    o.on_status("ups_a", {"state": "FAILED", "image": ota.crc_hex(OLD), "error": "BASE_MISMATCH"})
+    o.on_status("ups_b", {"state": "ROLLED_BACK", "image": ota.crc_hex(OLD)})
+    clock.t += 61
+    assert o.step() is True
+    assert o.summary() == {"failed": ["ups_a"], "rolled_back": ["ups_b"], "timeout": ["cooling_a"]}
+    assert o.detail["ups_a"] == "BASE_MISMATCH"
+
+
+def test_already_on_target_not_sent(store):
+    o, sent, _ = _orch(store, ["ups_a"])
+    o.on_status("ups_a", {"state": "IDLE", "image": ota.crc_hex(NEW)})
+    assert o.step() is True
+    assert sent == []
+    assert o.result["ups_a"] == "ok"
+
+
+def test_silent_node_gets_full_image_after_discovery(store):
+    o, sent, clock = _orch(store, ["ups_a"], discover=5)
+    o.step()
+    assert sent == []                                      # its retained status may still come
+    clock.t += 5
+    o.step()
+    assert "/00000000-" in _tokens(sent[0][1])["URL"]
+    assert o.detail["ups_a"] == "full image"
+
+
+def test_unrecorded_node_fails(store):
+    o, sent, _ = _orch(store, ["generator_a"])
+    assert o.step() is True
+    assert o.result["generator_a"] == "failed"
+    assert sent == []
+
+
+def test_board_envs():
+    envs = ota.board_envs(os.path.join(REPO_ROOT, "esp32-nodes"))
+    assert len(envs) == 24
+    assert envs["server_rack_b4"] == "server_rack_b4"
+    assert "native" not in envs
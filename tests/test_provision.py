@@ -0,0 +1,120 @@
+"""Unit tests for broker/provision.py.
+
+The topics and tokens are a contract with the firmware's wr_identity.h, so
+the first test greps that header for them. The rest check the message
+format, MAC handling and roster validation, and publishing through a
+recording client.
+"""
+
+import json
+import os
+
+import pytest
+
+import provision
+
+REPO_ROOT = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+
+WR_SRC = os.path.join(REPO_ROOT, "esp32-nodes", "lib", "winter_river", "src")
+
+KNOWN = {"server_rack_b3": "rack_b3", "ups_a": "ups_a"}
+
+
+def test_firmware_contract():
+    with open(os.path.join(WR_SRC, "wr_identity.h")) as f:
+        src = f.read()
+    assert '"winter-river/provision/%s"' in src
+    assert '"winter-river/%s/identity"' in src
+    for token in ("ID", "LABEL"):
+        assert f'kw("{token}")' in src
+    for source in ("BUILD", "NVS", "UNPROVISIONED"):
+        assert f'"{source}"' in src
+    assert provision.PROVISION_TOPIC.format("a1b2c3d4e5f6") == "winter-river/provision/a1b2c3d4e5f6"
+
+
+def test_message_format():
+    assert provision.build_message("server_rack_b3", "rack_b3") == "ID:server_rack_b3 LABEL:rack_b3"
+
+
+@pytest.mark.parametrize("mac", ["a1b2c3d4e5f6", "A1:B2:C3:D4:E5:F6", "a1-b2-c3-d4-e5-f6"])
+def test_normalize_mac(mac):
+    assert provision.normalize_mac(mac) == "a1b2c3d4e5f6"
+
+
+@pytest.mark.parametrize("mac", ["", "a1b2c3d4e5", "a1b2c3d4e5f6a7", "g1b2c3d4e5f6"])
+def test_bad_mac_rejected(mac):
+    with pytest.raises(ValueError):
+        provision.normalize_mac(mac)
+
+
+def test_plan_uses_roster_labels():
+    rows = provision.plan({"A1:B2:C3:D4:E5:F6": "server_rack_b3", "a1b2c3d4e5f7": "ups_a"}, KNOWN)
+    assert rows == [("a1b2c3d4e5f6", "server_rack_b3", "rack_b3"),
+                    ("a1b2c3d4e5f7", "ups_a", "ups_a")]
+
+
+def test_plan_rejects_unknown_and_duplicate_ids():
+    with pytest.raises(ValueError, match="unknown"):
+        provision.plan({"a1b2c3d4e5f6": "server_rack_z9"}, KNOWN)
+    with pytest.raises(ValueError, match="both"):
+        provision.plan({"a1b2c3d4e5f6": "ups_a", "a1b2c3d4e5f7": "ups_a"}, KNOWN)
+
+
+def test_roster_labels():
+    labels = provision.labels(os.path.join(REPO_ROOT, "esp32-nodes"))
+    assert len(labels) == 24
+    assert labels["server_rack_b4"] == "rack_b4"
+
+
+def test_parse_report():
+    report = {"mac": "a1b2c3d4e5f6", "type": "SERVER_RACK", "label": "rack_b3", "source": "NVS"}
+    assert provision.parse_report("winter-river/server_rack_b3/identity",
+                                  json.dumps(report).encode()) == ("server_rack_b3", report)
+    assert provision.parse_report("winter-river/server_rack_b3/identity", b"") is None   # cleared
+    assert provision.parse_report("winter-river/server_rack_b3/identity", b"{bad") is None
+
+
+class _Info:
+    def wait_for_publish(self):
+        pass
+
+
+class _Client:
+    def __init__(self):
+        self.sent = []
+
+    def publish(self, topic, payload, qos=0, retain=False):
+        self.sent.append((topic, payload, qos, retain))
+        return _Info()
+
+    def loop_stop(self):
+        pass
+
+
+@pytest.fixture
+def client(monkeypatch):
+    c = _Client()
+    monkeypatch.setattr(provision, "_client", lambda args: c)
+    return c
+
+
+def test_set_publishes_retained(client):
+    assert provision.main(["set", "A1:B2:C3:D4:E5:F6", "server_rack_b4"]) == 0
+    assert client.sent == [("winter-river/provision/a1b2c3d4e5f6",
+                            "ID:server_rack_b4 LABEL:rack_b4", 1, True)]
+
+
+def test_set_unknown_node_sends_nothing(client):
+    assert provision.main(["set", "a1b2c3d4e5f6", "server_rack_z9"]) == 1
+    assert client.sent == []
+
+
+def test_apply_and_clear(client, tmp_path):
+    cfg = tmp_path / "config.toml"
+    cfg.write_text('[provision]\na1b2c3d4e5f6 = "utility_a"\na1b2c3d4e5f7 = "ups_b"\n')
+    assert provision.main(["apply", "--config", str(cfg)]) == 0
+    assert [s[0] for s in client.sent] == ["winter-river/provision/a1b2c3d4e5f6",
+                                           "winter-river/provision/a1b2c3d4e5f7"]
+    assert all(s[2:] == (1, True) for s in client.sent)
+    assert provision.main(["clear", "a1b2c3d4e5f6"]) == 0
+    assert client.sent[-1] == ("winter-river/provision/a1b2c3d4e5f6", b"", 1, True)
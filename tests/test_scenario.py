@@ -0,0 +1,315 @@
+"""Unit tests for broker/scenario.py.
+
+The program layout and limits are a contract with the firmware's
+wr_scenario.h, so the first test greps that header for them. The rest check
+the parser, the encoding against a hand-built program, the node-side checks
+the compiler mirrors, and the drills shipped in broker/scenarios/. The last
+ones run compiled programs on the firmware's own interpreter
+(esp32-nodes/check/wrscenario.cpp, built with the system compiler) and check
+the timeline it applies.
+"""
+
+import glob
+import os
+import struct
+import subprocess
+
+import pytest
+
+import provision
+import scenario as sc
+
+REPO_ROOT = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+
+WR_SRC = os.path.join(REPO_ROOT, "esp32-nodes", "lib", "winter_river", "src")
+
+SCENARIOS = sorted(glob.glob(os.path.join(REPO_ROOT, "broker", "scenarios", "*.scn")))
+
+
+def test_firmware_contract():
+    with open(os.path.join(WR_SRC, "wr_scenario.h")) as f:
+        src = f.read()
+    assert f"MAGIC = 0x{sc.MAGIC:02X};" in src
+    assert f"VERSION = {sc.VERSION};" in src
+    assert f"HEADER_BYTES = {struct.calcsize('<BBHq')};" in src
+    assert f"REPEAT_DEPTH = {sc.REPEAT_DEPTH};" in src
+    assert f"TEXT_MAX = {sc.TEXT_MAX};" in src
+    assert f"KEY_MAX = {sc.KEY_MAX};" in src
+    assert f"MAX_LEAD_MS = {sc.MAX_LEAD_MS};" in src
+    assert f"#define WR_SCENARIO_BYTES {sc.MAX_BYTES}" in src
+    assert f"tail[14] > {sc.MAX_DECIMALS}" in src
+    assert '"winter-river/%s/scenario"' in src
+    assert '"winter-river/%s/scenario/status"' in src
+    ops = {"SET": sc.SET, "WAIT": sc.WAIT, "RAMP": sc.RAMP, "REPEAT": sc.REPEAT, "END": sc.END}
+    for name, code in ops.items():
+        assert f"{name} = 0x{code:02X}" in src
+
+
+@pytest.mark.parametrize("text,ms", [
+    ("250ms", 250), ("2s", 2000), ("1.5s", 1500), ("2m", 120000), ("750", 750), ("0", 0),
+])
+def test_parse_duration(text, ms):
+    assert sc.parse_duration(text) == ms
+
+
+@pytest.mark.parametrize("text", ["", "2h", "-1s", "0.5ms", "5000000s"])
+def test_parse_duration_rejects(text):
+    with pytest.raises(ValueError):
+        sc.parse_duration(text)
+
+
+def test_parse_blocks_and_ops():
+    programs = sc.parse("""
+        # comment
+        node ups_a ups_b            # same program for both
+          set STATUS:ON_BATTERY BATT:80
+          repeat forever
+            ramp BATT 80 20.5 10s every 1s
+            wait 2s
+          end
+
+        node utility_a
+          wait 1.5s
+    """)
+    assert set(programs) == {"ups_a", "ups_b", "utility_a"}
+    assert programs["ups_a"] is programs["ups_b"]
+    assert programs["ups_a"] == [
+        ("set", "STATUS:ON_BATTERY BATT:80"),
+        ("repeat", 0),
+        ("ramp", "BATT", 80.0, 20.5, 10000, 1000, 1),
+        ("wait", 2000),
+        ("end",),
+    ]
+    assert programs["utility_a"] == [("wait", 1500)]
+
+
+def test_assemble_layout():
+    ops = [("set", "OPEN"), ("repeat", 2), ("ramp", "FREQ", 60.0, 59.5, 4000, 500, 2),
+           ("wait", 100), ("end",)]
+    code = (bytes([0x01, 4]) + b"OPEN"
+            + struct.pack("<BH", 0x04, 2)
+            + bytes([0x03, 4]) + b"FREQ" + struct.pack("<ffIHB", 60.0, 59.5, 4000, 500, 2)
+            + struct.pack("<BI", 0x02, 100)
+            + bytes([0x05]))
+    payload = sc.assemble(ops, start_ms=1_700_000_000_123)
+    assert payload == struct.pack("<BBHq", 0xA7, 1, len(code), 1_700_000_000_123) + code
+    start, lines = sc.disassemble(payload)
+    assert start == 1_700_000_000_123
+    assert lines == ["set OPEN", "repeat 2", "  ramp FREQ 60.00 59.50 4000ms every 500ms",
+                     "  wait 100ms", "end"]
+
+
+def test_duration():
+    assert sc.duration_ms([("wait", 100), ("repeat", 3), ("wait", 50),
+                           ("ramp", "A", 0, 1, 200, 10, 0), ("end",)]) == 850
+    assert sc.duration_ms([("repeat", 0), ("wait", 1), ("end",)]) is None
+
+
+@pytest.mark.parametrize("text,line", [
+    ("set A:1\n", 1),                                      # before a node block
+    ("node x\n  jump 3\n", 2),
+    ("node x\n  set\n", 2),
+    ("node x\n  set " + "A" * 64 + "\n", 2),
+    ("node x\n  wait\n", 2),
+    ("node x\n  ramp temp 1 2 1s\n", 2),                   # key not a token
+    ("node x\n  ramp TEMP 1 2 0s\n", 2),
+    ("node x\n  ramp TEMP 1 2 1s every 0\n", 2),
+    ("node x\n  ramp TEMP 1 2 1s by 5\n", 2),
+    ("node x\n  ramp TEMP 1 1e9 1s\n", 2),
+    ("node x\n  repeat 0\n  wait 1\n  end\n", 2),
+    ("node x\n  end\n", 2),
+    ("node x\n" + "  repeat 2\n" * 5, 6),
+    ("node x\n  repeat 2\nnode y\n", 3),
+    ("node x\nnode x\n", 2),
+    ("node x\n  repeat 2\n  wait 1\n", 0),
+    ("# nothing\n", 0),
+])
+def test_parse_errors(text, line):
+    with pytest.raises(sc.ScenarioError) as exc:
+        sc.parse(text)
+    assert exc.value.line == line
+
+
+def test_repeat_body_must_take_time():
+    # The node would spin on it (wr_scenario.h ZERO_LOOP).
+    with pytest.raises(sc.ScenarioError):
+        sc.compile_text("node x\n  repeat 3\n    set OPEN\n    wait 0\n  end\n")
+    sc.compile_text("node x\n  repeat 3\n    repeat 2\n      wait 1\n    end\n  end\n")
+
+
+def test_program_size_limit():
+    text = "node x\n" + "  set STATUS:OUTAGE VOLT:0\n  wait 1s\n" * 20
+    with pytest.raises(sc.ScenarioError):
+        sc.compile_text(text)
+
+
+@pytest.mark.parametrize("payload", [
+    b"",
+    struct.pack("<BBHq", 0xA6, 1, 0, 0),                    # tick frame magic
+    struct.pack("<BBHq", 0xA7, 1, 3, 0) + b"\x02\x00",      # length mismatch
+    struct.pack("<BBHq", 0xA7, 1, 3, 0) + b"\x02\x00\x00",  # WAIT cut short
+    struct.pack("<BBHq", 0xA7, 1, 1, 0) + b"\x09",          # unknown op
+    struct.pack("<BBHq", 0xA7, 1, 3, 0) + b"\x04\x02\x00",  # REPEAT without END
+])
+def test_disassemble_rejects_malformed(payload):
+    with pytest.raises(ValueError):
+        sc.disassemble(payload)
+
+
+def test_program_id_is_crc32():
+    assert sc.program_id(b"123456789") == "cbf43926"
+
+
+@pytest.mark.parametrize("path", SCENARIOS, ids=os.path.basename)
+def test_shipped_scenarios(path):
+    with open(path) as f:
+        programs = sc.parse(f.read())
+    known = provision.labels(os.path.join(REPO_ROOT, "esp32-nodes"))
+    assert set(programs) <= set(known)
+    for ops in programs.values():
+        payload = sc.assemble(ops, start_ms=2 ** 41)
+        assert len(payload) <= sc.MAX_BYTES
+        assert sc.parse("node x\n" + "\n".join(sc.disassemble(payload)[1]))["x"] == ops
+
+
+# wr_scenario.h Scenario::Error, in order.
+ERRORS = ["NONE", "TOO_LONG", "HEADER", "TRUNCATED", "BAD_OP", "NESTING", "ZERO_LOOP", "RAMP",
+          "START"]
+
+
+def _f32(x):
+    return struct.unpack("<f", struct.pack("<f", x))[0]
+
+
+def _timeline(ops, until=600_000):
+    """[(ms, control text)] the node should apply, on time: the semantics
+    wr_scenario.h documents, with its float32 ramp arithmetic."""
+    out, t, pc, stack = [], 0, 0, []
+    while pc < len(ops) and t < until:
+        op = ops[pc]
+        if op[0] == "set":
+            out.append((t, op[1]))
+        elif op[0] == "wait":
+            t += op[1]
+        elif op[0] == "ramp":
+            _, key, lo, hi, ms, step, dec = op
+            lo, hi = _f32(lo), _f32(hi)
+            for k in range(ms // step + 1):
+                if k * step >= ms:
+                    break
+                v = _f32(lo + _f32(_f32(_f32(hi - lo) * _f32(k * step)) / _f32(ms)))
+                out.append((t + k * step, f"{key}:{v:.{dec}f}"))
+            out.append((t + ms, f"{key}:{hi:.{dec}f}"))
+            t += ms
+        elif op[0] == "repeat":
+            stack.append([pc, op[1]])
+        elif op[0] == "end":
+            top = stack[-1]
+            if top[1] != 1:                      # 0 = forever
+                top[1] = max(top[1] - 1, 0)
+                pc = top[0] + 1
+                continue
+            stack.pop()
+        pc += 1
+    return out
+
+
+def _node_run(host_check, tmp_path, payload, *args):
+    """Run `payload` on wr::Scenario. Returns ([(ms, text)], final state line)."""
+    path = tmp_path / "program.bin"
+    path.write_bytes(payload)
+    r = subprocess.run([host_check("wrscenario"), str(path), *map(str, args)],
+                       capture_output=True, text=True, timeout=30)
+    assert r.returncode == 0, r.stdout + r.stderr
+    *lines, state = r.stdout.splitlines()
+    return [(int(ms), text) for ms, text in (line.split(" ", 1) for line in lines)], state
+
+
+def _state(payload, state, error="NONE", late=0):
+    return (f"state={state} error={ERRORS.index(error)} late_ms={late} "
+            f"program={sc.program_id(payload) if error != 'TOO_LONG' else '00000000'}")
+
+
+def test_firmware_runs_the_timeline(host_check, tmp_path):
+    payload = sc.compile_text("""
+        node x
+          set STATUS:OUTAGE VOLT:0
+          repeat 2
+            wait 400ms
+            set OPEN
+          end
+          ramp FREQ 60.0 58.0 1s every 250ms
+          wait 1.5s
+          ramp TEMP 20 30 1s every 300ms
+          set STATUS:GRID_OK
+    """)["x"]
+    lines, state = _node_run(host_check, tmp_path, payload)
+    assert lines == [
+        (0, "STATUS:OUTAGE VOLT:0"), (400, "OPEN"), (800, "OPEN"),
+        (800, "FREQ:60.0"), (1050, "FREQ:59.5"), (1300, "FREQ:59.0"), (1550, "FREQ:58.5"),
+        (1800, "FREQ:58.0"),
+        (3300, "TEMP:20"), (3600, "TEMP:23"), (3900, "TEMP:26"), (4200, "TEMP:29"),
+        (4300, "TEMP:30"), (4300, "STATUS:GRID_OK"),
+    ]
+    assert state == _state(payload, "DONE")
+
+
+@pytest.mark.parametrize("path", SCENARIOS, ids=os.path.basename)
+def test_firmware_runs_shipped_scenarios(host_check, tmp_path, path):
+    with open(path) as f:
+        programs = sc.parse(f.read())
+    for ops in programs.values():
+        payload = sc.assemble(ops)
+        lines, state = _node_run(host_check, tmp_path, payload)
+        assert lines == _timeline(ops)
+        assert state == _state(payload, "DONE")
+
+
+def test_firmware_late_wakeups_do_not_shift_the_program(host_check, tmp_path):
+    # A busy simulation task wakes late: ramp steps it overslept are skipped,
+    # but every deadline stays where it was, so no op is later than one wakeup.
+    ops = sc.parse("""
+        node x
+          repeat 3
+            set STATUS:OUTAGE
+            wait 700ms
+            ramp FREQ 60.0 58.0 2s every 100ms
+            set STATUS:GRID_OK
+            wait 1s
+          end
+    """)["x"]
+    payload = sc.assemble(ops)
+    lines, state = _node_run(host_check, tmp_path, payload, "--late", 150)
+    expected = iter(_timeline(ops))
+    for ms, text in lines:                       # an in-order subsequence, each at most 150 ms late
+        due = next(t for t, want in expected if want == text)
+        assert due <= ms <= due + 150, (ms, text)
+    sets = [text for _, text in _timeline(ops) if not text.startswith("FREQ")]
+    assert [text for _, text in lines if not text.startswith("FREQ")] == sets
+    assert state.startswith("state=DONE ")
+    assert 0 < int(state.split("late_ms=")[1].split()[0]) <= 150
+
+
+def test_firmware_stops_on_an_empty_message(host_check, tmp_path):
+    ops = sc.parse("node x\n  repeat forever\n    set OPEN\n    wait 1s\n  end\n")["x"]
+    payload = sc.assemble(ops)
+    lines, state = _node_run(host_check, tmp_path, payload, "--stop-at", 2500)
+    assert lines == [(0, "OPEN"), (1000, "OPEN"), (2000, "OPEN")]
+    assert state == _state(payload, "STOPPED")
+
+
+@pytest.mark.parametrize("payload,error", [
+    (struct.pack("<BBHq", 0xA6, 1, 0, 0), "HEADER"),                       # tick frame magic
+    (struct.pack("<BBHq", 0xA7, 1, 3, 0) + b"\x02\x00", "HEADER"),        # length mismatch
+    (struct.pack("<BBHq", 0xA7, 1, 3, 0) + b"\x02\x00\x00", "TRUNCATED"),
+    (struct.pack("<BBHq", 0xA7, 1, 1, 0) + b"\x09", "BAD_OP"),
+    (struct.pack("<BBHq", 0xA7, 1, 3, 0) + b"\x04\x02\x00", "NESTING"),
+    (struct.pack("<BBHq", 0xA7, 1, 10, 0) + b"\x04\x02\x00\x01\x04OPEN\x05", "ZERO_LOOP"),
+    (struct.pack("<BBHq", 0xA7, 1, 21, 0) + b"\x03\x04FREQ"
+     + struct.pack("<ffIHB", 60.0, 59.0, 1000, 0, 1), "RAMP"),               # step 0
+    (bytes(sc.MAX_BYTES + 1), "TOO_LONG"),
+])
+def test_firmware_rejects_what_the_compiler_would_not_emit(host_check, tmp_path, payload, error):
+    lines, state = _node_run(host_check, tmp_path, payload)
+    assert lines == []
+    assert state == _state(payload, "REJECTED", error)
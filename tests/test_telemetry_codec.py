@@ -0,0 +1,221 @@
+"""Unit tests for broker/telemetry_codec.py.
+
+The codec's schema tables are a hand-kept mirror of the firmware's
+wr_schema.h / wr_state.h, so the first group of tests parses those headers
+and fails on any drift. The rest round-trip every node type against the
+JSON payload its firmware would have produced.
+"""
+
+import json
+import os
+import re
+import struct
+
+import pytest
+
+import telemetry_codec as codec
+
+REPO_ROOT = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+
+WR_SRC = os.path.join(REPO_ROOT, "esp32-nodes", "lib", "winter_river", "src")
+
+
+def _read(name):
+    with open(os.path.join(WR_SRC, name)) as f:
+        return f.read()
+
+
+# Firmware-shaped sample per node type (field order = node's JSON order).
+SAMPLES = {
+    "UTILITY": {"v_out": 230.0, "freq_hz": 60.0, "load_pct": 12, "state": "GRID_OK",
+                "voltage_kv": 230.0, "phase": 3},
+    "HV_MV_TRANSFORMER": {"input_kv": 230.0, "output_kv": 35, "load_pct": 35,
+                          "power_mva": 17.5, "temp_f": 105, "state": "NORMAL",
+                          "voltage": 35000},
+    "MV_SWITCHGEAR": {"breaker": True, "current_a": 116.0, "load_kw": 4000.0,
+                      "load_pct": 25, "state": "CLOSED", "voltage": 34500},
+    "MV_LV_TRANSFORMER": {"load_pct": 45, "power_kva": 450.0, "temp_f": 112,
+                          "state": "NORMAL", "voltage": 480},
+    "LV_SWITCHGEAR": {"breaker": False, "current_a": 625.0, "load_kw": 300.0,
+                      "load_pct": 30, "state": "GENERATOR", "voltage": 480},
+    "GENERATOR": {"fuel_pct": 85, "rpm": 1800, "output_v": 480.0, "load_pct": 0,
+                  "state": "RUNNING", "voltage": 480},
+    "UPS": {"battery_pct": 72, "load_pct": 40, "input_v": 0.0, "output_v": 480.0,
+            "state": "ON_BATTERY", "voltage": 480},
+    "COOLING": {"input_v": 480.0, "coolant_temp_f": 65, "fan_speed_pct": 60,
+                "fan_count": 55, "fans_running": 55, "load_pct": 60,
+                "state": "DEGRADED", "voltage": 480},
+    "SERVER_RACK": {"cpu_pct": 42, "inlet_f": 75, "power_kw": 3.2, "units": 8,
+                    "state": "NORMAL", "voltage": 48},
+}
+
+
+TS_MS = 1760612345678
+SEQ   = 8123
+
+
+def _firmware_json(fields, ts_ms=TS_MS, ts_err_us=840, seq=SEQ):
+    """Byte-for-byte what wr::JsonWriter emits (compact separators)."""
+    stamp = {"ts": codec.format_ts_ms(ts_ms), "ts_ms": ts_ms, "ts_err_us": ts_err_us,
+             "seq": seq}
+    return json.dumps({**stamp, **fields}, separators=(",", ":")).encode()
+
+
+# ── schema drift vs. firmware headers ─────────────────────────────────────────
+
+class TestSchemaMatchesFirmware:
+    def test_magic_and_version(self):
+        src = _read("wr_schema.h")
+        assert int(re.search(r"MAGIC\s*=\s*(0x[0-9A-Fa-f]+)", src).group(1), 16) == codec.MAGIC
+        assert int(re.search(r"VERSION\s*=\s*(\d+)", src).group(1)) == codec.VERSION
+        header = int(re.search(r"HEADER_BYTES\s*=\s*(\d+)", src).group(1))
+        assert header == struct.calcsize(codec._HEADERS[codec.VERSION])
+
+    def test_field_tables(self):
+        src = _read("wr_schema.h")
+        tables = {
+            m.group(1): re.findall(r'\{"(\w+)",\s*Kind::(\w+)\}', m.group(2))
+            for m in re.finditer(r"Field (\w+)_FIELDS\[\] = \{(.*?)\n\};", src, re.S)
+        }
+        ids = {t: int(i) for i, t in re.findall(r"WR_SCHEMA\((\d+), (\w+)\)", src)}
+
+        assert ids == codec.TYPE_IDS
+        for tid, (ntype, fields) in codec.SCHEMAS.items():
+            assert [tuple(f) for f in tables[ntype]] == list(fields), ntype
+
+    def test_state_codes(self):
+        src = _read("wr_state.h")
+        names = re.findall(r'X\((\w+),\s*"(\w+)"', src)
+        assert tuple(wire for _, wire in names) == codec.STATES
+
+
+# ── round trip ────────────────────────────────────────────────────────────────
+
+class TestRoundTrip:
+    @pytest.mark.parametrize("ntype", sorted(SAMPLES))
+    def test_decode_matches_firmware_json(self, ntype):
+        packed = codec.encode(ntype, SAMPLES[ntype], ts_ms=TS_MS, ts_err_us=840, seq=SEQ)
+        assert codec.decode(packed) == json.loads(_firmware_json(SAMPLES[ntype]))
+        assert codec.node_type(packed) == ntype
+
+    @pytest.mark.parametrize("ntype", sorted(SAMPLES))
+    def test_at_least_4x_smaller_than_json(self, ntype):
+        packed = codec.encode(ntype, SAMPLES[ntype], ts_ms=TS_MS, ts_err_us=840, seq=SEQ)
+        assert len(_firmware_json(SAMPLES[ntype])) >= 4 * len(packed)
+
+    def test_decoded_json_keeps_field_order(self):
+        packed = codec.encode("UPS", SAMPLES["UPS"], ts_ms=TS_MS, ts_err_us=840, seq=SEQ)
+        assert json.dumps(codec.decode(packed), separators=(",", ":")).encode() == \
+            _firmware_json(SAMPLES["UPS"])
+
+    def test_unset_clock(self):
+        packed = codec.encode("SERVER_RACK", SAMPLES["SERVER_RACK"])
+        out = codec.decode(packed)
+        assert (out["ts"], out["ts_ms"], out["ts_err_us"]) == ("--:--:--", 0, None)
+
+    def test_error_bound_saturates(self):
+        packed = codec.encode("SERVER_RACK", SAMPLES["SERVER_RACK"], ts_ms=TS_MS, ts_err_us=10 ** 6)
+        assert codec.decode(packed)["ts_err_us"] == codec.TS_ERR_UNSET - 1
+
+    def test_version_2_still_decodes(self):
+        v3 = codec.encode("UPS", SAMPLES["UPS"], ts_ms=TS_MS, ts_err_us=840)
+        v2 = struct.pack("<BBBIHH", codec.MAGIC, 2, codec.TYPE_IDS["UPS"],
+                         TS_MS & 0xFFFFFFFF, TS_MS >> 32, 840) + \
+            v3[struct.calcsize(codec._HEADERS[3]):]
+        out = codec.decode(v2)
+        assert "seq" not in out and out["ts_ms"] == TS_MS
+        assert {k: out[k] for k in SAMPLES["UPS"]} == SAMPLES["UPS"]
+
+    def test_version_1_still_decodes(self):
+        v3 = codec.encode("UPS", SAMPLES["UPS"])
+        v1 = struct.pack("<BBBHB", codec.MAGIC, 1, codec.TYPE_IDS["UPS"], 45296 & 0xFFFF, 0) + \
+            v3[struct.calcsize(codec._HEADERS[3]):]
+        assert codec.decode(v1) == {"ts": "12:34:56", **SAMPLES["UPS"]}
+
+    def test_non_finite_float_decodes_to_null(self):
+        fields = dict(SAMPLES["SERVER_RACK"], power_kw=None, inlet_f=None)
+        out = codec.decode(codec.encode("SERVER_RACK", fields))
+        assert out["power_kw"] is None and out["inlet_f"] is None
+
+    def test_out_of_range_values_saturate(self):
+        fields = dict(SAMPLES["UPS"], battery_pct=300, input_v=-99999.0)
+        out = codec.decode(codec.encode("UPS", fields))
+        assert out["battery_pct"] == 255
+        assert out["input_v"] == -3276.7
+
+    def test_halves_round_away_from_zero_like_firmware(self):
+        fields = dict(SAMPLES["SERVER_RACK"], power_kw=0.25, inlet_f=-2.5)
+        out = codec.decode(codec.encode("SERVER_RACK", fields))
+        assert out["power_kw"] == 0.3 and out["inlet_f"] == -3
+
+
+# ── malformed input ───────────────────────────────────────────────────────────
+
+class TestRejects:
+    def _good(self):
+        return bytearray(codec.encode("UPS", SAMPLES["UPS"]))
+
+    def test_json_is_not_binary(self):
+        assert not codec.is_binary(b'{"ts":"--:--:--"}')
+        assert codec.is_binary(bytes(self._good()))
+
+    def test_bad_magic(self):
+        buf = self._good(); buf[0] = ord("{")
+        with pytest.raises(ValueError, match="magic"):
+            codec.decode(bytes(buf))
+
+    def test_future_version(self):
+        buf = self._good(); buf[1] = codec.VERSION + 1
+        with pytest.raises(ValueError, match="version"):
+            codec.decode(bytes(buf))
+
+    def test_unknown_type(self):
+        buf = self._good(); buf[2] = 200
+        with pytest.raises(ValueError, match="type id"):
+            codec.decode(bytes(buf))
+
+    def test_length_mismatch(self):
+        with pytest.raises(ValueError, match="expects"):
+            codec.decode(bytes(self._good()) + b"\x00")
+
+    def test_short(self):
+        with pytest.raises(ValueError, match="short"):
+            codec.decode(b"\xa5\x01")
+
+    def test_bad_state_code(self):
+        buf = self._good(); buf[-3] = 250      # state byte precedes u16 voltage
+        with pytest.raises(ValueError, match="state"):
+            codec.decode(bytes(buf))
+
+
+# ── backfill batches ──────────────────────────────────────────────────────────
+
+class TestBackfillBatch:
+    def _records(self, n=3):
+        return [codec.encode("UPS", SAMPLES["UPS"], ts_ms=TS_MS + 5000 * i, seq=SEQ + i)
+                for i in range(n)]
+
+    def test_firmware_slot_holds_every_type(self):
+        src = _read("wr_backfill.h")
+        assert '"winter-river/%s/backfill"' in src
+        slot = int(re.search(r"BACKFILL_SLOT\s*=\s*(\d+)", src).group(1))
+        longest = max(codec._DECODERS[(codec.VERSION, tid)][0].size for tid in codec.SCHEMAS)
+        assert longest + 1 <= slot
+
+    def test_round_trip(self):
+        records, bad = codec.decode_batch(codec.encode_batch(self._records()))
+        assert bad == 0
+        assert [r["seq"] for r in records] == [SEQ, SEQ + 1, SEQ + 2]
+        assert records[2]["ts_ms"] == TS_MS + 10000
+
+    def test_bad_record_is_skipped(self):
+        recs = self._records()
+        recs[1] = b"\xa5\x09" + recs[1][2:]                    # unsupported version
+        records, bad = codec.decode_batch(codec.encode_batch(recs))
+        assert (len(records), bad) == (2, 1)
+
+    def test_truncated_batch_ends_at_the_damage(self):
+        batch = codec.encode_batch(self._records())
+        records, bad = codec.decode_batch(batch[:-4])
+        assert (len(records), bad) == (2, 1)
+        assert codec.decode_batch(b"") == ([], 0)
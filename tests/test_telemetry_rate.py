@@ -0,0 +1,72 @@
+"""Host tests for the firmware's runtime telemetry rate (wr::TelemetryRate,
+esp32-nodes/lib/winter_river/src/wr_rate.h) and the RATE: / BURST: control
+tokens the broker sends it (wr::handleCommonToken(), wr_telemetry.h).
+
+esp32-nodes/check/wrrate.cpp delivers control messages at set virtual times
+and prints every telemetry tick.
+"""
+
+import subprocess
+
+import main as broker_main
+
+TELEMETRY_INTERVAL_MS = 5000   # the node default (winter_river.h)
+RATE_MIN_MS = 100
+RATE_MAX_MS = 15000
+BURST_INTERVAL_MS = 250
+
+
+def _run(host_check, script, until):
+    r = subprocess.run([host_check("wrrate"), "--until", str(until)], input=script,
+                       capture_output=True, text=True, timeout=30)
+    assert r.returncode == 0, r.stdout + r.stderr
+    ticks, ctl = [], []
+    for line in r.stdout.splitlines():
+        ms, kind, *rest = line.split()
+        if kind == "tick":
+            ticks.append(int(ms))
+        else:
+            ctl.append((int(ms), rest[0], int(rest[1].split("=")[1])))
+    return ticks, ctl
+
+
+def _gaps(ticks):
+    return [b - a for a, b in zip(ticks, ticks[1:])]
+
+
+def test_rate_sets_the_idle_interval(host_check):
+    ticks, ctl = _run(host_check, "0 RATE:2000\n", 10000)
+    assert ctl == [(0, "1", 2000)]
+    assert ticks == [2000, 4000, 6000, 8000, 10000]
+
+
+def test_rate_is_clamped(host_check):
+    ticks, ctl = _run(host_check, "0 RATE:60000\n1000 RATE:10\n2000 RATE:0\n", 2000)
+    assert [idle for _, _, idle in ctl] == [RATE_MAX_MS, RATE_MIN_MS, TELEMETRY_INTERVAL_MS]
+    # The slowest a node can be told to go still beats the broker's stale check.
+    assert RATE_MAX_MS < broker_main.STALE_NODE_THRESHOLD_SEC * 1000
+
+    ticks, _ = _run(host_check, "0 RATE:60000\n", 3 * RATE_MAX_MS)
+    assert _gaps(ticks) == [RATE_MAX_MS, RATE_MAX_MS]
+
+
+def test_burst_ticks_at_once_then_decays_back_to_idle(host_check):
+    ticks, ctl = _run(host_check, "0 RATE:2000\n10000 BURST:3000\n", 30000)
+    assert ctl[1] == (10000, "1", 2000)
+    assert 10000 in ticks
+    after = ticks[ticks.index(10000):]
+    gaps = _gaps(after)
+    # 3 s at the burst rate, then the interval doubles back to RATE:'s idle.
+    assert gaps[:14] == [BURST_INTERVAL_MS] * 12 + [500, 1000]
+    assert set(gaps[14:]) == {2000}
+
+
+def test_unknown_token_is_left_to_the_node(host_check):
+    _, ctl = _run(host_check, "0 RATE:1000 LOAD:5 BURST\n", 0)
+    assert ctl == [(0, "101", 1000)]
+
+
+def test_key_that_hashes_like_rate_is_not_rate(host_check):
+    # "UUVCFPC" has RATE's FNV-1a hash; only the key text tells them apart.
+    _, ctl = _run(host_check, "0 UUVCFPC:60000\n", 0)
+    assert ctl == [(0, "0", TELEMETRY_INTERVAL_MS)]
@@ -0,0 +1,156 @@
+"""Unit tests for broker/tick_frame.py.
+
+The frame layout and the slot tokens are a contract with the firmware's
+wr_tick.h, so the first test greps that header for them. The rest check the
+slot map, the encoding against a hand-built frame, and that a full fleet's
+control fits the node's buffer. The last ones hand encoded frames to the
+firmware's own receiver (esp32-nodes/check/wrtick.cpp, built with the system
+compiler) and check what each node's slot decodes to.
+"""
+
+import os
+import struct
+import subprocess
+
+import pytest
+
+import provision
+import tick_frame as tf
+
+REPO_ROOT = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+
+WR_SRC = os.path.join(REPO_ROOT, "esp32-nodes", "lib", "winter_river", "src")
+
+
+def test_firmware_contract():
+    with open(os.path.join(WR_SRC, "wr_tick.h")) as f:
+        src = f.read()
+    assert f"MAGIC = 0x{tf.MAGIC:02X};" in src
+    assert f"VERSION = {tf.VERSION};" in src
+    assert f"HEADER_BYTES = {struct.calcsize('<BBIIB')};" in src
+    assert f'"{tf.TOPIC}"' in src
+    assert '"winter-river/%s/slot"' in src
+    for token in ("SLOT", "MAP"):
+        assert f'kw("{token}")' in src
+    assert "TICK_FRAME_BYTES = 2048;" in src
+    assert tf.MAX_BYTES <= 2048 - 2 - len(tf.TOPIC) - 5   # topic + fixed header
+
+
+def test_slots_are_sorted_ids_and_map_follows_the_set():
+    m = tf.SlotMap({"ups_a", "cooling_a", "utility_a"})
+    assert m.ids == ["cooling_a", "ups_a", "utility_a"]
+    assert m.assignment("ups_a") == f"SLOT:1 MAP:{m.map_id}"
+    assert tf.SlotMap(["utility_a", "ups_a", "cooling_a"]).map_id == m.map_id
+    assert tf.SlotMap({"ups_a", "cooling_a"}).map_id != m.map_id
+
+
+def test_encode_layout():
+    m = tf.SlotMap({"a", "b", "c"})
+    frame = m.encode(7, {"a": "STATUS:NORMAL", "c": "OPEN"})
+    table = 11 + 2 * 3
+    assert frame == (struct.pack("<BBIIB", 0xA6, 1, 7, m.map_id, 3)
+                     + struct.pack("<HHH", table + 13, table + 13, table + 17)
+                     + b"STATUS:NORMALOPEN")
+    assert tf.decode(frame) == (7, m.map_id, ["STATUS:NORMAL", "", "OPEN"])
+
+
+def test_encode_rejects_unknown_node():
+    with pytest.raises(KeyError):
+        tf.SlotMap({"a"}).encode(1, {"b": "OPEN"})
+
+
+@pytest.mark.parametrize("frame", [
+    b"",
+    bytes([0xA5, 1]) + bytes(9),                          # binary telemetry magic
+    struct.pack("<BBIIB", 0xA6, 1, 1, 0, 2) + b"\x0f",    # truncated table
+    struct.pack("<BBIIBH", 0xA6, 1, 1, 0, 1, 40),         # slot past the end
+])
+def test_decode_rejects_malformed(frame):
+    with pytest.raises(ValueError):
+        tf.decode(frame)
+
+
+# Longest control string per node type (main.py _control_cmd), by id prefix.
+WORST = {
+    "generator":   "RPM:1800 STATUS:DE_ENERGIZED",
+    "ups":         "INPUT:480.0 BATT:100 STATUS:ON_BATTERY",
+    "cooling":     "INPUT:480.0 TEMP:100.0 SPEED:100 STATUS:DEGRADED",
+    "server_rack": "INPUT:480.0 STATUS:DE_ENERGIZED TEMP:100.0",
+}
+
+
+def test_full_fleet_fits():
+    ids = provision.labels(os.path.join(REPO_ROOT, "esp32-nodes"))
+    m = tf.SlotMap(ids)
+    commands = {}
+    for nid in ids:
+        if nid.startswith("utility"):
+            continue
+        body = next((v for k, v in WORST.items() if nid.startswith(k)), "CLOSE STATUS:DE_ENERGIZED")
+        commands[nid] = body + " BURST:10000 SEQ:99999999 T:2147483647"   # cascade tick
+    assert len(m.encode(2 ** 32 - 1, commands)) <= tf.MAX_BYTES
+
+
+def _node(host_check, node_id, messages):
+    """Run wr::TickFrame as `node_id` over [(topic, payload bytes)]. Returns
+    one (taken, tick, slot bytes or None) per message, and the counters."""
+    lines = "".join(f"{topic} {payload.hex() or '-'}\n" for topic, payload in messages)
+    r = subprocess.run([host_check("wrtick"), node_id], input=lines, capture_output=True,
+                       text=True)
+    assert r.returncode == 0, r.stdout + r.stderr
+    *rows, counters = r.stdout.splitlines()
+    out = []
+    for row in rows:
+        taken, tick, text = row.split()
+        out.append((taken == "1", int(tick), None if text == "-" else bytes.fromhex(text)))
+    return out, counters
+
+
+def _slot(m, nid):
+    return (tf.SLOT_TOPIC.format(nid), m.assignment(nid).encode())
+
+
+def test_firmware_takes_its_slot(host_check):
+    ids = provision.labels(os.path.join(REPO_ROOT, "esp32-nodes"))
+    m = tf.SlotMap(ids)
+    commands = {nid: f"STATUS:NORMAL SEQ:{i + 1} T:12345" for i, nid in enumerate(ids)
+                if not nid.startswith("utility")}
+    frame = m.encode(42, commands)
+    for nid in ids:
+        rows, counters = _node(host_check, nid, [_slot(m, nid), (tf.TOPIC, frame)])
+        assert rows[0] == (True, 0, None)                     # the assignment itself
+        text = commands.get(nid)
+        assert rows[1] == (True, 42, text.encode() if text else None), nid
+        assert counters == "frames=1 skipped=0 bad=0"
+
+
+def test_firmware_ignores_frames_it_cannot_use(host_check):
+    m = tf.SlotMap({"ups_a", "cooling_a", "utility_a"})
+    other = tf.SlotMap({"ups_a", "cooling_a", "utility_a", "ups_b"})
+    frame = m.encode(5, {"ups_a": "BATT:80"})
+    rows, counters = _node(host_check, "ups_a", [
+        (tf.TOPIC, frame),                                    # no assignment yet
+        _slot(m, "ups_a"),
+        (tf.TOPIC, other.encode(6, {"ups_a": "BATT:70"})),    # another slot map
+        ("winter-river/ups_a/control", b"BATT:60"),           # not the node's to route
+        (tf.TOPIC, b"\xa5" + frame[1:]),                      # not a tick frame
+        (tf.TOPIC, frame),
+        (tf.SLOT_TOPIC.format("ups_a"), b""),                 # retained assignment cleared
+        (tf.TOPIC, frame),
+    ])
+    assert rows == [(True, 0, None), (True, 0, None), (True, 0, None), (False, 0, b"BATT:60"),
+                    (True, 0, None), (True, 5, b"BATT:80"), (True, 5, None), (True, 5, None)]
+    assert counters == "frames=1 skipped=3 bad=1"
+
+
+def test_firmware_stays_inside_a_truncated_frame(host_check):
+    m = tf.SlotMap({"cooling_a", "ups_a", "utility_a"})
+    frame = m.encode(9, {"cooling_a": "SPEED:80", "ups_a": "BATT:80 STATUS:ON_BATTERY"})
+    cuts = [frame[:n] for n in range(len(frame))]
+    rows, counters = _node(host_check, "ups_a", [_slot(m, "ups_a")] + [(tf.TOPIC, c) for c in cuts])
+    # The node reads only its own slot (1): a frame cut after it still applies.
+    (end,) = struct.unpack_from("<H", frame, 11 + 2)
+    taken = [c for c in cuts if len(c) >= end]
+    assert [text for _, _, text in rows[1:]] == [
+        b"BATT:80 STATUS:ON_BATTERY" if len(c) >= end else None for c in cuts]
+    assert counters == f"frames={len(taken)} skipped=0 bad={len(cuts) - len(taken)}"
@@ -0,0 +1,118 @@
+"""Unit tests for broker/time_sync.py.
+
+The topics and tokens are a contract with the firmware's wr_time.h, so the
+first test greps that header for them. The rest drive TimeResponder with a
+fake clock and a mock MQTT client, and the firmware's own filter through
+esp32-nodes/check/wrtime.cpp.
+"""
+
+import os
+import re
+import subprocess
+from unittest.mock import MagicMock
+
+import pytest
+
+import time_sync as ts
+
+REPO_ROOT = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+
+WR_SRC = os.path.join(REPO_ROOT, "esp32-nodes", "lib", "winter_river", "src")
+
+
+class StepClock:
+    """Advances 40 µs per reading, so T3 > T2 like a real reply."""
+
+    def __init__(self, t=1760612345678000):
+        self.t = t
+
+    def __call__(self):
+        self.t += 40
+        return self.t
+
+
+def _msg(payload):
+    msg = MagicMock()
+    msg.topic = ts.REQUEST_TOPIC
+    msg.payload = payload.encode() if isinstance(payload, str) else payload
+    return msg
+
+
+def _tokens(reply):
+    return dict(t.split(":", 1) for t in reply.split())
+
+
+class TestFirmwareContract:
+    def test_topics_and_tokens_match_wr_time_h(self):
+        with open(os.path.join(WR_SRC, "wr_time.h")) as f:
+            src = f.read()
+        assert f'"{ts.REQUEST_TOPIC}"' in src
+        assert '"winter-river/%s/time"' in src
+        assert '"ID:%s N:%lu"' in src
+        for tok in ('kw("N")', 'kw("T2")', 'kw("T3")'):
+            assert tok in src
+
+
+class TestParse:
+    def test_request(self):
+        assert ts.parse_request(b"ID:ups_a N:42") == ("ups_a", 42)
+
+    @pytest.mark.parametrize("payload", [
+        b"", b"ID:ups_a", b"N:42", b"ID:ups_a N:x", b"ID:ups_a N:-1",
+        b"ID:+ N:1", b"ID:# N:1", b"ID:a/b N:1", b"\xff\xfe",
+    ])
+    def test_malformed_or_unsafe_requests_are_refused(self, payload):
+        assert ts.parse_request(payload) is None
+
+
+class TestResponder:
+    @pytest.fixture
+    def responder(self, monkeypatch):
+        monkeypatch.setattr(ts.mqtt, "Client", lambda *a, **k: MagicMock())
+        return ts.TimeResponder("localhost", 1883, clock=StepClock())
+
+    def test_replies_on_the_node_topic_with_both_stamps(self, responder):
+        client = MagicMock()
+        responder.on_message(client, None, _msg("ID:server_rack_a3 N:7"))
+        topic, reply = client.publish.call_args.args
+        assert topic == "winter-river/server_rack_a3/time"
+        tok = _tokens(reply)
+        assert tok["N"] == "7"
+        assert int(tok["T3"]) > int(tok["T2"]) > 1760612345678000
+        assert client.publish.call_args.kwargs.get("qos") == 0
+        assert responder.answered == 1
+
+    def test_malformed_request_gets_no_reply(self, responder):
+        client = MagicMock()
+        responder.on_message(client, None, _msg("hello"))
+        client.publish.assert_not_called()
+        assert responder.rejected == 1
+
+    def test_subscribes_on_connect_only(self, responder):
+        client = MagicMock()
+        responder._on_connect(client, None, None, 5)
+        client.subscribe.assert_not_called()
+        responder._on_connect(client, None, None, 0)
+        assert client.subscribe.call_args.args[0] == ts.REQUEST_TOPIC
+
+
+class TestFirmwareClock:
+    """wr::TimeSync against a simulated responder, on virtual time."""
+
+    @pytest.fixture
+    def wrtime(self, host_check):
+        try:
+            return host_check("wrtime", "-fsanitize=undefined", "-fno-sanitize-recover=undefined")
+        except subprocess.CalledProcessError:
+            pytest.skip("no UndefinedBehaviorSanitizer")
+
+    # 0, a 3 h NTP correction, and one whose µs × 1e9 wraps int64 to a
+    # plausible drift.
+    @pytest.mark.parametrize("step_us", [0, 3 * 3600 * 10**6, 18446744074])
+    def test_follows_a_pi_clock_step(self, wrtime, step_us):
+        r = subprocess.run([wrtime, str(step_us)], capture_output=True, text=True, timeout=60)
+        assert r.returncode == 0, r.stdout + r.stderr
+        before, after, outside = map(int, re.search(
+            r"before=(\d+) after=(\d+) outside=(\d+)", r.stdout).groups())
+        assert before <= 1 and after <= 1
+        assert outside == 0